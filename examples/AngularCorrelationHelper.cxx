@@ -2,27 +2,31 @@
 
 void AngularCorrelationHelper::CreateHistograms(unsigned int slot)
 {
-   // set up the queue for event mixing by filling it with empty events
-   // we chose 10 here as a reasonable compromise between statistics and computing power/memory needed
-   for(int i = 0; i < fNofMixedEvents; ++i) {
-      fGriffinDeque[slot].emplace_back(new TGriffin);
-      fBgoDeque[slot].emplace_back(new TGriffinBgo);
-   }
+   // the event-mixing buffer fMixing[slot] only stores the array number of each hit, its position is looked up from here
+   fPositions[slot].clear();
 
    std::string conditions = fAddback ? "using addback" : "without addback";
    conditions += fFolding ? ", folded around 90^{o}" : "";
    conditions += fGrouping ? ", grouped" : "";
 
-   for(auto angle = fAngles->begin(); angle != fAngles->end(); ++angle) {
-      int i                                           = std::distance(fAngles->begin(), angle);
-      fH2[slot][Form("AngularCorrelation%d", i)]      = new TH2D(Form("AngularCorrelation%d", i), Form("%.1f^{o}: Suppressed #gamma-#gamma %s, |#Deltat_{#gamma-#gamma}| < %.1f", *angle, conditions.c_str(), fPrompt), fBins, fMinEnergy, fMaxEnergy, fBins, fMinEnergy, fMaxEnergy);
-      fH2[slot][Form("AngularCorrelationBG%d", i)]    = new TH2D(Form("AngularCorrelationBG%d", i), Form("%.1f^{o}: Suppressed #gamma-#gamma %s, |#Deltat_{#gamma-#gamma}| = %.1f - %.1f", *angle, conditions.c_str(), fTimeRandomLow, fTimeRandomHigh), fBins, fMinEnergy, fMaxEnergy, fBins, fMinEnergy, fMaxEnergy);
-      fH2[slot][Form("AngularCorrelationMixed%d", i)] = new TH2D(Form("AngularCorrelationMixed%d", i), Form("%.1f^{o}: Event mixed suppressed #gamma-#gamma %s", *angle, conditions.c_str()), fBins, fMinEnergy, fMaxEnergy, fBins, fMinEnergy, fMaxEnergy);
-   }
-
-   fH2[slot]["AngularCorrelation"]      = new TH2D("AngularCorrelation", Form("Suppressed #gamma-#gamma %s, |#Deltat_{#gamma-#gamma}| < %.1f", conditions.c_str(), fPrompt), fBins, fMinEnergy, fMaxEnergy, fBins, fMinEnergy, fMaxEnergy);
-   fH2[slot]["AngularCorrelationBG"]    = new TH2D("AngularCorrelationBG", Form("Suppressed #gamma-#gamma %s, #Deltat_{#gamma-#gamma} = %.1f - %.1f", conditions.c_str(), fTimeRandomLow, fTimeRandomHigh), fBins, fMinEnergy, fMaxEnergy, fBins, fMinEnergy, fMaxEnergy);
-   fH2[slot]["AngularCorrelationMixed"] = new TH2D("AngularCorrelationMixed", Form("Event mixed suppressed #gamma-#gamma %s", conditions.c_str()), fBins, fMinEnergy, fMaxEnergy, fBins, fMinEnergy, fMaxEnergy);
+   // the histograms are declared with handles, so filling them doesn't need to look up (or build) their names
+   const auto nAngles = static_cast<size_t>(std::distance(fAngles->begin(), fAngles->end()));
+   fCorrelations      = fH2[slot].DeclareFamily(nAngles, [&](size_t i) {
+      std::string name = Form("AngularCorrelation%zu", i);
+      return std::make_pair(name, new TH2D(name.c_str(), Form("%.1f^{o}: Suppressed #gamma-#gamma %s, |#Deltat_{#gamma-#gamma}| < %.1f", *std::next(fAngles->begin(), i), conditions.c_str(), fPrompt), fBins, fMinEnergy, fMaxEnergy, fBins, fMinEnergy, fMaxEnergy));
+   });
+   fCorrelationsBG    = fH2[slot].DeclareFamily(nAngles, [&](size_t i) {
+      std::string name = Form("AngularCorrelationBG%zu", i);
+      return std::make_pair(name, new TH2D(name.c_str(), Form("%.1f^{o}: Suppressed #gamma-#gamma %s, |#Deltat_{#gamma-#gamma}| = %.1f - %.1f", *std::next(fAngles->begin(), i), conditions.c_str(), fTimeRandomLow, fTimeRandomHigh), fBins, fMinEnergy, fMaxEnergy, fBins, fMinEnergy, fMaxEnergy));
+   });
+   fCorrelationsMixed = fH2[slot].DeclareFamily(nAngles, [&](size_t i) {
+      std::string name = Form("AngularCorrelationMixed%zu", i);
+      return std::make_pair(name, new TH2D(name.c_str(), Form("%.1f^{o}: Event mixed suppressed #gamma-#gamma %s", *std::next(fAngles->begin(), i), conditions.c_str()), fBins, fMinEnergy, fMaxEnergy, fBins, fMinEnergy, fMaxEnergy));
+   });
+
+   fCorrelation      = fH2[slot].Declare("AngularCorrelation", new TH2D("AngularCorrelation", Form("Suppressed #gamma-#gamma %s, |#Deltat_{#gamma-#gamma}| < %.1f", conditions.c_str(), fPrompt), fBins, fMinEnergy, fMaxEnergy, fBins, fMinEnergy, fMaxEnergy));
+   fCorrelationBG    = fH2[slot].Declare("AngularCorrelationBG", new TH2D("AngularCorrelationBG", Form("Suppressed #gamma-#gamma %s, #Deltat_{#gamma-#gamma} = %.1f - %.1f", conditions.c_str(), fTimeRandomLow, fTimeRandomHigh), fBins, fMinEnergy, fMaxEnergy, fBins, fMinEnergy, fMaxEnergy));
+   fCorrelationMixed = fH2[slot].Declare("AngularCorrelationMixed", new TH2D("AngularCorrelationMixed", Form("Event mixed suppressed #gamma-#gamma %s", conditions.c_str()), fBins, fMinEnergy, fMaxEnergy, fBins, fMinEnergy, fMaxEnergy));
 
    // for the first slot we also write the griffin angles
    if(slot == 0) {
@@ -32,6 +36,7 @@ void AngularCorrelationHelper::CreateHistograms(unsigned int slot)
 
 void AngularCorrelationHelper::Exec(unsigned int slot, TGriffin& fGriffin, TGriffinBgo& fGriffinBgo)
 {
+   auto& positions = fPositions[slot];
    for(auto g1 = 0; g1 < (fAddback ? fGriffin.GetSuppressedAddbackMultiplicity(&fGriffinBgo) : fGriffin.GetSuppressedMultiplicity(&fGriffinBgo)); ++g1) {
       auto grif1 = (fAddback ? fGriffin.GetSuppressedAddbackHit(g1) : fGriffin.GetSuppressedHit(g1));
       if(ExcludeDetector(grif1->GetDetector()) || ExcludeCrystal(grif1->GetArrayNumber())) continue;
@@ -57,46 +62,45 @@ void AngularCorrelationHelper::Exec(unsigned int slot, TGriffin& fGriffin, TGrif
          // check the timing to see if these are coincident or time-random hits
          double ggTime = TMath::Abs(grif2->GetTime() - grif1->GetTime());
          if(ggTime <= fPrompt) {
-            fH2[slot].at("AngularCorrelation")->Fill(grif1->GetEnergy(), grif2->GetEnergy());
-            fH2[slot].at(Form("AngularCorrelation%d", angleIndex))->Fill(grif1->GetEnergy(), grif2->GetEnergy());
+            fH2[slot][fCorrelation]->Fill(grif1->GetEnergy(), grif2->GetEnergy());
+            fH2[slot][fCorrelations[angleIndex]]->Fill(grif1->GetEnergy(), grif2->GetEnergy());
          } else if(fTimeRandomLow <= ggTime && ggTime <= fTimeRandomHigh) {
-            fH2[slot].at("AngularCorrelationBG")->Fill(grif1->GetEnergy(), grif2->GetEnergy());
-            fH2[slot].at(Form("AngularCorrelationBG%d", angleIndex))->Fill(grif1->GetEnergy(), grif2->GetEnergy());
+            fH2[slot][fCorrelationBG]->Fill(grif1->GetEnergy(), grif2->GetEnergy());
+            fH2[slot][fCorrelationsBG[angleIndex]]->Fill(grif1->GetEnergy(), grif2->GetEnergy());
          }
       }
 
-      // Event mixing: loop over all stored events for this thread/slot and use them as the "second" gamma ray
-      for(auto l = 0; l < fGriffinDeque[slot].size(); ++l) {
-         auto fLastGriffin = fGriffinDeque[slot][l];
-         auto fLastBgo     = fBgoDeque[slot][l];
-         for(auto g2 = 0; g2 < (fAddback ? fLastGriffin->GetSuppressedAddbackMultiplicity(fLastBgo) : fLastGriffin->GetSuppressedMultiplicity(fLastBgo)); ++g2) {
-            auto grif2 = (fAddback ? fLastGriffin->GetSuppressedAddbackHit(g2) : fLastGriffin->GetSuppressedHit(g2));
-            if(ExcludeDetector(grif2->GetDetector()) || ExcludeCrystal(grif2->GetArrayNumber())) continue;
-
-            // skip hits in the same detector when using addback, or in the same crystal when not using addback
-            if(grif1->GetDetector() == grif2->GetDetector() && (fAddback || grif1->GetCrystal() == grif2->GetCrystal())) continue;
+      // Event mixing: loop over all hits of the events stored for this thread/slot and use them as the "second" gamma ray
+      const auto position1 = grif1->GetPosition(fGriffinDistance);
+      fMixing[slot].ForEachHit([&](const TMixingHit& hit2) {
+         // skip hits in the same detector when using addback, or in the same crystal when not using addback
+         if(grif1->GetDetector() == hit2.fDetector && (fAddback || grif1->GetCrystal() == hit2.fCrystal)) return;
+         // hits without a valid array number have no position
+         if(hit2.fIndex < 0 || static_cast<size_t>(hit2.fIndex) >= positions.size()) return;
 
-            double angle = grif1->GetPosition(fGriffinDistance).Angle(grif2->GetPosition(fGriffinDistance)) * 180. / TMath::Pi();
-            if(angle < fAngles->Rounding()) continue;
-            if(fFolding && angle > 90.) angle = 180. - angle;
+         double angle = position1.Angle(positions[hit2.fIndex]) * 180. / TMath::Pi();
+         if(angle < fAngles->Rounding()) return;
+         if(fFolding && angle > 90.) angle = 180. - angle;
 
-            // find the index of the angle
-            auto angleIndex = fAngles->Index(angle);
-            if(angleIndex < 0) continue;
-            // no point in checking the time here, the two hits are from different events
-            fH2[slot].at("AngularCorrelationMixed")->Fill(grif1->GetEnergy(), grif2->GetEnergy());
-            fH2[slot].at(Form("AngularCorrelationMixed%d", angleIndex))->Fill(grif1->GetEnergy(), grif2->GetEnergy());
-         }
+         // find the index of the angle
+         auto angleIndex = fAngles->Index(angle);
+         if(angleIndex < 0) return;
+         // no point in checking the time here, the two hits are from different events
+         fH2[slot][fCorrelationMixed]->Fill(grif1->GetEnergy(), hit2.fEnergy);
+         fH2[slot][fCorrelationsMixed[angleIndex]]->Fill(grif1->GetEnergy(), hit2.fEnergy);
+      });
+
+      // add the hit to the current event of the event-mixing buffer, it is used for mixing once the event is stored,
+      // hits without a valid array number (negative) can't be stored as we have no position for them
+      if(grif1->GetArrayNumber() < 0) continue;
+      const auto index = static_cast<size_t>(grif1->GetArrayNumber());
+      if(index >= positions.size()) {
+         positions.resize(index + 1);
       }
+      positions[index] = position1;
+      fMixing[slot].Add(TMixingHit{grif1->GetEnergy(), grif1->GetTime(), grif1->GetArrayNumber(), grif1->GetDetector(), grif1->GetCrystal(), 0});
    }
 
-   // Add the current event to the queue, delete the oldest event in the queue, and pop the pointer from the queue.
-   fGriffinDeque[slot].emplace_back(new TGriffin(fGriffin));
-   fBgoDeque[slot].emplace_back(new TGriffinBgo(fGriffinBgo));
-
-   delete fGriffinDeque[slot].front();
-   delete fBgoDeque[slot].front();
-
-   fGriffinDeque[slot].pop_front();
-   fBgoDeque[slot].pop_front();
+   // store the current event in place of the oldest one
+   fMixing[slot].Store();
 }
@@ -26,8 +26,14 @@ private:
 
    TGriffinAngles* fAngles{nullptr};
 
-   std::map<unsigned int, std::deque<TGriffin*>>    fGriffinDeque;
-   std::map<unsigned int, std::deque<TGriffinBgo*>> fBgoDeque;
+   THandle<TH2> fCorrelation;         // all prompt gamma-gamma
+   THandle<TH2> fCorrelationBG;       // all time random gamma-gamma
+   THandle<TH2> fCorrelationMixed;    // all event mixed gamma-gamma
+   TFamily<TH2> fCorrelations;        // prompt gamma-gamma per angle
+   TFamily<TH2> fCorrelationsBG;      // time random gamma-gamma per angle
+   TFamily<TH2> fCorrelationsMixed;   // event mixed gamma-gamma per angle
+
+   std::map<unsigned int, std::vector<TVector3>> fPositions;   // positions of the hits by array number, for the hits in the event-mixing buffer
 
    bool ExcludeDetector(int detector)
    {
@@ -77,6 +83,9 @@ public:
       fAngles = new TGriffinAngles(fGriffinDistance, fFolding, fGrouping, fAddback);
       fAngles->Print();
 
+      // the hits of the last fNofMixedEvents events are used for event mixing
+      SetMixing(fNofMixedEvents);
+
       // Setup calls CreateHistograms, which uses the stored angle combinations, so we need those set before
       Setup();
    }
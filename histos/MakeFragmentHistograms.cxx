@@ -3,11 +3,16 @@
 
 extern "C" void MakeFragmentHistograms(TRuntimeObjects& obj)
 {
+   // declaring the histograms once means each fill is an array access, instead of creating the name and looking it up for every fragment
+   static const auto addresses = TRuntimeObjects::DeclareHistogram("General", "Addresses", 0xffff, 0, 0xffff);
+   static const auto charge    = TRuntimeObjects::DeclareHistogramFamily("General", "charge0x%04x", 2000, 0, 20000);
+   static const auto energy    = TRuntimeObjects::DeclareHistogramFamily("General", "energy0x%04x", 2000, 0, 2000);
+
    std::shared_ptr<const TFragment> frag = obj.GetFragment();
 
    if(frag != nullptr) {
-      obj.FillHistogram("Addresses", 0xffff, 0, 0xffff, frag->GetAddress());
-      obj.FillHistogram(Form("charge0x%04x", frag->GetAddress()), 2000, 0, 20000, frag->GetCharge());
-      obj.FillHistogram(Form("energy0x%04x", frag->GetAddress()), 2000, 0, 2000, frag->GetEnergy());
+      obj.FillHistogram(addresses, frag->GetAddress());
+      obj.FillHistogram(charge, frag->GetAddress(), frag->GetCharge());
+      obj.FillHistogram(energy, frag->GetAddress(), frag->GetEnergy());
    }
 }
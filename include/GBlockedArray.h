@@ -0,0 +1,509 @@
+#ifndef GBLOCKEDARRAY_H
+#define GBLOCKEDARRAY_H
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Rtypes.h"
+#include "TArrayD.h"
+#include "TArrayF.h"
+#include "TArrayL64.h"
+#include "TBuffer.h"
+#include "TDirectory.h"
+#include "TError.h"
+#include "TString.h"
+
+/////////////////////////////////////////////////////////////////
+///
+/// \class GBlockedArray
+///
+/// Bin content storage of GCubeF and GCubeD with 64-bit indices.
+///
+/// The cells are stored in blocks of kBlockSize cells, each block
+/// is one 8x8x8 tile of the cube (see GCube::GetBin64), so neighbouring
+/// cells in all three directions are close in memory. Blocks are only
+/// allocated once a cell in them is set to a non-zero value, unallocated
+/// blocks read as zero. For the typically sparse high-resolution cubes
+/// this saves most of the memory and the time to write them.
+///
+/// Only allocated blocks are written. If they don't fit into a single
+/// buffer (kMaxInlineBytes, ROOT can't write keys larger than 1 GB),
+/// WriteChunks writes them as separate keys <prefix>_chunk<i> (content)
+/// and <prefix>_chunk<i>_blocks (block indices) in front of the object
+/// itself, and ReadChunks reads them back (called by GCube::DirectoryAutoAdd
+/// when the cube is read from a file).
+///
+/// Alternatively the cells can be stored in a memory-mapped file (Map),
+/// for cubes that don't fit into memory. The file holds all blocks in
+/// order, so a projection only reads the tiles it needs from it, and
+/// additions are buffered and applied sorted by cell (SetBuffered), so
+/// the pages of the file are touched in order. Only the name of the file
+/// is streamed for a mapped array.
+///
+/////////////////////////////////////////////////////////////////
+
+/// How GBlockedArray::Map opens the file
+enum class EMapMode { kCreate,     ///< create (or overwrite) the file and copy the current content into it
+                      kOpen,       ///< use the content of the existing file, changes are written to the file
+                      kPrivate };  ///< use the content of the existing file, changes are only made in memory
+
+template <typename T>
+class GBlockedArray {
+public:
+   static constexpr int      kBlockShift     = 9;                         ///< 2^kBlockShift cells per block
+   static constexpr Long64_t kBlockSize      = 1LL << kBlockShift;        ///< number of cells per block
+   static constexpr Long64_t kBlockMask      = kBlockSize - 1;            ///< mask for the cell within a block
+   static constexpr Long64_t kMaxInlineBytes = 512LL * 1024LL * 1024LL;   ///< maximum size of the content written inline or in one chunk
+
+   using TArrayT = typename std::conditional<std::is_same<T, Float_t>::value, TArrayF, TArrayD>::type;
+
+   static constexpr size_t   kMaxPending     = 1 << 20;                   ///< number of buffered additions after which they are applied
+
+   GBlockedArray() = default;
+   GBlockedArray(const GBlockedArray& rhs) { *this = rhs; }
+   GBlockedArray(GBlockedArray&& rhs) noexcept { *this = std::move(rhs); }
+   ~GBlockedArray() { Unmap(false); }
+
+   /// Copies the content of rhs into memory, a copy of a mapped array is not mapped
+   GBlockedArray& operator=(const GBlockedArray& rhs)
+   {
+      if(this == &rhs) {
+         return *this;
+      }
+      Unmap(false);
+      fSize = rhs.fSize;
+      fBlocks.clear();
+      fBlocks.resize(static_cast<size_t>(rhs.NumberOfBlocks()));
+      for(size_t b = 0; b < fBlocks.size(); ++b) {
+         const T* block = rhs.Block(static_cast<Long64_t>(b));
+         if(block != nullptr && (!rhs.IsMapped() || !IsZero(block))) {
+            fBlocks[b].reset(new T[kBlockSize]);
+            std::copy(block, block + kBlockSize, fBlocks[b].get());
+         }
+      }
+      fPendingChunks = rhs.fPendingChunks;
+      fChunkPrefix   = rhs.fChunkPrefix;
+      return *this;
+   }
+
+   GBlockedArray& operator=(GBlockedArray&& rhs) noexcept
+   {
+      if(this == &rhs) {
+         return *this;
+      }
+      Unmap(false);
+      fSize          = rhs.fSize;
+      fBlocks        = std::move(rhs.fBlocks);
+      fPendingChunks = rhs.fPendingChunks;
+      fChunkPrefix   = rhs.fChunkPrefix;
+      fMapped        = std::exchange(rhs.fMapped, nullptr);
+      fMappedBytes   = std::exchange(rhs.fMappedBytes, 0);
+      fFile          = std::exchange(rhs.fFile, -1);
+      fMapMode       = rhs.fMapMode;
+      fMappedFile    = std::exchange(rhs.fMappedFile, TString());
+      fBuffered      = rhs.fBuffered;
+      fPending       = std::move(rhs.fPending);
+      return *this;
+   }
+
+   /// Changes the number of cells, the content of blocks that are kept is not changed. A mapped array is
+   /// copied into memory first if the number of cells changes.
+   void Set(Long64_t size)
+   {
+      if(IsMapped() && size != fSize) {
+         Unmap();
+      }
+      fSize = size;
+      fBlocks.resize(static_cast<size_t>((size + kBlockMask) >> kBlockShift));
+   }
+   Long64_t Size() const { return fSize; }
+   Long64_t NumberOfBlocks() const { return static_cast<Long64_t>(fBlocks.size()); }
+
+   /// Number of blocks that are allocated
+   Long64_t AllocatedBlocks() const
+   {
+      return std::count_if(fBlocks.begin(), fBlocks.end(), [](const std::unique_ptr<T[]>& block) { return static_cast<bool>(block); });
+   }
+
+   /// Returns the content of cell i, zero if its block isn't allocated. For a mapped array the buffered additions
+   /// to the cell are added to the result without applying them, which scans all of them. Everything that reads
+   /// many cells (e.g. the projections, integrals, and statistics of GCube) has to call FlushPending first.
+   T At(Long64_t i) const
+   {
+      if(fMapped != nullptr) {
+         T result = fMapped[i];
+         for(const auto& pending : fPending) {
+            if(pending.first == i) {
+               result += pending.second;
+            }
+         }
+         return result;
+      }
+      const auto& block = fBlocks[static_cast<size_t>(i >> kBlockShift)];
+      return block ? block[i & kBlockMask] : T(0);
+   }
+   /// Returns a reference to the content of cell i, allocating its block if necessary
+   T& Ref(Long64_t i) { return Allocate(i >> kBlockShift)[i & kBlockMask]; }
+   /// Sets the content of cell i, without allocating a block to set a cell to zero
+   void Set(Long64_t i, T val)
+   {
+      if(val == T(0) && fMapped == nullptr && !fBlocks[static_cast<size_t>(i >> kBlockShift)]) {
+         return;
+      }
+      Ref(i) = val;
+   }
+   /// Adds w to cell i, buffered for a mapped array with buffering turned on
+   void Add(Long64_t i, T w)
+   {
+      if(fBuffered && fMapped != nullptr) {
+         fPending.emplace_back(i, w);
+         if(fPending.size() >= kMaxPending) {
+            FlushPending();
+         }
+         return;
+      }
+      Ref(i) += w;
+   }
+
+   /// Adds c times the content of rhs (which needs to have the same size)
+   void Add(const GBlockedArray& rhs, Double_t c)
+   {
+      for(Long64_t b = 0; b < rhs.NumberOfBlocks() && b < NumberOfBlocks(); ++b) {
+         const T* other = rhs.Block(b);
+         if(other == nullptr || (rhs.IsMapped() && IsZero(other))) {
+            continue;
+         }
+         T* block = Allocate(b);
+         for(Long64_t i = 0; i < kBlockSize; ++i) {
+            block[i] += static_cast<T>(c * other[i]);
+         }
+      }
+   }
+
+   /// Returns block b, nullptr if it isn't allocated
+   const T* Block(Long64_t b) const
+   {
+      if(fMapped != nullptr) {
+         FlushPending();
+         return fMapped + (b << kBlockShift);
+      }
+      return fBlocks[static_cast<size_t>(b)].get();
+   }
+
+   T* Allocate(Long64_t b)
+   {
+      if(fMapped != nullptr) {
+         FlushPending();
+         return fMapped + (b << kBlockShift);
+      }
+      auto& block = fBlocks[static_cast<size_t>(b)];
+      if(!block) {
+         block.reset(new T[kBlockSize]());
+      }
+      return block.get();
+   }
+
+   /// Frees all blocks, i.e. sets all cells to zero. A file mapped with EMapMode::kPrivate is unmapped.
+   void Reset()
+   {
+      for(auto& block : fBlocks) {
+         block.reset();
+      }
+      fPendingChunks = 0;
+      fPending.clear();
+      if(IsMapped()) {
+         if(fMapMode == EMapMode::kPrivate) {
+            Unmap(false);
+         } else {
+            // truncating the file and extending it again turns all pages of the mapping into holes that read as zero
+            if(ftruncate(fFile, 0) != 0 || ftruncate(fFile, static_cast<off_t>(fMappedBytes)) != 0) {
+               std::memset(fMapped, 0, fMappedBytes);
+            }
+         }
+      }
+   }
+
+   bool        Map(const char* fileName, EMapMode mode = EMapMode::kCreate);
+   void        Unmap(bool keepContent = true);
+   bool        IsMapped() const { return fMapped != nullptr; }
+   const char* MappedFile() const { return fMappedFile.Data(); }
+   void        Sync() const;
+
+   /// Turns buffering of the additions to a mapped array on or off, must be off while several threads add at once
+   void SetBuffered(bool val)
+   {
+      if(!val) {
+         FlushPending();
+      }
+      fBuffered = val;
+   }
+   void FlushPending() const;
+
+   /// Returns true if the allocated blocks don't fit into a single buffer
+   bool NeedsChunks() const { return AllocatedBlocks() * (kBlockSize * static_cast<Long64_t>(sizeof(T)) + static_cast<Long64_t>(sizeof(Long64_t))) > kMaxInlineBytes; }
+
+   /// Number of chunks that still have to be read by ReadChunks
+   Int_t PendingChunks() const { return fPendingChunks; }
+
+   void  Streamer(TBuffer& b);
+   Int_t WriteChunks(TDirectory* dir, const char* prefix, Option_t* option, Int_t bufsize) const;
+   bool  ReadChunks(TDirectory* dir);
+
+private:
+   static bool IsZero(const T* block)
+   {
+      return std::all_of(block, block + kBlockSize, [](T val) { return val == T(0); });
+   }
+
+   Long64_t                                    fSize{0};                      ///< number of cells
+   std::vector<std::unique_ptr<T[]>>           fBlocks;                       ///< blocks of cells, nullptr for blocks that are all zero
+   mutable Int_t                               fPendingChunks{0};             ///< number of chunks written by WriteChunks, or still to be read by ReadChunks
+   mutable TString                             fChunkPrefix;                  ///< prefix of the names of the chunks
+   T*                                          fMapped{nullptr};              ///< all cells in the mapped file, nullptr if not mapped
+   size_t                                      fMappedBytes{0};               ///< size of the mapping
+   int                                         fFile{-1};                     ///< file descriptor of the mapped file
+   EMapMode                                    fMapMode{EMapMode::kCreate};   ///< how the mapped file was opened
+   TString                                     fMappedFile;                   ///< name of the mapped file
+   bool                                        fBuffered{false};              ///< flag whether additions to the mapped file are buffered
+   mutable std::vector<std::pair<Long64_t, T>> fPending;                    ///< buffered additions (cell and weight)
+};
+
+template <typename T>
+bool GBlockedArray<T>::Map(const char* fileName, EMapMode mode)
+{
+   /// Maps the cells to the file fileName. With EMapMode::kCreate the file is created with the size of all
+   /// cells (unused parts of it don't take up disk space on most file systems) and the current content is
+   /// copied into it, otherwise the file has to exist with the size of all cells and its content replaces the
+   /// current one. Returns false if the file can't be opened or mapped, the array is unchanged in that case.
+   Unmap();
+   const auto bytes = static_cast<size_t>(NumberOfBlocks() * kBlockSize) * sizeof(T);
+   if(bytes == 0) {
+      return false;
+   }
+   int flags = O_RDWR;
+   if(mode == EMapMode::kCreate) {
+      flags |= O_CREAT | O_TRUNC;
+   } else if(mode == EMapMode::kPrivate) {
+      flags = O_RDONLY;
+   }
+   int file = open(fileName, flags, 0644);
+   if(file < 0) {
+      return false;
+   }
+   struct stat status {};
+   if((mode == EMapMode::kCreate && ftruncate(file, static_cast<off_t>(bytes)) != 0) ||
+      (mode != EMapMode::kCreate && (fstat(file, &status) != 0 || static_cast<size_t>(status.st_size) != bytes))) {
+      close(file);
+      return false;
+   }
+   void* address = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, mode == EMapMode::kPrivate ? MAP_PRIVATE : MAP_SHARED, file, 0);
+   if(address == MAP_FAILED) {
+      close(file);
+      return false;
+   }
+   fMapped      = static_cast<T*>(address);
+   fMappedBytes = bytes;
+   fFile        = file;
+   fMapMode     = mode;
+   fMappedFile  = fileName;
+   for(size_t b = 0; b < fBlocks.size(); ++b) {
+      if(fBlocks[b] && mode == EMapMode::kCreate) {
+         std::copy(fBlocks[b].get(), fBlocks[b].get() + kBlockSize, fMapped + (b << kBlockShift));
+      }
+      fBlocks[b].reset();
+   }
+   return true;
+}
+
+template <typename T>
+void GBlockedArray<T>::Unmap(bool keepContent)
+{
+   /// Unmaps the file, copying the non-zero blocks into memory if keepContent is true. Changes of a file
+   /// mapped with EMapMode::kCreate or EMapMode::kOpen are kept in the file.
+   if(fMapped == nullptr) {
+      return;
+   }
+   if(keepContent) {
+      FlushPending();
+      for(size_t b = 0; b < fBlocks.size(); ++b) {
+         const T* block = fMapped + (b << kBlockShift);
+         if(!IsZero(block)) {
+            fBlocks[b].reset(new T[kBlockSize]);
+            std::copy(block, block + kBlockSize, fBlocks[b].get());
+         }
+      }
+   } else if(fMapMode != EMapMode::kPrivate) {
+      FlushPending();
+   }
+   fPending.clear();
+   munmap(fMapped, fMappedBytes);
+   close(fFile);
+   fMapped      = nullptr;
+   fMappedBytes = 0;
+   fFile        = -1;
+   fMappedFile  = "";
+}
+
+template <typename T>
+void GBlockedArray<T>::Sync() const
+{
+   /// Applies the buffered additions and writes the changes of the mapped file to disk.
+   FlushPending();
+   if(fMapped != nullptr && fMapMode != EMapMode::kPrivate) {
+      msync(fMapped, fMappedBytes, MS_SYNC);
+   }
+}
+
+template <typename T>
+void GBlockedArray<T>::FlushPending() const
+{
+   /// Applies the buffered additions to the mapped file, sorted by cell.
+   if(fPending.empty()) {
+      return;
+   }
+   std::sort(fPending.begin(), fPending.end(), [](const std::pair<Long64_t, T>& lhs, const std::pair<Long64_t, T>& rhs) { return lhs.first < rhs.first; });
+   for(const auto& pending : fPending) {
+      fMapped[pending.first] += pending.second;
+   }
+   fPending.clear();
+}
+
+template <typename T>
+void GBlockedArray<T>::Streamer(TBuffer& b)
+{
+   /// Streams the size, and the allocated blocks (index and content). If WriteChunks has just written the
+   /// blocks to a directory, only the prefix and number of those chunks are streamed. Without chunks (e.g.
+   /// Clone or a TMessage) the blocks are always streamed inline, an array too large for a single buffer is
+   /// an error. A mapped array streams no blocks, its content is written to the mapped file instead (see
+   /// GCubeF::Streamer).
+   if(b.IsReading()) {
+      Long64_t size      = 0;
+      Long64_t allocated = 0;
+      Bool_t   isInline  = kTRUE;
+      b >> size;
+      // a mapped file keeps its content, only the mapping is dropped before the streamed content replaces it
+      Unmap(false);
+      Reset();
+      Set(size);
+      b >> allocated;
+      b >> isInline;
+      if(isInline) {
+         for(Long64_t i = 0; i < allocated; ++i) {
+            Long64_t index = 0;
+            b >> index;
+            b.ReadFastArray(Allocate(index), static_cast<Int_t>(kBlockSize));
+         }
+      } else {
+         fChunkPrefix.Streamer(b);
+         b >> fPendingChunks;
+      }
+   } else {
+      Sync();
+      Long64_t allocated = AllocatedBlocks();
+      Bool_t   isInline  = (fPendingChunks == 0);
+      if(isInline && allocated * (kBlockSize * static_cast<Long64_t>(sizeof(T)) + static_cast<Long64_t>(sizeof(Long64_t))) > kMaxInt) {
+         ::Error("GBlockedArray::Streamer", "%lld blocks are too large to be streamed into a single buffer, write the histogram to a file instead", allocated);
+         allocated = 0;
+      }
+      b << fSize;
+      b << allocated;
+      b << isInline;
+      if(isInline) {
+         for(size_t i = 0; i < fBlocks.size() && allocated > 0; ++i) {
+            if(fBlocks[i]) {
+               b << static_cast<Long64_t>(i);
+               b.WriteFastArray(fBlocks[i].get(), static_cast<Int_t>(kBlockSize));
+            }
+         }
+      } else {
+         fChunkPrefix.Streamer(b);
+         b << fPendingChunks;
+         // the chunks belong to this write only, any later streaming (e.g. Clone) has to be inline again
+         fPendingChunks = 0;
+      }
+   }
+}
+
+template <typename T>
+Int_t GBlockedArray<T>::WriteChunks(TDirectory* dir, const char* prefix, Option_t* option, Int_t bufsize) const
+{
+   /// Writes the allocated blocks to dir as keys <prefix>_chunk<i> and <prefix>_chunk<i>_blocks, each of them
+   /// at most kMaxInlineBytes large. Does nothing if the blocks fit into a single buffer. Returns the number of
+   /// bytes written.
+   fPendingChunks = 0;
+   fChunkPrefix   = prefix;
+   if(dir == nullptr || !NeedsChunks()) {
+      return 0;
+   }
+   const Long64_t blocksPerChunk = kMaxInlineBytes / (kBlockSize * static_cast<Long64_t>(sizeof(T)));
+
+   Int_t     nbytes = 0;
+   TArrayL64 indices(static_cast<Int_t>(blocksPerChunk));
+   TArrayT   content(static_cast<Int_t>(blocksPerChunk * kBlockSize));
+   Long64_t  used   = 0;
+   auto      flush  = [&]() {
+      indices.Set(static_cast<Int_t>(used));
+      content.Set(static_cast<Int_t>(used * kBlockSize));
+      nbytes += dir->WriteObjectAny(&content, TArrayT::Class(), Form("%s_chunk%d", prefix, fPendingChunks), option, bufsize);
+      nbytes += dir->WriteObjectAny(&indices, TArrayL64::Class(), Form("%s_chunk%d_blocks", prefix, fPendingChunks), option, bufsize);
+      ++fPendingChunks;
+      indices.Set(static_cast<Int_t>(blocksPerChunk));
+      content.Set(static_cast<Int_t>(blocksPerChunk * kBlockSize));
+      used = 0;
+   };
+   for(size_t b = 0; b < fBlocks.size(); ++b) {
+      if(!fBlocks[b]) {
+         continue;
+      }
+      indices[static_cast<Int_t>(used)] = static_cast<Long64_t>(b);
+      std::copy(fBlocks[b].get(), fBlocks[b].get() + kBlockSize, content.GetArray() + used * kBlockSize);
+      if(++used == blocksPerChunk) {
+         flush();
+      }
+   }
+   if(used > 0) {
+      flush();
+   }
+   return nbytes;
+}
+
+template <typename T>
+bool GBlockedArray<T>::ReadChunks(TDirectory* dir)
+{
+   /// Reads the chunks written by WriteChunks from dir. Returns false if a chunk is missing.
+   if(fPendingChunks == 0) {
+      return true;
+   }
+   if(dir == nullptr) {
+      return false;
+   }
+   for(Int_t chunk = 0; chunk < fPendingChunks; ++chunk) {
+      TArrayT*   content = nullptr;
+      TArrayL64* indices = nullptr;
+      dir->GetObject(Form("%s_chunk%d", fChunkPrefix.Data(), chunk), content);
+      dir->GetObject(Form("%s_chunk%d_blocks", fChunkPrefix.Data(), chunk), indices);
+      if(content == nullptr || indices == nullptr || content->GetSize() != indices->GetSize() * kBlockSize) {
+         delete content;
+         delete indices;
+         return false;
+      }
+      for(Int_t i = 0; i < indices->GetSize(); ++i) {
+         std::copy(content->GetArray() + i * kBlockSize, content->GetArray() + (i + 1) * kBlockSize, Allocate(indices->At(i)));
+      }
+      delete content;
+      delete indices;
+   }
+   fPendingChunks = 0;
+   return true;
+}
+
+#endif
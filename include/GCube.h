@@ -4,12 +4,39 @@
 #include "TH1.h"
 #include "TH2.h"
 #include "TH3.h"
-#include "TArrayF.h"
-#include "TArrayD.h"
 #include "TProfile.h"
 #include "TF1.h"
 #include "TRandom.h"
 
+#include <array>
+#include <utility>
+#include <vector>
+
+#include "GBlockedArray.h"
+#include "GGate.h"
+#include "GProjectionIndex.h"
+#include "GSharedFill.h"
+
+/////////////////////////////////////////////////////////////////
+///
+/// \class GCube
+///
+/// Symmetric three-dimensional histogram, only the cells with
+/// binx >= biny >= binz are stored.
+///
+/// The cells are numbered with 64-bit integers (GetBin64) in tiles
+/// of 8x8x8 bins, so cubes with more than 2^31 cells (about 1300 bins
+/// per axis) are possible and neighbouring cells are close in memory.
+/// GetBin and all other methods using Int_t bin numbers only work for
+/// cubes with less than 2^31 cells, Fill, GetBinContent/SetBinContent
+/// with three bins, the projections, integrals, Add, Merge, and the I/O
+/// use 64-bit cell numbers. The content of GCubeF and GCubeD is stored
+/// in a GBlockedArray, and written in chunks if it is too large for a
+/// single key (see Write). Cubes too large for the memory can keep their
+/// cells in a memory-mapped file instead (MapFile).
+///
+/////////////////////////////////////////////////////////////////
+
 class GCube : public TH1 {
 public:
    GCube() = default;
@@ -21,7 +48,7 @@ public:
    GCube& operator=(const GCube&);
    GCube& operator=(GCube&&) noexcept;
 
-   ~GCube() = default;
+   ~GCube();
 
    Int_t         BufferEmpty(Int_t action = 0) override;
    Int_t         BufferFill(Double_t, Double_t) override { return -2; }   // MayNotUse
@@ -63,9 +90,21 @@ public:
    Int_t FindFirstBinAbove(Double_t threshold = 0, Int_t axis = 1, Int_t firstBin = 1, Int_t lastBin = -1) const override;
    Int_t FindLastBinAbove(Double_t threshold = 0, Int_t axis = 1, Int_t firstBin = 1, Int_t lastBin = -1) const override;
 #endif
+   using TH1::Add;
+   Bool_t           Add(const TH1* h1, Double_t c1 = 1) override;
    virtual void     FitSlicesZ(TF1* f1 = nullptr, Int_t binminx = 0, Int_t binmaxx = -1, Int_t binminy = 0,
                                Int_t binmaxy = -1, Int_t cut = 0, Option_t* option = "QNR");
    Int_t            GetBin(Int_t binx, Int_t biny = 0, Int_t binz = 0) const override;
+   Long64_t         GetBin64(Int_t binx, Int_t biny, Int_t binz) const;
+   static Long64_t  NumberOfCells(Int_t nbins);
+   using TH1::GetBinContent;
+   Double_t         GetBinContent(Int_t binx, Int_t biny, Int_t binz) const override;
+   using TH1::SetBinContent;
+   void             SetBinContent(Int_t binx, Int_t biny, Int_t binz, Double_t content) override;
+   virtual Double_t GetCellContent(Long64_t) const { return 0.; }   ///< content of the cell with the 64-bit number cell (see GetBin64)
+   virtual void     SetCellContent(Long64_t, Double_t) {}
+   virtual void     AddCellContent(Long64_t, Double_t) {}
+   Double_t         GetCellError(Long64_t cell) const;
    virtual Double_t GetBinWithContent2(Double_t c, Int_t& binx, Int_t& biny, Int_t& binz, Int_t firstxbin = 1,
                                        Int_t lastxbin = -1, Int_t firstybin = 1, Int_t lastybin = -1,
                                        Int_t firstzbin = 1, Int_t lastzbin = -1, Double_t maxdiff = 0) const;
@@ -96,16 +135,61 @@ public:
    void           PutStats(Double_t* stats) override;
    virtual GCube* Rebin3D(Int_t ngroup = 2, const char* newname = "");
    void           Reset(Option_t* option = "") override;
+   void           Sumw2(Bool_t flag = kTRUE) override;
    virtual void   SetShowProjection(const char* option = "xy", Int_t nbins = 1);   // *MENU*
    TH1*           ShowBackground(Int_t niter = 20, Option_t* option = "same") override;
    Int_t          ShowPeaks(Double_t sigma = 2, Option_t* option = "", Double_t threshold = 0.05) override;   // *MENU*
    void           Smooth(Int_t ntimes = 1, Option_t* option = "") override;                                   // *MENU*
 
+   void SetShared(bool val = true);
+   bool IsShared() const { return fSharedFill != nullptr; }
+
+   void FillCombinations(const Double_t* energies, size_t n, Double_t w = 1.);
+
+   std::vector<TH1D*> Projections(const std::vector<GGate>& gates, Option_t* option = "", Int_t nThreads = 0) const;
+
+   void UseProjectionIndex(bool val = true, Long64_t maxBytes = 2LL << 30);
+   bool UsesProjectionIndex() const { return fUseProjectionIndex; }
+   void ResetProjectionIndex();
+
+   virtual bool        MapFile(const char*, EMapMode = EMapMode::kCreate) { return false; }   ///< stores the cells in a memory-mapped file
+   virtual void        UnmapFile() {}                                                        ///< copies the cells of the mapped file back into memory
+   virtual const char* MappedFile() const { return ""; }                                     ///< name of the mapped file, empty if the cells are in memory
+
+   using TH1::Write;
+   Int_t Write(const char* name = nullptr, Int_t option = 0, Int_t bufsize = 0) const override;
+   void  DirectoryAutoAdd(TDirectory* dir) override;
+
 protected:
    using TH1::DoIntegral;
    Double_t DoIntegral(Int_t binx1, Int_t binx2, Int_t biny1, Int_t biny2, Int_t binz1, Int_t binz2, Double_t& error,
                        Option_t* option, Bool_t doError = kFALSE) const override;
 
+   Long64_t     FindFillBin(Double_t x, Double_t y, Double_t z, Bool_t& inRange);
+   void         FindFillBins(const Double_t* x, size_t n, Int_t* bins);
+   void         SetNcells();
+   virtual void AddCells(const GCube* h1, Double_t c1);
+   void         ConvertVersion1(const TArray& cells);
+
+   virtual Int_t WriteChunks(TDirectory*, const char*, Option_t*, Int_t) const { return 0; }   ///< writes the content as separate keys if it is too large for the key of the histogram
+   virtual bool  ReadChunks(TDirectory*) { return true; }                                      ///< reads the content written by WriteChunks
+   virtual void  BufferCells(bool) {}                                                          ///< turns buffering of the additions to the mapped file on or off
+   virtual void  FlushCells() const {}                                                         ///< applies the buffered additions to the mapped file
+
+   static constexpr int kTileShift = 3;                       ///< 2^kTileShift bins per axis in each tile
+   static constexpr int kTileMask  = (1 << kTileShift) - 1;   ///< mask for the bin within a tile
+
+   /// Number of the cell of the bins binx >= biny >= binz. The tiles tx >= ty >= tz are numbered
+   /// tx(tx+1)(tx+2)/6 + ty(ty+1)/2 + tz, and the cells within a tile consecutively.
+   static Long64_t CellNumber(Int_t binx, Int_t biny, Int_t binz)
+   {
+      Long64_t tx   = binx >> kTileShift;
+      Long64_t ty   = biny >> kTileShift;
+      Long64_t tz   = binz >> kTileShift;
+      Long64_t tile = tx * (tx + 1) * (tx + 2) / 6 + ty * (ty + 1) / 2 + tz;
+      return (tile << (3 * kTileShift)) + ((((binx & kTileMask) << kTileShift) + (biny & kTileMask)) << kTileShift) + (binz & kTileMask);
+   }
+
    void Matrix(TH2* val) { fMatrix = val; }
    TH2* Matrix() { return fMatrix; }
 
@@ -119,12 +203,24 @@ private:
    Double_t fTsumwyz{0};        // Total Sum of weight*Y*Z
    TH2*     fMatrix{nullptr};   //!<! Transient pointer to the 2D-Matrix used in Draw() or GetMatrix()
 
+   GSharedFill* fSharedFill{nullptr};   //!<! Transient buffers and locks used while the histogram is shared by several threads
+
+   bool                      fUseProjectionIndex{false};   //!<! Flag whether Projection uses fProjectionIndex
+   Long64_t                  fProjectionIndexBytes{0};     //!<! Maximum memory fProjectionIndex may use
+   mutable GProjectionIndex* fProjectionIndex{nullptr};    //!<! Transient cumulative sums along the y- and z-axis, built on demand by Projection
+
+   const GProjectionIndex* ProjectionIndex(bool errors) const;
+
+   void FillShared(Double_t x, Double_t y, Double_t z, Double_t w);
+   void FlushShared(GSharedFill::TBuffer& buffer);
+   void AddShared(std::vector<std::pair<Long64_t, Double_t>>& bins, const std::array<Double_t, 11>& stats, Double_t entries);
+
    /// /cond CLASSIMP
    ClassDefOverride(GCube, 1)   // NOLINT(readability-else-after-return)
                                 /// /endcond
 };
 
-class GCubeF : public GCube, public TArrayF {
+class GCubeF : public GCube {
 public:
    GCubeF();
    GCubeF(const char* name, const char* title, Int_t nbins, Double_t low, Double_t up);
@@ -136,27 +232,27 @@ public:
 
    TH2F* GetMatrix(bool force = false);
 
-   void     AddBinContent(Int_t bin) override { ++fArray[bin]; }
-   void     AddBinContent(Int_t bin, Double_t w) override { fArray[bin] += static_cast<Float_t>(w); }
-   void     Copy(TObject& rh) const override;
-   void     Draw(Option_t* option = "") override { GetMatrix()->Draw(option); }
-   TH1*     DrawCopy(Option_t* option = "", const char* name_postfix = "_copy") const override;
-   Double_t GetBinContent(Int_t bin) const override;
-   Double_t GetBinContent(Int_t bin, Int_t) const override { return GetBinContent(bin); }
-   Double_t GetBinContent(Int_t binx, Int_t biny, Int_t binz) const override
-   {
-      return GetBinContent(GetBin(binx, biny, binz));
-   }
-   void     Reset(Option_t* option = "") override;
-   Double_t RetrieveBinContent(Int_t bin) const override { return static_cast<Double_t>(fArray[bin]); }
-   void     SetBinContent(Int_t bin, Double_t content) override;
-   void     SetBinContent(Int_t bin, Int_t, Double_t content) override { SetBinContent(bin, content); }
-   void     SetBinContent(Int_t binx, Int_t biny, Int_t binz, Double_t content) override
-   {
-      SetBinContent(GetBin(binx, biny, binz), content);
-   }
+   using GCube::GetBinContent;
+   using GCube::SetBinContent;
+   void          AddBinContent(Int_t bin) override { fCells.Add(bin, 1); }
+   void          AddBinContent(Int_t bin, Double_t w) override { fCells.Add(bin, static_cast<Float_t>(w)); }
+   void          AddCellContent(Long64_t cell, Double_t w) override { fCells.Add(cell, static_cast<Float_t>(w)); }
+   void          Copy(TObject& rh) const override;
+   void          Draw(Option_t* option = "") override { GetMatrix()->Draw(option); }
+   TH1*          DrawCopy(Option_t* option = "", const char* name_postfix = "_copy") const override;
+   Double_t      GetBinContent(Int_t bin) const override;
+   Double_t      GetBinContent(Int_t bin, Int_t) const override { return GetBinContent(bin); }
+   Double_t      GetCellContent(Long64_t cell) const override { return static_cast<Double_t>(fCells.At(cell)); }
+   void          Reset(Option_t* option = "") override;
+   Double_t      RetrieveBinContent(Int_t bin) const override { return static_cast<Double_t>(fCells.At(bin)); }
+   void          SetBinContent(Int_t bin, Double_t content) override;
+   void          SetBinContent(Int_t bin, Int_t, Double_t content) override { SetBinContent(bin, content); }
+   void          SetCellContent(Long64_t cell, Double_t content) override { fCells.Set(cell, static_cast<Float_t>(content)); }
    void          SetBinsLength(Int_t n = -1) override;
-   void          UpdateBinContent(Int_t bin, Double_t content) override { fArray[bin] = static_cast<Float_t>(content); }
+   void          UpdateBinContent(Int_t bin, Double_t content) override { fCells.Set(bin, static_cast<Float_t>(content)); }
+   bool          MapFile(const char* fileName, EMapMode mode = EMapMode::kCreate) override;
+   void          UnmapFile() override { fCells.Unmap(); }
+   const char*   MappedFile() const override { return fCells.MappedFile(); }
    GCubeF&       operator=(const GCubeF& h1);
    GCubeF&       operator=(GCubeF&&) noexcept;
    friend GCubeF operator*(Float_t c1, GCubeF& h1);
@@ -166,12 +262,22 @@ public:
    friend GCubeF operator*(GCubeF& h1, GCubeF& h2);
    friend GCubeF operator/(GCubeF& h1, GCubeF& h2);
 
+protected:
+   Int_t WriteChunks(TDirectory* dir, const char* name, Option_t* option, Int_t bufsize) const override { return fCells.WriteChunks(dir, name, option, bufsize); }
+   bool  ReadChunks(TDirectory* dir) override { return fCells.ReadChunks(dir); }
+   void  AddCells(const GCube* h1, Double_t c1) override;
+   void  BufferCells(bool val) override { fCells.SetBuffered(val && fCells.IsMapped()); }
+   void  FlushCells() const override { fCells.FlushPending(); }
+
+private:
+   GBlockedArray<Float_t> fCells;   //!<! content of the cells, streamed by the custom streamer
+
    /// /cond CLASSIMP
-   ClassDefOverride(GCubeF, 1)   // NOLINT(readability-else-after-return)
+   ClassDefOverride(GCubeF, 3)   // NOLINT(readability-else-after-return)
                                  /// /endcond
 };
 
-class GCubeD : public GCube, public TArrayD {
+class GCubeD : public GCube {
 public:
    GCubeD();
    GCubeD(const char* name, const char* title, Int_t nbins, Double_t low, Double_t up);
@@ -183,27 +289,27 @@ public:
 
    TH2D* GetMatrix(bool force = false);
 
-   void     AddBinContent(Int_t bin) override { ++fArray[bin]; }
-   void     AddBinContent(Int_t bin, Double_t w) override { fArray[bin] += w; }
-   void     Copy(TObject& rh) const override;
-   TH1*     DrawCopy(Option_t* option = "", const char* name_postfix = "_copy") const override;
-   void     Draw(Option_t* option = "") override { GetMatrix()->Draw(option); }
-   Double_t GetBinContent(Int_t bin) const override;
-   Double_t GetBinContent(Int_t bin, Int_t) const override { return GetBinContent(bin); }
-   Double_t GetBinContent(Int_t binx, Int_t biny, Int_t binz) const override
-   {
-      return GetBinContent(GetBin(binx, biny, binz));
-   }
-   void     Reset(Option_t* option = "") override;
-   Double_t RetrieveBinContent(Int_t bin) const override { return static_cast<Double_t>(fArray[bin]); }
-   void     SetBinContent(Int_t bin, Double_t content) override;
-   void     SetBinContent(Int_t bin, Int_t, Double_t content) override { SetBinContent(bin, content); }
-   void     SetBinContent(Int_t binx, Int_t biny, Int_t binz, Double_t content) override
-   {
-      SetBinContent(GetBin(binx, biny, binz), content);
-   }
+   using GCube::GetBinContent;
+   using GCube::SetBinContent;
+   void          AddBinContent(Int_t bin) override { fCells.Add(bin, 1); }
+   void          AddBinContent(Int_t bin, Double_t w) override { fCells.Add(bin, w); }
+   void          AddCellContent(Long64_t cell, Double_t w) override { fCells.Add(cell, w); }
+   void          Copy(TObject& rh) const override;
+   TH1*          DrawCopy(Option_t* option = "", const char* name_postfix = "_copy") const override;
+   void          Draw(Option_t* option = "") override { GetMatrix()->Draw(option); }
+   Double_t      GetBinContent(Int_t bin) const override;
+   Double_t      GetBinContent(Int_t bin, Int_t) const override { return GetBinContent(bin); }
+   Double_t      GetCellContent(Long64_t cell) const override { return static_cast<Double_t>(fCells.At(cell)); }
+   void          Reset(Option_t* option = "") override;
+   Double_t      RetrieveBinContent(Int_t bin) const override { return static_cast<Double_t>(fCells.At(bin)); }
+   void          SetBinContent(Int_t bin, Double_t content) override;
+   void          SetBinContent(Int_t bin, Int_t, Double_t content) override { SetBinContent(bin, content); }
+   void          SetCellContent(Long64_t cell, Double_t content) override { fCells.Set(cell, content); }
    void          SetBinsLength(Int_t n = -1) override;
-   void          UpdateBinContent(Int_t bin, Double_t content) override { fArray[bin] = content; }
+   void          UpdateBinContent(Int_t bin, Double_t content) override { fCells.Set(bin, content); }
+   bool          MapFile(const char* fileName, EMapMode mode = EMapMode::kCreate) override;
+   void          UnmapFile() override { fCells.Unmap(); }
+   const char*   MappedFile() const override { return fCells.MappedFile(); }
    GCubeD&       operator=(const GCubeD& h1);
    GCubeD&       operator=(GCubeD&& h1) noexcept;
    friend GCubeD operator*(Float_t c1, GCubeD& h1);
@@ -213,8 +319,18 @@ public:
    friend GCubeD operator*(GCubeD& h1, GCubeD& h2);
    friend GCubeD operator/(GCubeD& h1, GCubeD& h2);
 
+protected:
+   Int_t WriteChunks(TDirectory* dir, const char* name, Option_t* option, Int_t bufsize) const override { return fCells.WriteChunks(dir, name, option, bufsize); }
+   bool  ReadChunks(TDirectory* dir) override { return fCells.ReadChunks(dir); }
+   void  AddCells(const GCube* h1, Double_t c1) override;
+   void  BufferCells(bool val) override { fCells.SetBuffered(val && fCells.IsMapped()); }
+   void  FlushCells() const override { fCells.FlushPending(); }
+
+private:
+   GBlockedArray<Double_t> fCells;   //!<! content of the cells, streamed by the custom streamer
+
    /// /cond CLASSIMP
-   ClassDefOverride(GCubeD, 1)   // NOLINT(readability-else-after-return)
+   ClassDefOverride(GCubeD, 3)   // NOLINT(readability-else-after-return)
                                  /// /endcond
 };
 #endif
@@ -0,0 +1,67 @@
+#ifndef GCUTG_H
+#define GCUTG_H
+
+#include <vector>
+
+#include "TCutG.h"
+
+/////////////////////////////////////////////////////////////////
+///
+/// \class GCutG
+///
+/// TCutG with a fast IsInside for cuts that are checked for every
+/// event (e.g. PID or timing gates).
+///
+/// Points outside the bounding box of the polygon are rejected
+/// right away. For the others only the edges that overlap the same
+/// horizontal slab of the polygon as the point are checked, instead
+/// of walking the whole polygon. The result is the same as the one
+/// of TCutG::IsInside (up to rounding for points on the boundary).
+///
+/// The slabs are built when the cut is created, read, or changed via
+/// SetPoint. Other changes of the points need a call of Update,
+/// until then TCutG::IsInside is used if the number of points changed.
+///
+/////////////////////////////////////////////////////////////////
+
+class GCutG : public TCutG {
+public:
+   GCutG() = default;
+   explicit GCutG(const TCutG& cut);
+   GCutG(const char* name, Int_t n, const Double_t* x, const Double_t* y);
+
+   using TCutG::IsInside;
+   Int_t IsInside(Double_t x, Double_t y) const override;
+   void  IsInside(Int_t n, const Double_t* x, const Double_t* y, Bool_t* inside) const;
+
+   void SetPoint(Int_t i, Double_t x, Double_t y) override;
+   void Update();
+
+private:
+   /// Edge from point fX1, fY1 to point fX2, fY2
+   struct TEdge {
+      Double_t fX1;
+      Double_t fY1;
+      Double_t fX2;
+      Double_t fY2;
+   };
+
+   static constexpr Int_t kMaxSlabs = 256;   ///< maximum number of slabs
+
+   Int_t Slab(Double_t y) const;
+
+   Int_t              fSlabPoints{-1};   //!<! number of points the slabs were built for, -1 if they haven't been built
+   Double_t           fXMin{0.};         //!<! bounding box of the polygon
+   Double_t           fXMax{0.};         //!<! bounding box of the polygon
+   Double_t           fYMin{0.};         //!<! bounding box of the polygon
+   Double_t           fYMax{0.};         //!<! bounding box of the polygon
+   Double_t           fSlabScale{0.};    //!<! number of slabs per unit of y
+   std::vector<Int_t> fSlabStart;        //!<! index of the first edge of each slab in fSlabEdges, plus the end of the last slab
+   std::vector<TEdge> fSlabEdges;        //!<! edges of all slabs, an edge spanning several slabs is stored in each of them
+
+   /// \cond CLASSIMP
+   ClassDefOverride(GCutG, 1)   // NOLINT(readability-else-after-return)
+                                /// \endcond
+};
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef GGATE_H
+#define GGATE_H
+
+#include <string>
+#include <vector>
+
+#include "Rtypes.h"
+
+class TH1;
+class TH1D;
+
+/////////////////////////////////////////////////////////////////
+///
+/// \class GGate
+///
+/// A gate for GHSym::Projections and GCube::Projections, which
+/// project many gates in a single sweep over the histogram.
+///
+/// A gate is a list of bin ranges with weights, its projection is
+/// the sum of the projections of all ranges multiplied by their
+/// weights. The first range is the gate itself, background regions
+/// are added with a negative weight (AddBackground). The second bin
+/// range of each range is only used for GCube (double gates).
+///
+/////////////////////////////////////////////////////////////////
+
+class GGate {
+public:
+   /// Bin range (first to last bin, inclusive) with a weight
+   struct TWeightedRange {
+      Int_t    fFirst{0};     ///< first bin of the gate
+      Int_t    fLast{-1};     ///< last bin of the gate
+      Int_t    fFirst2{0};    ///< first bin of the second gate (GCube only)
+      Int_t    fLast2{-1};    ///< last bin of the second gate (GCube only)
+      Double_t fWeight{1.};   ///< weight of this range
+   };
+
+   GGate() = default;
+   GGate(Int_t first, Int_t last, const char* name = "") : fName(name) { AddRange(first, last, 0, -1, 1.); }
+   GGate(Int_t first, Int_t last, Int_t first2, Int_t last2, const char* name = "") : fName(name) { AddRange(first, last, first2, last2, 1.); }
+
+   /// Adds a range with weight, a last bin of -1 means up to the overflow bin
+   GGate& AddRange(Int_t first, Int_t last, Int_t first2, Int_t last2, Double_t weight)
+   {
+      fRanges.push_back({first, last, first2, last2, weight});
+      return *this;
+   }
+
+   /// Adds a background region that is subtracted scaled by scale, or for a negative scale by the ratio of the
+   /// number of bins of the gate (the first range) and of the background region
+   GGate& AddBackground(Int_t first, Int_t last, Double_t scale = -1.) { return AddBackground(first, last, 0, -1, scale); }
+   GGate& AddBackground(Int_t first, Int_t last, Int_t first2, Int_t last2, Double_t scale = -1.)
+   {
+      if(scale < 0. && !fRanges.empty()) {
+         scale = static_cast<Double_t>(Bins(fRanges[0].fFirst, fRanges[0].fLast) * Bins(fRanges[0].fFirst2, fRanges[0].fLast2)) /
+                 static_cast<Double_t>(Bins(first, last) * Bins(first2, last2));
+      }
+      return AddRange(first, last, first2, last2, -scale);
+   }
+
+   /// Creates (or re-uses) the projection of a gate onto the x-axis of histogram from the summed bin contents
+   static TH1D* Projection(const char* name, const TH1& histogram, const Double_t* content, const Double_t* error2);
+
+   const std::vector<TWeightedRange>& Ranges() const { return fRanges; }
+   const std::string&                 Name() const { return fName; }
+   void                               Name(const char* name) { fName = name; }
+
+private:
+   /// Number of bins in first to last, 1 for a range of all bins (last = -1) so it doesn't affect the ratio
+   static Long64_t Bins(Int_t first, Int_t last) { return last < first ? 1 : static_cast<Long64_t>(last - first + 1); }
+
+   std::string                 fName;     ///< name of the projection of this gate
+   std::vector<TWeightedRange> fRanges;   ///< weighted bin ranges of this gate
+};
+
+#endif
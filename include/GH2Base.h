@@ -4,11 +4,14 @@
 #include <cstdio>
 #include <iostream>
 #include <map>
+#include <memory>
 
 #include <TNamed.h>
 #include <TH2.h>
 #include <TList.h>
 
+#include "GProjectionIndex.h"
+
 class GH1D;
 
 enum class EBackgroundSubtraction { kNoBackground,
@@ -66,6 +69,14 @@ public:
    void       SetSummaryDirection(EDirection dir) { fSummaryDirection = dir; }
    EDirection GetSummaryDirection() const { return fSummaryDirection; }
 
+   void UseProjectionIndex(bool val = true);
+   bool UsesProjectionIndex() const { return fUseProjectionIndex; }
+   void ResetProjectionIndex();
+
+   /// Entries, sums of weights, and number of cells of the matrix, used to check whether the projection index is outdated.
+   /// The default is no fingerprint (NaN), which disables the projection index.
+   virtual GProjectionIndex::TFingerprint ProjectionFingerprint() const;
+
    class iterator {   // NOLINT(readability-identifier-naming)
    public:
       explicit iterator(GH2Base* mat)
@@ -111,14 +122,23 @@ public:
    iterator begin() { return {this, false}; }
    iterator end() { return {this, true}; }
 
+protected:
+   TH1D* Project(int axis, const char* name, int firstbin, int lastbin, Option_t* option = "");
+
 private:
-   void   Init();
+   void                    Init();
+   const GProjectionIndex* ProjectionIndex(int axis, bool errors);
+
    TList* fProjections{nullptr};
 
    TList*     fSummaryProjections{nullptr};   //!
    bool       fIsSummary{false};
    EDirection fSummaryDirection{EDirection::kXDirection};
 
+   bool                              fUseProjectionIndex{false};   //! flag whether the projections use the projection index
+   std::shared_ptr<GProjectionIndex> fProjectionIndexX;            //! cumulative sums along the y-axis for projections on the x-axis
+   std::shared_ptr<GProjectionIndex> fProjectionIndexY;            //! cumulative sums along the x-axis for projections on the y-axis
+
    /// /cond CLASSIMP
    ClassDef(GH2Base, 1)   // NOLINT(readability-else-after-return)
                           /// /endcond
@@ -41,12 +41,22 @@ public:
    void     Copy(TObject&) const override;
    TObject* Clone(const char* newname = "") const override;
 
+   // all of these drop the projection index, the projection fingerprint doesn't always see their changes
+   void Reset(Option_t* opt = "") override;
+   using TH2D::SetBinContent;
+   void SetBinContent(Int_t bin, Double_t content) override;
+   using TH2D::Add;
+   Bool_t Add(const TH1* h1, Double_t c1 = 1) override;
+   Bool_t Add(const TH1* h1, const TH1* h2, Double_t c1 = 1, Double_t c2 = 1) override;
+
    GH1D* ProjectionX(const char* name = "_px", int firstbin = 0, int lastbin = -1, Option_t* option = "");   // *MENU*
 
    GH1D* ProjectionY(const char* name = "_py", int firstbin = 0, int lastbin = -1, Option_t* option = "");   // *MENU*
 
    TH2* GetTH2() override { return this; }
 
+   GProjectionIndex::TFingerprint ProjectionFingerprint() const override { return {fEntries, fTsumw, fTsumw2, static_cast<Double_t>(fNcells)}; }
+
 private:
    /// /cond CLASSIMP
    ClassDefOverride(GH2D, 1)   // NOLINT(readability-else-after-return)
@@ -9,6 +9,14 @@
 #include "TF1.h"
 #include "TRandom.h"
 
+#include <array>
+#include <utility>
+#include <vector>
+
+#include "GGate.h"
+#include "GProjectionIndex.h"
+#include "GSharedFill.h"
+
 class GHSym : public TH1 {
 public:
    GHSym();
@@ -20,7 +28,7 @@ public:
    GHSym& operator=(const GHSym&);
    GHSym& operator=(GHSym&&) noexcept;
 
-   ~GHSym() = default;
+   ~GHSym();
 
    Int_t         BufferEmpty(Int_t action = 0) override;
    Int_t         BufferFill(Double_t, Double_t) override { return -2; }   // MayNotUse
@@ -105,11 +113,25 @@ public:
    Int_t             ShowPeaks(Double_t sigma = 2, Option_t* option = "", Double_t threshold = 0.05) override;   // *MENU*
    void              Smooth(Int_t ntimes = 1, Option_t* option = "") override;                                   // *MENU*
 
+   void SetShared(bool val = true);
+   bool IsShared() const { return fSharedFill != nullptr; }
+
+   void FillCombinations(const Double_t* energies, size_t n, Double_t w = 1.);
+
+   std::vector<TH1D*> Projections(const std::vector<GGate>& gates, Option_t* option = "", Int_t nThreads = 0) const;
+
+   void UseProjectionIndex(bool val = true);
+   bool UsesProjectionIndex() const { return fUseProjectionIndex; }
+   void ResetProjectionIndex();
+
 protected:
    using TH1::DoIntegral;
    virtual Double_t DoIntegral(Int_t binx1, Int_t binx2, Int_t biny1, Int_t biny2, Double_t& error, Option_t* option,
                                Bool_t doError = kFALSE) const;
 
+   Int_t FindFillBin(Double_t x, Double_t y, Bool_t& inRange);
+   void  FindFillBins(const Double_t* x, size_t n, Int_t* bins);
+
    TH2* Matrix() { return fMatrix; }
    void Matrix(TH2* val) { fMatrix = val; }
 
@@ -119,6 +141,17 @@ private:
    Double_t fTsumwxy{0.};       ///< Total Sum of weight*X*Y
    TH2*     fMatrix{nullptr};   //!<! Transient pointer to the 2D-Matrix used in Draw() or GetMatrix()
 
+   GSharedFill* fSharedFill{nullptr};   //!<! Transient buffers and locks used while the histogram is shared by several threads
+
+   bool                      fUseProjectionIndex{false};   //!<! Flag whether Projection uses fProjectionIndex
+   mutable GProjectionIndex* fProjectionIndex{nullptr};    //!<! Transient cumulative sums along the y-axis, built on demand by Projection
+
+   const GProjectionIndex* ProjectionIndex(bool errors) const;
+
+   void FillShared(Double_t x, Double_t y, Double_t w);
+   void FlushShared(GSharedFill::TBuffer& buffer);
+   void AddShared(std::vector<std::pair<Int_t, Double_t>>& bins, const std::array<Double_t, 7>& stats, Double_t entries);
+
    /// /cond CLASSIMP
    ClassDefOverride(GHSym, 1)   // NOLINT(readability-else-after-return)
                                 /// /endcond
@@ -0,0 +1,111 @@
+#ifndef GPROJECTIONINDEX_H
+#define GPROJECTIONINDEX_H
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+#include "Rtypes.h"
+
+/////////////////////////////////////////////////////////////////
+///
+/// \class GProjectionIndex
+///
+/// Cumulative sums (prefix sums) of the content and the squared
+/// errors of a histogram along the gate axis (or the two gate axes),
+/// one row per bin of the projected axis. With these the content of
+/// a gated projection is the difference of two sums per output bin
+/// (four for two gate axes), independent of the width of the gate.
+///
+/// Used by GHSym::Projection, GCube::Projection, and the projections
+/// of GH2Base once they are enabled via UseProjectionIndex. The index
+/// remembers the entries, sums of weights, and number of cells of the
+/// histogram it was built from (TFingerprint) and is rebuilt if they
+/// changed. Changes of the content that don't change any of
+/// them (e.g. AddBinContent) need a call of ResetProjectionIndex.
+///
+/// The sums are kept in double precision, so the projections agree
+/// with summing the bins directly up to rounding.
+///
+/////////////////////////////////////////////////////////////////
+
+class GProjectionIndex {
+public:
+   /// Entries, sum of weights, sum of squared weights, and number of cells of a histogram
+   using TFingerprint = std::array<Double_t, 4>;
+
+   GProjectionIndex(Int_t nOut, Int_t nGate, Int_t gateAxes, bool errors);
+
+   static Long64_t Bytes(Int_t nOut, Int_t nGate, Int_t gateAxes, bool errors);
+
+   /// Calculates the sums for one gate axis from content(out, gate) and error2(out, gate), bins start at 0.
+   template <typename TContent, typename TError2>
+   void Build(TContent content, TError2 error2, const TFingerprint& fingerprint);
+   /// Calculates the sums for two gate axes from content(out, gate1, gate2) and error2(out, gate1, gate2).
+   template <typename TContent, typename TError2>
+   void Build2(TContent content, TError2 error2, const TFingerprint& fingerprint);
+
+   Double_t Sum(Int_t out, Int_t first, Int_t last) const { return Sum(fContent, out, first, last); }
+   Double_t Sum(Int_t out, Int_t first1, Int_t last1, Int_t first2, Int_t last2) const { return Sum(fContent, out, first1, last1, first2, last2); }
+   Double_t Error2(Int_t out, Int_t first, Int_t last) const { return Sum(fError2, out, first, last); }
+   Double_t Error2(Int_t out, Int_t first1, Int_t last1, Int_t first2, Int_t last2) const { return Sum(fError2, out, first1, last1, first2, last2); }
+
+   bool  HasErrors() const { return !fError2.empty(); }
+   bool  Matches(const TFingerprint& fingerprint) const { return fFingerprint == fingerprint; }
+   Int_t GateAxes() const { return fGateAxes; }
+
+private:
+   Double_t Sum(const std::vector<Double_t>& sums, Int_t out, Int_t first, Int_t last) const;
+   Double_t Sum(const std::vector<Double_t>& sums, Int_t out, Int_t first1, Int_t last1, Int_t first2, Int_t last2) const;
+
+   size_t Row(Int_t out) const { return static_cast<size_t>(out) * fRowSize; }
+
+   Int_t                 fNOut{0};         ///< number of bins of the projected axis (including under- and overflow)
+   Int_t                 fNGate{0};        ///< number of bins of the gate axes (including under- and overflow)
+   Int_t                 fGateAxes{1};     ///< number of gate axes (1 or 2)
+   size_t                fRowSize{0};      ///< number of sums per bin of the projected axis
+   std::vector<Double_t> fContent;         ///< sums of the content, fContent[Row(out) + i] is the sum of the gate bins below i
+   std::vector<Double_t> fError2;          ///< sums of the squared errors, empty if they are not needed
+   TFingerprint          fFingerprint{};   ///< fingerprint of the histogram the sums were built from
+};
+
+template <typename TContent, typename TError2>
+void GProjectionIndex::Build(TContent content, TError2 error2, const TFingerprint& fingerprint)
+{
+   // the sums of each row start with a zero, so the sum of the bins first to last is the difference of two entries
+   for(Int_t out = 0; out < fNOut; ++out) {
+      Double_t* sum  = fContent.data() + Row(out);
+      Double_t* sum2 = fError2.empty() ? nullptr : fError2.data() + Row(out);
+      for(Int_t gate = 0; gate < fNGate; ++gate) {
+         sum[gate + 1] = sum[gate] + content(out, gate);
+         if(sum2 != nullptr) {
+            sum2[gate + 1] = sum2[gate] + error2(out, gate);
+         }
+      }
+   }
+   fFingerprint = fingerprint;
+}
+
+template <typename TContent, typename TError2>
+void GProjectionIndex::Build2(TContent content, TError2 error2, const TFingerprint& fingerprint)
+{
+   // each row is a (fNGate+1)x(fNGate+1) table of two-dimensional sums, starting with a row and column of zeros
+   const size_t stride = static_cast<size_t>(fNGate) + 1;
+   for(Int_t out = 0; out < fNOut; ++out) {
+      Double_t* sum  = fContent.data() + Row(out);
+      Double_t* sum2 = fError2.empty() ? nullptr : fError2.data() + Row(out);
+      for(Int_t gate1 = 0; gate1 < fNGate; ++gate1) {
+         const size_t below = gate1 * stride;
+         const size_t row   = below + stride;
+         for(Int_t gate2 = 0; gate2 < fNGate; ++gate2) {
+            sum[row + gate2 + 1] = content(out, gate1, gate2) + sum[row + gate2] + sum[below + gate2 + 1] - sum[below + gate2];
+            if(sum2 != nullptr) {
+               sum2[row + gate2 + 1] = error2(out, gate1, gate2) + sum2[row + gate2] + sum2[below + gate2 + 1] - sum2[below + gate2];
+            }
+         }
+      }
+   }
+   fFingerprint = fingerprint;
+}
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef GSHAREDFILL_H
+#define GSHAREDFILL_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "Rtypes.h"
+
+/////////////////////////////////////////////////////////////////
+///
+/// \class GSharedFill
+///
+/// Bookkeeping for a GHSym or GCube that is filled from several
+/// threads at the same time (see GHSym::SetShared and GCube::SetShared).
+///
+/// Each thread gets its own small buffer of fills. When the buffer
+/// is full, the histogram turns the buffered values into bins and
+/// statistics without holding any lock, sorts the bins, and adds them
+/// to the shared bin array, locking one stripe of bins at a time. So
+/// the memory needed is independent of the number of threads, and
+/// threads only wait for each other if they add to the same stripe
+/// at the same time.
+///
+/// The buffers are owned by this object, so the ones of all threads
+/// can be flushed at the end (GHSym::SetShared(false)).
+///
+/////////////////////////////////////////////////////////////////
+
+class GSharedFill {
+public:
+   /// Buffered fills of one thread, each fill is a fixed number of values (e.g. x, y, weight)
+   using TBuffer = std::vector<Double_t>;
+
+   explicit GSharedFill(size_t valuesPerFill, size_t fillsPerBuffer = 1024);
+   GSharedFill(const GSharedFill&)                = delete;
+   GSharedFill(GSharedFill&&) noexcept            = delete;
+   GSharedFill& operator=(const GSharedFill&)     = delete;
+   GSharedFill& operator=(GSharedFill&&) noexcept = delete;
+   ~GSharedFill()                                 = default;
+
+   TBuffer& Buffer();
+   bool     IsFull(const TBuffer& buffer) const { return buffer.size() >= fBufferSize; }
+
+   std::vector<TBuffer*> Buffers();
+
+   /// Mutex of the stripe of bins the bin belongs to
+   std::mutex& StripeMutex(Long64_t bin) { return fStripeMutex[static_cast<size_t>(bin >> kStripeShift) % kNumberOfStripes]; }
+   /// Returns true if both bins belong to the same stripe
+   static bool SameStripe(Long64_t bin1, Long64_t bin2) { return (bin1 >> kStripeShift) == (bin2 >> kStripeShift); }
+   /// Mutex for the statistics (entries and sums of weights) of the histogram
+   std::mutex& StatsMutex() { return fStatsMutex; }
+
+private:
+   static constexpr int    kStripeShift     = 12;     ///< each stripe has 2^kStripeShift consecutive bins
+   static constexpr size_t kNumberOfStripes = 1024;   ///< number of stripe mutexes, stripes further apart share a mutex
+
+   static std::atomic<uint64_t> fLastId;   ///< last id handed out, ids identify the buffers of the threads
+
+   uint64_t                                 fId;            ///< unique id of this object
+   size_t                                   fBufferSize;    ///< number of values after which a buffer is full
+   std::mutex                               fMutex;         ///< mutex for fBuffers
+   std::vector<std::unique_ptr<TBuffer>>    fBuffers;       ///< buffers of all threads that filled the histogram
+   std::mutex                               fStatsMutex;    ///< mutex for the statistics of the histogram
+   std::array<std::mutex, kNumberOfStripes> fStripeMutex;   ///< mutexes of the stripes of bins
+};
+
+#endif
@@ -12,12 +12,18 @@
 /// This loop takes built events and fills histograms using
 /// 'histos/MakeAnalysisHistograms.cxx'
 ///
+/// With --histogram-threads N, N threads take items from the input
+/// queue, each filling its own shard of the histograms (see
+/// TCompiledHistograms and THistogramWorkers), which are merged
+/// when writing and when the histograms are requested via GetObjects.
+///
 ////////////////////////////////////////////////////////////////////////////////
 
 #include <string>
 
 #include "StoppableThread.h"
 #include "TCompiledHistograms.h"
+#include "THistogramWorkers.h"
 #include "ThreadsafeQueue.h"
 #include "TUnpackedEvent.h"
 
@@ -71,12 +77,14 @@ private:
 
    void OpenFile();
    void CloseFile();
+   void StartWorkers();
 
    TFile*      fOutputFile;
    std::string fOutputFilename;
 
 #ifndef __CINT__
    std::shared_ptr<ThreadsafeQueue<std::shared_ptr<TUnpackedEvent>>> fInputQueue;
+   THistogramWorkers<std::shared_ptr<TUnpackedEvent>>                fWorkers;   ///< additional threads filling the histograms
 #endif
 
    /// \cond CLASSIMP
@@ -6,7 +6,9 @@
  */
 
 #include <future>
+#include <chrono>
 #include <vector>
+#include <unordered_set>
 
 #include "TClass.h"
 #include "TTree.h"
@@ -21,6 +23,11 @@
 ///
 /// This loop writes built events to file
 ///
+/// As with the TFragWriteLoop, the output can be rolled over to a new
+/// file after a configurable number of bytes, entries, or minutes. The
+/// branches already created are re-created in each new file, the PPG and
+/// sorting diagnostics are snapshots of the sort up to the end of that file.
+///
 ////////////////////////////////////////////////////////////////////////////////
 
 class TAnalysisWriteLoop : public StoppableThread {
@@ -59,17 +66,29 @@ protected:
 private:
    TAnalysisWriteLoop(std::string name, const std::string& outputFilename);
 
+   void OpenOutputFile();
+   bool ShouldRollOver() const;
+   void RollOver();
+   void WriteFile(bool rollOver);
+
    void AddBranch(TClass* cls);
    void WriteEvent(std::shared_ptr<TUnpackedEvent>& event);
 
-   TFile*     fOutputFile;
-   TTree*     fEventTree;
-   TTree*     fOutOfOrderTree;
-   TFragment* fOutOfOrderFrag;
-   bool       fOutOfOrder;
+   std::string fOutputFilename;
+   size_t      fFileIndex{0};   ///< index of the current output file (only non-zero if output files are rolled over)
+#ifndef __CINT__
+   std::chrono::steady_clock::time_point fFileStartTime;   ///< time the current output file was opened
+#endif
+
+   TFile*     fOutputFile{nullptr};
+   TTree*     fEventTree{nullptr};
+   TTree*     fOutOfOrderTree{nullptr};
+   TFragment* fOutOfOrderFrag{nullptr};
+   bool       fOutOfOrder{false};
 #ifndef __CINT__
    std::map<TClass*, TDetector**>                                     fDetMap;
    std::map<TClass*, TDetector*>                                      fDefaultDets;
+   std::unordered_set<TClass*>                                        fWriteDetectors;   ///< detector classes written to the tree (from --build-detector), all if empty
    std::shared_ptr<ThreadsafeQueue<std::shared_ptr<TUnpackedEvent>>>  fInputQueue;
    std::shared_ptr<ThreadsafeQueue<std::shared_ptr<const TFragment>>> fOutOfOrderQueue;
 #endif
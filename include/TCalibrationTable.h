@@ -0,0 +1,175 @@
+#ifndef TCALIBRATIONTABLE_H
+#define TCALIBRATIONTABLE_H
+
+/** \addtogroup Sorting
+ *  @{
+ */
+
+/////////////////////////////////////////////////////////////////
+///
+/// \class TCalibrationTable
+///
+/// The TCalibrationTable is a flattened, immutable snapshot of the
+/// energy and time calibrations of all TChannels, used on the hot path
+/// of the sort (TDetectorHit::GetEnergy and TDetectorHit::GetTime).
+/// The channels are found through a dense address index, or a sorted
+/// list of addresses if they are spread out too far.
+///
+/// TCalibrationTable::Get returns the current snapshot without locking,
+/// a new one is built once a calibration in a TChannel changes, or is
+/// published by TCalibrationTable::Reload during an online sort. The
+/// results are the same as those of the TChannel calibration functions.
+///
+/////////////////////////////////////////////////////////////////
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Rtypes.h"
+
+class TChannel;
+class TMnemonic;
+class TGraph;
+
+class TCalibrationTable {
+public:
+   /// Range of coefficients in TCalibrationTable::fCoefficients
+   struct TCoefficients {
+      uint32_t fFirst{0};   ///< index of the first (constant) coefficient
+      uint32_t fSize{0};    ///< number of coefficients
+   };
+
+   /// Flattened calibration of a single channel
+   struct TChannelCalibration {
+      const TChannel*  fChannel{nullptr};               ///< copy of the channel this calibration was compiled from, owned by the table
+      unsigned int     fAddress{0};                     ///< address of the channel
+      const TMnemonic* fMnemonic{nullptr};              ///< mnemonic of the channel, used to calculate the time
+      int              fIntegration{0};                 ///< integration from the channel
+      bool             fUseCalFileIntegration{false};   ///< flag whether the integration of the channel is always used
+      uint32_t         fFirstPolynomial{0};             ///< index of the first energy polynomial in fPolynomials
+      uint32_t         fNofPolynomials{0};              ///< number of energy polynomials
+      uint32_t         fFirstRange{0};                  ///< index of the first energy range in fRanges
+      uint32_t         fNofRanges{0};                   ///< number of energy ranges
+      TCoefficients    fDrift;                          ///< energy drift coefficients
+      uint32_t         fFirstSegment{0};                ///< index of the first energy nonlinearity segment in fSegments (and of its grid in fBuckets)
+      uint32_t         fNofSegments{0};                 ///< number of energy nonlinearity segments, zero if there is no energy nonlinearity
+      double           fNonlinearityLow{0.};            ///< lowest energy covered by the energy nonlinearity
+      double           fNonlinearityHigh{0.};           ///< highest energy covered by the energy nonlinearity
+      double           fBucketsPerEnergy{0.};           ///< inverse width of the buckets of the energy nonlinearity grid
+   };
+
+   static const TCalibrationTable&                 Get();
+   static std::shared_ptr<const TCalibrationTable> Snapshot();
+   static void                                     Invalidate() { ++fGeneration; }
+   static uint64_t                                 Generation() { return fGeneration.load(); }
+
+   static void   Reload(const std::string& fileName, bool wait = false);
+   static void   ReloadData(const std::string& data, bool wait = false);
+   static size_t ApplyReloads();
+   static void   WaitForReload();
+
+   TCalibrationTable(const TCalibrationTable&)                = delete;
+   TCalibrationTable(TCalibrationTable&&) noexcept            = delete;
+   TCalibrationTable& operator=(const TCalibrationTable&)     = delete;
+   TCalibrationTable& operator=(TCalibrationTable&&) noexcept = delete;
+   ~TCalibrationTable();
+
+   uint64_t Version() const { return fVersion; }
+
+   const TChannelCalibration* Find(unsigned int address) const
+   {
+      if(fDense) {
+         if(address < fMinAddress || address - fMinAddress >= fIndex.size()) { return nullptr; }
+         int32_t index = fIndex[address - fMinAddress];
+         return index < 0 ? nullptr : &fCalibrations[index];
+      }
+      return FindSorted(address);
+   }
+
+   size_t Size() const { return fCalibrations.size(); }
+   bool   Dense() const { return fDense; }
+
+   double CalibrateEnergy(const TChannelCalibration& cal, double charge) const;
+   double CalibrateEnergy(const TChannelCalibration& cal, double charge, int integration) const;
+   double EnergyNonlinearity(const TChannelCalibration& cal, double energy) const;
+
+   void Calibrate(size_t size, const UInt_t* address, const Float_t* charge, const Short_t* kValue, const Long64_t* timeStamp, const Float_t* cfd, double* energy, double* time = nullptr) const;
+
+   /// Evaluates the polynomial with size coefficients (lowest order first) at x using the Horner scheme.
+   template <typename T>
+   static double Polynomial(const T* coefficients, size_t size, double x)
+   {
+      auto result = static_cast<double>(coefficients[size - 1]);
+      for(size_t i = size - 1; i > 0; --i) {
+         result = result * x + static_cast<double>(coefficients[i - 1]);
+      }
+      return result;
+   }
+   /// Evaluates the polynomial for n values of x, the same operations as the scalar version, but with the loop over x innermost.
+   static void Polynomial(const double* coefficients, size_t size, const double* x, size_t n, double* result)
+   {
+      for(size_t j = 0; j < n; ++j) {
+         result[j] = coefficients[size - 1];
+      }
+      for(size_t i = size - 1; i > 0; --i) {
+         const double coefficient = coefficients[i - 1];
+         for(size_t j = 0; j < n; ++j) {
+            result[j] = result[j] * x[j] + coefficient;
+         }
+      }
+   }
+
+   void Print(Option_t* opt = "") const;
+
+private:
+   TCalibrationTable() = default;
+
+   static void                Publish();
+   static void                Update(const std::string& data);
+   void                       Build();
+   const TChannelCalibration* FindSorted(unsigned int address) const;
+   TCoefficients              AddCoefficients(const std::vector<double>& coefficients);
+   TCoefficients              AddCoefficients(const std::vector<Float_t>& coefficients);
+   void                       AddNonlinearity(TChannelCalibration& cal, const TGraph& graph);
+
+   /// Linear segment of an energy nonlinearity, valid from fX up to the fX of the next segment
+   struct TSegment {
+      double fX{0.};       ///< energy of the lower point
+      double fY{0.};       ///< nonlinearity at the lower point
+      double fSlope{0.};   ///< slope up to the next point
+   };
+
+   static constexpr size_t kMaxDenseSpan = 1 << 20;   ///< maximum address span for which the dense index is used
+
+   std::vector<TChannelCalibration>              fCalibrations;    ///< compiled calibrations
+   std::vector<std::unique_ptr<const TChannel>>  fChannels;        ///< copies of the channels, so threads using this table never access a deleted TChannel
+   std::vector<TCoefficients>                    fPolynomials;     ///< energy polynomials of all channels
+   std::vector<std::pair<double, double>>        fRanges;          ///< energy ranges of all channels
+   std::vector<double>                           fCoefficients;    ///< all coefficients of all channels
+   std::vector<TSegment>                         fSegments;        ///< energy nonlinearity segments of all channels
+   std::vector<uint32_t>                         fBuckets;         ///< uniform energy grid per channel, each bucket holds the segment containing its lower edge
+   bool                                          fDense{true};     ///< flag whether fIndex is used
+   unsigned int                                  fMinAddress{0};   ///< address of fIndex[0]
+   std::vector<int32_t>                          fIndex;           ///< index of the calibration of each address, -1 if there is none
+   std::vector<std::pair<unsigned int, int32_t>> fSortedIndex;     ///< sorted addresses and indices if the addresses are too spread out for fIndex
+
+   uint64_t fVersion{0};   ///< version of this snapshot, incremented with every published table
+
+   static std::atomic<uint64_t>                       fGeneration;        ///< incremented on every change of the calibrations in the TChannels
+   static std::atomic<uint64_t>                       fBuiltGeneration;   ///< generation the current table was built for
+   static std::atomic<uint64_t>                       fPublished;         ///< version of the current table
+   static std::shared_ptr<const TCalibrationTable>    fCurrent;           ///< current table, only accessed with std::atomic_load/std::atomic_store
+   static std::unordered_map<unsigned int, TChannel*> fReloaded;          ///< channels with calibrations reloaded during the sort, not yet applied to the TChannels
+   static std::mutex                                  fBuildMutex;        ///< mutex to make sure only one thread builds a table at a time
+   static std::thread                                 fReloadThread;      ///< thread of the last reload, joined by WaitForReload
+   static std::mutex                                  fReloadMutex;       ///< mutex protecting fReloadThread
+};
+/*! @} */
+#endif
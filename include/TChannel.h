@@ -80,7 +80,20 @@ public:
    static void      SetMnemonicClass(const TClassRef& cls) { fMnemonicClass = cls; }
    static TClassRef GetMnemonicClass() { return fMnemonicClass; }
 
+   static void CalibrationChanged();   ///< invalidates the TCalibrationTable, called by all functions changing a calibration
+
+   friend class TCalibrationTable;
+
 private:
+   TChannel(const char* tempName, bool detached);
+   TChannel(const TChannel& chan, bool detached);
+
+   /// invalidates the TCalibrationTable, unless this is a detached channel
+   void Changed() const
+   {
+      if(!fDetached) { CalibrationChanged(); }
+   }
+
    unsigned int                fAddress{0};       // The address of the digitizer
    TPriorityValue<int>         fIntegration{1};   // The charge integration setting
    TPriorityValue<std::string> fDigitizerTypeString;
@@ -94,6 +107,8 @@ private:
    mutable int fSegmentNumber{-1};
    mutable int fCrystalNumber{-1};
 
+   bool fDetached{false};   ///< detached channels (parsed or copied for the calibration table) aren't in the channel maps and don't change the calibration table
+
    TPriorityValue<Long64_t>   fTimeOffset;
    TPriorityValue<double>     fTimeDrift;   ///< Time drift factor
    TPriorityValue<TMnemonic*> fMnemonic;
@@ -139,6 +154,10 @@ public:
    inline void SetNumber(const TPriorityValue<int>& tmp)
    {
       if(fNumber == tmp) { return; }
+      if(fDetached) {
+         fNumber = tmp;
+         return;
+      }
       // channel number has changed so we need to delete the old one and insert the new one
       fChannelNumberMap->erase(fNumber.Value());
       fNumber = tmp;
@@ -146,13 +165,25 @@ public:
          fChannelNumberMap->insert(std::make_pair(fNumber.Value(), this));
       }
    }
-   inline void SetIntegration(const TPriorityValue<int>& tmp) { fIntegration = tmp; }
+   inline void SetIntegration(const TPriorityValue<int>& tmp)
+   {
+      fIntegration = tmp;
+      Changed();
+   }
    static void SetIntegration(const std::string& mnemonic, int tmpint, EPriority pr);
    inline void SetStream(const TPriorityValue<int>& tmp) { fStream = tmp; }
    void        SetDigitizerType(const TPriorityValue<std::string>& tmp);
    static void SetDigitizerType(const std::string& mnemonic, const char* tmpstr, EPriority prio);
-   inline void SetTimeOffset(const TPriorityValue<Long64_t>& tmp) { fTimeOffset = tmp; }
-   inline void SetTimeDrift(const TPriorityValue<double>& tmp) { fTimeDrift = tmp; }
+   inline void SetTimeOffset(const TPriorityValue<Long64_t>& tmp)
+   {
+      fTimeOffset = tmp;
+      Changed();
+   }
+   inline void SetTimeDrift(const TPriorityValue<double>& tmp)
+   {
+      fTimeDrift = tmp;
+      Changed();
+   }
 
    void SetDetectorNumber(int tempint) { fDetectorNumber = tempint; }
    void SetSegmentNumber(int tempint) { fSegmentNumber = tempint; }
@@ -184,7 +215,11 @@ public:
    double              GetTIMEChi2() const { return fTIMEChi2.Value(); }
    double              GetEFFChi2() const { return fEFFChi2.Value(); }
 
-   void        SetUseCalFileIntegration(const TPriorityValue<bool>& tmp = TPriorityValue<bool>(true, EPriority::kUser)) { fUseCalFileInt = tmp; }
+   void SetUseCalFileIntegration(const TPriorityValue<bool>& tmp = TPriorityValue<bool>(true, EPriority::kUser))
+   {
+      fUseCalFileInt = tmp;
+      Changed();
+   }
    static void SetUseCalFileIntegration(const std::string& mnemonic, bool flag, EPriority pr);
    bool        UseCalFileIntegration() { return fUseCalFileInt.Value(); }
 
@@ -205,41 +240,85 @@ public:
    {
       if(range >= fENGCoefficients.size()) { fENGCoefficients.resize(range + 1); }
       fENGCoefficients.Address()->at(range).push_back(temp);
+      Changed();
+   }
+   inline void AddENGDriftCoefficent(Float_t temp)
+   {
+      fENGDriftCoefficents.Address()->push_back(temp);
+      Changed();
+   }
+   inline void AddCFDCoefficient(double temp)
+   {
+      fCFDCoefficients.Address()->push_back(temp);
+      Changed();
    }
-   inline void AddENGDriftCoefficent(Float_t temp) { fENGDriftCoefficents.Address()->push_back(temp); }
-   inline void AddCFDCoefficient(double temp) { fCFDCoefficients.Address()->push_back(temp); }
    inline void AddLEDCoefficient(double temp) { fLEDCoefficients.Address()->push_back(temp); }
-   inline void AddTIMECoefficient(double temp) { fTIMECoefficients.Address()->push_back(temp); }
+   inline void AddTIMECoefficient(double temp)
+   {
+      fTIMECoefficients.Address()->push_back(temp);
+      Changed();
+   }
    inline void AddEFFCoefficient(double temp) { fEFFCoefficients.Address()->push_back(temp); }
    inline void AddCTCoefficient(double temp) { fCTCoefficients.Address()->push_back(temp); }
-   void        AddEnergyNonlinearityPoint(double x, double y) { fEnergyNonlinearity.Address()->SetPoint(fEnergyNonlinearity.Address()->GetN(), x, y); }
+   void        AddEnergyNonlinearityPoint(double x, double y)
+   {
+      fEnergyNonlinearity.Address()->SetPoint(fEnergyNonlinearity.Address()->GetN(), x, y);
+      Changed();
+   }
 
    inline void ResizeENG(size_t size)
    {
       fENGCoefficients.resize(size);
       fENGChi2.resize(size);
       fENGRanges.resize(size);
+      Changed();
    }
 
-   void SetAllENGCoefficients(const TPriorityValue<std::vector<std::vector<Float_t>>>& tmp) { fENGCoefficients = tmp; }
+   void SetAllENGCoefficients(const TPriorityValue<std::vector<std::vector<Float_t>>>& tmp)
+   {
+      fENGCoefficients = tmp;
+      Changed();
+   }
    void SetENGCoefficients(const std::vector<Float_t>& tmp, size_t range = 0)
    {
       if(range >= fENGCoefficients.size()) { fENGCoefficients.resize(range + 1); }
       fENGCoefficients.Address()->at(range) = tmp;
+      Changed();
+   }
+   void SetENGRanges(const TPriorityValue<std::vector<std::pair<double, double>>>& tmp)
+   {
+      fENGRanges = tmp;
+      Changed();
    }
-   void SetENGRanges(const TPriorityValue<std::vector<std::pair<double, double>>>& tmp) { fENGRanges = tmp; }
    void SetENGRange(const std::pair<double, double>& tmp, const size_t& range)
    {
       if(range >= fENGRanges.size()) { fENGRanges.resize(range + 1); }
       fENGRanges.Address()->at(range) = tmp;
+      Changed();
+   }
+   void SetENGDriftCoefficents(const TPriorityValue<std::vector<Float_t>>& tmp)
+   {
+      fENGDriftCoefficents = tmp;
+      Changed();
+   }
+   void SetCFDCoefficients(const TPriorityValue<std::vector<double>>& tmp)
+   {
+      fCFDCoefficients = tmp;
+      Changed();
    }
-   void SetENGDriftCoefficents(const TPriorityValue<std::vector<Float_t>>& tmp) { fENGDriftCoefficents = tmp; }
-   void SetCFDCoefficients(const TPriorityValue<std::vector<double>>& tmp) { fCFDCoefficients = tmp; }
    void SetLEDCoefficients(const TPriorityValue<std::vector<double>>& tmp) { fLEDCoefficients = tmp; }
-   void SetTIMECoefficients(const TPriorityValue<std::vector<double>>& tmp) { fTIMECoefficients = tmp; }
+   void SetTIMECoefficients(const TPriorityValue<std::vector<double>>& tmp)
+   {
+      fTIMECoefficients = tmp;
+      Changed();
+   }
    void SetEFFCoefficients(const TPriorityValue<std::vector<double>>& tmp) { fEFFCoefficients = tmp; }
    void SetCTCoefficients(const TPriorityValue<std::vector<double>>& tmp) { fCTCoefficients = tmp; }
-   void SetEnergyNonlinearity(const TPriorityValue<TGraph>& tmp) { fEnergyNonlinearity = tmp; }
+   void SetEnergyNonlinearity(const TPriorityValue<TGraph>& tmp)
+   {
+      fEnergyNonlinearity = tmp;
+      Changed();
+   }
 
    inline void SetAllENGChi2(const TPriorityValue<std::vector<double>>& tmp) { fENGChi2 = tmp; }
    inline void SetENGChi2(const TPriorityValue<double>& tmp, const size_t& range = 0)
@@ -317,6 +396,9 @@ public:
    static void  WriteCalBuffer(Option_t* opt = "");
    static void  ReadEnergyNonlinearities(TFile*, const char* graphName = "EnergyNonlinearity0x", bool all = false);
 
+   static std::vector<TChannel*> ParseChannels(const char* inputdata, EPriority prio = EPriority::kUser, int* lines = nullptr);
+   static Int_t                  ParseBinaryData(const char* data, Int_t size);
+
    void Print(Option_t* opt = "") const override;
    void Clear(Option_t* opt = "") override;
    // static  void PrintAll(Option_t* opt = "");
@@ -325,19 +407,25 @@ public:
    void        PrintCTCoeffs(Option_t* opt = "") const;
 
    static int WriteToRoot(TFile* fileptr = nullptr);
+   static int WriteSnapshot(TFile* fileptr);
 
 private:
    // the follow is to make the custom streamer
    // stuff play nice.  pcb.
    static std::string fFileData;
-   static void        InitChannelInput();
+   static std::string fFileBinary;        ///< binary calibration of the channels in fFileData, written next to it
+   static ULong64_t   fInputHash;         ///< hash of the calibration last read from file
+   static ULong64_t   fInputGeneration;   ///< generation of the TCalibrationTable after the calibration was last read from file
+   static void        InitChannelInput(ULong64_t hash = 0, const char* binary = nullptr, Int_t size = 0);
    static void        SaveToSelf();
    static void        SaveToSelf(const char*);
+   static Int_t       MergeChannels(const std::vector<TChannel*>& channels);
+   static void        WriteBinaryData(TBuffer& buffer, const std::vector<TChannel*>& channels, EPriority prio);
 
    static Int_t ReadFile(TFile* tempf);
 
    /// \cond CLASSIMP
-   ClassDefOverride(TChannel, 6)   // NOLINT(readability-else-after-return)
+   ClassDefOverride(TChannel, 7)   // NOLINT(readability-else-after-return)
    /// \endcond
 };
 /*! @} */
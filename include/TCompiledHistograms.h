@@ -2,10 +2,12 @@
 #define TCOMPILEDHISTOGRAMS_H
 
 #ifndef __CINT__
+#include <atomic>
 #include <mutex>
 #include <memory>
 #endif
 #include <string>
+#include <vector>
 
 #include "TObject.h"
 #include "TList.h"
@@ -18,6 +20,30 @@
 
 class TFile;
 
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \class TCompiledHistograms
+///
+/// Loads the compiled histogram library and calls it for each fragment or
+/// event, filling the histograms in fObjects.
+///
+/// With more than one shard (SetNumberOfShards), each shard has its own
+/// TRuntimeObjects with its own list of histograms, so several threads can
+/// fill histograms at the same time (Fill with the shard of the thread)
+/// without the user code having to be thread-safe. The histograms of the
+/// shards are added to the ones in fObjects and reset by Merge, which is
+/// called by Write, and every fMergeEvery seconds while filling shard 0.
+/// Only histograms (TH1) are merged.
+///
+/// A library filling histograms from events can declare the detector
+/// classes it uses with a function
+/// \code
+/// extern "C" void DeclareDetectors() { TUnpackedEvent::BuildDetector(TGriffin::Class()); }
+/// \endcode
+/// see TUnpackedEvent and DeclareDetectors.
+///
+////////////////////////////////////////////////////////////////////////////////
+
 class TCompiledHistograms : public TObject {
 public:
    TCompiledHistograms();
@@ -27,8 +53,15 @@ public:
 #ifndef __CINT__
    void Fill(std::shared_ptr<const TFragment> frag);
    void Fill(std::shared_ptr<TUnpackedEvent> detectors);
+   void Fill(std::shared_ptr<const TFragment> frag, size_t shard);
+   void Fill(std::shared_ptr<TUnpackedEvent> detectors, size_t shard);
 #endif
    void Reload();
+   void DeclareDetectors();
+
+   void   SetNumberOfShards(size_t shards);
+   size_t GetNumberOfShards() const;
+   void   Merge();
 
    std::string GetLibraryName() const { return fLibName; }
 
@@ -48,6 +81,12 @@ private:
    void   swap_lib(TCompiledHistograms& other);
    time_t get_timestamp();
    bool   file_exists();
+#ifndef __CINT__
+   bool GetFunction(std::shared_ptr<DynamicLibrary>& library, void (*&func)(TRuntimeObjects&));
+   void MergeIfDue(size_t shard);
+#endif
+   static void MergeObject(TObject* obj, TList* list, TDirectory* dir);
+   static void ResetHistograms(TList* list);
 
    std::string fLibName;
    std::string fFuncName;
@@ -69,6 +108,20 @@ private:
 
    TRuntimeObjects fObj;
 
+#ifndef __CINT__
+   /// Histograms of one filling thread
+   struct TShard {
+      TShard(TList* gates, std::vector<TFile*>& cutFiles) : fObj(&fObjects, gates, cutFiles) {}
+      TList           fObjects;   ///< histograms filled since the last merge
+      TRuntimeObjects fObj;       ///< runtime objects passed to the user code, filling fObjects
+      std::mutex      fMutex;     ///< mutex for filling and merging
+   };
+
+   std::vector<std::unique_ptr<TShard>> fShards;          ///< shards of the filling threads, empty if there is only one thread
+   std::atomic<time_t>                  fLastMerged{0};   ///< time of the last merge of the shards
+   int                                  fMergeEvery{5};   ///< seconds between merges of the shards while filling
+#endif
+
    // \cond CLASSIMP
    ClassDefOverride(TCompiledHistograms, 0)   // NOLINT(readability-else-after-return)
                                               // \endcond
@@ -33,6 +33,7 @@
 #include "TPPG.h"
 #include "TScaler.h"
 #include "TFragmentMap.h"
+#include "TFragmentFilter.h"
 #include "ThreadsafeQueue.h"
 #include "TEpicsFrag.h"
 #include "TGRSIOptions.h"
@@ -111,7 +112,8 @@ protected:
 
    bool FragmentHasWaveform() const { return fFragmentHasWaveform; }
 
-   TFragmentMap               FragmentMap() const { return fFragmentMap; }
+   TFragmentMap&              FragmentMap() { return fFragmentMap; }
+   TFragmentFilter&           FragmentFilter() { return fFragmentFilter; }
    std::map<UInt_t, Long64_t> LastTimeStampMap() const { return fLastTimeStampMap; }
 
    static TGRSIOptions* Options() { return fOptions; }
@@ -140,10 +142,19 @@ private:
    uint64_t       fLastTriggerId;       ///< The last Trigged ID in the raw File
    uint64_t       fLastNetworkPacket;   ///< The last network packet recieved.
 
-   std::map<Long_t, int> fFragmentIdMap;
-   bool                  fFragmentHasWaveform;
+   /// Number of fragments seen so far for one trigger ID, used as a ring buffer indexed by trigger ID.
+   struct TTriggerIdCount {
+      Long_t fTriggerId{-1};
+      int    fCount{0};
+   };
+   int NextFragmentId(Long_t triggerId);
 
-   TFragmentMap fFragmentMap;   ///< Class that holds a map of fragments per address, takes care of calculating charges for GRF4 banks
+   std::vector<TTriggerIdCount> fFragmentIds;      ///< ring buffer of fragment counts for the last (power of 2) trigger IDs
+   Long_t                       fFragmentIdMask;   ///< mask to get the ring buffer index from a trigger ID
+   bool                         fFragmentHasWaveform;
+
+   TFragmentFilter fFragmentFilter;   ///< Class that decides which fragments are kept (by address, mnemonic, detector type, charge, or waveform)
+   TFragmentMap    fFragmentMap;      ///< Class that holds a map of fragments per address, takes care of calculating charges for GRF4 banks
 
    std::map<UInt_t, Long64_t> fLastTimeStampMap;
 
@@ -63,10 +63,12 @@ public:
    virtual void AddHit(TDetectorHit* hit)
    {
       fHits.push_back(hit);
+      ++fGeneration;
    }
-   void         Copy(TObject&) const override;                      //!<!
-   void         Clear(Option_t* = "") override { fHits.clear(); }   //!<!
+   void         Copy(TObject&) const override;                                    //!<!
+   void         Clear(Option_t* = "") override { fHits.clear(); ++fGeneration; }   //!<!
    virtual void ClearTransients();                                  //!<!
+   virtual void Calibrate();                                        //!<!
    void         Print(Option_t* opt = "") const override;           //!<!
    virtual void Print(std::ostream& out) const;
 
@@ -78,6 +80,12 @@ public:
    std::vector<TDetectorHit*>&       Hits() { return fHits; }
    const std::vector<TDetectorHit*>& Hits() const { return fHits; }
 
+   /// Changes whenever the hits might have changed (Clear, ClearTransients, AddHit, Copy, or reading the detector
+   /// from a tree), so results derived from the hits can be cached until then. Call NewGeneration after changing
+   /// the hits in any other way.
+   ULong64_t Generation() const { return fGeneration; }
+   void      NewGeneration() { ++fGeneration; }
+
    friend std::ostream& operator<<(std::ostream& out, const TDetector& det)
    {
       det.Print(out);
@@ -86,6 +94,7 @@ public:
 
 private:
    std::vector<TDetectorHit*> fHits;
+   ULong64_t                  fGeneration{0};   //!<! incremented whenever the hits might have changed, also when read from a tree (see LinkDef.h)
 
    /// \cond CLASSIMP
    ClassDefOverride(TDetector, 1)   // NOLINT(readability-else-after-return)
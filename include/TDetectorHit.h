@@ -19,6 +19,7 @@
 
 #include "TPPG.h"
 #include "TTransientBits.h"
+#include "TDither.h"
 
 class TDetector;
 
@@ -109,10 +110,10 @@ public:
    void         SetAddress(const UInt_t& temp_address) { fAddress = temp_address; }                                                               //!<!
    void         SetKValue(const Short_t& temp_kval) { fKValue = temp_kval; }                                                                      //!<!
    void         SetCharge(const Float_t& temp_charge) { fCharge = temp_charge; }                                                                  //!<!
-   void         SetCharge(const Int_t& temp_charge) { fCharge = static_cast<Float_t>(temp_charge) + static_cast<Float_t>(gRandom->Uniform()); }   //!<! this function automatically randomizes the integer provided
+   void         SetCharge(const Int_t& temp_charge) { fCharge = static_cast<Float_t>(temp_charge) + static_cast<Float_t>(TDither::Uniform(EDither::kCharge)); }   //!<! this function automatically randomizes the integer provided
    virtual void SetCfd(const Float_t& val) { fCfd = val; }                                                                                        //!<!
-   virtual void SetCfd(const uint32_t& val) { fCfd = static_cast<Float_t>(val) + static_cast<Float_t>(gRandom->Uniform()); }                      //!<! this function automatically randomizes the integer provided
-   virtual void SetCfd(const Int_t& val) { fCfd = static_cast<Float_t>(val) + static_cast<Float_t>(gRandom->Uniform()); }                         //!<! this function automatically randomizes the integer provided
+   virtual void SetCfd(const uint32_t& val) { fCfd = static_cast<Float_t>(val) + static_cast<Float_t>(TDither::Uniform(EDither::kCfd)); }         //!<! this function automatically randomizes the integer provided
+   virtual void SetCfd(const Int_t& val) { fCfd = static_cast<Float_t>(val) + static_cast<Float_t>(TDither::Uniform(EDither::kCfd)); }            //!<! this function automatically randomizes the integer provided
    void         SetWaveform(const std::vector<Short_t>& val) { fWaveform = val; }                                                                 //!<!
    void         AddWaveformSample(const Short_t& val) { fWaveform.push_back(val); }                                                               //!<!
    virtual void SetTimeStamp(const Long64_t& val) { fTimeStamp = val; }                                                                           //!<!
@@ -168,6 +169,8 @@ public:
    Long64_t    GetCycleTimeStamp() const;
    double      GetTimeSinceTapeMove() const;
 
+   virtual void Calibrate();   ///< calculates and stores channel, energy, and time, afterwards the getters only read them
+
    void ClearEnergy()
    {
       fEnergy = 0.0;
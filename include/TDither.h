@@ -0,0 +1,91 @@
+#ifndef TDITHER_H
+#define TDITHER_H
+
+/** \addtogroup Sorting
+ *  @{
+ */
+
+/////////////////////////////////////////////////////////////////
+///
+/// \class TDither
+///
+/// The TDither provides the random numbers used to dither integer
+/// charges, CFDs, and timestamps, and to select between overlapping
+/// energy calibration ranges. It replaces gRandom for these, which is
+/// a single generator shared (and raced on) by all threads of the sort,
+/// so the results depended on the interleaving of the threads.
+///
+/// The random numbers come from a counter-based generator (Philox4x32-10),
+/// i.e. each number is a pure function of a key (seed), a counter, and
+/// no state is shared between threads:
+/// - TDither::Uniform(key, address, purpose, draw) uses an explicit
+///   counter, e.g. the timestamp of a hit, so the same hit always gets
+///   the same number, regardless of which thread asks for it and when.
+/// - TDither::Uniform(purpose) uses the entry number and address set
+///   by a TDither::TScope on this thread, counting the draws within the
+///   scope. The sort sets these scopes: the unpacking loop per raw event,
+///   TUnpackedEvent per fragment and event, and TGRSISelector per entry.
+///   Without a scope (e.g. in an interactive session) it falls back to a
+///   per-thread sequence, which is not reproducible between threads.
+///
+/// Dithering can be disabled (TDither::SetEnabled(false)), in which case
+/// all numbers are 0.
+///
+/////////////////////////////////////////////////////////////////
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+#include "Rtypes.h"
+
+enum class EDither : uint8_t { kCharge,
+                               kCfd,
+                               kLed,
+                               kTime,
+                               kRange,
+                               kPileUp };
+
+class TDither {
+public:
+   /// Sets the entry number and address used by TDither::Uniform(EDither) on this thread while it exists.
+   class TScope {
+   public:
+      TScope(Long64_t entry, UInt_t address);
+      TScope(const TScope&)                = delete;
+      TScope(TScope&&) noexcept            = delete;
+      TScope& operator=(const TScope&)     = delete;
+      TScope& operator=(TScope&&) noexcept = delete;
+      ~TScope();
+
+   private:
+      bool     fWasScoped{false};   ///< whether there was a scope active before this one
+      Long64_t fEntry{0};           ///< entry number of the previous scope
+      UInt_t   fAddress{0};         ///< address of the previous scope
+      uint32_t fDraw{0};            ///< number of draws in the previous scope
+   };
+
+   static double Uniform(EDither purpose);
+   static double Uniform(uint64_t key, UInt_t address, EDither purpose, uint32_t draw = 0);
+
+   /// Bits of a double, to use a (dithered) value as key
+   static uint64_t DoubleBits(double val)
+   {
+      uint64_t bits = 0;
+      std::memcpy(&bits, &val, sizeof(bits));
+      return bits;
+   }
+
+   /// The Philox4x32-10 block function, exposed for the known-answer test
+   static std::array<uint32_t, 4> Philox4x32(std::array<uint32_t, 4> counter, std::array<uint32_t, 2> key);
+
+   static void     SetEnabled(bool val);
+   static bool     Enabled();
+   static void     SetSeed(uint64_t seed);
+   static uint64_t Seed();
+
+private:
+   static double Philox(uint64_t counterLow, uint32_t counterHigh0, uint32_t counterHigh1);
+};
+/*! @} */
+#endif
@@ -12,12 +12,18 @@
 /// This loop takes fragments and fills histograms based on
 /// 'histos/MakeFragmentHistograms.cxx'
 ///
+/// With --histogram-threads N, N threads take items from the input
+/// queue, each filling its own shard of the histograms (see
+/// TCompiledHistograms and THistogramWorkers), which are merged
+/// when writing and when the histograms are requested via GetObjects.
+///
 ////////////////////////////////////////////////////////////////////////////////
 
 #include <string>
 
 #include "StoppableThread.h"
 #include "TCompiledHistograms.h"
+#include "THistogramWorkers.h"
 #include "ThreadsafeQueue.h"
 
 class TFile;
@@ -70,12 +76,14 @@ private:
 
    void OpenFile();
    void CloseFile();
+   void StartWorkers();
 
    TFile*      fOutputFile;
    std::string fOutputFilename;
 
 #ifndef __CINT__
    std::shared_ptr<ThreadsafeQueue<std::shared_ptr<const TFragment>>> fInputQueue;
+   THistogramWorkers<std::shared_ptr<const TFragment>>                fWorkers;   ///< additional threads filling the histograms
 #endif
 
    /// \cond CLASSIMP
@@ -11,9 +11,17 @@
 ///
 /// This loop writes fragments to a root-file.
 ///
+/// If any of the roll-file options (--roll-file-size, --roll-file-entries,
+/// or --roll-file-minutes) are set, the current file is closed once the
+/// limit is reached and a new file is started. Each file is self-contained,
+/// i.e. contains the channels, run info, PPG, and diagnostics. The PPG and
+/// diagnostics are snapshots of the sort up to the end of that file, the
+/// scalers are the ones read since the previous file.
+///
 ////////////////////////////////////////////////////////////////////////////////
 
 #include <map>
+#include <chrono>
 
 #include "TClass.h"
 #include "TTree.h"
@@ -26,7 +34,7 @@
 
 class TFragWriteLoop : public StoppableThread {
 public:
-   static TFragWriteLoop* Get(std::string name = "", std::string fOutputFilename = "");
+   static TFragWriteLoop* Get(std::string name = "", std::string outputFilename = "");
 
    TFragWriteLoop(const TFragWriteLoop&)                = delete;
    TFragWriteLoop(TFragWriteLoop&&) noexcept            = delete;
@@ -61,13 +69,26 @@ protected:
    bool Iteration() override;
 
 private:
-   TFragWriteLoop(std::string name, const std::string& fOutputFilename);
+   TFragWriteLoop(std::string name, const std::string& outputFilename);
+
+   void OpenOutputFile();
+   bool ShouldRollOver() const;
+   void RollOver();
+   void WriteFile(bool rollOver);
 #ifndef __CINT__
    void WriteEvent(const std::shared_ptr<const TFragment>& event);
    void WriteBadEvent(const std::shared_ptr<const TBadFragment>& event);
    void WriteScaler(const std::shared_ptr<TEpicsFrag>& scaler);
 #endif
 
+   std::string fOutputFilename;
+   size_t      fFileIndex{0};   ///< index of the current output file (only non-zero if output files are rolled over)
+#ifndef __CINT__
+   std::chrono::steady_clock::time_point fFileStartTime;   ///< time the current output file was opened
+#endif
+   Long64_t fGoodFragmentsWritten{0};   ///< number of good fragments written to all files
+   Long64_t fBadFragmentsWritten{0};    ///< number of bad fragments written to all files
+
    TFile* fOutputFile;
 
    TTree* fEventTree;
@@ -0,0 +1,71 @@
+#ifndef TFRAGMENTFILTER_H
+#define TFRAGMENTFILTER_H
+
+/** \addtogroup Sorting
+ *  @{
+ */
+
+/////////////////////////////////////////////////////////////////
+///
+/// \class TFragmentFilter
+///
+/// The TFragmentFilter decides which fragments the data parser passes on
+/// to the rest of the sort. Fragments can be selected by address ranges
+/// (--keep-address), mnemonic regular expressions (--keep-mnemonic),
+/// and detector types (--keep-detector-type). A fragment is kept if it
+/// matches any of these, or if none of them are set. On top of that
+/// fragments can be required to have a minimum charge (--keep-min-charge)
+/// and to have or not have a waveform (--keep-waveform).
+///
+/// The decision based on the address is cached, so each fragment costs
+/// a single hash lookup. The number of fragments rejected by each filter
+/// is recorded in the TParsingDiagnostics.
+///
+/////////////////////////////////////////////////////////////////
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+#ifndef __CINT__
+#include <memory>
+#endif
+
+#include "TFragment.h"
+
+class TFragmentFilter {
+public:
+   enum class EFilter { kChannel,
+                        kCharge,
+                        kWaveform };
+
+   TFragmentFilter();
+
+   bool Active() const { return fActive; }
+#ifndef __CINT__
+   bool Keep(const std::shared_ptr<const TFragment>& frag);
+#endif
+
+private:
+   void Setup();
+   bool KeepAddress(const std::shared_ptr<const TFragment>& frag);
+   void Reject(EFilter filter);
+
+   bool fActive{false};   ///< flag whether any filter is set
+   bool fSetup{false};    ///< flag whether the mnemonics have been resolved and the diagnostics set up
+
+   std::vector<std::pair<UInt_t, UInt_t>> fAddressRanges;           ///< ranges of addresses to keep (inclusive)
+   std::vector<std::string>               fMnemonicRegEx;           ///< regular expressions of the mnemonics to keep
+   std::unordered_set<UInt_t>             fMnemonicAddresses;       ///< addresses of the channels matching fMnemonicRegEx
+   std::unordered_set<Short_t>            fDetectorTypes;           ///< detector types to keep
+   bool                                   fSelectChannels{false};   ///< flag whether any of the channel selections are set
+   double                                 fMinCharge{0.};           ///< minimum charge of fragments to keep
+   int                                    fWaveform{-1};            ///< 1 - keep only fragments with waveform, 0 - keep only fragments without waveform, anything else - keep all
+
+   std::unordered_map<UInt_t, bool> fKeepAddress;        ///< cached decision per address
+   std::vector<size_t>              fDiagnosticsIndex;   ///< index of each filter in the parsing diagnostics
+};
+/*! @} */
+#endif
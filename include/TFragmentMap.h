@@ -13,40 +13,75 @@
 /// In the newest GRIFFIN data (starting with tests in 2016), piled-up hits
 /// have 2*n-1 integrated charges reported, for the different integration areas.
 ///
+/// Pending fragments are kept in a fixed-size slot per address. Fragments
+/// that are waiting for their partners for longer than the expiry window
+/// (or that can never be solved) are pushed to the bad fragment queue, so
+/// both memory and the cost per fragment stay bounded.
+///
 /////////////////////////////////////////////////////////////////
 
-#include <map>
 #include <vector>
+#include <unordered_map>
 #ifndef __CINT__
-#include <tuple>
+#include <array>
 #include <memory>
 #endif
 #include "TFragment.h"
 #include "TBadFragment.h"
 #include "ThreadsafeQueue.h"
+#include "TFragmentFilter.h"
 
 class TFragmentMap {
 public:
+   static constexpr size_t kMaxFragments = 3;                       ///< maximum number of piled-up hits we can solve for
+   static constexpr size_t kMaxCharges   = 2 * kMaxFragments - 1;   ///< maximum number of integrated charges for kMaxFragments piled-up hits
+
 #ifndef __CINT__
    TFragmentMap(std::vector<std::shared_ptr<ThreadsafeQueue<std::shared_ptr<const TFragment>>>>& goodOutputQueue,
-                std::shared_ptr<ThreadsafeQueue<std::shared_ptr<const TBadFragment>>>&           badOutputQueue);
+                std::shared_ptr<ThreadsafeQueue<std::shared_ptr<const TBadFragment>>>&           badOutputQueue,
+                TFragmentFilter&                                                                 filter);
 #endif
 
 #ifndef __CINT__
    bool Add(const std::shared_ptr<TFragment>&, const std::vector<Int_t>&, const std::vector<Short_t>&);
 #endif
+   void   DropAll();
+   size_t PendingFragments() const;
+
+   static void     ExpiryWindow(Long64_t val) { fExpiryWindow = val; }
+   static Long64_t ExpiryWindow() { return fExpiryWindow; }
 
 private:
-   static bool fDebug;
+   static bool     fDebug;
+   static Long64_t fExpiryWindow;    ///< time (in timestamp units) after which pending fragments whose partners never arrived are dropped
+   static size_t   fCheckInterval;   ///< number of fragments added between checks of all addresses for expired fragments
+
 #ifndef __CINT__
-   void Solve(std::vector<std::shared_ptr<TFragment>>, std::vector<Float_t>, std::vector<Long_t>, int situation = -1);
-   void DropFragments(std::pair<
-                      std::multimap<UInt_t, std::tuple<std::shared_ptr<TFragment>, std::vector<Int_t>, std::vector<Short_t>>>::iterator,
-                      std::multimap<UInt_t, std::tuple<std::shared_ptr<TFragment>, std::vector<Int_t>, std::vector<Short_t>>>::iterator>& range);
-
-   std::multimap<UInt_t, std::tuple<std::shared_ptr<TFragment>, std::vector<Int_t>, std::vector<Short_t>>> fMap;
-   std::vector<std::shared_ptr<ThreadsafeQueue<std::shared_ptr<const TFragment>>>>&                        fGoodOutputQueue;
-   std::shared_ptr<ThreadsafeQueue<std::shared_ptr<const TBadFragment>>>&                                  fBadOutputQueue;
+   /// Fixed-size storage for the pending pieces of a pile-up for one address.
+   /// The charges and integration lengths of all pending fragments are stored consecutively.
+   struct TPileUpSlot {
+      std::array<std::shared_ptr<TFragment>, kMaxFragments> fFragments;
+      std::array<size_t, kMaxFragments>                     fNofCharges{};   ///< number of charges of each pending fragment
+      std::array<Int_t, kMaxCharges>                        fCharges{};
+      std::array<Short_t, kMaxCharges>                      fKValues{};
+      size_t                                                fNofFragments{0};
+      size_t                                                fTotalCharges{0};
+      Long64_t                                              fFirstTimeStamp{0};
+   };
+
+   void Solve(std::array<std::shared_ptr<TFragment>, kMaxFragments>& frag, size_t nofFrags, const std::array<Float_t, kMaxCharges>& charges,
+              const std::array<Long_t, kMaxCharges>& kValues, int situation = -1);
+   void DropFragments(TPileUpSlot& slot);
+   void DropExpired();
+   void Push(const std::shared_ptr<TFragment>& frag);
+
+   std::unordered_map<UInt_t, TPileUpSlot>                                          fSlots;               ///< one slot per address, re-used once the pile-up has been solved
+   size_t                                                                           fPending{0};          ///< number of fragments currently waiting for their partners
+   Long64_t                                                                         fLatestTimeStamp{0};  ///< latest timestamp added so far
+   size_t                                                                           fAddsSinceCheck{0};   ///< number of fragments added since the last check for expired fragments
+   std::vector<std::shared_ptr<ThreadsafeQueue<std::shared_ptr<const TFragment>>>>& fGoodOutputQueue;
+   std::shared_ptr<ThreadsafeQueue<std::shared_ptr<const TBadFragment>>>&           fBadOutputQueue;
+   TFragmentFilter&                                                                 fFilter;
 #endif
 };
 /*! @} */
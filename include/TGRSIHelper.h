@@ -2,6 +2,9 @@
 #define TGRSIHELPER_H
 #include "RVersion.h"
 #if ROOT_VERSION_CODE >= ROOT_VERSION(6, 14, 0)
+#include <type_traits>
+#include <utility>
+
 #include "ROOT/RDataFrame.hxx"
 #include "TObject.h"
 #include "TList.h"
@@ -16,10 +19,12 @@
 #include "TAnalysisOptions.h"
 #include "GHSym.h"
 #include "GCube.h"
+#include "GCutG.h"
 #include "GValue.h"
 #include "TPPG.h"
 #include "TRunInfo.h"
 #include "TGRSIMap.h"
+#include "TMixingBuffer.h"
 #include "TChannel.h"
 #include "TUserSettings.h"
 
@@ -33,6 +38,42 @@
 /// list into general GRSISort variables, like the analysis options, g-value
 /// files, cut files, or calibration files.
 ///
+/// Histograms are created once per data processing slot and merged at the
+/// end. For large GHSym and GCube histograms this can take too much memory,
+/// so those can instead be created once and shared by all slots via
+/// TGRSIHelper::Shared, e.g. in CreateHistograms:
+/// \code
+/// fCube[slot]["ggg"] = Shared<GCubeF>("ggg", "#gamma-#gamma-#gamma", 4096, 0., 4096.);
+/// \endcode
+/// Shared histograms are filled from all slots at the same time (see
+/// GHSym::SetShared and GCube::SetShared).
+///
+/// The cuts from the cut files are read once and stored in fCuts as
+/// GCutG (behind the TCutG pointers), so checking them for every event
+/// via fCuts.at(name)->IsInside(x, y) is cheap. Cuts added to fCuts by
+/// the user are kept as they are.
+///
+/// Histograms that are filled for every event can be declared in
+/// CreateHistograms, which returns a handle that is the same for all
+/// slots. Filling via the handle is a vector access instead of a lookup
+/// of the name, and families of histograms (e.g. one per angle) replace
+/// building the name for every fill:
+/// \code
+/// fSum    = fH1[slot].Declare("sum", new TH1D("sum", "sum", 4000, 0., 4000.));
+/// fAngles = fH2[slot].DeclareFamily(nAngles, [&](size_t i) {
+///    std::string name = Form("angle%zu", i);
+///    return std::make_pair(name, new TH2D(name.c_str(), ...));
+/// });
+/// ...
+/// fH1[slot][fSum]->Fill(energy);
+/// fH2[slot][fAngles[angleIndex]]->Fill(e1, e2);
+/// \endcode
+/// fSum and fAngles are members of type THandle<TH1> and TFamily<TH2>.
+///
+/// For event mixing each slot has a TMixingBuffer (fMixing), which
+/// stores compact records of the hits of the last events. Its depth and
+/// the selection of the stored hits are set via SetMixing before Setup.
+///
 ////////////////////////////////////////////////////////////////////////////////
 
 class TGRSIHelper : public TObject {
@@ -40,6 +81,11 @@ public:
    std::string& Prefix() { return fPrefix; }
 
 protected:
+   template <typename T>
+   using THandle = TGRSIMapHandle<T*>;   ///< handle of a histogram declared via fH1, fH2, ... [slot].Declare
+   template <typename T>
+   using TFamily = TGRSIMapFamily<T*>;   ///< handles of the histograms declared via fH1, fH2, ... [slot].DeclareFamily
+
    TPPG*          Ppg() { return fPpg; }
    TRunInfo*      RunInfo() { return fRunInfo; }
    TUserSettings* UserSettings() { return fUserSettings; }
@@ -52,15 +98,45 @@ protected:
    std::vector<TGRSIMap<std::string, GCube*>>                 fCube;                    // NOLINT(cppcoreguidelines-non-private-member-variables-in-classes) //!<! one map per data processing slot for GRSISort's 3D histograms
    std::vector<TGRSIMap<std::string, TTree*>>                 fTree;                    // NOLINT(cppcoreguidelines-non-private-member-variables-in-classes) //!<! one map per data processing slot for trees
    std::vector<TGRSIMap<std::string, TObject*>>               fObject;                  // NOLINT(cppcoreguidelines-non-private-member-variables-in-classes) //!<! one map per data processing slot for any TObjects
-   std::map<std::string, TCutG*>                              fCuts;                    // NOLINT(cppcoreguidelines-non-private-member-variables-in-classes) //!<! map of cuts
+   std::map<std::string, TCutG*>                              fCuts;                    // NOLINT(cppcoreguidelines-non-private-member-variables-in-classes) //!<! map of cuts, the ones from the cut files are GCutG with a fast IsInside
    TPPG*                                                      fPpg{nullptr};            // NOLINT(cppcoreguidelines-non-private-member-variables-in-classes) //!<! pointer to the PPG
    TRunInfo*                                                  fRunInfo{nullptr};        // NOLINT(cppcoreguidelines-non-private-member-variables-in-classes) //!<! pointer to the run info
    TUserSettings*                                             fUserSettings{nullptr};   // NOLINT(cppcoreguidelines-non-private-member-variables-in-classes) //!<! pointer to the user settings
    std::string                                                fPrefix{"TGRSIHelper"};   // NOLINT(cppcoreguidelines-non-private-member-variables-in-classes) //!<! name of this action (used as prefix)
+   std::vector<TMixingBuffer>                                 fMixing;                  // NOLINT(cppcoreguidelines-non-private-member-variables-in-classes) //!<! one event-mixing buffer per data processing slot (see SetMixing)
+
+   /// Sets the number of events stored for event mixing and the selection of the stored hits, has to be called
+   /// before Setup. Without calling this the buffers in fMixing don't store any events.
+   void SetMixing(size_t depth, TMixingBuffer::TSelection selection = nullptr)
+   {
+      fMixingDepth     = depth;
+      fMixingSelection = std::move(selection);
+   }
+
+   /// Returns the GHSym or GCube (or derived class) with this name that is shared by all data processing slots,
+   /// creating it with the arguments on the first call. All other calls, from any slot, return the same histogram.
+   template <typename T, typename... Args>
+   T* Shared(const char* name, Args&&... args)
+   {
+      static_assert(std::is_base_of<GHSym, T>::value || std::is_base_of<GCube, T>::value, "only GHSym and GCube histograms can be shared by all slots");
+      auto iter = fShared.find(name);
+      if(iter != fShared.end()) {
+         return static_cast<T*>(iter->second);
+      }
+      auto* hist = new T(name, std::forward<Args>(args)...);
+      hist->SetShared(true);
+      fShared.emplace(name, hist);
+      return hist;
+   }
 
 private:
    static constexpr int fSizeLimit = 1073741822;   //!<! 1 GiB size limit for objects in ROOT
    void                 CheckSizes(unsigned int slot, const char* usage);
+   bool                 IsShared(const TObject* obj) const;
+
+   std::map<std::string, TH1*> fShared;            //!<! histograms shared by all slots
+   size_t                      fMixingDepth{0};    //!<! number of events stored in the event-mixing buffers
+   TMixingBuffer::TSelection   fMixingSelection;   //!<! selection of the hits stored in the event-mixing buffers
 
 public:
    /// This type is a requirement for every helper.
@@ -17,22 +17,61 @@
 /// This class re-implements std::map with more explicit
 /// exceptions replacing out-of-range exceptions.
 ///
+/// Entries added via Declare or DeclareFamily can also be
+/// accessed via the returned handle, which is an index into a
+/// vector instead of a lookup of the key. Maps that get the
+/// same declarations in the same order (e.g. the maps of all
+/// data processing slots of a TGRSIHelper) have the same handles.
+///
 ////////////////////////////////////////////////////////////
 
 template <typename key_type>
 class TGRSIMapException;
 
+/// Handle of an entry of a TGRSIMap (see TGRSIMap::Declare)
+template <typename mapped_type>
+struct TGRSIMapHandle {
+   size_t fIndex{0};   ///< index of the entry in the order of declaration
+};
+
+/// Handles of a family of entries of a TGRSIMap (see TGRSIMap::DeclareFamily), e.g. one histogram per angle
+template <typename mapped_type>
+struct TGRSIMapFamily {
+   size_t fFirst{0};   ///< index of the first entry in the order of declaration
+   size_t fSize{0};    ///< number of entries
+
+   TGRSIMapHandle<mapped_type> operator[](size_t index) const { return {fFirst + index}; }
+   size_t                      size() const { return fSize; }
+};
+
 template <typename key_type, typename mapped_type, typename key_compare = std::less<key_type>,
           typename allocator_type = std::allocator<std::pair<const key_type, mapped_type>>>
 class TGRSIMap {
 public:
-   TGRSIMap()                               = default;
-   TGRSIMap(const TGRSIMap&)                = default;
+   using handle_t = TGRSIMapHandle<mapped_type>;
+   using family_t = TGRSIMapFamily<mapped_type>;
+
+   TGRSIMap() = default;
+   TGRSIMap(const TGRSIMap& rhs) { *this = rhs; }
    TGRSIMap(TGRSIMap&&) noexcept            = default;
-   TGRSIMap& operator=(const TGRSIMap&)     = default;
    TGRSIMap& operator=(TGRSIMap&&) noexcept = default;
    ~TGRSIMap()                              = default;
 
+   /// Copies the entries, the handles refer to the entries of the copy
+   TGRSIMap& operator=(const TGRSIMap& rhs)
+   {
+      if(this == &rhs) {
+         return *this;
+      }
+      fMap = rhs.fMap;
+      fHandles.clear();
+      fHandles.reserve(rhs.fHandles.size());
+      for(const auto& iter : rhs.fHandles) {
+         fHandles.push_back(fMap.find(iter->first));
+      }
+      return *this;
+   }
+
    void Print()
    {
       for(auto iter : fMap) {
@@ -59,6 +98,26 @@ public:
 
    mapped_type&       operator[](const key_type& key) { return fMap[key]; }
    const mapped_type& operator[](const key_type& key) const { return fMap[key]; }
+   mapped_type&       operator[](handle_t handle) { return fHandles[handle.fIndex]->second; }
+   const mapped_type& operator[](handle_t handle) const { return fHandles[handle.fIndex]->second; }
+
+   /// Adds (or replaces) the entry key and returns its handle
+   handle_t Declare(const key_type& key, const mapped_type& value)
+   {
+      fHandles.push_back(fMap.insert_or_assign(key, value).first);
+      return {fHandles.size() - 1};
+   }
+   /// Adds size entries, create(index) returns the key and value of each entry
+   template <typename Create>
+   family_t DeclareFamily(size_t size, Create create)
+   {
+      family_t family{fHandles.size(), size};
+      for(size_t index = 0; index < size; ++index) {
+         auto entry = create(index);
+         Declare(entry.first, entry.second);
+      }
+      return family;
+   }
 
    using map_t = std::map<key_type, mapped_type, key_compare, allocator_type>;
    typename map_t::iterator       begin() { return fMap.begin(); }
@@ -71,7 +130,11 @@ public:
    size_t size() const noexcept { return fMap.size(); }
    size_t max_size() const noexcept { return fMap.max_size(); }
    // modifier functions of std::map
-   void clear() noexcept { fMap.clear(); }
+   void clear() noexcept
+   {
+      fMap.clear();
+      fHandles.clear();
+   }
    // insert
    // insert_or_assign
    // emplace
@@ -82,9 +145,14 @@ public:
    }
    // emplace_hint
    // try_emplace
+   // erasing declared entries leaves their handles dangling, swap drops all handles
    void erase(typename map_t::iterator pos) { fMap.erase(pos); }
    void erase(typename map_t::iterator first, typename map_t::iterator last) { fMap.erase(first, last); }
-   void swap(map_t& other) { fMap.swap(other); }
+   void swap(map_t& other)
+   {
+      fMap.swap(other);
+      fHandles.clear();
+   }
    // lookup functions of std::map
    typename map_t::size_type      count(const key_type* key) const { return fMap.count(key); }
    typename map_t::iterator       find(const key_type& key) { return fMap.find(key); }
@@ -95,6 +163,7 @@ public:
 
 private:
    std::map<key_type, mapped_type, key_compare, allocator_type> fMap;
+   std::vector<typename map_t::iterator>                        fHandles;   ///< declared entries in the order of declaration
 };
 
 template <typename key_type>
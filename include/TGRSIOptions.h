@@ -6,6 +6,7 @@
  */
 
 #include <map>
+#include <limits>
 
 #include "TObject.h"
 #include "TFile.h"
@@ -110,12 +111,26 @@ public:
 
    size_t FragmentWriteQueueSize() const { return fFragmentWriteQueueSize; }
    size_t AnalysisWriteQueueSize() const { return fAnalysisWriteQueueSize; }
+   size_t HistogramThreads() const { return fHistogramThreads; }
+
+   size_t RollFileSize() const { return fRollFileSize; }
+   size_t RollFileEntries() const { return fRollFileEntries; }
+   double RollFileMinutes() const { return fRollFileMinutes; }
+   bool   RollOutputFiles() const { return fRollFileSize > 0 || fRollFileEntries > 0 || fRollFileMinutes > 0.; }
 
    size_t NumberOfEvents() const { return fNumberOfEvents; }
 
-   bool IgnoreMissingChannel() const { return fIgnoreMissingChannel; }
-   bool SkipInputSort() const { return fSkipInputSort; }
-   int  SortDepth() const { return fSortDepth; }
+   bool   IgnoreMissingChannel() const { return fIgnoreMissingChannel; }
+   bool   SkipInputSort() const { return fSkipInputSort; }
+   int    SortDepth() const { return fSortDepth; }
+   size_t TriggerIdWindow() const { return fTriggerIdWindow; }
+
+   const std::vector<std::string>& KeepAddresses() const { return fKeepAddresses; }
+   const std::vector<std::string>& KeepMnemonics() const { return fKeepMnemonics; }
+   const std::vector<int>&         KeepDetectorTypes() const { return fKeepDetectorTypes; }
+   double                          KeepMinCharge() const { return fKeepMinCharge; }
+   int                             KeepWaveform() const { return fKeepWaveform; }
+   const std::vector<std::string>& BuildDetectors() const { return fBuildDetectors; }
 
    bool ShouldExitImmediately() const { return fShouldExit; }
 
@@ -210,12 +225,25 @@ private:
 
    size_t fFragmentWriteQueueSize{100000};   ///< Size of the Fragment write Q
    size_t fAnalysisWriteQueueSize{100000};   ///< Size of the analysis write Q
+   size_t fHistogramThreads{1};              ///< Number of threads filling the fragment and analysis histograms each
+
+   size_t fRollFileSize{0};       ///< Number of bytes after which the output files are rolled over to a new file (0 - never)
+   size_t fRollFileEntries{0};    ///< Number of entries after which the output files are rolled over to a new file (0 - never)
+   double fRollFileMinutes{0.};   ///< Wall-clock minutes after which the output files are rolled over to a new file (0 - never)
 
    size_t fNumberOfEvents{0};   ///< Number of events, fragments, etc. to process (0 - all)
 
-   bool fIgnoreMissingChannel{false};   ///< Flag to completely ignore missing channels
-   bool fSkipInputSort{false};          ///< Flag to sort on time or triggers
-   int  fSortDepth{200000};             ///< Size of Q that stores fragments to be built into events
+   bool   fIgnoreMissingChannel{false};   ///< Flag to completely ignore missing channels
+   bool   fSkipInputSort{false};          ///< Flag to sort on time or triggers
+   int    fSortDepth{200000};             ///< Size of Q that stores fragments to be built into events
+   size_t fTriggerIdWindow{65536};        ///< Number of trigger IDs (before the current one) for which fragment IDs are kept track of
+
+   std::vector<std::string> fKeepAddresses;                                          ///< Address ranges of fragments to keep (all if empty)
+   std::vector<std::string> fKeepMnemonics;                                          ///< Regular expressions of mnemonics of fragments to keep (all if empty)
+   std::vector<int>         fKeepDetectorTypes;                                      ///< Detector types of fragments to keep (all if empty)
+   double                   fKeepMinCharge{std::numeric_limits<double>::lowest()};   ///< Minimum charge of fragments to keep
+   int                      fKeepWaveform{-1};                                       ///< Keep only fragments with (1) or without (0) waveform, or all (-1)
+   std::vector<std::string> fBuildDetectors;                                         ///< Detector classes to build into the analysis events (all if empty)
 
    static TAnalysisOptions* fAnalysisOptions;   ///< contains all options for analysis
    static TUserSettings*    fUserSettings;      ///< contains user settings read from text-file
@@ -245,7 +273,7 @@ private:
    std::string fParserLibrary;   ///< location of shared object library for data parser and files
 
    /// \cond CLASSIMP
-   ClassDefOverride(TGRSIOptions, 5)   // NOLINT(readability-else-after-return)
+   ClassDefOverride(TGRSIOptions, 8)   // NOLINT(readability-else-after-return)
    /// \endcond
 };
 /*! @} */
@@ -17,6 +17,10 @@ void trimWS(std::string& line);
 int GetRunNumber(const std::string&);
 int GetSubRunNumber(const std::string&);
 
+std::string RolledFileName(const std::string& fileName, size_t index);
+size_t      GetRollIndex(const std::string& fileName);
+std::string RemoveRollIndex(const std::string& fileName);
+
 inline size_t FindFileSize(const char* fname)
 {
    std::ifstream temp(fname, std::ios::in | std::ios::ate);
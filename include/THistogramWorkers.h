@@ -0,0 +1,89 @@
+#ifndef THISTOGRAMWORKERS_H
+#define THISTOGRAMWORKERS_H
+
+/** \addtogroup Loops
+ *  @{
+ */
+
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \class THistogramWorkers
+///
+/// The additional threads of a histogram loop (TFragHistLoop and
+/// TAnalysisHistLoop) with --histogram-threads N. Each thread takes items
+/// from the input queue of the loop and fills its own shard 1 to N - 1
+/// of the TCompiledHistograms, shard 0 is filled by the loop itself.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __CINT__
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+#endif
+
+#include "ThreadsafeQueue.h"
+
+template <typename T>
+class THistogramWorkers {
+public:
+   THistogramWorkers()                                        = default;
+   THistogramWorkers(const THistogramWorkers&)                = delete;
+   THistogramWorkers(THistogramWorkers&&) noexcept            = delete;
+   THistogramWorkers& operator=(const THistogramWorkers&)     = delete;
+   THistogramWorkers& operator=(THistogramWorkers&&) noexcept = delete;
+   ~THistogramWorkers() { Stop(); }
+
+#ifndef __CINT__
+   /// Starts a thread for each shard but the first one. Each thread calls fill(item, shard) for the items it takes from the queue,
+   /// waits while paused() returns true, and runs until the queue is finished and empty, or Stop is called.
+   template <typename Fill, typename Paused>
+   void Start(size_t nofShards, const std::shared_ptr<ThreadsafeQueue<T>>& queue, Fill fill, Paused paused)
+   {
+      for(size_t shard = 1; shard < nofShards; ++shard) {
+         fThreads.emplace_back([this, queue, fill, paused, shard]() {
+            while(!fStop) {
+               if(paused()) {
+                  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                  continue;
+               }
+               T item;
+               queue->Pop(item);
+               if(item) {
+                  fill(item, shard);
+               } else if(queue->IsFinished()) {
+                  return;
+               }
+            }
+         });
+      }
+   }
+
+   /// Waits for all threads to finish.
+   void Join()
+   {
+      for(auto& thread : fThreads) {
+         if(thread.joinable()) {
+            thread.join();
+         }
+      }
+      fThreads.clear();
+   }
+
+   /// Stops all threads, even if the queue isn't empty yet, and waits for them.
+   void Stop()
+   {
+      fStop = true;
+      Join();
+   }
+
+private:
+   std::vector<std::thread> fThreads;       ///< threads filling shards 1 to N - 1
+   std::atomic_bool         fStop{false};   ///< flag to stop the threads
+#endif
+};
+
+/*! @} */
+#endif
@@ -0,0 +1,114 @@
+#ifndef TMIXINGBUFFER_H
+#define TMIXINGBUFFER_H
+
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "Rtypes.h"
+
+/** \addtogroup Sorting
+ *  * @{
+ *  */
+
+/// Compact record of a hit used for event mixing (see TMixingBuffer)
+struct TMixingHit {
+   Double_t fEnergy{0.};    ///< energy of the hit
+   Double_t fTime{0.};      ///< time of the hit
+   Int_t    fIndex{0};      ///< position index of the hit (e.g. the array number), to look up its position
+   Int_t    fDetector{0};   ///< detector of the hit
+   Int_t    fCrystal{0};    ///< crystal of the hit
+   UInt_t   fFlags{0};      ///< user defined flags (e.g. whether the hit is an addback hit)
+};
+
+////////////////////////////////////////////////////////////
+///
+/// \class TMixingBuffer
+///
+/// Ring buffer of the hits of the last events for event mixing,
+/// see TGRSIHelper::SetMixing. Instead of copies of the detectors
+/// (and the suppression and addback calculated again for each
+/// mixed pair) only the compact records of the selected hits are
+/// stored. The memory of the stored events is re-used, so after
+/// the first events no memory is allocated anymore.
+///
+/// The hits of the current event are added via Add while it is
+/// being mixed with the stored events (ForEachHit), and Store
+/// replaces the oldest stored event with it afterwards.
+///
+////////////////////////////////////////////////////////////
+
+class TMixingBuffer {
+public:
+   /// Selection of the hits that are stored, hits for which it returns false are not used for mixing
+   using TSelection = std::function<bool(const TMixingHit&)>;
+
+   explicit TMixingBuffer(size_t depth = 10, TSelection selection = nullptr)
+      : fEvents(depth), fSelection(std::move(selection))
+   {
+   }
+
+   /// Adds the hit to the current event if it passes the selection
+   void Add(const TMixingHit& hit)
+   {
+      if(!fSelection || fSelection(hit)) {
+         fCurrent.push_back(hit);
+      }
+   }
+
+   /// Stores the current event in place of the oldest stored event, and starts a new current event
+   void Store()
+   {
+      if(!fEvents.empty()) {
+         fEvents[fNext].swap(fCurrent);
+         fNext   = (fNext + 1) % fEvents.size();
+         fStored = std::min(fStored + 1, fEvents.size());
+      }
+      fCurrent.clear();
+   }
+
+   /// Removes all stored events and the hits of the current event
+   void Clear()
+   {
+      for(auto& event : fEvents) {
+         event.clear();
+      }
+      fCurrent.clear();
+      fNext   = 0;
+      fStored = 0;
+   }
+
+   /// Calls func(hit) for every hit of the stored events
+   template <typename Function>
+   void ForEachHit(Function func) const
+   {
+      for(const auto& event : fEvents) {
+         for(const auto& hit : event) {
+            func(hit);
+         }
+      }
+   }
+
+   size_t Depth() const { return fEvents.size(); }   ///< maximum number of stored events
+   size_t Size() const { return fStored; }           ///< number of stored events
+   /// Hits of the stored event i, 0 being the most recent one, no hits if fewer than i+1 events are stored (e.g. at depth 0)
+   const std::vector<TMixingHit>& Event(size_t i) const
+   {
+      static const std::vector<TMixingHit> empty;
+      if(i >= fStored) {
+         return empty;
+      }
+      return fEvents[(fNext + fEvents.size() - 1 - i) % fEvents.size()];
+   }
+
+private:
+   std::vector<std::vector<TMixingHit>> fEvents;      ///< hits of the stored events, fEvents[fNext] is the oldest one
+   std::vector<TMixingHit>              fCurrent;     ///< hits of the current event
+   size_t                               fNext{0};     ///< index of the event the next call of Store replaces
+   size_t                               fStored{0};   ///< number of stored events
+   TSelection                           fSelection;   ///< selection of the hits, all hits are stored if not set
+};
+
+/*! @} */
+#endif
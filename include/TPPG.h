@@ -25,6 +25,7 @@
 //////////////////////////////////////////////////////////////////////////
 
 #include <map>
+#include <mutex>
 #include <utility>
 #include <iostream>
 
@@ -205,6 +206,7 @@ public:
 
 private:
    bool CalculateCycleFromData(bool verbose = false);
+   void InsertData(const TPPGData* pat);
 
    PPGMap_t::iterator MapBegin() const { return ++(fPPGStatusMap->begin()); }
    PPGMap_t::iterator MapEnd() const { return fPPGStatusMap->end(); }
@@ -221,6 +223,8 @@ private:
    std::vector<int16_t>   fPPGCodes{0x8, 0x2, 0x1, 0x4};   //!<! ppg state codes (these are always set)
    std::vector<ULong64_t> fDurations{0, 0, 0, 0};          //!<! duration of ppg state calculated from data
 
+   static std::mutex fMutex;   ///< protects adding and copying data, so a copy can be taken while the parser adds data
+
    /// \cond CLASSIMP
    ClassDefOverride(TPPG, 6)   // NOLINT(readability-else-after-return)
    /// \endcond
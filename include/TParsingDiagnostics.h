@@ -23,6 +23,7 @@
 
 #ifndef __CINT__
 #include <memory>
+#include <mutex>
 #endif
 
 #include "TObject.h"
@@ -88,6 +89,10 @@ private:
    std::unordered_map<Short_t, Long_t> fNumberOfGoodFragments;   ///< unordered_map of number of good fragments per detector type
    std::unordered_map<Short_t, Long_t> fNumberOfBadFragments;    ///< unordered_map of number of bad fragments per detector type
 
+   // fragment filter counters
+   std::vector<std::string> fFilterNames;                ///< names of the fragment filters
+   std::vector<Long_t>      fNumberOfFilteredFragments;   ///< number of fragments rejected by each fragment filter
+
    // channel address unordered_maps
    std::unordered_map<UInt_t, TParsingDiagnosticsData> fChannelAddressData;   ///< unordered_map of data per channel address
 
@@ -104,16 +109,20 @@ private:
 
    TH1F* fIdHist{nullptr};   ///< histogram of event survival
 
+#ifndef __CINT__
+   static std::mutex fMutex;   ///< protects the counters, so the write loop can take a copy (see Copy) while the parser counts fragments
+#endif
+
 public:
 //"setter" functions
 #ifndef __CINT__
    void GoodFragment(const std::shared_ptr<const TFragment>&);
 #endif
-   void GoodFragment(Short_t detType)
-   {
-      fNumberOfGoodFragments[detType]++;
-   }
-   void BadFragment(Short_t detType) { fNumberOfBadFragments[detType]++; }
+   void GoodFragment(Short_t detType);
+   void BadFragment(Short_t detType);
+
+   size_t AddFilter(const std::string& name);
+   void   FilteredFragment(size_t filterIndex);
 
    void ReadPPG(TPPG*);
 
@@ -133,6 +142,8 @@ public:
       return 0;
    }
 
+   Long_t NumberOfFilteredFragments(const std::string& name) const;
+
    ULong64_t PPGCycleLength() const { return fPPGCycleLength; }
 
    // other functions
@@ -144,7 +155,7 @@ public:
    void Draw(Option_t* opt = "") override;
 
    /// \cond CLASSIMP
-   ClassDefOverride(TParsingDiagnostics, 2);   // NOLINT(readability-else-after-return)
+   ClassDefOverride(TParsingDiagnostics, 3);   // NOLINT(readability-else-after-return)
    /// \endcond
 };
 /*! @} */
@@ -3,15 +3,22 @@
 
 #include <string>
 #include <map>
+#include <vector>
 #ifndef __CINT__
 #include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #endif
+#include <cmath>
 
 #include "TCutG.h"
 #include "TDirectory.h"
 #include "TList.h"
+#include "TH1D.h"
 
+#include "GCutG.h"
 #include "TFragment.h"
 #include "TUnpackedEvent.h"
 
@@ -24,9 +31,44 @@ class TProfile;
 /**
    For each event, an instance of this type will be passed to the custom histogrammer.
    This class contains all detectors present, and all existing cuts and histograms.
+
+   Histograms are found through a hashed registry of directory, name, and binning, so filling a histogram
+   by name doesn't search the lists of the directories. Asking for an existing histogram with a different
+   binning or type is an error, and nothing is filled. Histograms that are filled very often, or
+   families of histograms with one histogram per index (e.g. per address), can be declared once via
+   TRuntimeObjects::DeclareHistogram or TRuntimeObjects::DeclareHistogramFamily. Filling them via
+   the returned handle is an array access, without building the name of the histogram:
+   \code
+   static const auto charge = TRuntimeObjects::DeclareHistogramFamily("General", "charge0x%04x", 2000, 0, 20000);
+   static const auto matrix = TRuntimeObjects::DeclareHistogram<TH2F>("General", "matrix", 2000, 0, 2000, 2000, 0, 2000);
+   obj.FillHistogram(charge, frag->GetAddress(), frag->GetCharge());
+   \endcode
+   The registry and the handles drop histograms and directories that are deleted (RecursiveRemove).
+
+   Cuts are read from the cut files only once per name (TRuntimeObjects::GetCut), and returned as GCutG,
+   so checking them for every event is cheap.
  */
 class TRuntimeObjects : public TNamed {
 public:
+   /// Handle of a declared histogram of type T, valid for all TRuntimeObjects.
+   template <class T = TH1D>
+   struct THistogramHandle {
+      size_t fId{0};   ///< index of the declaration
+   };
+   /// Handle of a declared family of histograms of type T, valid for all TRuntimeObjects.
+   template <class T = TH1D>
+   struct THistogramFamily {
+      size_t fId{0};   ///< index of the declaration
+   };
+   /// Binning of a histogram, the y-axis is only used for 2D histograms (fYBins > 0)
+   struct TBinning {
+      int    fXBins{0};    ///< number of x-bins
+      double fXLow{0.};    ///< lower edge of the x-axis
+      double fXHigh{0.};   ///< upper edge of the x-axis
+      int    fYBins{0};    ///< number of y-bins
+      double fYLow{0.};    ///< lower edge of the y-axis
+      double fYHigh{0.};   ///< upper edge of the y-axis
+   };
 /// Constructor
 #ifndef __CINT__
    TRuntimeObjects(std::shared_ptr<const TFragment> frag, TList* objects, TList* gates, std::vector<TFile*>& cut_files,
@@ -34,6 +76,13 @@ public:
 #endif
    TRuntimeObjects(TList* objects, TList* gates, std::vector<TFile*>& cut_files, TDirectory* directory = nullptr,
                    const char* name = "default");
+   TRuntimeObjects(const TRuntimeObjects&)                = delete;
+   TRuntimeObjects(TRuntimeObjects&&) noexcept            = delete;
+   TRuntimeObjects& operator=(const TRuntimeObjects&)     = delete;
+   TRuntimeObjects& operator=(TRuntimeObjects&&) noexcept = delete;
+   ~TRuntimeObjects();
+
+   void RecursiveRemove(TObject* obj) override;
 
 #ifndef __CINT__
    /// Returns a pointer to the detector of type T
@@ -46,7 +95,7 @@ public:
    std::shared_ptr<const TFragment> GetFragment() { return fFrag; }
 #endif
 
-   TCutG* GetCut(const std::string& name);
+   GCutG* GetCut(const std::string& name);
 
    TList& GetObjects();
    TList& GetGates();
@@ -112,6 +161,58 @@ public:
       return FillHistogramSym(dirname.c_str(), name.c_str(), Xbins, Xlow, Xhigh, Xvalue, Ybins, Ylow, Yhigh, Yvalue);
    }
 
+#ifndef __CINT__
+   /// Declares the 1D histogram name in directory dirname and returns a handle to fill it with. The histogram is
+   /// the same one the other FillHistogram functions fill (for TH1D), it is created on the first fill.
+   template <class T = TH1D>
+   static THistogramHandle<T> DeclareHistogram(const char* dirname, const char* name, int bins, double low, double high)
+   {
+      return THistogramHandle<T>{Declare(dirname, name, TBinning{bins, low, high}, T::Class(), &Create1D<T>, false)};
+   }
+   /// Declares the 2D histogram name in directory dirname and returns a handle to fill it with.
+   template <class T>
+   static THistogramHandle<T> DeclareHistogram(const char* dirname, const char* name, int xBins, double xLow, double xHigh, int yBins, double yLow, double yHigh)
+   {
+      return THistogramHandle<T>{Declare(dirname, name, TBinning{xBins, xLow, xHigh, yBins, yLow, yHigh}, T::Class(), &Create2D<T>, false)};
+   }
+   /// Declares a family of 1D histograms in directory dirname, with one histogram per index. The name of each
+   /// histogram is format with the index, e.g. "charge0x%04x". The name is only created once, on the first fill
+   /// of each index.
+   template <class T = TH1D>
+   static THistogramFamily<T> DeclareHistogramFamily(const char* dirname, const char* format, int bins, double low, double high)
+   {
+      return THistogramFamily<T>{Declare(dirname, format, TBinning{bins, low, high}, T::Class(), &Create1D<T>, true)};
+   }
+   /// Declares a family of 2D histograms in directory dirname, with one histogram per index.
+   template <class T>
+   static THistogramFamily<T> DeclareHistogramFamily(const char* dirname, const char* format, int xBins, double xLow, double xHigh, int yBins, double yLow, double yHigh)
+   {
+      return THistogramFamily<T>{Declare(dirname, format, TBinning{xBins, xLow, xHigh, yBins, yLow, yHigh}, T::Class(), &Create2D<T>, true)};
+   }
+
+   /// Fills the declared histogram with the values (x, [y,] [weight], as for T::Fill), unless any of them is NaN.
+   /// Returns the histogram, or nullptr if it exists with a different binning or type.
+   template <class T, class... Values>
+   T* FillHistogram(THistogramHandle<T> handle, Values... values)
+   {
+      auto* hist = static_cast<T*>(GetHandle(handle.fId, 0));
+      if(hist != nullptr && !(std::isnan(static_cast<double>(values)) || ...)) {
+         hist->Fill(static_cast<double>(values)...);
+      }
+      return hist;
+   }
+   /// Fills the histogram with this index of the declared family, see the other FillHistogram.
+   template <class T, class... Values>
+   T* FillHistogram(THistogramFamily<T> family, unsigned int index, Values... values)
+   {
+      auto* hist = static_cast<T*>(GetHandle(family.fId, index));
+      if(hist != nullptr && !(std::isnan(static_cast<double>(values)) || ...)) {
+         hist->Fill(static_cast<double>(values)...);
+      }
+      return hist;
+   }
+#endif
+
    double GetVariable(const char* name) const;
 
    static TRuntimeObjects* Get(const std::string& name = "default")
@@ -139,9 +240,57 @@ public:
 private:
    static std::map<std::string, TRuntimeObjects*> fRuntimeMap;
    TDirectory*                                    FindDirectory(const char*);
+   TObject*                                       FindHistogram(const char* dirname, const char* name, const TBinning& binning, TClass* cls, TDirectory*& dir);
+   void                                           AddHistogram(TDirectory* dir, TH1* hist);
+   TH1*                                           GetHandle(size_t id, unsigned int index);
 #ifndef __CINT__
    std::shared_ptr<TUnpackedEvent>  fDetectors;
    std::shared_ptr<const TFragment> fFrag;
+
+   /// Histogram in the registry with its directory, both are nullptr if the histogram exists with a different binning or type
+   struct TRegistryEntry {
+      TDirectory* fDirectory{nullptr};
+      TObject*    fObject{nullptr};
+   };
+
+   using TCreate = TH1* (*)(const char* name, const TBinning& binning);
+
+   /// Declaration of a histogram or histogram family
+   struct TDeclaration {
+      std::string fDirectory;         ///< name of the directory
+      std::string fName;              ///< name of the histogram, or format of the names of the family
+      TBinning    fBinning;           ///< binning of the histogram(s)
+      TClass*     fClass{nullptr};    ///< type of the histogram(s)
+      TCreate     fCreate{nullptr};   ///< creates a histogram of this type
+      bool        fFamily{false};     ///< flag whether this is a family of histograms
+   };
+
+   template <class T>
+   static TH1* Create1D(const char* name, const TBinning& binning)
+   {
+      return new T(name, name, binning.fXBins, binning.fXLow, binning.fXHigh);
+   }
+   template <class T>
+   static TH1* Create2D(const char* name, const TBinning& binning)
+   {
+      return new T(name, name, binning.fXBins, binning.fXLow, binning.fXHigh, binning.fYBins, binning.fYLow, binning.fYHigh);
+   }
+
+   static constexpr unsigned int kMaxDenseIndex = 1 << 16;   ///< indices of histogram families below this are stored in a vector
+
+   static size_t                    Declare(const char* dirname, const char* name, const TBinning& binning, TClass* cls, TCreate create, bool family);
+   static std::vector<TDeclaration> fDeclarations;      ///< all declared histograms and families
+   static std::mutex                fDeclarationMutex;   ///< mutex for fDeclarations
+   static std::mutex                fCutMutex;           ///< mutex for reading cuts from the cut files
+
+   std::string                                             fKey;             ///< buffer for the key of the registry, to avoid allocating it for every fill
+   std::unordered_map<std::string, TRegistryEntry>         fRegistry;        ///< all histograms by directory, name, and binning
+   std::unordered_map<std::string, TDirectory*>            fDirectories;     ///< all directories by name
+   std::unordered_set<TObject*>                            fCached;          ///< all histograms and directories in fRegistry, fDirectories, and the handles
+   std::vector<std::vector<TH1*>>                          fHandles;         ///< histograms of the declarations, indexed by declaration and index
+   std::vector<std::unordered_map<unsigned int, TH1*>>     fSparseHandles;   ///< histograms of the declared families with indices of kMaxDenseIndex and above
+   std::unordered_map<std::string, std::unique_ptr<GCutG>> fCuts;            ///< cuts by name, nullptr for cuts that aren't in any cut file
+   size_t                                                  fCutFiles{0};     ///< number of cut files when the missing cuts were looked up
 #endif
    TList*               fObjects{nullptr};
    TList*               fGates{nullptr};
@@ -21,6 +21,10 @@
 #include <vector>
 #include <unordered_map>
 
+#ifndef __CINT__
+#include <mutex>
+#endif
+
 #include "TObject.h"
 #include "TH1F.h"
 
@@ -51,12 +55,16 @@ private:
 
    std::unordered_map<TClass*, std::pair<int64_t, int64_t>> fHitsRemoved;   ///< removed hits and total hits per detector class
 
+#ifndef __CINT__
+   static std::mutex fMutex;   ///< protects the diagnostics, so the write loop can take a copy (see Copy) while the event building continues
+#endif
+
 public:
    //"setter" functions
    void OutOfTimeOrder(double newFragTime, double oldFragTime, int64_t newEntry);
    void OutOfOrder(int64_t newFragTS, int64_t oldFragTS, int64_t newEntry);
-   void AddTime(double val) { fPreviousTimes.push_back(val); }
-   void AddTimeStamp(Long_t val) { fPreviousTimeStamps.push_back(val); }
+   void AddTime(double val);
+   void AddTimeStamp(Long_t val);
    void MissingChannel(const UInt_t& address);
    void AddDetectorClass(TChannel*);
    void RemovedHits(TClass* detClass, int64_t removed, int64_t total);
@@ -1,6 +1,12 @@
 #ifndef TSUPPRESSED_H
 #define TSUPPRESSED_H
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <vector>
+
 #include "TDetector.h"
 #include "TDetectorHit.h"
 #include "TBgo.h"
@@ -16,6 +22,24 @@
 /// This is an abstract class that adds basic functionality for
 /// Compton suppressed detectors like GRIFFIN.
 ///
+/// Derived classes can limit the pairs of hits the addback and
+/// suppression criteria are checked for via AddbackWindow,
+/// SuppressionWindow, AddbackNeighbours, and SuppressionNeighbours.
+/// They have to be true for every pair the criteria accept, so the
+/// addback and suppressed hits are the same as without them. The
+/// addback hits and the BGO hits are kept sorted by time, so only
+/// the ones in the window of each hit are checked, and the neighbours
+/// of each pair of detectors (TChannel detector numbers) are looked
+/// up once until the detector is cleared.
+///
+/// The created vectors are cached: asking again for the same vector
+/// with the same BGO returns right away, until the hits of this
+/// detector or the BGO change their generation (see
+/// TDetector::Generation, e.g. Clear, ClearTransients, or
+/// TTree::GetEntry), or ResetCache is called. The created vectors
+/// own their hits, the Create functions delete the hits left in them
+/// before re-creating them (see DeleteHits).
+///
 /////////////////////////////////////////////////////////////////
 
 class TSuppressed : public TDetector {
@@ -30,122 +54,254 @@ public:
    virtual bool AddbackCriterion(const TDetectorHit*, const TDetectorHit*) { return false; }
    virtual bool SuppressionCriterion(const TDetectorHit*, const TDetectorHit*) { return false; }
 
+   /// Maximum time difference of an addback hit and a hit that AddbackCriterion accepts, negative if there is no such limit.
+   virtual double AddbackWindow() const { return -1.; }
+   /// Maximum time difference of a hit and a BGO hit that SuppressionCriterion accepts, negative if there is no such limit.
+   virtual double SuppressionWindow() const { return -1.; }
+   /// Returns false if AddbackCriterion never accepts a hit in detector2 for an addback hit in detector1.
+   virtual bool AddbackNeighbours(Int_t, Int_t) const { return true; }
+   /// Returns false if SuppressionCriterion never accepts a BGO hit in bgoDetector for a hit in detector.
+   virtual bool SuppressionNeighbours(Int_t, Int_t) const { return true; }
+
    void Copy(TObject&) const override;           //!<!
    void Clear(Option_t* opt = "all") override;   //!<!
+   void ClearTransients() override;              //!<!
+
+   /// Makes the next call of each Create function re-create its vectors.
+   void ResetCache() { NewGeneration(); }
 
 protected:
+   /// Deletes the hits of a vector created by one of the Create functions, e.g. in the destructor of the derived class.
+   template <class T>
+   static void DeleteHits(std::vector<T*>& hits)
+   {
+      for(auto* hit : hits) {
+         delete hit;
+      }
+      hits.clear();
+   }
+
    template <class T>
    void CreateAddback(const std::vector<T*>& hits, std::vector<T*>& addbacks, std::vector<UShort_t>& nofFragments)
    {
-      /// This funxtion always(!) re-creates the vectors of addback hits and number of fragments per addback hit based on the provided vector of hits
-      addbacks.clear();
+      /// This function re-creates the vectors of addback hits and number of fragments per addback hit based on the provided vector of hits,
+      /// unless they have already been created from them (see ResetCache)
+      if(IsCached(Result(addbacks, nullptr, hits)) && nofFragments.size() == addbacks.size()) {
+         return;
+      }
+      DeleteHits(addbacks);
       nofFragments.clear();
-      size_t j = 0;
+      ClearAddbacks();
       for(auto hit : hits) {
-         // check for each existing addback hit if this hit should be added to it
-         for(j = 0; j < addbacks.size(); ++j) {
-            if(AddbackCriterion(addbacks[j], hit)) {
-               addbacks[j]->Add(hit);
-               // copy constructor does not copy the bit field, so we need to set it
-               addbacks[j]->SetHitBit(TDetectorHit::EBitFlag::kIsEnergySet);   // this must be set for summed hits
-               addbacks[j]->SetHitBit(TDetectorHit::EBitFlag::kIsTimeSet);     // this must be set for summed hits
-               ++(nofFragments.at(j));
-               break;
-            }
-         }
-         // if we haven't found an addback hit to add this hit to, or if there are no addback hits yet we create a new addback hit
-         if(j == addbacks.size()) {
-            /// Because the functions to return hit vectors etc. are almost always returning vectors of TDetectorHits, T is most likely TDetectorHit.
-            /// This means we can't use T directly to create a new hit, we need to use TClass::New().
-            T* tmpT = static_cast<T*>(hit->IsA()->New());
-            *tmpT   = *hit;
-            addbacks.push_back(tmpT);
-            nofFragments.push_back(1);
-         }
+         AddToAddback(hit, addbacks, nofFragments);
       }
+      SetCached(Result(addbacks, nullptr, hits));
    }
 
    template <class T>
    void CreateSuppressed(const TBgo* bgo, const std::vector<T*>& hits, std::vector<T*>& suppressedHits)
    {
-      /// This function always(!) re-creates the vector of suppressed hits based on the provided TBgo and vector of hits
-      suppressedHits.clear();
+      /// This function re-creates the vector of suppressed hits based on the provided TBgo and vector of hits,
+      /// unless it has already been created from them (see ResetCache)
+      if(IsCached(Result(suppressedHits, bgo, hits))) {
+         return;
+      }
+      DeleteHits(suppressedHits);
+      SortSuppressors(bgo);
       for(auto hit : hits) {
-         bool suppress = false;
-         if(bgo != nullptr) {
-            for(auto* b : bgo->GetHitVector()) {
-               if(SuppressionCriterion(hit, b)) {
-                  suppress = true;
-                  break;
-               }
-            }
-         }
          /// Because the functions to return hit vectors etc. are almost always returning vectors of TDetectorHits, T is most likely TDetectorHit.
          /// This means we can't use T directly to create a new hit, we need to use TClass::New().
-         if(!suppress) {
+         if(!Suppressed(hit)) {
             T* tmpT = static_cast<T*>(hit->IsA()->New());
             *tmpT   = *hit;
             suppressedHits.push_back(tmpT);
          }
       }
+      SetCached(Result(suppressedHits, bgo, hits));
    }
 
    template <class T>
    void CreateSuppressedAddback(const TBgo* bgo, const std::vector<T*>& hits, std::vector<T*>& addbacks, std::vector<UShort_t>& nofFragments)
    {
-      /// This funxtion always(!) re-creates the vectors of suppressed addback hits and number of fragments per suppressed addback hit based on the provided TBgo and vector of hits
-      addbacks.clear();
+      /// This function re-creates the vectors of suppressed addback hits and number of fragments per suppressed addback hit based on the provided TBgo and vector of hits,
+      /// unless they have already been created from them (see ResetCache)
+      if(IsCached(Result(addbacks, bgo, hits)) && nofFragments.size() == addbacks.size()) {
+         return;
+      }
+      DeleteHits(addbacks);
       nofFragments.clear();
-      size_t            j = 0;
+      ClearAddbacks();
+      SortSuppressors(bgo);
       std::vector<bool> suppressed;
       for(auto hit : hits) {
-         // check if this hit is suppressed
-         bool suppress = false;
-         if(bgo != nullptr) {
-            for(auto* b : bgo->GetHitVector()) {
-               if(SuppressionCriterion(hit, b)) {
-                  suppress = true;
-                  break;
-               }
-            }
+         // add the hit to an addback hit, and if this hit is suppressed the whole addback hit is suppressed
+         size_t j = AddToAddback(hit, addbacks, nofFragments);
+         if(j == suppressed.size()) {
+            suppressed.push_back(false);
+         }
+         if(!suppressed[j] && Suppressed(hit)) {
+            suppressed[j] = true;
          }
-         // check for each existing addback hit if this hit should be added to it
-         for(j = 0; j < addbacks.size(); ++j) {
-            if(AddbackCriterion(addbacks[j], hit)) {
-               addbacks[j]->Add(hit);
-               // copy constructor does not copy the bit field, so we need to set it
-               addbacks[j]->SetHitBit(TDetectorHit::EBitFlag::kIsEnergySet);   // this must be set for summed hits
-               addbacks[j]->SetHitBit(TDetectorHit::EBitFlag::kIsTimeSet);     // this must be set for summed hits
-               ++(nofFragments.at(j));
-               if(suppress) {
-                  suppressed[j] = true;
-               }
-               break;
+      }
+      // remove the suppressed addback hits in place, keeping the order of the others
+      size_t kept = 0;
+      for(size_t j = 0; j < addbacks.size(); ++j) {
+         if(suppressed[j]) {
+            delete addbacks[j];
+            continue;
+         }
+         addbacks[kept]     = addbacks[j];
+         nofFragments[kept] = nofFragments[j];
+         ++kept;
+      }
+      addbacks.resize(kept);
+      nofFragments.resize(kept);
+      SetCached(Result(addbacks, bgo, hits));
+   }
+
+private:
+   /// Pairs of detectors (with numbers 0 to 63) that are neighbours, looked up once per pair
+   struct TAdjacency {
+      std::array<ULong64_t, 64> fKnown{};        ///< bit d2 of fKnown[d1] is set if the pair d1, d2 has been looked up
+      std::array<ULong64_t, 64> fNeighbours{};   ///< bit d2 of fNeighbours[d1] is set if d1 and d2 are neighbours
+
+      template <typename Function>
+      bool Test(Int_t detector1, Int_t detector2, Function neighbours)
+      {
+         if(detector1 < 0 || detector1 >= 64 || detector2 < 0 || detector2 >= 64) {
+            return neighbours(detector1, detector2);
+         }
+         const ULong64_t bit = 1ULL << detector2;
+         if((fKnown[detector1] & bit) == 0) {
+            fKnown[detector1] |= bit;
+            if(neighbours(detector1, detector2)) {
+               fNeighbours[detector1] |= bit;
             }
          }
-         // if we haven't found an addback hit to add this hit to, or if there are no addback hits yet we create a new addback hit
-         if(j == addbacks.size()) {
-            /// Because the functions to return hit vectors etc. are almost always returning vectors of TDetectorHits, T is most likely TDetectorHit.
-            /// This means we can't use T directly to create a new hit, we need to use TClass::New().
-            T* tmpT = static_cast<T*>(hit->IsA()->New());
-            *tmpT   = *hit;
-            addbacks.push_back(tmpT);
-            nofFragments.push_back(1);
-            suppressed.push_back(suppress);
+         return (fNeighbours[detector1] & bit) != 0;
+      }
+   };
+
+   /// Vector created by one of the Create functions, and what it was created from
+   struct TResult {
+      const void* fResult{nullptr};    ///< the created vector
+      const TBgo* fBgo{nullptr};       ///< BGO used for the suppression
+      const void* fHits{nullptr};      ///< data of the vector of hits it was created from
+      size_t      fNofHits{0};         ///< number of hits it was created from
+      const void* fFirst{nullptr};     ///< first element of the created vector, to notice if it has been changed since
+      size_t      fSize{0};            ///< size of the created vector, to notice if it has been changed since
+      ULong64_t   fGeneration{0};      ///< generation of this detector it was created in
+      ULong64_t   fBgoGeneration{0};   ///< generation of the BGO it was created in
+   };
+
+   template <class T>
+   TResult Result(const std::vector<T*>& result, const TBgo* bgo, const std::vector<T*>& hits) const
+   {
+      return {&result, bgo, hits.data(), hits.size(), result.empty() ? nullptr : result.front(), result.size(), Generation(), bgo == nullptr ? 0 : bgo->Generation()};
+   }
+   bool IsCached(const TResult& result) const;
+   void SetCached(const TResult& result);
+
+   /// Time and detector of a hit, so they don't need to be looked up for every pair
+   struct TCachedHit {
+      double              fTime{0.};
+      Int_t               fDetector{0};
+      const TDetectorHit* fHit{nullptr};
+   };
+
+   /// Window plus the possible rounding of time +- window, so no pair the criterion accepts is skipped
+   static double Slack(double time, double window) { return window + 4. * std::numeric_limits<double>::epsilon() * (std::abs(time) + window); }
+
+   TCachedHit Cache(const TDetectorHit* hit, double window) const { return {window < 0. ? 0. : hit->GetTime(), hit->GetDetector(), hit}; }
+
+   template <class T>
+   size_t AddToAddback(T* hit, std::vector<T*>& addbacks, std::vector<UShort_t>& nofFragments)
+   {
+      /// Adds the hit to the first addback hit AddbackCriterion accepts it for, or creates a new addback hit from it.
+      /// Addback hits outside of the AddbackWindow or not in an AddbackNeighbours detector are skipped without calling
+      /// AddbackCriterion. Returns the index of the addback hit.
+      const double window = AddbackWindow();
+      const auto   cached = Cache(hit, window);
+      if(window < 0.) {
+         for(size_t j = 0; j < addbacks.size(); ++j) {
+            if(TryAddback(hit, cached, j, addbacks, nofFragments, window)) {
+               return j;
+            }
          }
+         return NewAddback(hit, addbacks, nofFragments, window);
       }
-      // loop over all created addback hits and check if they contain a suppressed hit
-      for(j = 0; j < addbacks.size(); ++j) {
-         // if this hit is suppressed we need to suppress the whole addback event
-         if(suppressed[j]) {
-            addbacks.erase(addbacks.begin() + j);
-            nofFragments.erase(nofFragments.begin() + j);
-            suppressed.erase(suppressed.begin() + j);
-            --j;
+      // the addback hits in the window around the time of this hit, checked in the order they were created in
+      const double slack = Slack(cached.fTime, window);
+      auto         begin = std::lower_bound(fAddbackTimes.begin(), fAddbackTimes.end(), cached.fTime - slack, [](const std::pair<double, size_t>& addback, double time) { return addback.first < time; });
+      fAddbackWindow.clear();
+      for(auto addback = begin; addback != fAddbackTimes.end() && addback->first <= cached.fTime + slack; ++addback) {
+         fAddbackWindow.push_back(addback->second);
+      }
+      std::sort(fAddbackWindow.begin(), fAddbackWindow.end());
+      for(size_t j : fAddbackWindow) {
+         if(TryAddback(hit, cached, j, addbacks, nofFragments, window)) {
+            return j;
          }
       }
+      return NewAddback(hit, addbacks, nofFragments, window);
    }
 
+   template <class T>
+   bool TryAddback(T* hit, const TCachedHit& cached, size_t j, std::vector<T*>& addbacks, std::vector<UShort_t>& nofFragments, double window)
+   {
+      /// Adds the hit to addback hit j if they are neighbours and AddbackCriterion accepts them.
+      const auto& candidate = fAddbackCandidates[j];
+      if(!fAddbackAdjacency.Test(candidate.fDetector, cached.fDetector, [this](Int_t d1, Int_t d2) { return AddbackNeighbours(d1, d2); })) {
+         return false;
+      }
+      if(!AddbackCriterion(addbacks[j], hit)) {
+         return false;
+      }
+      addbacks[j]->Add(hit);
+      // copy constructor does not copy the bit field, so we need to set it
+      addbacks[j]->SetHitBit(TDetectorHit::EBitFlag::kIsEnergySet);   // this must be set for summed hits
+      addbacks[j]->SetHitBit(TDetectorHit::EBitFlag::kIsTimeSet);     // this must be set for summed hits
+      ++(nofFragments.at(j));
+      // adding the hit might have changed the time or detector of the addback hit
+      auto updated = Cache(addbacks[j], window);
+      if(window >= 0. && updated.fTime != candidate.fTime) {
+         MoveAddbackTime(j, candidate.fTime, updated.fTime);
+      }
+      fAddbackCandidates[j] = updated;
+      return true;
+   }
+
+   template <class T>
+   size_t NewAddback(T* hit, std::vector<T*>& addbacks, std::vector<UShort_t>& nofFragments, double window)
+   {
+      /// Because the functions to return hit vectors etc. are almost always returning vectors of TDetectorHits, T is most likely TDetectorHit.
+      /// This means we can't use T directly to create a new hit, we need to use TClass::New().
+      T* tmpT = static_cast<T*>(hit->IsA()->New());
+      *tmpT   = *hit;
+      addbacks.push_back(tmpT);
+      nofFragments.push_back(1);
+      fAddbackCandidates.push_back(Cache(tmpT, window));
+      if(window >= 0.) {
+         InsertAddbackTime(fAddbackCandidates.back().fTime, addbacks.size() - 1);
+      }
+      return addbacks.size() - 1;
+   }
+
+   void ClearAddbacks();
+   void InsertAddbackTime(double time, size_t index);
+   void MoveAddbackTime(size_t index, double oldTime, double newTime);
+
+   void SortSuppressors(const TBgo* bgo);
+   bool Suppressed(const TDetectorHit* hit);
+
+   TAdjacency                             fAddbackAdjacency;       //!<! detectors that can be added back, from AddbackNeighbours
+   TAdjacency                             fSuppressionAdjacency;   //!<! detectors and BGO detectors that can suppress them, from SuppressionNeighbours
+   std::vector<TCachedHit>                fAddbackCandidates;      //!<! time and detector of the addback hits while they are created
+   std::vector<std::pair<double, size_t>> fAddbackTimes;           //!<! times and indices of the addback hits sorted by time (if there is an AddbackWindow)
+   std::vector<size_t>                    fAddbackWindow;          //!<! indices of the addback hits in the window of the current hit
+   std::vector<TCachedHit>                fSuppressors;            //!<! BGO hits sorted by time (if there is a SuppressionWindow)
+   std::vector<TResult>                   fResults;                //!<! vectors created by the Create functions, and what from
+
    /// \cond CLASSIMP
    ClassDefOverride(TSuppressed, 1)   // NOLINT(readability-else-after-return)
    /// \endcond
@@ -4,6 +4,7 @@
 #ifndef __CINT__
 #include <type_traits>
 #include <memory>
+#include <unordered_set>
 #endif
 #if __GNUC__ > 5
 #include <sstream>
@@ -15,6 +16,23 @@
 
 class TFragment;
 
+/////////////////////////////////////////////////////////////////
+///
+/// \class TUnpackedEvent
+///
+/// The detectors built from the fragments of one event.
+///
+/// By default all detector classes present in the event are built.
+/// The consumers of the events declare the classes they need before
+/// the sort starts: the analysis histogram library via its optional
+/// DeclareDetectors function (see TCompiledHistograms), the analysis
+/// write loop via the --build-detector option. A consumer that can't
+/// tell needs all of them (BuildAllDetectors). The fragments of the
+/// detector classes no consumer needs are skipped, so those detectors
+/// are not built at all.
+///
+/////////////////////////////////////////////////////////////////
+
 class TUnpackedEvent {
 public:
    TUnpackedEvent();
@@ -39,6 +57,15 @@ public:
 
    void Build();
 
+#ifndef __CINT__
+   /// Declares that detectors of class cls are needed, must be called before any events are built
+   static void BuildDetector(TClass* cls) { fBuildDetectors.insert(cls); }
+   /// Declares that all detector classes are needed, must be called before any events are built
+   static void BuildAllDetectors() { fBuildAllDetectors = true; }
+   /// Returns true if detectors of class cls are built, i.e. if all or no classes were declared or cls is one of them
+   static bool IsBuilt(TClass* cls) { return fBuildAllDetectors || fBuildDetectors.empty() || fBuildDetectors.count(cls) != 0; }
+#endif
+
    size_t Size() { return fDetectors.size(); }
 
 #if __GNUC__ > 5
@@ -51,6 +78,9 @@ private:
 #ifndef __CINT__
    std::vector<std::shared_ptr<const TFragment>> fFragments;
    std::vector<std::shared_ptr<TDetector>>       fDetectors;
+
+   static std::unordered_set<TClass*> fBuildDetectors;      ///< detector classes that are built, all if empty
+   static bool                        fBuildAllDetectors;   ///< flag whether a consumer needs all detector classes
 #endif
 };
 
@@ -13,8 +13,15 @@
 #include "TF3.h"
 #include "TRandom.h"
 #include "TClass.h"
+#include "TBuffer.h"
 
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <functional>
 #include <iostream>
+#include <thread>
+#include <utility>
 
 // Internal exceptions for the CheckConsistency method
 class DifferentDimension : public std::exception {
@@ -34,27 +41,27 @@ GCube::GCube(const char* name, const char* title, Int_t nbins, Double_t low, Dou
    : TH1(name, title, nbins, low, up)
 {
    fYaxis.Set(nbins, low, up);
+   fZaxis.Set(nbins, low, up);
    // TH1 constructor sets fNcells to nbins+2
-   // we need (nbins+2)*((nbins+2)+1)*((nbins+2)+2)/6 cells
-   fNcells = (fNcells * (nbins + 3) * (nbins + 4)) / 6;
+   SetNcells();
 }
 
 GCube::GCube(const char* name, const char* title, Int_t nbins, const Double_t* bins)
    : TH1(name, title, nbins, bins)
 {
    fYaxis.Set(nbins, bins);
+   fZaxis.Set(nbins, bins);
    // TH1 constructor sets fNcells to nbins+2
-   // we need (nbins+2)*((nbins+2)+1)*((nbins+2)+2)/6 cells
-   fNcells = (fNcells * (nbins + 3) * (nbins + 4)) / 6;
+   SetNcells();
 }
 
 GCube::GCube(const char* name, const char* title, Int_t nbins, const Float_t* bins)
    : TH1(name, title, nbins, bins)
 {
    fYaxis.Set(nbins, bins);
+   fZaxis.Set(nbins, bins);
    // TH1 constructor sets fNcells to nbins+2
-   // we need (nbins+2)*((nbins+2)+1)*((nbins+2)+2)/6 cells
-   fNcells = (fNcells * (nbins + 3) * (nbins + 4)) / 6;
+   SetNcells();
 }
 
 GCube::GCube(const GCube& rhs) : TH1()   // NOLINT(readability-redundant-member-init)
@@ -67,6 +74,12 @@ GCube::GCube(GCube&& rhs) noexcept : TH1()   // NOLINT(readability-redundant-mem
    rhs.Copy(*this);
 }
 
+GCube::~GCube()
+{
+   delete fSharedFill;
+   delete fProjectionIndex;
+}
+
 Int_t GCube::BufferEmpty(Int_t action)
 {
    /// Fill histogram with all entries in the buffer.
@@ -218,6 +231,7 @@ void GCube::Copy(TObject& obj) const
    static_cast<GCube&>(obj).fTsumwy2 = fTsumwy2;
    static_cast<GCube&>(obj).fTsumwxy = fTsumwxy;
    static_cast<GCube&>(obj).fMatrix  = nullptr;
+   static_cast<GCube&>(obj).ResetProjectionIndex();
 }
 
 Double_t GCube::DoIntegral(Int_t binx1, Int_t binx2, Int_t biny1, Int_t biny2, Int_t binz1, Int_t binz2,
@@ -225,6 +239,7 @@ Double_t GCube::DoIntegral(Int_t binx1, Int_t binx2, Int_t biny1, Int_t biny2, I
 {
    // internal function compute integral and optionally the error  between the limits
    // specified by the bin number values working for all histograms (1D, 2D and 3D)
+   FlushCells();
 
    Int_t nbinsx = GetNbinsX();
    if(binx1 < 0) {
@@ -283,17 +298,17 @@ Double_t GCube::DoIntegral(Int_t binx1, Int_t binx2, Int_t biny1, Int_t biny2, I
             if(width) {
                dz = fZaxis.GetBinWidth(binz);
             }
-            Int_t bin = GetBin(binx, biny, binz);
+            Long64_t bin = GetBin64(binx, biny, binz);
             if(width) {
-               integral += GetBinContent(bin) * dx * dy * dz;
+               integral += GetCellContent(bin) * dx * dy * dz;
             } else {
-               integral += GetBinContent(bin);
+               integral += GetCellContent(bin);
             }
             if(doError) {
                if(width) {
-                  igerr2 += GetBinError(bin) * GetBinError(bin) * dx * dx * dy * dy * dz * dz;
+                  igerr2 += GetCellError(bin) * GetCellError(bin) * dx * dx * dy * dy * dz * dz;
                } else {
-                  igerr2 += GetBinError(bin) * GetBinError(bin);
+                  igerr2 += GetCellError(bin) * GetCellError(bin);
                }
             }
          }
@@ -316,76 +331,26 @@ Int_t GCube::Fill(Double_t)
 Int_t GCube::Fill(Double_t x, Double_t y, Double_t z)
 {
    /// Increment cell defined by x,y,z by 1.
+   if(fSharedFill != nullptr) {
+      FillShared(x, y, z, 1.);
+      return 0;
+   }
    if(fBuffer != nullptr) {
       return BufferFill(x, y, z, 1);
    }
 
-   Int_t binx = 0;
-   Int_t biny = 0;
-   Int_t binz = 0;
    fEntries++;
-   // go through all orderings of x,y,z to find right combination
-   if(z <= y && y <= x) {
-      // z, y, x
-      binx = fXaxis.FindBin(x);
-      biny = fYaxis.FindBin(y);
-      binz = fZaxis.FindBin(z);
-   } else if(z <= x && y <= x) {
-      // y, z, x
-      binx = fXaxis.FindBin(x);
-      biny = fZaxis.FindBin(z);
-      binz = fYaxis.FindBin(y);
-   } else if(y <= x) {   // at this stage we know that z > y and z > x if y <= x
-                         // y, x, z
-      binx = fZaxis.FindBin(z);
-      biny = fXaxis.FindBin(x);
-      binz = fYaxis.FindBin(y);
-   } else if(z <= x) {   // at this stage we know that y > x
-                         // z, x, y
-      binx = fYaxis.FindBin(y);
-      biny = fXaxis.FindBin(x);
-      binz = fZaxis.FindBin(z);
-   } else if(z <= y) {   // at this stage we know that y > x
-                         // x, z, y
-      binx = fYaxis.FindBin(y);
-      biny = fZaxis.FindBin(z);
-      binz = fXaxis.FindBin(x);
-   } else {
-      // x, y, z
-      binx = fZaxis.FindBin(z);
-      biny = fYaxis.FindBin(y);
-      binz = fXaxis.FindBin(x);
-   }
-
-   if(binx < 0 || biny < 0 || binz < 0) {
+   Bool_t   inRange = kTRUE;
+   Long64_t bin     = FindFillBin(x, y, z, inRange);
+   if(bin < 0) {
       return -1;
    }
-   Int_t bin = biny * (2 * fXaxis.GetNbins() - biny + 3) / 2 + binx - binz +
-               (fXaxis.GetNbins() + 2) * (fXaxis.GetNbins() + 3) * (fXaxis.GetNbins() + 4) / 6 -
-               (fXaxis.GetNbins() + 2 - binz) * (fXaxis.GetNbins() + 3 - binz) * (fXaxis.GetNbins() + 4 - binz) / 6 - biny;
-   std::cout << "binx,y,z = " << binx << "," << biny << "," << binz << " => bin = " << bin << std::endl;
-   bin = static_cast<Int_t>(binx + biny * (fXaxis.GetNbins() - (biny + 1.) / 2.) +
-                            binz * (binz / 2. * (binz / 3. - fXaxis.GetNbins() + 3.) + fXaxis.GetNbins() * (3 + fXaxis.GetNbins() / 2.) +
-                                    10. / 3.));
-   std::cout << "binx,y,z = " << binx << "," << biny << "," << binz << " => bin = " << bin << std::endl;
-   AddBinContent(bin);
+   AddCellContent(bin, 1.);
    if(fSumw2.fN != 0) {
       ++fSumw2.fArray[bin];
    }
-   if(binx == 0 || binx > fXaxis.GetNbins()) {
-      if(!fgStatOverflows) {
-         return -1;
-      }
-   }
-   if(biny == 0 || biny > fYaxis.GetNbins()) {
-      if(!fgStatOverflows) {
-         return -1;
-      }
-   }
-   if(binz == 0 || binz > fZaxis.GetNbins()) {
-      if(!fgStatOverflows) {
-         return -1;
-      }
+   if(!inRange) {
+      return -1;
    }
    // not sure if these summed weights are calculated correct
    // as of now this is the method used in TH3
@@ -401,20 +366,57 @@ Int_t GCube::Fill(Double_t x, Double_t y, Double_t z)
    fTsumwxz += x * z;
    fTsumwyz += y * z;
 
-   return bin;
+   return static_cast<Int_t>(std::min(bin, static_cast<Long64_t>(kMaxInt)));
 }
 
 Int_t GCube::Fill(Double_t x, Double_t y, Double_t z, Double_t w)
 {
    /// Increment cell defined by x,y,z by w.
+   if(fSharedFill != nullptr) {
+      FillShared(x, y, z, w);
+      return 0;
+   }
    if(fBuffer != nullptr) {
       return BufferFill(x, y, z, 1);
    }
 
+   fEntries++;
+   Bool_t   inRange = kTRUE;
+   Long64_t bin     = FindFillBin(x, y, z, inRange);
+   if(bin < 0) {
+      return -1;
+   }
+   AddCellContent(bin, w);
+   if(fSumw2.fN != 0) {
+      fSumw2.fArray[bin] += w * w;
+   }
+   if(!inRange) {
+      return -1;
+   }
+   // not sure if these summed weights are calculated correct
+   // as of now this is the method used in TH3
+   fTsumw += w;
+   fTsumw2 += w * w;
+   fTsumwx += w * x;
+   fTsumwx2 += w * x * x;
+   fTsumwy += w * y;
+   fTsumwy2 += w * y * y;
+   fTsumwxy += w * x * y;
+   fTsumwz += w * z;
+   fTsumwz2 += w * z * z;
+   fTsumwxz += w * x * z;
+   fTsumwyz += w * y * z;
+
+   return static_cast<Int_t>(std::min(bin, static_cast<Long64_t>(kMaxInt)));
+}
+
+Long64_t GCube::FindFillBin(Double_t x, Double_t y, Double_t z, Bool_t& inRange)
+{
+   /// Returns the bin Fill(x, y, z) increments, or -1 if there is none. inRange is set to false if the
+   /// bin is an under- or overflow bin that doesn't count towards the statistics.
    Int_t binx = 0;
    Int_t biny = 0;
    Int_t binz = 0;
-   fEntries++;
    // go through all orderings of x,y,z to find right combination
    if(z <= y && y <= x) {
       // z, y, x
@@ -451,43 +453,245 @@ Int_t GCube::Fill(Double_t x, Double_t y, Double_t z, Double_t w)
    if(binx < 0 || biny < 0 || binz < 0) {
       return -1;
    }
-   auto bin = static_cast<Int_t>(binx + biny * (fXaxis.GetNbins() - (biny + 1.) / 2.) +
-                                 binz * (binz / 2. * (binz / 3. - fXaxis.GetNbins() + 3.) + fXaxis.GetNbins() * (3 + fXaxis.GetNbins() / 2.) +
-                                         10. / 3.));
-   AddBinContent(bin, w);
-   if(fSumw2.fN != 0) {
-      fSumw2.fArray[bin] += w * w;
+   inRange = fgStatOverflows || (binx != 0 && binx <= fXaxis.GetNbins() && biny != 0 && biny <= fYaxis.GetNbins() && binz != 0 && binz <= fZaxis.GetNbins());
+   return CellNumber(binx, biny, binz);
+}
+
+void GCube::SetShared(bool val)
+{
+   /// In shared mode the histogram can be filled from several threads at the same time via Fill(x, y, z) and
+   /// Fill(x, y, z, w), without one copy of the histogram per thread. The fills of each thread are buffered and
+   /// added in blocks (see GSharedFill), so the histogram is only complete once the shared mode is turned off
+   /// again, which adds the remaining fills of all threads. Nothing but filling should be done with the
+   /// histogram while it is shared. The additions to a mapped file (see MapFile) are not buffered while the
+   /// histogram is shared, the shared mode adds them sorted by cell already.
+   if(val) {
+      if(fSharedFill == nullptr) {
+         BufferCells(false);
+         fSharedFill = new GSharedFill(4);
+      }
+      return;
    }
-   if(binx == 0 || binx > fXaxis.GetNbins()) {
-      if(!fgStatOverflows) {
-         return -1;
+   if(fSharedFill != nullptr) {
+      for(auto* buffer : fSharedFill->Buffers()) {
+         FlushShared(*buffer);
       }
+      delete fSharedFill;
+      fSharedFill = nullptr;
+      BufferCells(true);
    }
-   if(biny == 0 || biny > fYaxis.GetNbins()) {
-      if(!fgStatOverflows) {
-         return -1;
+}
+
+void GCube::FillShared(Double_t x, Double_t y, Double_t z, Double_t w)
+{
+   auto& buffer = fSharedFill->Buffer();
+   buffer.push_back(x);
+   buffer.push_back(y);
+   buffer.push_back(z);
+   buffer.push_back(w);
+   if(fSharedFill->IsFull(buffer)) {
+      FlushShared(buffer);
+   }
+}
+
+void GCube::FlushShared(GSharedFill::TBuffer& buffer)
+{
+   /// Adds the buffered fills (x, y, z, w) of one thread to the histogram. Bins and statistics are calculated
+   /// without any lock, the bins are sorted and added one stripe at a time.
+   std::vector<std::pair<Long64_t, Double_t>> bins;
+   bins.reserve(buffer.size() / 4);
+   std::array<Double_t, 11> stats{};
+   Double_t                 entries = 0.;
+   for(size_t i = 0; i + 3 < buffer.size(); i += 4) {
+      Double_t x = buffer[i];
+      Double_t y = buffer[i + 1];
+      Double_t z = buffer[i + 2];
+      Double_t w = buffer[i + 3];
+      ++entries;
+      Bool_t   inRange = kTRUE;
+      Long64_t bin     = FindFillBin(x, y, z, inRange);
+      if(bin < 0) {
+         continue;
+      }
+      bins.emplace_back(bin, w);
+      if(!inRange) {
+         continue;
+      }
+      stats[0] += w;
+      stats[1] += w * w;
+      stats[2] += w * x;
+      stats[3] += w * x * x;
+      stats[4] += w * y;
+      stats[5] += w * y * y;
+      stats[6] += w * x * y;
+      stats[7] += w * z;
+      stats[8] += w * z * z;
+      stats[9] += w * x * z;
+      stats[10] += w * y * z;
+   }
+   buffer.clear();
+
+   AddShared(bins, stats, entries);
+}
+
+void GCube::AddShared(std::vector<std::pair<Long64_t, Double_t>>& bins, const std::array<Double_t, 11>& stats, Double_t entries)
+{
+   /// Adds the weights to the cells while shared, sorted and one stripe at a time, and the statistics.
+   std::sort(bins.begin(), bins.end());
+   for(size_t first = 0; first < bins.size();) {
+      std::lock_guard<std::mutex> lock(fSharedFill->StripeMutex(bins[first].first));
+      size_t                      last = first;
+      for(; last < bins.size() && GSharedFill::SameStripe(bins[first].first, bins[last].first); ++last) {
+         AddCellContent(bins[last].first, bins[last].second);
+         if(fSumw2.fN != 0) {
+            fSumw2.fArray[bins[last].first] += bins[last].second * bins[last].second;
+         }
       }
+      first = last;
    }
-   if(binz == 0 || binz > fZaxis.GetNbins()) {
-      if(!fgStatOverflows) {
-         return -1;
+
+   std::lock_guard<std::mutex> lock(fSharedFill->StatsMutex());
+   fEntries += entries;
+   fTsumw += stats[0];
+   fTsumw2 += stats[1];
+   fTsumwx += stats[2];
+   fTsumwx2 += stats[3];
+   fTsumwy += stats[4];
+   fTsumwy2 += stats[5];
+   fTsumwxy += stats[6];
+   fTsumwz += stats[7];
+   fTsumwz2 += stats[8];
+   fTsumwxz += stats[9];
+   fTsumwyz += stats[10];
+}
+
+void GCube::FindFillBins(const Double_t* x, size_t n, Int_t* bins)
+{
+   /// Sets bins to the bins of the n values x. For uniform axes this is the same calculation as
+   /// TAxis::FindBin, without any calls so the loop can be vectorized.
+   const Int_t    nbins = fXaxis.GetNbins();
+   const Double_t xmin  = fXaxis.GetXmin();
+   const Double_t xmax  = fXaxis.GetXmax();
+   if(fXaxis.GetXbins()->fN != 0) {
+      for(size_t i = 0; i < n; ++i) {
+         bins[i] = fXaxis.FindBin(x[i]);
       }
+      return;
    }
-   // not sure if these summed weights are calculated correct
-   // as of now this is the method used in TH3
-   fTsumw += w;
-   fTsumw2 += w * w;
-   fTsumwx += w * x;
-   fTsumwx2 += w * x * x;
-   fTsumwy += w * y;
-   fTsumwy2 += w * y * y;
-   fTsumwxy += w * x * y;
-   fTsumwz += w * z;
-   fTsumwz2 += w * z * z;
-   fTsumwxz += w * x * z;
-   fTsumwyz += w * y * z;
+   for(size_t i = 0; i < n; ++i) {
+      bins[i] = x[i] < xmin ? 0 : (!(x[i] < xmax) ? nbins + 1 : 1 + static_cast<Int_t>(nbins * (x[i] - xmin) / (xmax - xmin)));
+   }
+}
 
-   return bin;
+void GCube::FillCombinations(const Double_t* energies, size_t n, Double_t w)
+{
+   /// Fills all n(n-1)(n-2)/6 triples of the energies with weight w. This is the same as calling
+   /// Fill(energies[i], energies[j], energies[k], w) for all i < j < k (apart from the rounding of the
+   /// statistics), but the bin of each energy is only found once, and the bins are sorted, so the cells
+   /// of all triples follow directly without going through the orderings of each triple.
+   if(n < 3) {
+      return;
+   }
+   if(fBuffer != nullptr || CanExtendAllAxes() || fXaxis.GetLabels() != nullptr) {
+      for(size_t i = 0; i + 2 < n; ++i) {
+         for(size_t j = i + 1; j + 1 < n; ++j) {
+            for(size_t k = j + 1; k < n; ++k) {
+               Fill(energies[i], energies[j], energies[k], w);
+            }
+         }
+      }
+      return;
+   }
+
+   std::vector<Int_t> bins(n);
+   FindFillBins(energies, n, bins.data());
+
+   // statistics of the triples (x, y, z) = (energies[i], energies[j], energies[k]) with i < j < k, only
+   // counting triples with all energies in range, summed over the middle energy of each triple using the
+   // number, sum, and sum of squares of the energies before (l) and after (r) it
+   const Int_t              nbins = fXaxis.GetNbins();
+   std::array<Double_t, 11> stats{};
+   Double_t                 total     = 0.;
+   Double_t                 totalSum  = 0.;
+   Double_t                 totalSum2 = 0.;
+   for(size_t j = 0; j < n; ++j) {
+      if(fgStatOverflows || (bins[j] != 0 && bins[j] <= nbins)) {
+         ++total;
+         totalSum += energies[j];
+         totalSum2 += energies[j] * energies[j];
+      }
+   }
+   Double_t l     = 0.;
+   Double_t lSum  = 0.;
+   Double_t lSum2 = 0.;
+   for(size_t j = 0; j < n; ++j) {
+      if(!fgStatOverflows && (bins[j] == 0 || bins[j] > nbins)) {
+         continue;
+      }
+      Double_t y     = energies[j];
+      Double_t r     = total - l - 1.;
+      Double_t rSum  = totalSum - lSum - y;
+      Double_t rSum2 = totalSum2 - lSum2 - y * y;
+      stats[0] += l * r;
+      stats[2] += lSum * r;
+      stats[3] += lSum2 * r;
+      stats[4] += y * l * r;
+      stats[5] += y * y * l * r;
+      stats[6] += y * lSum * r;
+      stats[7] += rSum * l;
+      stats[8] += rSum2 * l;
+      stats[9] += lSum * rSum;
+      stats[10] += y * rSum * l;
+      ++l;
+      lSum += y;
+      lSum2 += y * y;
+   }
+   stats[1] = stats[0] * w * w;
+   for(size_t i = 0; i < stats.size(); ++i) {
+      if(i != 1) {
+         stats[i] *= w;
+      }
+   }
+   Double_t entries = static_cast<Double_t>(n) * static_cast<Double_t>(n - 1) * static_cast<Double_t>(n - 2) / 6.;
+
+   // with the bins sorted in descending order, bins[i] >= bins[j] >= bins[k] for all i < j < k
+   std::sort(bins.begin(), bins.end(), std::greater<Int_t>());
+   if(fSharedFill != nullptr) {
+      std::vector<std::pair<Long64_t, Double_t>> cells;
+      cells.reserve(static_cast<size_t>(entries));
+      for(size_t i = 0; i + 2 < n; ++i) {
+         for(size_t j = i + 1; j + 1 < n; ++j) {
+            for(size_t k = j + 1; k < n; ++k) {
+               cells.emplace_back(CellNumber(bins[i], bins[j], bins[k]), w);
+            }
+         }
+      }
+      AddShared(cells, stats, entries);
+      return;
+   }
+   for(size_t i = 0; i + 2 < n; ++i) {
+      for(size_t j = i + 1; j + 1 < n; ++j) {
+         for(size_t k = j + 1; k < n; ++k) {
+            Long64_t cell = CellNumber(bins[i], bins[j], bins[k]);
+            AddCellContent(cell, w);
+            if(fSumw2.fN != 0) {
+               fSumw2.fArray[cell] += w * w;
+            }
+         }
+      }
+   }
+   fEntries += entries;
+   fTsumw += stats[0];
+   fTsumw2 += stats[1];
+   fTsumwx += stats[2];
+   fTsumwx2 += stats[3];
+   fTsumwy += stats[4];
+   fTsumwy2 += stats[5];
+   fTsumwxy += stats[6];
+   fTsumwz += stats[7];
+   fTsumwz2 += stats[8];
+   fTsumwxz += stats[9];
+   fTsumwyz += stats[10];
 }
 
 Int_t GCube::Fill(const char* namex, const char* namey, const char* namez, Double_t w)
@@ -525,10 +729,8 @@ Int_t GCube::Fill(const char* namex, const char* namey, const char* namez, Doubl
       std::swap(biny, binz);
    }
 
-   auto bin = static_cast<Int_t>(binx + biny * (fXaxis.GetNbins() - (biny + 1.) / 2.) +
-                                 binz * (binz / 2. * (binz / 3. - fXaxis.GetNbins() + 3.) + fXaxis.GetNbins() * (3 + fXaxis.GetNbins() / 2.) +
-                                         10. / 3.));
-   AddBinContent(bin, w);
+   Long64_t bin = GetBin64(binx, biny, binz);
+   AddCellContent(bin, w);
    if(fSumw2.fN != 0) {
       fSumw2.fArray[bin] += w * w;
    }
@@ -683,6 +885,7 @@ Int_t GCube::FindFirstBinAbove(Double_t threshold, Int_t axis, Int_t firstBin, I
 {
    /// find first bin with content > threshold for axis (1=x, 2=y, 3=z)
    /// if no bins with content > threshold is found the function returns -1.
+   FlushCells();
 
    if(axis < 1 || axis > 3) {
       Warning("FindFirstBinAbove", "Invalid axis number : %d, axis x assumed\n", axis);
@@ -732,6 +935,7 @@ Int_t GCube::FindLastBinAbove(Double_t threshold, Int_t axis, Int_t firstBin, In
 {
    // find last bin with content > threshold for axis (1=x, 2=y, 3=z)
    // if no bins with content > threshold is found the function returns -1.
+   FlushCells();
 
    if(axis < 1 || axis > 3) {
       Warning("FindLastBinAbove", "Invalid axis number : %d, axis x assumed\n", axis);
@@ -878,13 +1082,13 @@ void GCube::FitSlicesZ(TF1* f1, Int_t binminx, Int_t binmaxx, Int_t binminy, Int
          hpz->Reset();
          Int_t nfill = 0;
          for(Int_t binz = 1; binz <= nbinsz; binz++) {
-            Int_t    bin = GetBin(binx, biny, binz);
-            Double_t w   = RetrieveBinContent(bin);
+            Long64_t bin = GetBin64(binx, biny, binz);
+            Double_t w   = GetCellContent(bin);
             if(w == 0) {
                continue;
             }
             hpz->Fill(fZaxis.GetBinCenter(binz), w);
-            hpz->SetBinError(binz, GetBinError(bin));
+            hpz->SetBinError(binz, GetCellError(bin));
             nfill++;
          }
          if(nfill < cut) {
@@ -908,6 +1112,18 @@ void GCube::FitSlicesZ(TF1* f1, Int_t binminx, Int_t binmaxx, Int_t binminy, Int
 
 Int_t GCube::GetBin(Int_t binx, Int_t biny, Int_t binz) const
 {
+   /// Returns the bin number as Int_t, or -1 if the cube has too many cells for that (use GetBin64 instead).
+   Long64_t bin = GetBin64(binx, biny, binz);
+   if(bin > kMaxInt) {
+      return -1;
+   }
+   return static_cast<Int_t>(bin);
+}
+
+Long64_t GCube::GetBin64(Int_t binx, Int_t biny, Int_t binz) const
+{
+   /// Returns the 64-bit number of the cell of bins binx, biny, and binz. The bins are sorted so that
+   /// binx >= biny >= binz, and the cells are numbered in tiles of 8x8x8 bins (see CellNumber).
    Int_t n = fXaxis.GetNbins() + 2;
    if(binx < 0) {
       binx = 0;
@@ -938,9 +1154,157 @@ Int_t GCube::GetBin(Int_t binx, Int_t biny, Int_t binz) const
       std::swap(biny, binz);
    }
 
-   return static_cast<Int_t>(binx + biny * (fXaxis.GetNbins() - (biny + 1.) / 2.) +
-                             binz * (binz / 2. * (binz / 3. - fXaxis.GetNbins() + 3.) + fXaxis.GetNbins() * (3 + fXaxis.GetNbins() / 2.) +
-                                     10. / 3.));
+   return CellNumber(binx, biny, binz);
+}
+
+Long64_t GCube::NumberOfCells(Int_t nbins)
+{
+   /// Number of cells needed for a cube with nbins bins per axis (plus under- and overflow), i.e. the number
+   /// of tiles with tx >= ty >= tz times the cells per tile.
+   Long64_t tiles = ((nbins + 1) >> kTileShift) + 1;
+   return (tiles * (tiles + 1) * (tiles + 2) / 6) << (3 * kTileShift);
+}
+
+void GCube::SetNcells()
+{
+   /// Sets fNcells for the current number of bins, limited to kMaxInt for cubes with too many cells for Int_t bin numbers.
+   fNcells = static_cast<Int_t>(std::min(NumberOfCells(fXaxis.GetNbins()), static_cast<Long64_t>(kMaxInt)));
+}
+
+Double_t GCube::GetBinContent(Int_t binx, Int_t biny, Int_t binz) const
+{
+   if(fBuffer != nullptr) {
+      const_cast<GCube*>(this)->BufferEmpty();   // NOLINT(cppcoreguidelines-pro-type-const-cast)
+   }
+   return GetCellContent(GetBin64(binx, biny, binz));
+}
+
+void GCube::SetBinContent(Int_t binx, Int_t biny, Int_t binz, Double_t content)
+{
+   fEntries++;
+   fTsumw = 0;
+   SetCellContent(GetBin64(binx, biny, binz), content);
+}
+
+Double_t GCube::GetCellError(Long64_t cell) const
+{
+   /// Error of the cell, errors are only stored (Sumw2) for cubes with Int_t bin numbers.
+   if(cell <= kMaxInt) {
+      return GetBinError(static_cast<Int_t>(cell));
+   }
+   return TMath::Sqrt(TMath::Abs(GetCellContent(cell)));
+}
+
+Bool_t GCube::Add(const TH1* h1, Double_t c1)
+{
+   /// Adds c1 times h1. If h1 is a cube with the same binning and neither of them has errors stored (Sumw2),
+   /// the cells are added directly (whole tiles for GCubeF and GCubeD), otherwise TH1::Add is used, which
+   /// only works for cubes with Int_t bin numbers.
+   const auto* cube = dynamic_cast<const GCube*>(h1);
+   if(cube == nullptr || cube == this || fBuffer != nullptr || cube->fBuffer != nullptr || GetSumw2N() != 0 ||
+      cube->GetSumw2N() != 0 || !SameLimitsAndNBins(fXaxis, *(cube->GetXaxis()))) {
+      return TH1::Add(h1, c1);
+   }
+
+   std::array<Double_t, kNstat> stats1{};
+   std::array<Double_t, kNstat> stats2{};
+   GetStats(stats1.data());
+   cube->GetStats(stats2.data());
+   Double_t entries = TMath::Abs(GetEntries() + c1 * cube->GetEntries());
+
+   AddCells(cube, c1);
+
+   // like TH1::Add, the statistics can only be kept for positive coefficients
+   if(c1 < 0) {
+      ResetStats();
+   } else {
+      for(size_t i = 0; i < stats1.size(); ++i) {
+         stats1[i] += c1 * stats2[i];
+      }
+      PutStats(stats1.data());
+   }
+   SetEntries(entries);
+   return kTRUE;
+}
+
+void GCube::AddCells(const GCube* h1, Double_t c1)
+{
+   /// Adds c1 times the content of all cells of h1, which has the same binning.
+   h1->FlushCells();
+   Long64_t ncells = NumberOfCells(fXaxis.GetNbins());
+   for(Long64_t cell = 0; cell < ncells; ++cell) {
+      Double_t content = h1->GetCellContent(cell);
+      if(content != 0.) {
+         AddCellContent(cell, c1 * content);
+      }
+   }
+}
+
+void GCube::ConvertVersion1(const TArray& cells)
+{
+   /// Version 1 of GCubeF and GCubeD inherited the content from TArrayF/TArrayD, with the cells numbered by a
+   /// packed index without tiles. This sets the cells and the errors (if stored) from the old numbering.
+   Int_t   n = fXaxis.GetNbins();
+   TArrayD sumw2(fSumw2);
+   SetBinsLength();
+   if(sumw2.fN != 0) {
+      fSumw2.Set(fNcells);
+      fSumw2.Reset();
+   }
+   for(Int_t binx = 0; binx < n + 2; ++binx) {
+      for(Int_t biny = 0; biny <= binx; ++biny) {
+         for(Int_t binz = 0; binz <= biny; ++binz) {
+            auto old = static_cast<Int_t>(binx + biny * (n - (biny + 1.) / 2.) + binz * (binz / 2. * (binz / 3. - n + 3.) + n * (3 + n / 2.) + 10. / 3.));
+            if(old < 0 || old >= cells.GetSize()) {
+               continue;
+            }
+            Long64_t cell = CellNumber(binx, biny, binz);
+            SetCellContent(cell, cells.GetAt(old));
+            if(old < sumw2.fN) {
+               fSumw2.fArray[cell] = sumw2.fArray[old];
+            }
+         }
+      }
+   }
+}
+
+void GCube::Sumw2(Bool_t flag)
+{
+   /// The sum of squares of weights can only be stored for cubes with Int_t bin numbers.
+   if(flag && NumberOfCells(fXaxis.GetNbins()) > kMaxInt) {
+      Error("Sumw2", "%s has too many cells to store the sum of squares of weights", GetName());
+      return;
+   }
+   TH1::Sumw2(flag);
+}
+
+Int_t GCube::Write(const char* name, Int_t option, Int_t bufsize) const
+{
+   /// Writes the cube to the current directory. If the content is too large for a single key (ROOT can't
+   /// write keys larger than 1 GB), it is written first as separate keys <name>_chunk<i> and
+   /// <name>_chunk<i>_blocks, which are read back when the cube is read (see DirectoryAutoAdd).
+   Int_t nbytes = 0;
+   if(gDirectory != nullptr) {
+      TString keyName = (name != nullptr && strlen(name) > 0) ? name : GetName();
+      TString opt;
+      if((option & kOverwrite) != 0) {
+         opt += "OverWrite";
+      }
+      if((option & kWriteDelete) != 0) {
+         opt += "WriteDelete";
+      }
+      nbytes += WriteChunks(gDirectory, keyName.Data(), opt.Data(), bufsize);
+   }
+   return nbytes + TH1::Write(name, option, bufsize);
+}
+
+void GCube::DirectoryAutoAdd(TDirectory* dir)
+{
+   /// Called when the cube has been read from dir, reads the content that was written in chunks.
+   TH1::DirectoryAutoAdd(dir);
+   if(!ReadChunks(dir)) {
+      Error("DirectoryAutoAdd", "failed to read the content of %s, it was written in chunks that are missing", GetName());
+   }
 }
 
 Double_t GCube::GetBinWithContent2(Double_t c, Int_t& binx, Int_t& biny, Int_t& binz, Int_t firstxbin, Int_t lastxbin,
@@ -968,6 +1332,7 @@ Double_t GCube::GetBinWithContent2(Double_t c, Int_t& binx, Int_t& biny, Int_t&
    //          ie if firstzbin=1 and lastzbin=0 (default) the search is on all bins in Z except
    //          for Z's under- and overflow bins.
    // NOTE2: if maxdiff=0 (default), the first cell with content=c is returned.
+   FlushCells();
 
    if(fDimension != 3) {
       binx = -1;
@@ -1162,6 +1527,7 @@ void GCube::GetStats(Double_t* stats) const
    ///  To force the underflows and overflows in the computation, one must
    ///  call the static function TH1::StatOverflows(kTRUE) before filling
    ///  the histogram.
+   FlushCells();
 
    if(fBuffer != nullptr) {
       const_cast<GCube*>(this)->BufferEmpty();   // NOLINT(cppcoreguidelines-pro-type-const-cast)
@@ -1211,10 +1577,10 @@ void GCube::GetStats(Double_t* stats) const
          for(Int_t biny = firstBinY; biny <= lastBinY; ++biny) {
             Double_t y = fYaxis.GetBinCenter(biny);
             for(Int_t binx = firstBinX; binx <= lastBinX; ++binx) {
-               Int_t    bin = GetBin(binx, biny, binz);
+               Long64_t bin = GetBin64(binx, biny, binz);
                Double_t x   = fXaxis.GetBinCenter(binx);
-               Double_t w   = GetBinContent(bin);
-               Double_t err = TMath::Abs(GetBinError(bin));
+               Double_t w   = GetCellContent(bin);
+               Double_t err = TMath::Abs(GetCellError(bin));
                stats[0] += w;
                stats[1] += err * err;
                stats[2] += w * x;
@@ -1388,6 +1754,7 @@ Double_t GCube::KolmogorovTest(const TH1* h2, Option_t* option) const
    ///  The average of all the maximum  distances obtained is used in the tests.
    ///
    ///  Code adapted by Rene Brun from original HBOOK routine HDIFF
+   FlushCells();
 
    TString opt = option;
    opt.ToUpper();
@@ -1769,45 +2136,45 @@ Long64_t GCube::Merge(TCollection* list)
          Int_t ny = h->GetYaxis()->GetNbins();
          Int_t nz = h->GetZaxis()->GetNbins();
 
-         // mantain loop in separate binz, biny and binz to avoid
-         // callinig FindBin(x,y,z) for every bin
-         for(Int_t binz = 0; binz <= nz + 1; ++binz) {
+         h->FlushCells();
+         // the cells only cover binx >= biny >= binz, so we loop over those and read them by their 64-bit cell number
+         // (GetBin64 sorts the bins of this cube again, the FindBin calls keep the order of the bins)
+         for(Int_t binx = 0; binx <= nx + 1; ++binx) {
             if(!allSameLimits) {
-               iz = fZaxis.FindBin(h->GetZaxis()->GetBinCenter(binz));
+               ix = fXaxis.FindBin(h->GetXaxis()->GetBinCenter(binx));
             } else {
-               iz = binz;
+               ix = binx;
             }
-
-            for(Int_t biny = 0; biny <= ny + 1; ++biny) {
+            for(Int_t biny = 0; biny <= binx && biny <= ny + 1; ++biny) {
                if(!allSameLimits) {
                   iy = fYaxis.FindBin(h->GetYaxis()->GetBinCenter(biny));
                } else {
                   iy = biny;
                }
-               for(Int_t binx = 0; binx <= nx + 1; ++binx) {
-                  Int_t    bin = binx + (nx + 2) * (biny + (ny + 2) * binz);
-                  Double_t cu  = h->GetBinContent(bin);
+               for(Int_t binz = 0; binz <= biny && binz <= nz + 1; ++binz) {
+                  Long64_t cell = h->GetBin64(binx, biny, binz);
+                  Double_t cu   = h->GetCellContent(cell);
                   if(!allSameLimits) {
-                     // look at non-empty unerflow/overflows
-                     if(cu != 0 && (h->IsBinUnderflow(bin) || h->IsBinOverflow(bin))) {
+                     // look at non-empty underflows/overflows
+                     if(cu != 0 && (binz == 0 || binx == nx + 1)) {
                         Error("Merge", "Cannot merge histograms - the histograms have"
                                        " different limits and undeflows/overflows are present."
                                        " The initial histogram is now broken!");
                         return -1;
                      }
-                     ix = fXaxis.FindBin(h->GetXaxis()->GetBinCenter(binx));
+                     iz = fZaxis.FindBin(h->GetZaxis()->GetBinCenter(binz));
                   } else {
                      // case histograms with the same limits
-                     ix = binx;
+                     iz = binz;
                   }
-                  Int_t ibin = GetBin(ix, iy, iz);
+                  Long64_t ibin = GetBin64(ix, iy, iz);
 
                   if(ibin < 0) {
                      continue;
                   }
-                  AddBinContent(ibin, cu);
-                  if(fSumw2.fN != 0) {
-                     Double_t error1 = h->GetBinError(bin);
+                  AddCellContent(ibin, cu);
+                  if(fSumw2.fN != 0 && ibin < fSumw2.fN) {
+                     Double_t error1 = h->GetCellError(cell);
                      fSumw2.fArray[ibin] += error1 * error1;
                   }
                }
@@ -1829,10 +2196,62 @@ Long64_t GCube::Merge(TCollection* list)
    return static_cast<Long64_t>(nentries);
 }
 
+void GCube::UseProjectionIndex(bool val, Long64_t maxBytes)
+{
+   /// With the projection index Projection uses two-dimensional cumulative sums over the y- and z-axis (see
+   /// GProjectionIndex), so a projection takes the same time for all gates, instead of being proportional to
+   /// the area of the gate. The index needs (nbins+2)(nbins+3)^2 doubles (twice that with errors), it is built
+   /// on demand by the first projection and rebuilt after the histogram changed. If it would need more than
+   /// maxBytes, the projections sum the cells directly.
+   Int_t nbins = fXaxis.GetNbins() + 2;
+   if(val && GProjectionIndex::Bytes(nbins, nbins, 2, GetSumw2N() != 0) > maxBytes) {
+      Warning("UseProjectionIndex", "projection index would need %lld bytes, more than the maximum of %lld bytes, not using it", GProjectionIndex::Bytes(nbins, nbins, 2, GetSumw2N() != 0), maxBytes);
+      val = false;
+   }
+   fUseProjectionIndex   = val;
+   fProjectionIndexBytes = maxBytes;
+   if(!val) {
+      ResetProjectionIndex();
+   }
+}
+
+void GCube::ResetProjectionIndex()
+{
+   /// Deletes the projection index, it is rebuilt by the next projection. Only needs to be called after changing
+   /// the content in a way that doesn't change the entries or sums of weights, e.g. via AddCellContent.
+   delete fProjectionIndex;
+   fProjectionIndex = nullptr;
+}
+
+const GProjectionIndex* GCube::ProjectionIndex(bool errors) const
+{
+   /// Returns the projection index, building it if it doesn't exist yet, or is outdated. Returns nullptr if the
+   /// projection index isn't used, or would be too large.
+   if(!fUseProjectionIndex) {
+      return nullptr;
+   }
+   GProjectionIndex::TFingerprint fingerprint = {fEntries, fTsumw, fTsumw2, static_cast<Double_t>(NumberOfCells(fXaxis.GetNbins()))};
+   if(fProjectionIndex != nullptr && fProjectionIndex->Matches(fingerprint) && (fProjectionIndex->HasErrors() || !errors)) {
+      return fProjectionIndex;
+   }
+   delete fProjectionIndex;
+   fProjectionIndex = nullptr;
+   Int_t nbins      = fXaxis.GetNbins() + 2;
+   if(GProjectionIndex::Bytes(nbins, nbins, 2, errors) > fProjectionIndexBytes) {
+      return nullptr;
+   }
+   fProjectionIndex = new GProjectionIndex(nbins, nbins, 2, errors);
+   FlushCells();
+   fProjectionIndex->Build2([this](Int_t xbin, Int_t ybin, Int_t zbin) { return GetCellContent(GetBin64(xbin, ybin, zbin)); },
+                            [this](Int_t xbin, Int_t ybin, Int_t zbin) { Double_t error = GetCellError(GetBin64(xbin, ybin, zbin)); return error * error; }, fingerprint);
+   return fProjectionIndex;
+}
+
 TH1D* GCube::Projection(const char* name, Int_t firstBiny, Int_t lastBiny, Int_t firstBinz, Int_t lastBinz,
                         Option_t* option) const
 {
    /// method for performing projection
+   FlushCells();
    const char* expectedName = "_pr";
 
    TString opt = option;
@@ -1980,6 +2399,7 @@ TH1D* GCube::Projection(const char* name, Int_t firstBiny, Int_t lastBiny, Int_t
    // Fill the projected histogram
    Double_t totcont       = 0.;
    Bool_t   computeErrors = h1->GetSumw2N() != 0;
+   const GProjectionIndex* index = ProjectionIndex(computeErrors);
 
    // implement filling of projected histogram
    // xbin is bin number of xAxis (the projected axis). Loop is done on all bin of TH2 histograms
@@ -1991,13 +2411,21 @@ TH1D* GCube::Projection(const char* name, Int_t firstBiny, Int_t lastBiny, Int_t
          continue;
       }
 
-      for(Int_t ybin = firstBiny; ybin <= lastBiny; ++ybin) {
-         for(Int_t zbin = firstBinz; zbin <= lastBinz; ++zbin) {
-            // sum bin content and error if needed
-            cont += GetBinContent(xbin, ybin, zbin);
-            if(computeErrors) {
-               Double_t exy = GetBinError(xbin, ybin, zbin);
-               err2 += exy * exy;
+      if(index != nullptr) {
+         cont = index->Sum(xbin, firstBiny, lastBiny, firstBinz, lastBinz);
+         if(computeErrors) {
+            err2 = index->Error2(xbin, firstBiny, lastBiny, firstBinz, lastBinz);
+         }
+      } else {
+         for(Int_t ybin = firstBiny; ybin <= lastBiny; ++ybin) {
+            for(Int_t zbin = firstBinz; zbin <= lastBinz; ++zbin) {
+               // sum bin content and error if needed
+               Long64_t cell = GetBin64(xbin, ybin, zbin);
+               cont += GetCellContent(cell);
+               if(computeErrors) {
+                  Double_t exy = GetCellError(cell);
+                  err2 += exy * exy;
+               }
             }
          }
       }
@@ -2081,6 +2509,136 @@ TH1D* GCube::Projection(const char* name, Int_t firstBiny, Int_t lastBiny, Int_t
    return h1;
 }
 
+std::vector<TH1D*> GCube::Projections(const std::vector<GGate>& gates, Option_t* option, Int_t nThreads) const
+{
+   /// Projects all gates in a single sweep over the cube, split into blocks of rows (cells with the same largest
+   /// bin) that are processed by nThreads threads (all hardware threads if nThreads is zero or less). The
+   /// projection of each gate is the same as the sum of Projection(name, first, last, first2, last2) of its
+   /// ranges multiplied by their weights (see GGate), and it always covers the full x-axis. Errors are
+   /// calculated if the option contains "e" or the cube has errors stored (Sumw2), each range adds its weight
+   /// squared times the squared errors. The projections are named after the gates, or <name>_gate<index> for
+   /// gates without a name.
+   if(fBuffer != nullptr) {
+      const_cast<GCube*>(this)->BufferEmpty();   // NOLINT(cppcoreguidelines-pro-type-const-cast)
+   }
+   // the threads only read the cells, so the buffered additions to a mapped file have to be applied first
+   FlushCells();
+   TString opt = option;
+   opt.ToLower();
+   const bool  computeErrors = opt.Contains("e") || GetSumw2N() != 0;
+   const Int_t nbins         = fXaxis.GetNbins() + 2;
+   const auto  nOut          = static_cast<size_t>(nbins) * gates.size();
+
+   // gates each bin of the first gate axis is part of, with their weight and range of the second gate axis
+   struct TGateBin {
+      size_t   fGate;
+      Double_t fWeight;
+      Int_t    fFirst2;
+      Int_t    fLast2;
+   };
+   std::vector<std::vector<TGateBin>> binGates(nbins);
+   for(size_t gate = 0; gate < gates.size(); ++gate) {
+      for(const auto& range : gates[gate].Ranges()) {
+         Int_t first  = std::max(range.fFirst, 0);
+         Int_t last   = (range.fLast < 0 || range.fLast >= nbins) ? nbins - 1 : range.fLast;
+         Int_t first2 = std::max(range.fFirst2, 0);
+         Int_t last2  = (range.fLast2 < 0 || range.fLast2 >= nbins) ? nbins - 1 : range.fLast2;
+         for(Int_t bin = first; bin <= last; ++bin) {
+            binGates[bin].push_back({gate, range.fWeight, first2, last2});
+         }
+      }
+   }
+
+   // each thread sums into its own projections, limited to about 256 MB for all of them
+   if(nThreads <= 0) {
+      nThreads = static_cast<Int_t>(std::max(1U, std::thread::hardware_concurrency()));
+   }
+   const size_t bytesPerThread = std::max(nOut * sizeof(Double_t) * (computeErrors ? 2 : 1), static_cast<size_t>(1));
+   nThreads                    = std::max(1, std::min(nThreads, static_cast<Int_t>((256UL << 20) / bytesPerThread)));
+   std::vector<std::vector<Double_t>> content(nThreads, std::vector<Double_t>(nOut, 0.));
+   std::vector<std::vector<Double_t>> error2(computeErrors ? nThreads : 0, std::vector<Double_t>(nOut, 0.));
+
+   // each distinct permutation x, y, z of the bins of a cell adds to bin x of the gates with y in the first and
+   // z in the second range, cells without any gated bin are skipped
+   constexpr Int_t kRowsPerBlock = 4;
+   auto            sweep         = [&](Int_t thread) {
+      Double_t* cont        = content[thread].data();
+      Double_t* err2        = computeErrors ? error2[thread].data() : nullptr;
+      Double_t  cellContent = 0.;
+      Double_t  cellError2  = 0.;
+      auto      add         = [&](Int_t x, Int_t y, Int_t z) {
+         for(const auto& gateBin : binGates[y]) {
+            if(z < gateBin.fFirst2 || z > gateBin.fLast2) {
+               continue;
+            }
+            cont[gateBin.fGate * nbins + x] += gateBin.fWeight * cellContent;
+            if(err2 != nullptr) {
+               err2[gateBin.fGate * nbins + x] += gateBin.fWeight * gateBin.fWeight * cellError2;
+            }
+         }
+      };
+      for(Int_t block = thread; block * kRowsPerBlock < nbins; block += nThreads) {
+         for(Int_t binx = block * kRowsPerBlock; binx < std::min((block + 1) * kRowsPerBlock, nbins); ++binx) {
+            for(Int_t biny = 0; biny <= binx; ++biny) {
+               for(Int_t binz = 0; binz <= biny; ++binz) {
+                  if(binGates[binx].empty() && binGates[biny].empty() && binGates[binz].empty()) {
+                     continue;
+                  }
+                  Long64_t cell = CellNumber(binx, biny, binz);
+                  cellContent   = GetCellContent(cell);
+                  cellError2    = 0.;
+                  if(err2 != nullptr) {
+                     Double_t error = GetCellError(cell);
+                     cellError2     = error * error;
+                  }
+                  if(cellContent == 0. && cellError2 == 0.) {
+                     continue;
+                  }
+                  // all distinct permutations of binx >= biny >= binz
+                  add(binx, biny, binz);
+                  if(biny != binz) {
+                     add(binx, binz, biny);
+                  }
+                  if(biny != binx) {
+                     add(biny, binx, binz);
+                     add(biny, binz, binx);
+                  }
+                  if(binz != biny && binz != binx) {
+                     add(binz, binx, biny);
+                     if(binx != biny) {
+                        add(binz, biny, binx);
+                     }
+                  }
+               }
+            }
+         }
+      }
+   };
+   std::vector<std::thread> threads;
+   for(Int_t thread = 1; thread < nThreads; ++thread) {
+      threads.emplace_back(sweep, thread);
+   }
+   sweep(0);
+   for(auto& thread : threads) {
+      thread.join();
+   }
+   for(Int_t thread = 1; thread < nThreads; ++thread) {
+      for(size_t i = 0; i < nOut; ++i) {
+         content[0][i] += content[thread][i];
+         if(computeErrors) {
+            error2[0][i] += error2[thread][i];
+         }
+      }
+   }
+
+   std::vector<TH1D*> result;
+   for(size_t gate = 0; gate < gates.size(); ++gate) {
+      TString name = gates[gate].Name().empty() ? TString::Format("%s_gate%zu", GetName(), gate) : TString(gates[gate].Name().c_str());
+      result.push_back(GGate::Projection(name, *this, content[0].data() + gate * nbins, computeErrors ? error2[0].data() + gate * nbins : nullptr));
+   }
+   return result;
+}
+
 void GCube::PutStats(Double_t* stats)
 {
    // Replace current statistics with the values in array stats
@@ -2118,6 +2676,7 @@ GCube* GCube::Rebin3D(Int_t ngroup, const char* newname)
    ///          and the corresponding bins are added to
    ///          the overflow bin.
    ///          Statistics will be recomputed from the new bin contents.
+   FlushCells();
 
    Int_t    nbins = fXaxis.GetNbins();
    Double_t min   = fXaxis.GetXmin();
@@ -2131,7 +2690,7 @@ GCube* GCube::Rebin3D(Int_t ngroup, const char* newname)
 
    // Save old bin contents into a new array
    Double_t entries = fEntries;
-   auto*    oldBins = new Double_t[(nbins + 2) * (nbins + 3) * (nbins + 4) / 6];
+   auto*    oldBins = new Double_t[fNcells];
    for(Int_t xbin = 0; xbin < nbins + 2; xbin++) {
       for(Int_t ybin = 0; ybin <= xbin; ybin++) {
          for(Int_t zbin = 0; zbin <= ybin; zbin++) {
@@ -2142,7 +2701,7 @@ GCube* GCube::Rebin3D(Int_t ngroup, const char* newname)
    }
    Double_t* oldErrors = nullptr;
    if(fSumw2.fN != 0) {
-      oldErrors = new Double_t[(nbins + 2) * (nbins + 3) * (nbins + 4) / 6];
+      oldErrors = new Double_t[fNcells];
       for(Int_t xbin = 0; xbin < nbins + 2; xbin++) {
          for(Int_t ybin = 0; ybin <= xbin; ybin++) {
             for(Int_t zbin = 0; zbin <= ybin; zbin++) {
@@ -2438,6 +2997,7 @@ void GCube::Reset(Option_t* option)
    //*-*            ===========================================
 
    TH1::Reset(option);
+   ResetProjectionIndex();
    TString opt = option;
    opt.ToUpper();
 
@@ -2637,7 +3197,7 @@ GCubeF::GCubeF()
 GCubeF::GCubeF(const char* name, const char* title, Int_t nbins, Double_t low, Double_t up)
    : GCube(name, title, nbins, low, up)
 {
-   TArrayF::Set(fNcells);
+   SetBinsLength();
    if(fgDefaultSumw2) {
       Sumw2();
    }
@@ -2649,7 +3209,7 @@ GCubeF::GCubeF(const char* name, const char* title, Int_t nbins, Double_t low, D
 
 GCubeF::GCubeF(const char* name, const char* title, Int_t nbins, const Double_t* bins) : GCube(name, title, nbins, bins)
 {
-   TArrayF::Set(fNcells);
+   SetBinsLength();
    if(fgDefaultSumw2) {
       Sumw2();
    }
@@ -2657,20 +3217,20 @@ GCubeF::GCubeF(const char* name, const char* title, Int_t nbins, const Double_t*
 
 GCubeF::GCubeF(const char* name, const char* title, Int_t nbins, const Float_t* bins) : GCube(name, title, nbins, bins)
 {
-   TArrayF::Set(fNcells);
+   SetBinsLength();
    if(fgDefaultSumw2) {
       Sumw2();
    }
 }
 
 GCubeF::GCubeF(const GCubeF& rhs)
-   : GCube(rhs), TArrayF(rhs)
+   : GCube(rhs)
 {
    rhs.Copy(*this);
 }
 
 GCubeF::GCubeF(GCubeF&& rhs) noexcept
-   : GCube(std::move(rhs)), TArrayF(rhs)
+   : GCube(std::move(rhs))
 {
    rhs.Copy(*this);
 }
@@ -2679,6 +3239,7 @@ GCubeF::~GCubeF() = default;
 
 TH2F* GCubeF::GetMatrix(bool force)
 {
+   FlushCells();
    if(Matrix() != nullptr && !force) {
       return static_cast<TH2F*>(Matrix());
    }
@@ -2701,6 +3262,74 @@ TH2F* GCubeF::GetMatrix(bool force)
 void GCubeF::Copy(TObject& rh) const
 {
    GCube::Copy(static_cast<GCubeF&>(rh));
+   // the base class copy constructor calls this before the cells of rh are constructed, rh is no GCubeF yet in that case
+   auto* cube = dynamic_cast<GCubeF*>(&rh);
+   if(cube != nullptr) {
+      cube->fCells = fCells;
+   }
+}
+
+void GCubeF::AddCells(const GCube* h1, Double_t c1)
+{
+   /// Adds c1 times the content of h1 (with the same binning), whole tiles at a time if h1 is a GCubeF as well.
+   const auto* cube = dynamic_cast<const GCubeF*>(h1);
+   if(cube == nullptr) {
+      GCube::AddCells(h1, c1);
+      return;
+   }
+   fCells.Add(cube->fCells, c1);
+}
+
+void GCubeF::Streamer(TBuffer& R__b)
+{
+   /// Stream an object of class GCubeF. Version 1 inherited the content from TArrayF, version 2 streams
+   /// the allocated tiles, or only the names of the chunks they were written to (see GBlockedArray::Streamer).
+   /// Version 3 also streams the name of the mapped file of the cells (see MapFile), which is mapped again
+   /// with EMapMode::kPrivate when the cube is read, so it can be gated without loading it into memory.
+   UInt_t R__s = 0;
+   UInt_t R__c = 0;
+   if(R__b.IsReading()) {
+      Version_t R__v = R__b.ReadVersion(&R__s, &R__c);
+      GCube::Streamer(R__b);
+      if(R__v < 2) {
+         TArrayF cells;
+         cells.Streamer(R__b);
+         ConvertVersion1(cells);
+      } else {
+         fCells.Streamer(R__b);
+         SetNcells();
+      }
+      if(R__v > 2) {
+         TString mappedFile;
+         mappedFile.Streamer(R__b);
+         if(mappedFile.Length() > 0 && !fCells.Map(mappedFile.Data(), EMapMode::kPrivate)) {
+            Error("Streamer", "failed to map %s, the content of %s is lost", mappedFile.Data(), GetName());
+         }
+      }
+      R__b.CheckByteCount(R__s, R__c, GCubeF::IsA());
+   } else {
+      R__c = R__b.WriteVersion(GCubeF::IsA(), kTRUE);
+      GCube::Streamer(R__b);
+      fCells.Streamer(R__b);
+      TString mappedFile = fCells.MappedFile();
+      mappedFile.Streamer(R__b);
+      R__b.SetByteCount(R__c, kTRUE);
+   }
+}
+
+bool GCubeF::MapFile(const char* fileName, EMapMode mode)
+{
+   /// Stores the cells in the memory-mapped file fileName instead of memory (see GBlockedArray::Map). With
+   /// EMapMode::kCreate the current content is copied into the file, otherwise the content of the file (e.g.
+   /// of a cube that was filled on another machine) replaces it, but the statistics are not stored in the
+   /// file. Additions are buffered and applied sorted by cell, except in shared mode (see SetShared).
+   ResetProjectionIndex();
+   if(!fCells.Map(fileName, mode)) {
+      Error("MapFile", "failed to map %s with %lld cells to %s", GetName(), NumberOfCells(fXaxis.GetNbins()), fileName);
+      return false;
+   }
+   fCells.SetBuffered(!IsShared());
+   return true;
 }
 
 TH1* GCubeF::DrawCopy(Option_t* option, const char* name_postfix) const
@@ -2733,10 +3362,10 @@ Double_t GCubeF::GetBinContent(Int_t bin) const
    if(bin >= fNcells) {
       bin = fNcells - 1;
    }
-   if(fArray == nullptr) {
+   if(fCells.Size() == 0) {
       return 0;
    }
-   return static_cast<Double_t>(fArray[bin]);
+   return static_cast<Double_t>(fCells.At(bin));
 }
 
 void GCubeF::Reset(Option_t* option)
@@ -2745,7 +3374,7 @@ void GCubeF::Reset(Option_t* option)
    //*-*            ===========================================
 
    GCube::Reset(option);
-   TArrayF::Reset();
+   fCells.Reset();
 }
 
 void GCubeF::SetBinContent(Int_t bin, Double_t content)
@@ -2759,19 +3388,16 @@ void GCubeF::SetBinContent(Int_t bin, Double_t content)
    if(bin >= fNcells) {
       return;
    }
-   fArray[bin] = static_cast<Float_t>(content);
+   fCells.Set(bin, static_cast<Float_t>(content));
 }
 
-void GCubeF::SetBinsLength(Int_t n)
+void GCubeF::SetBinsLength(Int_t)
 {
    // Set total number of bins including under/overflow
-   // Reallocate bin contents array
+   // Reallocate bin contents array, the number of cells is always given by the number of bins of the x-axis
 
-   if(n < 0) {
-      n = (fXaxis.GetNbins() + 2) * (fYaxis.GetNbins() + 2);
-   }
-   fNcells = n;
-   TArrayF::Set(n);
+   SetNcells();
+   fCells.Set(NumberOfCells(fXaxis.GetNbins()));
 }
 
 GCubeF& GCubeF::operator=(const GCubeF& h1)
@@ -2859,7 +3485,7 @@ GCubeD::GCubeD()
 GCubeD::GCubeD(const char* name, const char* title, Int_t nbins, Double_t low, Double_t up)
    : GCube(name, title, nbins, low, up)
 {
-   TArrayD::Set(fNcells);
+   SetBinsLength();
    if(fgDefaultSumw2) {
       Sumw2();
    }
@@ -2871,7 +3497,7 @@ GCubeD::GCubeD(const char* name, const char* title, Int_t nbins, Double_t low, D
 
 GCubeD::GCubeD(const char* name, const char* title, Int_t nbins, const Double_t* bins) : GCube(name, title, nbins, bins)
 {
-   TArrayD::Set(fNcells);
+   SetBinsLength();
    if(fgDefaultSumw2) {
       Sumw2();
    }
@@ -2879,20 +3505,20 @@ GCubeD::GCubeD(const char* name, const char* title, Int_t nbins, const Double_t*
 
 GCubeD::GCubeD(const char* name, const char* title, Int_t nbins, const Float_t* bins) : GCube(name, title, nbins, bins)
 {
-   TArrayD::Set(fNcells);
+   SetBinsLength();
    if(fgDefaultSumw2) {
       Sumw2();
    }
 }
 
 GCubeD::GCubeD(const GCubeD& rhs)
-   : GCube(rhs), TArrayD(rhs)
+   : GCube(rhs)
 {
    rhs.Copy(*this);
 }
 
 GCubeD::GCubeD(GCubeD&& rhs) noexcept
-   : GCube(std::move(rhs)), TArrayD(rhs)
+   : GCube(std::move(rhs))
 {
    rhs.Copy(*this);
 }
@@ -2901,6 +3527,7 @@ GCubeD::~GCubeD() = default;
 
 TH2D* GCubeD::GetMatrix(bool force)
 {
+   FlushCells();
    if(Matrix() != nullptr && !force) {
       return static_cast<TH2D*>(Matrix());
    }
@@ -2925,6 +3552,74 @@ TH2D* GCubeD::GetMatrix(bool force)
 void GCubeD::Copy(TObject& rh) const
 {
    GCube::Copy(static_cast<GCubeD&>(rh));
+   // the base class copy constructor calls this before the cells of rh are constructed, rh is no GCubeD yet in that case
+   auto* cube = dynamic_cast<GCubeD*>(&rh);
+   if(cube != nullptr) {
+      cube->fCells = fCells;
+   }
+}
+
+void GCubeD::AddCells(const GCube* h1, Double_t c1)
+{
+   /// Adds c1 times the content of h1 (with the same binning), whole tiles at a time if h1 is a GCubeD as well.
+   const auto* cube = dynamic_cast<const GCubeD*>(h1);
+   if(cube == nullptr) {
+      GCube::AddCells(h1, c1);
+      return;
+   }
+   fCells.Add(cube->fCells, c1);
+}
+
+void GCubeD::Streamer(TBuffer& R__b)
+{
+   /// Stream an object of class GCubeD. Version 1 inherited the content from TArrayD, version 2 streams
+   /// the allocated tiles, or only the names of the chunks they were written to (see GBlockedArray::Streamer).
+   /// Version 3 also streams the name of the mapped file of the cells (see MapFile), which is mapped again
+   /// with EMapMode::kPrivate when the cube is read, so it can be gated without loading it into memory.
+   UInt_t R__s = 0;
+   UInt_t R__c = 0;
+   if(R__b.IsReading()) {
+      Version_t R__v = R__b.ReadVersion(&R__s, &R__c);
+      GCube::Streamer(R__b);
+      if(R__v < 2) {
+         TArrayD cells;
+         cells.Streamer(R__b);
+         ConvertVersion1(cells);
+      } else {
+         fCells.Streamer(R__b);
+         SetNcells();
+      }
+      if(R__v > 2) {
+         TString mappedFile;
+         mappedFile.Streamer(R__b);
+         if(mappedFile.Length() > 0 && !fCells.Map(mappedFile.Data(), EMapMode::kPrivate)) {
+            Error("Streamer", "failed to map %s, the content of %s is lost", mappedFile.Data(), GetName());
+         }
+      }
+      R__b.CheckByteCount(R__s, R__c, GCubeD::IsA());
+   } else {
+      R__c = R__b.WriteVersion(GCubeD::IsA(), kTRUE);
+      GCube::Streamer(R__b);
+      fCells.Streamer(R__b);
+      TString mappedFile = fCells.MappedFile();
+      mappedFile.Streamer(R__b);
+      R__b.SetByteCount(R__c, kTRUE);
+   }
+}
+
+bool GCubeD::MapFile(const char* fileName, EMapMode mode)
+{
+   /// Stores the cells in the memory-mapped file fileName instead of memory (see GBlockedArray::Map). With
+   /// EMapMode::kCreate the current content is copied into the file, otherwise the content of the file (e.g.
+   /// of a cube that was filled on another machine) replaces it, but the statistics are not stored in the
+   /// file. Additions are buffered and applied sorted by cell, except in shared mode (see SetShared).
+   ResetProjectionIndex();
+   if(!fCells.Map(fileName, mode)) {
+      Error("MapFile", "failed to map %s with %lld cells to %s", GetName(), NumberOfCells(fXaxis.GetNbins()), fileName);
+      return false;
+   }
+   fCells.SetBuffered(!IsShared());
+   return true;
 }
 
 TH1* GCubeD::DrawCopy(Option_t* option, const char* name_postfix) const
@@ -2956,10 +3651,10 @@ Double_t GCubeD::GetBinContent(Int_t bin) const
    if(bin >= fNcells) {
       bin = fNcells - 1;
    }
-   if(fArray == nullptr) {
+   if(fCells.Size() == 0) {
       return 0;
    }
-   return static_cast<Double_t>(fArray[bin]);
+   return static_cast<Double_t>(fCells.At(bin));
 }
 
 void GCubeD::Reset(Option_t* option)
@@ -2968,7 +3663,7 @@ void GCubeD::Reset(Option_t* option)
    //*-*            ===========================================
 
    GCube::Reset(option);
-   TArrayD::Reset();
+   fCells.Reset();
 }
 
 void GCubeD::SetBinContent(Int_t bin, Double_t content)
@@ -2982,19 +3677,16 @@ void GCubeD::SetBinContent(Int_t bin, Double_t content)
    if(bin >= fNcells) {
       return;
    }
-   fArray[bin] = static_cast<Float_t>(content);
+   fCells.Set(bin, static_cast<Double_t>(content));
 }
 
-void GCubeD::SetBinsLength(Int_t n)
+void GCubeD::SetBinsLength(Int_t)
 {
    // Set total number of bins including under/overflow
-   // Reallocate bin contents array
+   // Reallocate bin contents array, the number of cells is always given by the number of bins of the x-axis
 
-   if(n < 0) {
-      n = (fXaxis.GetNbins() + 2) * (fYaxis.GetNbins() + 2);
-   }
-   fNcells = n;
-   TArrayD::Set(n);
+   SetNcells();
+   fCells.Set(NumberOfCells(fXaxis.GetNbins()));
 }
 
 GCubeD& GCubeD::operator=(const GCubeD& h1)
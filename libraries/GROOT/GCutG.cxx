@@ -0,0 +1,126 @@
+#include "GCutG.h"
+
+#include <algorithm>
+
+#include "TBuffer.h"
+
+GCutG::GCutG(const TCutG& cut)
+   : TCutG(cut)
+{
+   Update();
+}
+
+GCutG::GCutG(const char* name, Int_t n, const Double_t* x, const Double_t* y)
+   : TCutG(name, n, x, y)
+{
+   Update();
+}
+
+Int_t GCutG::IsInside(Double_t x, Double_t y) const
+{
+   /// Returns 1 if the point x, y is inside the cut, using the same test as TCutG::IsInside
+   /// (TMath::IsInside) for the edges of the slab of y only.
+   if(fSlabPoints != fNpoints) {
+      return TCutG::IsInside(x, y);
+   }
+   if(y <= fYMin || y > fYMax || x <= fXMin || x > fXMax) {
+      return 0;
+   }
+   const Int_t slab   = Slab(y);
+   bool        inside = false;
+   for(Int_t e = fSlabStart[slab]; e < fSlabStart[slab + 1]; ++e) {
+      const auto& edge = fSlabEdges[e];
+      if(((edge.fY1 < y && edge.fY2 >= y) || (edge.fY2 < y && edge.fY1 >= y)) &&
+         edge.fX1 + (y - edge.fY1) / (edge.fY2 - edge.fY1) * (edge.fX2 - edge.fX1) < x) {
+         inside = !inside;
+      }
+   }
+   return inside ? 1 : 0;
+}
+
+void GCutG::IsInside(Int_t n, const Double_t* x, const Double_t* y, Bool_t* inside) const
+{
+   /// Checks the n points x[i], y[i], and sets inside[i] to whether the point is inside the cut.
+   for(Int_t i = 0; i < n; ++i) {
+      inside[i] = IsInside(x[i], y[i]) != 0;
+   }
+}
+
+void GCutG::SetPoint(Int_t i, Double_t x, Double_t y)
+{
+   TCutG::SetPoint(i, x, y);
+   Update();
+}
+
+void GCutG::Update()
+{
+   /// Builds the bounding box and the slabs from the current points. Each slab covers the same range of y, and has
+   /// all edges (point i to the previous point, as in TMath::IsInside) that a horizontal line in it can cross.
+   fSlabStart.clear();
+   fSlabEdges.clear();
+   fSlabPoints = fNpoints;
+   if(fNpoints < 1) {
+      fXMin      = 0.;
+      fXMax      = 0.;
+      fYMin      = 0.;
+      fYMax      = 0.;
+      fSlabScale = 0.;
+      fSlabStart.assign(2, 0);
+      return;
+   }
+   const auto xRange = std::minmax_element(fX, fX + fNpoints);
+   const auto yRange = std::minmax_element(fY, fY + fNpoints);
+   fXMin             = *xRange.first;
+   fXMax             = *xRange.second;
+   fYMin             = *yRange.first;
+   fYMax             = *yRange.second;
+
+   const Int_t nSlabs = std::max(1, std::min(fNpoints, kMaxSlabs));
+   fSlabScale         = fYMax > fYMin ? nSlabs / (fYMax - fYMin) : 0.;
+   fSlabStart.assign(nSlabs + 1, 0);
+
+   // count the edges of each slab first, then fill them in, horizontal edges are never crossed and are skipped
+   for(Int_t i = 0, j = fNpoints - 1; i < fNpoints; j = i++) {
+      if(fY[i] != fY[j]) {
+         for(Int_t slab = Slab(std::min(fY[i], fY[j])); slab <= Slab(std::max(fY[i], fY[j])); ++slab) {
+            ++fSlabStart[slab + 1];
+         }
+      }
+   }
+   for(Int_t slab = 0; slab < nSlabs; ++slab) {
+      fSlabStart[slab + 1] += fSlabStart[slab];
+   }
+   fSlabEdges.resize(fSlabStart[nSlabs]);
+   std::vector<Int_t> next(fSlabStart.begin(), fSlabStart.end() - 1);
+   for(Int_t i = 0, j = fNpoints - 1; i < fNpoints; j = i++) {
+      if(fY[i] != fY[j]) {
+         for(Int_t slab = Slab(std::min(fY[i], fY[j])); slab <= Slab(std::max(fY[i], fY[j])); ++slab) {
+            fSlabEdges[next[slab]++] = TEdge{fX[i], fY[i], fX[j], fY[j]};
+         }
+      }
+   }
+}
+
+Int_t GCutG::Slab(Double_t y) const
+{
+   /// Slab of y, points below or above the cut are put into the first or last slab.
+   const auto slab = static_cast<Int_t>(std::max(0., (y - fYMin) * fSlabScale));
+   return std::min(slab, static_cast<Int_t>(fSlabStart.size()) - 2);
+}
+
+void GCutG::Streamer(TBuffer& R__b)
+{
+   /// Stream an object of class GCutG, the same as a TCutG. The slabs are built when the cut is read.
+   UInt_t R__s = 0;
+   UInt_t R__c = 0;
+   if(R__b.IsReading()) {
+      R__b.ReadVersion(&R__s, &R__c);
+      TCutG::Streamer(R__b);
+      R__b.CheckByteCount(R__s, R__c, GCutG::IsA());
+      Update();
+   } else {
+      R__c = R__b.WriteVersion(GCutG::IsA(), kTRUE);
+      TCutG::Streamer(R__b);
+      R__b.SetByteCount(R__c, kTRUE);
+   }
+}
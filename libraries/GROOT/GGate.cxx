@@ -0,0 +1,48 @@
+#include "GGate.h"
+
+#include "TROOT.h"
+#include "TH1.h"
+#include "TMath.h"
+
+TH1D* GGate::Projection(const char* name, const TH1& histogram, const Double_t* content, const Double_t* error2)
+{
+   /// Creates (or re-uses) the projection with the name and sets its bins (including under- and overflow) to
+   /// content and the squared errors error2 (if not nullptr). The binning, title, and attributes are the ones
+   /// of the x-axis of histogram (the GHSym or GCube the gate was projected from).
+   const TAxis* xaxis = histogram.GetXaxis();
+   TH1D*        h1    = nullptr;
+   TObject*     h1obj = gROOT->FindObject(name);
+   if(h1obj != nullptr && h1obj->IsA() == TH1D::Class()) {
+      h1 = static_cast<TH1D*>(h1obj);
+      h1->Reset();
+      if(xaxis->GetXbins()->fN == 0) {
+         h1->SetBins(xaxis->GetNbins(), xaxis->GetXmin(), xaxis->GetXmax());
+      } else {
+         h1->SetBins(xaxis->GetNbins(), xaxis->GetXbins()->fArray);
+      }
+   } else if(xaxis->GetXbins()->fN == 0) {
+      h1 = new TH1D(name, histogram.GetTitle(), xaxis->GetNbins(), xaxis->GetXmin(), xaxis->GetXmax());
+   } else {
+      h1 = new TH1D(name, histogram.GetTitle(), xaxis->GetNbins(), xaxis->GetXbins()->fArray);
+   }
+   if(error2 != nullptr && h1->GetSumw2N() == 0) {
+      h1->Sumw2();
+   }
+   h1->GetXaxis()->ImportAttributes(xaxis);
+   h1->SetLineColor(histogram.GetLineColor());
+   h1->SetFillColor(histogram.GetFillColor());
+   h1->SetMarkerColor(histogram.GetMarkerColor());
+   h1->SetMarkerStyle(histogram.GetMarkerStyle());
+
+   Double_t totcont = 0.;
+   for(Int_t bin = 0; bin <= xaxis->GetNbins() + 1; ++bin) {
+      h1->SetBinContent(bin, content[bin]);
+      if(error2 != nullptr) {
+         h1->SetBinError(bin, TMath::Sqrt(error2[bin]));
+      }
+      totcont += content[bin];
+   }
+   // same as Projection for gates that don't cover the whole histogram
+   h1->SetEntries(h1->GetSumw2N() != 0 ? h1->GetEffectiveEntries() : TMath::Floor(totcont + 0.5));
+   return h1;
+}
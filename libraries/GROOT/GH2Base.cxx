@@ -1,8 +1,12 @@
 #include "GH2Base.h"
 
+#include <cmath>
+#include <cstring>
 #include <iostream>
+#include <limits>
 
 #include "TDirectory.h"
+#include "TH1D.h"
 
 #include "GH1D.h"
 #include "SuppressTH1GDirectory.h"
@@ -50,16 +54,16 @@ GH1D* GH2Base::Projection_Background(int axis, int firstbin, int lastbin, int fi
       bg_xlow  = GetTH2()->GetXaxis()->GetBinLowEdge(first_bg_bin);
       bg_xhigh = GetTH2()->GetXaxis()->GetBinUpEdge(last_bg_bin);
       sproj    = "projx";
-      proj     = GetTH2()->ProjectionX("temp1", firstbin, lastbin);
-      bg_proj  = GetTH2()->ProjectionX("temp2", first_bg_bin, last_bg_bin);
+      proj     = Project(0, "temp1", firstbin, lastbin);
+      bg_proj  = Project(0, "temp2", first_bg_bin, last_bg_bin);
    } else if(axis == 1) {
       xlow     = GetTH2()->GetYaxis()->GetBinLowEdge(firstbin);
       xhigh    = GetTH2()->GetYaxis()->GetBinUpEdge(lastbin);
       bg_xlow  = GetTH2()->GetYaxis()->GetBinLowEdge(first_bg_bin);
       bg_xhigh = GetTH2()->GetYaxis()->GetBinUpEdge(last_bg_bin);
       sproj    = "projy";
-      proj     = GetTH2()->ProjectionY("temp1", firstbin, lastbin);
-      bg_proj  = GetTH2()->ProjectionY("temp2", first_bg_bin, last_bg_bin);
+      proj     = Project(1, "temp1", firstbin, lastbin);
+      bg_proj  = Project(1, "temp2", first_bg_bin, last_bg_bin);
    } else {
       return nullptr;
    }
@@ -68,7 +72,8 @@ GH1D* GH2Base::Projection_Background(int axis, int firstbin, int lastbin, int fi
    title = Form("%s_%s_%d[%.02f]_%d[%.02f]_bg_%d[%.02f]_%d[%.02f]", GetTH2()->GetName(), sproj.c_str(), firstbin, xlow,
                 lastbin, xhigh, first_bg_bin, bg_xlow, last_bg_bin, bg_xhigh);
 
-   double bg_scaling = static_cast<double>(lastbin - firstbin) / static_cast<double>(last_bg_bin - first_bg_bin);
+   // scale the background by the ratio of the number of bins of gate and background (both inclusive), same as GGate::AddBackground
+   double bg_scaling = static_cast<double>(lastbin - firstbin + 1) / static_cast<double>(last_bg_bin - first_bg_bin + 1);
    if(mode == EBackgroundSubtraction::kNoBackground) {
       bg_scaling = 0;
    }
@@ -87,6 +92,104 @@ GH1D* GH2Base::Projection_Background(int axis, int firstbin, int lastbin, int fi
    return output;
 }
 
+void GH2Base::UseProjectionIndex(bool val)
+{
+   /// With the projection index the projections (including the background subtracted ones) use cumulative sums
+   /// along the gate axis (see GProjectionIndex), so a projection takes the same time for all gates, instead of
+   /// being proportional to the width of the gate. The index needs one double per bin of the matrix for each
+   /// projection direction used (twice that with errors), it is built on demand by the first projection and
+   /// rebuilt after the matrix changed. Projections with options or axis ranges set don't use the index.
+   fUseProjectionIndex = val;
+   if(!val) {
+      ResetProjectionIndex();
+   }
+}
+
+void GH2Base::ResetProjectionIndex()
+{
+   /// Deletes the projection indices, they are rebuilt by the next projection. Only needs to be called after
+   /// changing the content in a way that doesn't change the entries or sums of weights, e.g. via AddBinContent.
+   fProjectionIndexX.reset();
+   fProjectionIndexY.reset();
+}
+
+GProjectionIndex::TFingerprint GH2Base::ProjectionFingerprint() const
+{
+   /// Default for matrices that can't tell whether their content has changed: without a fingerprint the
+   /// projections never use the projection index (see Project).
+   const Double_t none = std::numeric_limits<Double_t>::quiet_NaN();
+   return {none, none, none, none};
+}
+
+const GProjectionIndex* GH2Base::ProjectionIndex(int axis, bool errors)
+{
+   /// Returns the projection index for projections on the x- (axis 0) or y-axis (axis 1), building it if it
+   /// doesn't exist yet, or is outdated.
+   auto&                          index       = (axis == 0) ? fProjectionIndexX : fProjectionIndexY;
+   GProjectionIndex::TFingerprint fingerprint = ProjectionFingerprint();
+   if(index && index->Matches(fingerprint) && (index->HasErrors() || !errors)) {
+      return index.get();
+   }
+   // a new index instead of rebuilding the old one, which might be shared with a copy of this matrix
+   TH2* mat = GetTH2();
+   if(axis == 0) {
+      index = std::make_shared<GProjectionIndex>(mat->GetXaxis()->GetNbins() + 2, mat->GetYaxis()->GetNbins() + 2, 1, errors);
+      index->Build([mat](Int_t xbin, Int_t ybin) { return mat->GetBinContent(xbin, ybin); },
+                   [mat](Int_t xbin, Int_t ybin) { Double_t error = mat->GetBinError(xbin, ybin); return error * error; }, fingerprint);
+   } else {
+      index = std::make_shared<GProjectionIndex>(mat->GetYaxis()->GetNbins() + 2, mat->GetXaxis()->GetNbins() + 2, 1, errors);
+      index->Build([mat](Int_t ybin, Int_t xbin) { return mat->GetBinContent(xbin, ybin); },
+                   [mat](Int_t ybin, Int_t xbin) { Double_t error = mat->GetBinError(xbin, ybin); return error * error; }, fingerprint);
+   }
+   return index.get();
+}
+
+TH1D* GH2Base::Project(int axis, const char* name, int firstbin, int lastbin, Option_t* option)
+{
+   /// Projects the bins firstbin to lastbin of the matrix on the x- (axis 0) or y-axis (axis 1), the same as
+   /// TH2::ProjectionX/TH2::ProjectionY, using the projection index if it is enabled. The statistics of the
+   /// projection are always calculated from its bins.
+   TH2*   mat      = GetTH2();
+   TAxis* outAxis  = (axis == 0) ? mat->GetXaxis() : mat->GetYaxis();
+   TAxis* gateAxis = (axis == 0) ? mat->GetYaxis() : mat->GetXaxis();
+   if(!fUseProjectionIndex || strlen(option) != 0 || outAxis->TestBit(TAxis::kAxisRange) || gateAxis->TestBit(TAxis::kAxisRange) ||
+      outAxis->GetLabels() != nullptr || std::isnan(ProjectionFingerprint()[0])) {
+      return (axis == 0) ? mat->ProjectionX(name, firstbin, lastbin, option) : mat->ProjectionY(name, firstbin, lastbin, option);
+   }
+   if(firstbin < 0) {
+      firstbin = 0;
+   }
+   if(lastbin < 0 || lastbin > gateAxis->GetNbins() + 1) {
+      lastbin = gateAxis->GetNbins() + 1;
+   }
+
+   bool                    computeErrors = mat->GetSumw2N() != 0;
+   const GProjectionIndex* index         = ProjectionIndex(axis, computeErrors);
+
+   TH1D* proj = nullptr;
+   if(outAxis->GetXbins()->fN == 0) {
+      proj = new TH1D(name, mat->GetTitle(), outAxis->GetNbins(), outAxis->GetXmin(), outAxis->GetXmax());
+   } else {
+      proj = new TH1D(name, mat->GetTitle(), outAxis->GetNbins(), outAxis->GetXbins()->GetArray());
+   }
+   if(computeErrors) {
+      proj->Sumw2();
+   }
+   proj->GetXaxis()->ImportAttributes(outAxis);
+
+   double total = 0.;
+   for(int bin = 0; bin <= outAxis->GetNbins() + 1; ++bin) {
+      double content = index->Sum(bin, firstbin, lastbin);
+      proj->SetBinContent(bin, content);
+      if(computeErrors) {
+         proj->SetBinError(bin, std::sqrt(index->Error2(bin, firstbin, lastbin)));
+      }
+      total += content;
+   }
+   proj->SetEntries(computeErrors ? proj->GetEffectiveEntries() : std::floor(total + 0.5));
+   return proj;
+}
+
 GH1D* GH2Base::GH2ProjectionX(const char* name, int firstbin, int lastbin, Option_t* option, bool KeepEmpty)
 {
    std::string title;
@@ -112,7 +215,7 @@ GH1D* GH2Base::GH2ProjectionX(const char* name, int firstbin, int lastbin, Optio
    GH1D* output = nullptr;
    {
       SuppressTH1GDirectory sup;
-      TH1D*                 proj = GetTH2()->ProjectionX("temp", firstbin, lastbin, option);
+      TH1D*                 proj = Project(0, "temp", firstbin, lastbin, option);
       output                     = new GH1D(*proj);
       proj->Delete();
    }
@@ -166,7 +269,7 @@ GH1D* GH2Base::GH2ProjectionY(const char* name, int firstbin, int lastbin, Optio
    GH1D* output = nullptr;
    {
       SuppressTH1GDirectory sup;
-      TH1D*                 proj = GetTH2()->ProjectionY("temp", firstbin, lastbin, option);
+      TH1D*                 proj = Project(1, "temp", firstbin, lastbin, option);
       output                     = new GH1D(*proj);
       proj->Delete();
    }
@@ -65,6 +65,30 @@ void GH2D::Clear(Option_t* opt)
    GH2Clear();
 }
 
+void GH2D::Reset(Option_t* opt)
+{
+   TH2D::Reset(opt);
+   ResetProjectionIndex();
+}
+
+void GH2D::SetBinContent(Int_t bin, Double_t content)
+{
+   TH2D::SetBinContent(bin, content);
+   ResetProjectionIndex();
+}
+
+Bool_t GH2D::Add(const TH1* h1, Double_t c1)
+{
+   ResetProjectionIndex();
+   return TH2D::Add(h1, c1);
+}
+
+Bool_t GH2D::Add(const TH1* h1, const TH1* h2, Double_t c1, Double_t c2)
+{
+   ResetProjectionIndex();
+   return TH2D::Add(h1, h2, c1, c2);
+}
+
 void GH2D::Print(Option_t*) const
 {
 }
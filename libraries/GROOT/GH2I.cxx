@@ -63,6 +63,30 @@ void GH2I::Clear(Option_t* opt)
    GH2Clear();
 }
 
+void GH2I::Reset(Option_t* opt)
+{
+   TH2I::Reset(opt);
+   ResetProjectionIndex();
+}
+
+void GH2I::SetBinContent(Int_t bin, Double_t content)
+{
+   TH2I::SetBinContent(bin, content);
+   ResetProjectionIndex();
+}
+
+Bool_t GH2I::Add(const TH1* h1, Double_t c1)
+{
+   ResetProjectionIndex();
+   return TH2I::Add(h1, c1);
+}
+
+Bool_t GH2I::Add(const TH1* h1, const TH1* h2, Double_t c1, Double_t c2)
+{
+   ResetProjectionIndex();
+   return TH2I::Add(h1, h2, c1, c2);
+}
+
 void GH2I::Print(Option_t*) const
 {
 }
@@ -13,7 +13,12 @@
 #include "TRandom.h"
 #include "TClass.h"
 
+#include <algorithm>
+#include <array>
+#include <functional>
 #include <iostream>
+#include <thread>
+#include <utility>
 
 // Internal exceptions for the CheckConsistency method
 class DifferentDimension : public std::exception {
@@ -74,6 +79,12 @@ GHSym::GHSym(GHSym&& rhs) noexcept : TH1()   // NOLINT(readability-redundant-mem
    rhs.Copy(*this);
 }
 
+GHSym::~GHSym()
+{
+   delete fSharedFill;
+   delete fProjectionIndex;
+}
+
 Int_t GHSym::BufferEmpty(Int_t action)
 {
    /// Fill histogram with all entries in the buffer.
@@ -209,6 +220,7 @@ void GHSym::Copy(TObject& obj) const
    static_cast<GHSym&>(obj).fTsumwy2 = fTsumwy2;
    static_cast<GHSym&>(obj).fTsumwxy = fTsumwxy;
    static_cast<GHSym&>(obj).fMatrix  = nullptr;
+   static_cast<GHSym&>(obj).ResetProjectionIndex();
 }
 
 Double_t GHSym::DoIntegral(Int_t binx1, Int_t binx2, Int_t biny1, Int_t biny2, Double_t& error, Option_t* option, Bool_t doError) const
@@ -288,37 +300,26 @@ Int_t GHSym::Fill(Double_t)
 Int_t GHSym::Fill(Double_t x, Double_t y)
 {
    /// Increment cell defined by x,y by 1.
+   if(fSharedFill != nullptr) {
+      FillShared(x, y, 1.);
+      return 0;
+   }
    if(fBuffer != nullptr) {
       return BufferFill(x, y, 1);
    }
 
-   Int_t binx = 0;
-   Int_t biny = 0;
    fEntries++;
-   if(y <= x) {
-      binx = fXaxis.FindBin(x);
-      biny = fYaxis.FindBin(y);
-   } else {
-      binx = fXaxis.FindBin(y);
-      biny = fYaxis.FindBin(x);
-   }
-   if(binx < 0 || biny < 0) {
+   Bool_t inRange = kTRUE;
+   Int_t  bin     = FindFillBin(x, y, inRange);
+   if(bin < 0) {
       return -1;
    }
-   Int_t bin = biny * (2 * fXaxis.GetNbins() - biny + 3) / 2 + binx;
    AddBinContent(bin);
    if(fSumw2.fN != 0) {
       ++fSumw2.fArray[bin];
    }
-   if(binx == 0 || binx > fXaxis.GetNbins()) {
-      if(!fgStatOverflows) {
-         return -1;
-      }
-   }
-   if(biny == 0 || biny > fYaxis.GetNbins()) {
-      if(!fgStatOverflows) {
-         return -1;
-      }
+   if(!inRange) {
+      return -1;
    }
    // not sure if these summed weights are calculated correct
    // as of now this is the method used in TH2
@@ -335,37 +336,26 @@ Int_t GHSym::Fill(Double_t x, Double_t y)
 Int_t GHSym::Fill(Double_t x, Double_t y, Double_t w)
 {
    /// Increment cell defined by x,y by 1.
+   if(fSharedFill != nullptr) {
+      FillShared(x, y, w);
+      return 0;
+   }
    if(fBuffer != nullptr) {
       return BufferFill(x, y, 1);
    }
 
-   Int_t binx = 0;
-   Int_t biny = 0;
    fEntries++;
-   if(y <= x) {
-      binx = fXaxis.FindBin(x);
-      biny = fYaxis.FindBin(y);
-   } else {
-      binx = fXaxis.FindBin(y);
-      biny = fYaxis.FindBin(x);
-   }
-   if(binx < 0 || biny < 0) {
+   Bool_t inRange = kTRUE;
+   Int_t  bin     = FindFillBin(x, y, inRange);
+   if(bin < 0) {
       return -1;
    }
-   Int_t bin = biny * (2 * fXaxis.GetNbins() - biny + 3) / 2 + binx;
    AddBinContent(bin, w);
    if(fSumw2.fN != 0) {
       fSumw2.fArray[bin] += w * w;
    }
-   if(binx == 0 || binx > fXaxis.GetNbins()) {
-      if(!fgStatOverflows) {
-         return -1;
-      }
-   }
-   if(biny == 0 || biny > fYaxis.GetNbins()) {
-      if(!fgStatOverflows) {
-         return -1;
-      }
+   if(!inRange) {
+      return -1;
    }
    // not sure if these summed weights are calculated correct
    // as of now this is the method used in TH2
@@ -379,6 +369,223 @@ Int_t GHSym::Fill(Double_t x, Double_t y, Double_t w)
    return bin;
 }
 
+Int_t GHSym::FindFillBin(Double_t x, Double_t y, Bool_t& inRange)
+{
+   /// Returns the bin Fill(x, y) increments, or -1 if there is none. inRange is set to false if the
+   /// bin is an under- or overflow bin that doesn't count towards the statistics.
+   Int_t binx = 0;
+   Int_t biny = 0;
+   if(y <= x) {
+      binx = fXaxis.FindBin(x);
+      biny = fYaxis.FindBin(y);
+   } else {
+      binx = fXaxis.FindBin(y);
+      biny = fYaxis.FindBin(x);
+   }
+   if(binx < 0 || biny < 0) {
+      return -1;
+   }
+   inRange = fgStatOverflows || (binx != 0 && binx <= fXaxis.GetNbins() && biny != 0 && biny <= fYaxis.GetNbins());
+   return biny * (2 * fXaxis.GetNbins() - biny + 3) / 2 + binx;
+}
+
+void GHSym::SetShared(bool val)
+{
+   /// In shared mode the histogram can be filled from several threads at the same time via Fill(x, y) and
+   /// Fill(x, y, w), without one copy of the histogram per thread. The fills of each thread are buffered and
+   /// added in blocks (see GSharedFill), so the histogram is only complete once the shared mode is turned off
+   /// again, which adds the remaining fills of all threads. Nothing but filling should be done with the
+   /// histogram while it is shared.
+   if(val) {
+      if(fSharedFill == nullptr) {
+         fSharedFill = new GSharedFill(3);
+      }
+      return;
+   }
+   if(fSharedFill != nullptr) {
+      for(auto* buffer : fSharedFill->Buffers()) {
+         FlushShared(*buffer);
+      }
+      delete fSharedFill;
+      fSharedFill = nullptr;
+   }
+}
+
+void GHSym::FillShared(Double_t x, Double_t y, Double_t w)
+{
+   auto& buffer = fSharedFill->Buffer();
+   buffer.push_back(x);
+   buffer.push_back(y);
+   buffer.push_back(w);
+   if(fSharedFill->IsFull(buffer)) {
+      FlushShared(buffer);
+   }
+}
+
+void GHSym::FlushShared(GSharedFill::TBuffer& buffer)
+{
+   /// Adds the buffered fills (x, y, w) of one thread to the histogram. Bins and statistics are calculated
+   /// without any lock, the bins are sorted and added one stripe at a time.
+   std::vector<std::pair<Int_t, Double_t>> bins;
+   bins.reserve(buffer.size() / 3);
+   std::array<Double_t, 7> stats{};
+   Double_t                entries = 0.;
+   for(size_t i = 0; i + 2 < buffer.size(); i += 3) {
+      Double_t x = buffer[i];
+      Double_t y = buffer[i + 1];
+      Double_t w = buffer[i + 2];
+      ++entries;
+      Bool_t inRange = kTRUE;
+      Int_t  bin     = FindFillBin(x, y, inRange);
+      if(bin < 0) {
+         continue;
+      }
+      bins.emplace_back(bin, w);
+      if(!inRange) {
+         continue;
+      }
+      stats[0] += w;
+      stats[1] += w * w;
+      stats[2] += w * x;
+      stats[3] += w * x * x;
+      stats[4] += w * y;
+      stats[5] += w * y * y;
+      stats[6] += w * x * y;
+   }
+   buffer.clear();
+
+   AddShared(bins, stats, entries);
+}
+
+void GHSym::AddShared(std::vector<std::pair<Int_t, Double_t>>& bins, const std::array<Double_t, 7>& stats, Double_t entries)
+{
+   /// Adds the weights to the bins while shared, sorted and one stripe at a time, and the statistics.
+   std::sort(bins.begin(), bins.end());
+   for(size_t first = 0; first < bins.size();) {
+      std::lock_guard<std::mutex> lock(fSharedFill->StripeMutex(bins[first].first));
+      size_t                      last = first;
+      for(; last < bins.size() && GSharedFill::SameStripe(bins[first].first, bins[last].first); ++last) {
+         AddBinContent(bins[last].first, bins[last].second);
+         if(fSumw2.fN != 0) {
+            fSumw2.fArray[bins[last].first] += bins[last].second * bins[last].second;
+         }
+      }
+      first = last;
+   }
+
+   std::lock_guard<std::mutex> lock(fSharedFill->StatsMutex());
+   fEntries += entries;
+   fTsumw += stats[0];
+   fTsumw2 += stats[1];
+   fTsumwx += stats[2];
+   fTsumwx2 += stats[3];
+   fTsumwy += stats[4];
+   fTsumwy2 += stats[5];
+   fTsumwxy += stats[6];
+}
+
+void GHSym::FindFillBins(const Double_t* x, size_t n, Int_t* bins)
+{
+   /// Sets bins to the bins of the n values x. For uniform axes this is the same calculation as
+   /// TAxis::FindBin, without any calls so the loop can be vectorized.
+   const Int_t    nbins = fXaxis.GetNbins();
+   const Double_t xmin  = fXaxis.GetXmin();
+   const Double_t xmax  = fXaxis.GetXmax();
+   if(fXaxis.GetXbins()->fN != 0) {
+      for(size_t i = 0; i < n; ++i) {
+         bins[i] = fXaxis.FindBin(x[i]);
+      }
+      return;
+   }
+   for(size_t i = 0; i < n; ++i) {
+      bins[i] = x[i] < xmin ? 0 : (!(x[i] < xmax) ? nbins + 1 : 1 + static_cast<Int_t>(nbins * (x[i] - xmin) / (xmax - xmin)));
+   }
+}
+
+void GHSym::FillCombinations(const Double_t* energies, size_t n, Double_t w)
+{
+   /// Fills all n(n-1)/2 pairs of the energies with weight w. This is the same as calling
+   /// Fill(energies[i], energies[j], w) for all i < j (apart from the rounding of the statistics), but the
+   /// bin of each energy is only found once, and the bins are sorted, so the bins of all pairs follow
+   /// directly without comparing the energies of each pair.
+   if(n < 2) {
+      return;
+   }
+   if(fBuffer != nullptr || CanExtendAllAxes() || fXaxis.GetLabels() != nullptr) {
+      for(size_t i = 0; i + 1 < n; ++i) {
+         for(size_t j = i + 1; j < n; ++j) {
+            Fill(energies[i], energies[j], w);
+         }
+      }
+      return;
+   }
+
+   std::vector<Int_t> bins(n);
+   FindFillBins(energies, n, bins.data());
+
+   // statistics of the pairs (x, y) = (energies[i], energies[j]) with i < j, only counting pairs
+   // with both energies in range, summed over the second energy of each pair
+   const Int_t             nbins = fXaxis.GetNbins();
+   std::array<Double_t, 7> stats{};
+   Double_t                earlier = 0.;
+   Double_t                sum     = 0.;
+   Double_t                sum2    = 0.;
+   for(size_t j = 0; j < n; ++j) {
+      if(!fgStatOverflows && (bins[j] == 0 || bins[j] > nbins)) {
+         continue;
+      }
+      Double_t y = energies[j];
+      stats[0] += earlier;
+      stats[2] += sum;
+      stats[3] += sum2;
+      stats[4] += earlier * y;
+      stats[5] += earlier * y * y;
+      stats[6] += sum * y;
+      ++earlier;
+      sum += y;
+      sum2 += y * y;
+   }
+   stats[1] = stats[0] * w * w;
+   for(size_t i = 0; i < stats.size(); ++i) {
+      if(i != 1) {
+         stats[i] *= w;
+      }
+   }
+   Double_t entries = static_cast<Double_t>(n) * static_cast<Double_t>(n - 1) / 2.;
+
+   // with the bins sorted in descending order, bins[i] >= bins[j] for all i < j
+   std::sort(bins.begin(), bins.end(), std::greater<Int_t>());
+   if(fSharedFill != nullptr) {
+      std::vector<std::pair<Int_t, Double_t>> pairs;
+      pairs.reserve(static_cast<size_t>(entries));
+      for(size_t j = 1; j < n; ++j) {
+         Int_t row = bins[j] * (2 * nbins - bins[j] + 3) / 2;
+         for(size_t i = 0; i < j; ++i) {
+            pairs.emplace_back(row + bins[i], w);
+         }
+      }
+      AddShared(pairs, stats, entries);
+      return;
+   }
+   for(size_t j = 1; j < n; ++j) {
+      Int_t row = bins[j] * (2 * nbins - bins[j] + 3) / 2;
+      for(size_t i = 0; i < j; ++i) {
+         AddBinContent(row + bins[i], w);
+         if(fSumw2.fN != 0) {
+            fSumw2.fArray[row + bins[i]] += w * w;
+         }
+      }
+   }
+   fEntries += entries;
+   fTsumw += stats[0];
+   fTsumw2 += stats[1];
+   fTsumwx += stats[2];
+   fTsumwx2 += stats[3];
+   fTsumwy += stats[4];
+   fTsumwy2 += stats[5];
+   fTsumwxy += stats[6];
+}
+
 Int_t GHSym::Fill(const char* namex, const char* namey, Double_t w)
 {
    // Increment cell defined by namex,namey by a weight w
@@ -1954,6 +2161,45 @@ TProfile* GHSym::Profile(const char* name, Int_t firstbin, Int_t lastbin, Option
    return h1;
 }
 
+void GHSym::UseProjectionIndex(bool val)
+{
+   /// With the projection index Projection uses cumulative sums along the y-axis (see GProjectionIndex), so a
+   /// projection takes the same time for all gates, instead of being proportional to the width of the gate. The
+   /// index needs (nbins+2)^2 doubles (twice that with errors), it is built on demand by the first projection
+   /// and rebuilt after the histogram changed. Projections with graphical cuts don't use the index.
+   fUseProjectionIndex = val;
+   if(!val) {
+      ResetProjectionIndex();
+   }
+}
+
+void GHSym::ResetProjectionIndex()
+{
+   /// Deletes the projection index, it is rebuilt by the next projection. Only needs to be called after changing
+   /// the content in a way that doesn't change the entries or sums of weights, e.g. via AddBinContent.
+   delete fProjectionIndex;
+   fProjectionIndex = nullptr;
+}
+
+const GProjectionIndex* GHSym::ProjectionIndex(bool errors) const
+{
+   /// Returns the projection index, building it if it doesn't exist yet, or is outdated. Returns nullptr if the
+   /// projection index isn't used.
+   if(!fUseProjectionIndex) {
+      return nullptr;
+   }
+   GProjectionIndex::TFingerprint fingerprint = {fEntries, fTsumw, fTsumw2, static_cast<Double_t>(fNcells)};
+   if(fProjectionIndex != nullptr && fProjectionIndex->Matches(fingerprint) && (fProjectionIndex->HasErrors() || !errors)) {
+      return fProjectionIndex;
+   }
+   delete fProjectionIndex;
+   Int_t nbins      = fXaxis.GetNbins() + 2;
+   fProjectionIndex = new GProjectionIndex(nbins, nbins, 1, errors);
+   fProjectionIndex->Build([this](Int_t xbin, Int_t ybin) { return GetCellContent(xbin, ybin); },
+                           [this](Int_t xbin, Int_t ybin) { Double_t error = GetCellError(xbin, ybin); return error * error; }, fingerprint);
+   return fProjectionIndex;
+}
+
 TH1D* GHSym::Projection(const char* name, Int_t firstBin, Int_t lastBin, Option_t* option) const
 {
    /// method for performing projection
@@ -2091,6 +2337,8 @@ TH1D* GHSym::Projection(const char* name, Int_t firstBin, Int_t lastBin, Option_
    // Fill the projected histogram
    Double_t totcont       = 0;
    Bool_t   computeErrors = h1->GetSumw2N() != 0;
+   // graphical cuts need the individual bins
+   const GProjectionIndex* index = ncuts == 0 ? ProjectionIndex(computeErrors) : nullptr;
 
    // implement filling of projected histogram
    // xbin is bin number of xAxis (the projected axis). Loop is done on all bin of TH2 histograms
@@ -2102,17 +2350,24 @@ TH1D* GHSym::Projection(const char* name, Int_t firstBin, Int_t lastBin, Option_
          continue;
       }
 
-      for(Int_t ybin = firstBin; ybin <= lastBin; ++ybin) {
-         if(ncuts != 0) {
-            if(!fPainter->IsInside(xbin, ybin)) {
-               continue;
-            }
-         }
-         // sum bin content and error if needed
-         cont += GetCellContent(xbin, ybin);
+      if(index != nullptr) {
+         cont = index->Sum(xbin, firstBin, lastBin);
          if(computeErrors) {
-            Double_t exy = GetCellError(xbin, ybin);
-            err2 += exy * exy;
+            err2 = index->Error2(xbin, firstBin, lastBin);
+         }
+      } else {
+         for(Int_t ybin = firstBin; ybin <= lastBin; ++ybin) {
+            if(ncuts != 0) {
+               if(!fPainter->IsInside(xbin, ybin)) {
+                  continue;
+               }
+            }
+            // sum bin content and error if needed
+            cont += GetCellContent(xbin, ybin);
+            if(computeErrors) {
+               Double_t exy = GetCellError(xbin, ybin);
+               err2 += exy * exy;
+            }
          }
       }
       // find corresponding bin number in h1 for xbin
@@ -2195,6 +2450,122 @@ TH1D* GHSym::Projection(const char* name, Int_t firstBin, Int_t lastBin, Option_
    return h1;
 }
 
+std::vector<TH1D*> GHSym::Projections(const std::vector<GGate>& gates, Option_t* option, Int_t nThreads) const
+{
+   /// Projects all gates in a single sweep over the matrix, split into blocks of rows that are processed by
+   /// nThreads threads (all hardware threads if nThreads is zero or less). The projection of each gate is the
+   /// same as the sum of Projection(name, first, last) of its ranges multiplied by their weights (see GGate),
+   /// and it always covers the full x-axis. Errors are calculated if the option contains "e" or the matrix
+   /// has errors stored (Sumw2), each range adds its weight squared times the squared errors. The projections
+   /// are named after the gates, or <name>_gate<index> for gates without a name.
+   if(fBuffer != nullptr) {
+      const_cast<GHSym*>(this)->BufferEmpty();   // NOLINT(cppcoreguidelines-pro-type-const-cast)
+   }
+   TString opt = option;
+   opt.ToLower();
+   const bool  computeErrors = opt.Contains("e") || GetSumw2N() != 0;
+   const Int_t nbins         = fXaxis.GetNbins() + 2;
+   const auto  nOut          = static_cast<size_t>(nbins) * gates.size();
+
+   // gates (index and weight) each bin is part of, and the sorted list of bins that are part of any gate
+   std::vector<std::vector<std::pair<size_t, Double_t>>> binGates(nbins);
+   std::vector<Int_t>                                    gatedBins;
+   for(size_t gate = 0; gate < gates.size(); ++gate) {
+      for(const auto& range : gates[gate].Ranges()) {
+         Int_t first = std::max(range.fFirst, 0);
+         Int_t last  = (range.fLast < 0 || range.fLast >= nbins) ? nbins - 1 : range.fLast;
+         for(Int_t bin = first; bin <= last; ++bin) {
+            binGates[bin].emplace_back(gate, range.fWeight);
+         }
+      }
+   }
+   for(Int_t bin = 0; bin < nbins; ++bin) {
+      if(!binGates[bin].empty()) {
+         gatedBins.push_back(bin);
+      }
+   }
+
+   // each thread sums into its own projections, limited to about 256 MB for all of them
+   if(nThreads <= 0) {
+      nThreads = static_cast<Int_t>(std::max(1U, std::thread::hardware_concurrency()));
+   }
+   const size_t bytesPerThread = std::max(nOut * sizeof(Double_t) * (computeErrors ? 2 : 1), static_cast<size_t>(1));
+   nThreads                    = std::max(1, std::min(nThreads, static_cast<Int_t>((256UL << 20) / bytesPerThread)));
+   std::vector<std::vector<Double_t>> content(nThreads, std::vector<Double_t>(nOut, 0.));
+   std::vector<std::vector<Double_t>> error2(computeErrors ? nThreads : 0, std::vector<Double_t>(nOut, 0.));
+
+   // cell binx, biny (binx >= biny) adds to bin binx of the gates biny is part of, and to bin biny of the gates
+   // binx is part of, rows without a gate only need to visit the gated bins
+   constexpr Int_t kRowsPerBlock = 16;
+   auto            sweep         = [&](Int_t thread) {
+      Double_t* cont = content[thread].data();
+      Double_t* err2 = computeErrors ? error2[thread].data() : nullptr;
+      auto      add  = [&](Int_t bin, Int_t binx, Int_t biny) {
+         Double_t c  = GetBinContent(bin);
+         Double_t e2 = 0.;
+         if(err2 != nullptr) {
+            Double_t error = GetBinError(bin);
+            e2             = error * error;
+         }
+         if(c == 0. && e2 == 0.) {
+            return;
+         }
+         for(const auto& [gate, weight] : binGates[biny]) {
+            cont[gate * nbins + binx] += weight * c;
+            if(err2 != nullptr) {
+               err2[gate * nbins + binx] += weight * weight * e2;
+            }
+         }
+         if(binx == biny) {
+            return;
+         }
+         for(const auto& [gate, weight] : binGates[binx]) {
+            cont[gate * nbins + biny] += weight * c;
+            if(err2 != nullptr) {
+               err2[gate * nbins + biny] += weight * weight * e2;
+            }
+         }
+      };
+      for(Int_t block = thread; block * kRowsPerBlock < nbins; block += nThreads) {
+         for(Int_t biny = block * kRowsPerBlock; biny < std::min((block + 1) * kRowsPerBlock, nbins); ++biny) {
+            Int_t row = biny * (2 * fXaxis.GetNbins() - biny + 3) / 2;
+            if(binGates[biny].empty()) {
+               for(auto binx = std::lower_bound(gatedBins.begin(), gatedBins.end(), biny); binx != gatedBins.end(); ++binx) {
+                  add(row + *binx, *binx, biny);
+               }
+               continue;
+            }
+            for(Int_t binx = biny; binx < nbins; ++binx) {
+               add(row + binx, binx, biny);
+            }
+         }
+      }
+   };
+   std::vector<std::thread> threads;
+   for(Int_t thread = 1; thread < nThreads; ++thread) {
+      threads.emplace_back(sweep, thread);
+   }
+   sweep(0);
+   for(auto& thread : threads) {
+      thread.join();
+   }
+   for(Int_t thread = 1; thread < nThreads; ++thread) {
+      for(size_t i = 0; i < nOut; ++i) {
+         content[0][i] += content[thread][i];
+         if(computeErrors) {
+            error2[0][i] += error2[thread][i];
+         }
+      }
+   }
+
+   std::vector<TH1D*> result;
+   for(size_t gate = 0; gate < gates.size(); ++gate) {
+      TString name = gates[gate].Name().empty() ? TString::Format("%s_gate%zu", GetName(), gate) : TString(gates[gate].Name().c_str());
+      result.push_back(GGate::Projection(name, *this, content[0].data() + gate * nbins, computeErrors ? error2[0].data() + gate * nbins : nullptr));
+   }
+   return result;
+}
+
 void GHSym::PutStats(Double_t* stats)
 {
    // Replace current statistics with the values in array stats
@@ -2519,6 +2890,7 @@ void GHSym::Reset(Option_t* option)
    //*-*            ===========================================
 
    TH1::Reset(option);
+   ResetProjectionIndex();
    TString opt = option;
    opt.ToUpper();
 
@@ -0,0 +1,53 @@
+#include "GProjectionIndex.h"
+
+#include <algorithm>
+
+GProjectionIndex::GProjectionIndex(Int_t nOut, Int_t nGate, Int_t gateAxes, bool errors)
+   : fNOut(nOut), fNGate(nGate), fGateAxes(gateAxes)
+{
+   fRowSize = static_cast<size_t>(nGate) + 1;
+   if(gateAxes == 2) {
+      fRowSize *= fRowSize;
+   }
+   fContent.assign(static_cast<size_t>(nOut) * fRowSize, 0.);
+   if(errors) {
+      fError2.assign(static_cast<size_t>(nOut) * fRowSize, 0.);
+   }
+}
+
+Long64_t GProjectionIndex::Bytes(Int_t nOut, Int_t nGate, Int_t gateAxes, bool errors)
+{
+   /// Returns the memory needed for an index with these dimensions.
+   Long64_t rowSize = static_cast<Long64_t>(nGate) + 1;
+   if(gateAxes == 2) {
+      rowSize *= rowSize;
+   }
+   return static_cast<Long64_t>(nOut) * rowSize * static_cast<Long64_t>(sizeof(Double_t)) * (errors ? 2 : 1);
+}
+
+Double_t GProjectionIndex::Sum(const std::vector<Double_t>& sums, Int_t out, Int_t first, Int_t last) const
+{
+   /// Sum of the gate bins first to last (inclusive) of the projected bin out.
+   first = std::max(first, 0);
+   last  = std::min(last, fNGate - 1);
+   if(last < first) {
+      return 0.;
+   }
+   const Double_t* row = sums.data() + Row(out);
+   return row[last + 1] - row[first];
+}
+
+Double_t GProjectionIndex::Sum(const std::vector<Double_t>& sums, Int_t out, Int_t first1, Int_t last1, Int_t first2, Int_t last2) const
+{
+   /// Sum of the gate bins first1 to last1 and first2 to last2 (inclusive) of the projected bin out.
+   first1 = std::max(first1, 0);
+   last1  = std::min(last1, fNGate - 1);
+   first2 = std::max(first2, 0);
+   last2  = std::min(last2, fNGate - 1);
+   if(last1 < first1 || last2 < first2) {
+      return 0.;
+   }
+   const size_t    stride = static_cast<size_t>(fNGate) + 1;
+   const Double_t* row    = sums.data() + Row(out);
+   return row[(last1 + 1) * stride + last2 + 1] - row[first1 * stride + last2 + 1] - row[(last1 + 1) * stride + first2] + row[first1 * stride + first2];
+}
@@ -0,0 +1,40 @@
+#include "GSharedFill.h"
+
+#include <unordered_map>
+
+std::atomic<uint64_t> GSharedFill::fLastId{0};
+
+GSharedFill::GSharedFill(size_t valuesPerFill, size_t fillsPerBuffer)
+   : fId(++fLastId), fBufferSize(valuesPerFill * fillsPerBuffer)
+{
+}
+
+GSharedFill::TBuffer& GSharedFill::Buffer()
+{
+   /// Returns the buffer of the calling thread, creating it on the first call of the thread.
+   // the buffers are found by the id of this object, not its address, so a new object at the
+   // same address as a deleted one doesn't find the buffers of the deleted one
+   thread_local std::unordered_map<uint64_t, TBuffer*> buffers;
+   auto                                                iter = buffers.find(fId);
+   if(iter != buffers.end()) {
+      return *(iter->second);
+   }
+
+   std::lock_guard<std::mutex> lock(fMutex);
+   fBuffers.emplace_back(new TBuffer);
+   fBuffers.back()->reserve(fBufferSize);
+   buffers.emplace(fId, fBuffers.back().get());
+   return *(fBuffers.back());
+}
+
+std::vector<GSharedFill::TBuffer*> GSharedFill::Buffers()
+{
+   /// Returns the buffers of all threads. Only safe to use once no thread fills anymore.
+   std::lock_guard<std::mutex> lock(fMutex);
+   std::vector<TBuffer*>       result;
+   result.reserve(fBuffers.size());
+   for(auto& buffer : fBuffers) {
+      result.push_back(buffer.get());
+   }
+   return result;
+}
@@ -1,4 +1,4 @@
-// GRootGuiFactory.h GRootFunctions.h GRootCommands.h GRootCanvas.h GRootBrowser.h GCanvas.h GH2Base.h  GH2I.h GH2D.h  GPeak.h GGaus.h GH1D.h GNotifier.h GPopup.h GSnapshot.h TCalibrator.h GHSym.h GCube.h TLevelScheme.h
+// GRootGuiFactory.h GRootFunctions.h GRootCommands.h GRootCanvas.h GRootBrowser.h GCanvas.h GH2Base.h  GH2I.h GH2D.h  GPeak.h GGaus.h GH1D.h GNotifier.h GPopup.h GSnapshot.h TCalibrator.h GHSym.h GCube.h GCutG.h TLevelScheme.h
 
 #ifdef __CINT__
 #pragma link off all globals;
@@ -37,6 +37,7 @@
 
 #pragma link C++ enum EAxis;
 #pragma link C++ enum kBackgroundSubtraction;
+#pragma link C++ enum EMapMode;
 #pragma link C++ function AddOffset;
 
 #pragma link C++ class GPopup + ;
@@ -57,8 +58,11 @@
 #pragma link C++ class GHSymF + ;
 #pragma link C++ class GHSymD + ;
 #pragma link C++ class GCube + ;
-#pragma link C++ class GCubeF + ;
-#pragma link C++ class GCubeD + ;
+#pragma link C++ class GCubeF - ;
+#pragma link C++ class GCubeD - ;
+#pragma link C++ class GGate + ;
+#pragma link C++ class GGate::TWeightedRange + ;
+#pragma link C++ class GCutG - ;
 
 #pragma link C++ class GPeak + ;
 #pragma link C++ class GGaus + ;
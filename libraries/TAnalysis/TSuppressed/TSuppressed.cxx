@@ -10,4 +10,104 @@ void TSuppressed::Clear(Option_t* opt)
 {
    // Clears the mother, and all of the hits
    TDetector::Clear(opt);
+   // the neighbours might depend on settings of the derived class
+   fAddbackAdjacency     = TAdjacency();
+   fSuppressionAdjacency = TAdjacency();
+}
+
+void TSuppressed::ClearTransients()
+{
+   TDetector::ClearTransients();
+}
+
+bool TSuppressed::IsCached(const TResult& result) const
+{
+   /// Returns true if the vector of result has been created from the same BGO and hits in the current generations of
+   /// this detector and the BGO, and hasn't been changed since.
+   for(const auto& cached : fResults) {
+      if(cached.fResult == result.fResult) {
+         return cached.fGeneration == result.fGeneration && cached.fBgo == result.fBgo && cached.fBgoGeneration == result.fBgoGeneration &&
+                cached.fHits == result.fHits && cached.fNofHits == result.fNofHits && cached.fFirst == result.fFirst && cached.fSize == result.fSize;
+      }
+   }
+   return false;
+}
+
+void TSuppressed::SetCached(const TResult& result)
+{
+   /// Remembers what the vector of result has been created from.
+   for(auto& cached : fResults) {
+      if(cached.fResult == result.fResult) {
+         cached = result;
+         return;
+      }
+   }
+   fResults.push_back(result);
+}
+
+void TSuppressed::ClearAddbacks()
+{
+   fAddbackCandidates.clear();
+   fAddbackTimes.clear();
+}
+
+void TSuppressed::InsertAddbackTime(double time, size_t index)
+{
+   /// Inserts the addback hit index at its time, after all addback hits with the same time.
+   auto position = std::upper_bound(fAddbackTimes.begin(), fAddbackTimes.end(), time, [](double val, const std::pair<double, size_t>& addback) { return val < addback.first; });
+   fAddbackTimes.emplace(position, time, index);
+}
+
+void TSuppressed::MoveAddbackTime(size_t index, double oldTime, double newTime)
+{
+   /// Moves the addback hit index from oldTime to newTime.
+   auto range = std::equal_range(fAddbackTimes.begin(), fAddbackTimes.end(), std::make_pair(oldTime, index), [](const std::pair<double, size_t>& lhs, const std::pair<double, size_t>& rhs) { return lhs.first < rhs.first; });
+   for(auto addback = range.first; addback != range.second; ++addback) {
+      if(addback->second == index) {
+         fAddbackTimes.erase(addback);
+         break;
+      }
+   }
+   InsertAddbackTime(newTime, index);
+}
+
+void TSuppressed::SortSuppressors(const TBgo* bgo)
+{
+   /// Caches time and detector of all BGO hits, sorted by time if there is a SuppressionWindow.
+   fSuppressors.clear();
+   if(bgo == nullptr) {
+      return;
+   }
+   const double window = SuppressionWindow();
+   for(auto* hit : bgo->GetHitVector()) {
+      fSuppressors.push_back(Cache(hit, window));
+   }
+   if(window >= 0.) {
+      std::sort(fSuppressors.begin(), fSuppressors.end(), [](const TCachedHit& lhs, const TCachedHit& rhs) { return lhs.fTime < rhs.fTime; });
+   }
+}
+
+bool TSuppressed::Suppressed(const TDetectorHit* hit)
+{
+   /// Returns true if any of the BGO hits cached by SortSuppressors suppresses the hit. Only the BGO hits within
+   /// the SuppressionWindow and in SuppressionNeighbours detectors are checked with SuppressionCriterion.
+   if(fSuppressors.empty()) {
+      return false;
+   }
+   const double window = SuppressionWindow();
+   const auto   cached = Cache(hit, window);
+   auto         begin  = fSuppressors.begin();
+   auto         end    = fSuppressors.end();
+   if(window >= 0.) {
+      const double slack = Slack(cached.fTime, window);
+      begin              = std::lower_bound(fSuppressors.begin(), fSuppressors.end(), cached.fTime - slack, [](const TCachedHit& suppressor, double time) { return suppressor.fTime < time; });
+      end                = std::upper_bound(begin, fSuppressors.end(), cached.fTime + slack, [](double time, const TCachedHit& suppressor) { return time < suppressor.fTime; });
+   }
+   for(auto suppressor = begin; suppressor != end; ++suppressor) {
+      if(fSuppressionAdjacency.Test(cached.fDetector, suppressor->fDetector, [this](Int_t d1, Int_t d2) { return SuppressionNeighbours(d1, d2); }) &&
+         SuppressionCriterion(hit, suppressor->fHit)) {
+         return true;
+      }
+   }
+   return false;
 }
@@ -19,9 +19,16 @@ TDataParser::TDataParser()
    : fBadOutputQueue(std::make_shared<ThreadsafeQueue<std::shared_ptr<const TBadFragment>>>("bad_frag_queue")),
      fScalerOutputQueue(std::make_shared<ThreadsafeQueue<std::shared_ptr<TEpicsFrag>>>("scaler_queue")),
      fNoWaveforms(false), fRecordDiag(true), fChannel(new TChannel), fMaxTriggerId(1024 * 1024 * 16),
-     fLastDaqId(0), fLastTriggerId(0), fLastNetworkPacket(0), fFragmentHasWaveform(false),
-     fFragmentMap(fGoodOutputQueues, fBadOutputQueue), fItemsPopped(nullptr), fInputSize(nullptr)
+     fLastDaqId(0), fLastTriggerId(0), fLastNetworkPacket(0), fFragmentIdMask(0), fFragmentHasWaveform(false),
+     fFragmentMap(fGoodOutputQueues, fBadOutputQueue, fFragmentFilter), fItemsPopped(nullptr), fInputSize(nullptr)
 {
+   // the ring buffer of fragment IDs needs to have a size that is a power of 2, so the index can be calculated with a simple mask
+   size_t size = 1;
+   while(size < TGRSIOptions::Get()->TriggerIdWindow()) {
+      size <<= 1;
+   }
+   fFragmentIds.resize(size);
+   fFragmentIdMask = static_cast<Long_t>(size - 1);
 }
 
 TDataParser::~TDataParser()
@@ -49,6 +56,8 @@ void TDataParser::ClearQueue()
 
 void TDataParser::SetFinished()
 {
+   // no more partners for any pending piled-up fragments will arrive
+   fFragmentMap.DropAll();
    for(const auto& outQueue : fGoodOutputQueues) {
       outQueue->SetFinished();
    }
@@ -59,8 +68,11 @@ void TDataParser::SetFinished()
 void TDataParser::Push(std::vector<std::shared_ptr<ThreadsafeQueue<std::shared_ptr<const TFragment>>>>& queues,
                        const std::shared_ptr<TFragment>&                                                frag)
 {
-   frag->SetFragmentId(fFragmentIdMap[frag->GetTriggerId()]);
-   fFragmentIdMap[frag->GetTriggerId()]++;
+   // drop any fragments we don't want to keep before they are counted and enqueued
+   if(!fFragmentFilter.Keep(frag)) {
+      return;
+   }
+   frag->SetFragmentId(NextFragmentId(frag->GetTriggerId()));
    frag->SetEntryNumber();
    for(const auto& queue : queues) {
       queue->Push(frag);
@@ -69,12 +81,29 @@ void TDataParser::Push(std::vector<std::shared_ptr<ThreadsafeQueue<std::shared_p
 
 void TDataParser::Push(ThreadsafeQueue<std::shared_ptr<const TBadFragment>>& queue, const std::shared_ptr<TBadFragment>& frag)
 {
-   frag->SetFragmentId(fFragmentIdMap[frag->GetTriggerId()]);
-   fFragmentIdMap[frag->GetTriggerId()]++;
+   frag->SetFragmentId(NextFragmentId(frag->GetTriggerId()));
    frag->SetEntryNumber();
    queue.Push(frag);
 }
 
+int TDataParser::NextFragmentId(Long_t triggerId)
+{
+   /// Returns the number of fragments seen so far with this trigger ID and increments it.
+   /// Only the last trigger IDs (as set by --trigger-id-window) are kept track of. A newer trigger ID
+   /// retires the older one it shares a slot in the ring buffer with. Fragments with a trigger ID that
+   /// has already been retired get a fragment ID of 0 and don't change the bookkeeping of newer IDs.
+   auto& entry = fFragmentIds[triggerId & fFragmentIdMask];
+   if(entry.fTriggerId != triggerId) {
+      // trigger IDs wrap around at fMaxTriggerId, so a much smaller trigger ID is a newer one
+      if(triggerId < entry.fTriggerId && static_cast<uint64_t>(entry.fTriggerId - triggerId) < fMaxTriggerId / 2) {
+         return 0;
+      }
+      entry.fTriggerId = triggerId;
+      entry.fCount     = 0;
+   }
+   return entry.fCount++;
+}
+
 std::string TDataParser::OutputQueueStatus()
 {
    std::ostringstream status;
@@ -0,0 +1,106 @@
+#include "TFragmentFilter.h"
+
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+
+#include "TChannel.h"
+#include "TGRSIOptions.h"
+#include "TParsingDiagnostics.h"
+
+TFragmentFilter::TFragmentFilter()
+{
+   auto* options = TGRSIOptions::Get();
+
+   for(const auto& range : options->KeepAddresses()) {
+      // ranges are given as "<low>-<high>" or as a single address, both can be hexadecimal (0x...) or decimal
+      try {
+         size_t dash = range.find('-');
+         if(dash == std::string::npos) {
+            auto address = static_cast<UInt_t>(std::stoul(range, nullptr, 0));
+            fAddressRanges.emplace_back(address, address);
+         } else {
+            fAddressRanges.emplace_back(static_cast<UInt_t>(std::stoul(range.substr(0, dash), nullptr, 0)),
+                                        static_cast<UInt_t>(std::stoul(range.substr(dash + 1), nullptr, 0)));
+         }
+      } catch(std::exception& e) {
+         std::cerr << DRED << "Failed to parse address range \"" << range << "\" (" << e.what() << "), ignoring it!" << RESET_COLOR << std::endl;
+      }
+   }
+   fMnemonicRegEx = options->KeepMnemonics();
+   for(const auto& detType : options->KeepDetectorTypes()) {
+      fDetectorTypes.insert(static_cast<Short_t>(detType));
+   }
+   fMinCharge = options->KeepMinCharge();
+   fWaveform  = options->KeepWaveform();
+
+   fSelectChannels = !fAddressRanges.empty() || !fMnemonicRegEx.empty() || !fDetectorTypes.empty();
+   fActive         = fSelectChannels || fMinCharge > std::numeric_limits<double>::lowest() || fWaveform == 0 || fWaveform == 1;
+}
+
+void TFragmentFilter::Setup()
+{
+   /// Resolves the mnemonics to addresses and registers the filters with the parsing diagnostics.
+   /// This is done when the first fragment arrives, by which time all channels have been read (e.g. from the ODB).
+   for(const auto& regex : fMnemonicRegEx) {
+      for(auto* channel : TChannel::FindChannelByRegEx(regex.c_str())) {
+         fMnemonicAddresses.insert(channel->GetAddress());
+      }
+   }
+   auto* diag = TParsingDiagnostics::Get();
+   fDiagnosticsIndex.clear();
+   fDiagnosticsIndex.push_back(diag->AddFilter("channel"));
+   fDiagnosticsIndex.push_back(diag->AddFilter("charge"));
+   fDiagnosticsIndex.push_back(diag->AddFilter("waveform"));
+   fSetup = true;
+}
+
+bool TFragmentFilter::Keep(const std::shared_ptr<const TFragment>& frag)
+{
+   /// Returns true if the fragment passes all filters, otherwise the filter that rejected it is recorded and false is returned.
+   if(!fActive) {
+      return true;
+   }
+   if(!fSetup) {
+      Setup();
+   }
+   if(fSelectChannels && !KeepAddress(frag)) {
+      Reject(EFilter::kChannel);
+      return false;
+   }
+   if(frag->GetCharge() < fMinCharge) {
+      Reject(EFilter::kCharge);
+      return false;
+   }
+   if((fWaveform == 1 && !frag->HasWave()) || (fWaveform == 0 && frag->HasWave())) {
+      Reject(EFilter::kWaveform);
+      return false;
+   }
+   return true;
+}
+
+bool TFragmentFilter::KeepAddress(const std::shared_ptr<const TFragment>& frag)
+{
+   /// Checks (and caches) whether the address of this fragment is selected by any of the address ranges, mnemonics, or detector types.
+   auto address = frag->GetAddress();
+   auto iter    = fKeepAddress.find(address);
+   if(iter != fKeepAddress.end()) {
+      return iter->second;
+   }
+
+   bool keep = fDetectorTypes.count(static_cast<Short_t>(frag->GetDetectorType())) > 0 || fMnemonicAddresses.count(address) > 0;
+   for(const auto& range : fAddressRanges) {
+      if(range.first <= address && address <= range.second) {
+         keep = true;
+         break;
+      }
+   }
+   fKeepAddress[address] = keep;
+
+   return keep;
+}
+
+void TFragmentFilter::Reject(EFilter filter)
+{
+   TParsingDiagnostics::Get()->FilteredFragment(fDiagnosticsIndex[static_cast<size_t>(filter)]);
+}
@@ -1,13 +1,18 @@
 #include "TFragmentMap.h"
 
-#include <iterator>
+#include <algorithm>
 
-bool TFragmentMap::fDebug = false;
+#include "TDither.h"
+
+bool     TFragmentMap::fDebug         = false;
+Long64_t TFragmentMap::fExpiryWindow  = 100000;
+size_t   TFragmentMap::fCheckInterval = 1000;
 
 TFragmentMap::TFragmentMap(
    std::vector<std::shared_ptr<ThreadsafeQueue<std::shared_ptr<const TFragment>>>>& goodOutputQueue,
-   std::shared_ptr<ThreadsafeQueue<std::shared_ptr<const TBadFragment>>>&           badOutputQueue)
-   : fGoodOutputQueue(goodOutputQueue), fBadOutputQueue(badOutputQueue)
+   std::shared_ptr<ThreadsafeQueue<std::shared_ptr<const TBadFragment>>>&           badOutputQueue,
+   TFragmentFilter&                                                                 filter)
+   : fGoodOutputQueue(goodOutputQueue), fBadOutputQueue(badOutputQueue), fFilter(filter)
 {
 }
 
@@ -22,8 +27,22 @@ bool TFragmentMap::Add(const std::shared_ptr<TFragment>& frag, const std::vector
          std::cout << "\t" << charge[i] << ",\t" << integrationLength[i] << std::endl;
       }
    }
+   fLatestTimeStamp = std::max(fLatestTimeStamp, frag->GetTimeStamp());
+   if(++fAddsSinceCheck >= fCheckInterval) {
+      DropExpired();
+   }
+
+   auto& slot = fSlots[frag->GetAddress()];
+   // any fragments of this address that have been waiting longer than the expiry window will never be solved
+   if(slot.fNofFragments > 0 && frag->GetTimeStamp() - slot.fFirstTimeStamp > fExpiryWindow) {
+      if(fDebug) {
+         std::cout << "address " << frag->GetAddress() << ": dropping " << slot.fNofFragments << " expired fragments" << std::endl;
+      }
+      DropFragments(slot);
+   }
+
    // a single fragment with just one charge/integration length can be directly put into the queue
-   if(charge.size() == 1 && fMap.count(frag->GetAddress()) == 0) {
+   if(charge.size() == 1 && slot.fNofFragments == 0) {
       frag->SetCharge(charge[0]);
       frag->SetKValue(integrationLength[0]);
       if(fDebug) {
@@ -34,46 +53,43 @@ bool TFragmentMap::Add(const std::shared_ptr<TFragment>& frag, const std::vector
                    << integrationLength[0] << ", # pileups " << frag->GetNumberOfPileups() << std::endl;
          if(frag->GetNumberOfPileups() > 1) {
             std::cout << "have fragments:" << std::endl;
-            for(auto& iter : fMap) {
-               std::cout << "\t" << hex(std::get<0>(iter.second)->GetAddress(), 4) << ": "
-                         << std::get<0>(iter.second)->GetNumberOfPileups() << std::endl;
+            for(auto& iter : fSlots) {
+               for(size_t i = 0; i < iter.second.fNofFragments; ++i) {
+                  std::cout << "\t" << hex(iter.first, 4) << ": " << iter.second.fFragments[i]->GetNumberOfPileups() << std::endl;
+               }
             }
          }
       }
-      frag->SetEntryNumber();
-      for(const auto& outputQueue : fGoodOutputQueue) {
-         outputQueue->Push(frag);
-      }
+      Push(frag);
       return true;
    }
    // check if this is the last fragment needed
-   size_t nofFrags   = 1;
-   size_t nofCharges = charge.size();
-   // equal_range returns a pair of iterators:
-   // the first points to the first fragment with this address,
-   // the second to the first fragment of the next address
-   // if no fragment with this address exists, both point to the first fragment of the next address
-   auto range = fMap.equal_range(frag->GetAddress());
-   for(auto it = range.first; it != range.second; ++it) {
-      ++nofFrags;
-      nofCharges += std::get<1>((*it).second).size();
-   }
+   size_t nofFrags   = slot.fNofFragments + 1;
+   size_t nofCharges = slot.fTotalCharges + charge.size();
    // not the last fragment:
    if(nofCharges != 2 * nofFrags - 1) {
-      // we need to insert this element into the map, and thanks to equal_range we already know where
+      // if we already have the maximum number of fragments we can solve for, or too many charges, this pile-up can't be solved
+      if(nofFrags >= kMaxFragments || nofCharges > kMaxCharges || charge.size() > integrationLength.size()) {
+         if(fDebug) {
+            std::cout << "address " << frag->GetAddress() << ": can't solve " << nofFrags << " fragments with " << nofCharges << " charges" << std::endl;
+         }
+         DropFragments(slot);
+         return false;
+      }
+      // we need to store this fragment in the slot of this address
       if(fDebug) {
          std::cout << "address " << frag->GetAddress() << ": inserting fragment " << frag << " with " << charge.size() << " charges" << std::endl;
       }
-      if(range.first != range.second) {
-         fMap.insert(
-            range.second,
-            std::pair<UInt_t, std::tuple<std::shared_ptr<TFragment>, std::vector<Int_t>, std::vector<Short_t>>>(
-               frag->GetAddress(), std::make_tuple(frag, charge, integrationLength)));
-      } else {
-         fMap.insert(
-            std::pair<UInt_t, std::tuple<std::shared_ptr<TFragment>, std::vector<Int_t>, std::vector<Short_t>>>(
-               frag->GetAddress(), std::make_tuple(frag, charge, integrationLength)));
+      if(slot.fNofFragments == 0) {
+         slot.fFirstTimeStamp = frag->GetTimeStamp();
       }
+      slot.fFragments[slot.fNofFragments]  = frag;
+      slot.fNofCharges[slot.fNofFragments] = charge.size();
+      std::copy(charge.begin(), charge.end(), slot.fCharges.begin() + slot.fTotalCharges);
+      std::copy(integrationLength.begin(), integrationLength.begin() + charge.size(), slot.fKValues.begin() + slot.fTotalCharges);
+      slot.fTotalCharges += charge.size();
+      ++slot.fNofFragments;
+      ++fPending;
       if(fDebug) {
          std::cout << "done" << std::endl;
       }
@@ -85,47 +101,44 @@ bool TFragmentMap::Add(const std::shared_ptr<TFragment>& frag, const std::vector
    }
    // last fragment:
    // now we can loop over the stored fragments and the current fragment and calculate all charges
-   std::vector<std::shared_ptr<TFragment>> frags;            // all fragments
-   std::vector<Long_t>                     kValues;          // all integration lengths
-   std::vector<Float_t>                    charges;          // all charges (not integrated charges, but integrated charge divided by integration length!)
-   int                                     situation = -1;   // flag to select different scenarios for the time sequence of multiple hits
+   // the dithering of the charges is keyed on the timestamp and address of the last fragment, so it doesn't depend on the thread
+   auto dither = [&frag](size_t draw) { return TDither::Uniform(static_cast<uint64_t>(frag->GetTimeStamp()), frag->GetAddress(), EDither::kPileUp, static_cast<uint32_t>(draw)); };
+   std::array<std::shared_ptr<TFragment>, kMaxFragments> frags;              // all fragments
+   std::array<Long_t, kMaxCharges>                       kValues{};          // all integration lengths
+   std::array<Float_t, kMaxCharges>                      charges{};          // all charges (not integrated charges, but integrated charge divided by integration length!)
+   size_t                                                nofCalcCharges = 0;   // number of charges calculated so far
+   int                                                   situation      = -1;  // flag to select different scenarios for the time sequence of multiple hits
    switch(nofFrags) {
    case 2:   // only one option: (2, 1)
    {
       if(charge.size() != 1) {
-         DropFragments(range);
+         DropFragments(slot);
          if(fDebug) {
             std::cout << "2 w/o single charge" << std::endl;
          }
          return false;
       }
-      // create and fill the vector of fragments
-      frags.push_back(std::get<0>((*(range.first)).second));
-      frags.push_back(frag);
-      // create and fill the vector of all integration lengths
-      if(fDebug) {
-         std::cout << "inserting ... " << std::endl;
-      }
-      kValues.insert(kValues.begin(), std::get<2>((*(range.first)).second).begin(), std::get<2>((*(range.first)).second).end());
-      if(fDebug) {
-         std::cout << "done" << std::endl;
-      }
-      kValues.push_back(integrationLength[0]);
-      // create and fill the vector of all charges
+      // fill the array of fragments
+      frags[0] = slot.fFragments[0];
+      frags[1] = frag;
+      // fill the array of all integration lengths
+      std::copy(slot.fKValues.begin(), slot.fKValues.begin() + slot.fTotalCharges, kValues.begin());
+      kValues[slot.fTotalCharges] = integrationLength[0];
+      // fill the array of all charges
       // we need the actual charges, not the integrated ones, so we calculate them now
       int dropped = -1;
-      for(size_t i = 0; i < std::get<1>((*(range.first)).second).size(); ++i) {
+      for(size_t i = 0; i < slot.fTotalCharges; ++i) {
          if(kValues[i] > 0) {
-            charges.push_back((static_cast<float>(std::get<1>((*(range.first)).second)[i]) + static_cast<float>(gRandom->Uniform())) / static_cast<float>(kValues[i]));
+            charges[nofCalcCharges++] = (static_cast<float>(slot.fCharges[i]) + static_cast<float>(dither(i))) / static_cast<float>(kValues[i]);
             if(fDebug) {
-               std::cout << "2, " << i << ": " << hex(std::get<1>((*(range.first)).second)[i]) << "/" << hex(kValues[i])
-                         << " = " << (std::get<1>((*(range.first)).second)[i] + gRandom->Uniform())
-                         << "/" << kValues[i] << " = " << charges.back() << std::endl;
+               std::cout << "2, " << i << ": " << hex(slot.fCharges[i]) << "/" << hex(kValues[i])
+                         << " = " << (slot.fCharges[i] + dither(i))
+                         << "/" << kValues[i] << " = " << charges[nofCalcCharges - 1] << std::endl;
             }
          } else {
             // drop this charge, it's no good
             if(dropped >= 0) {   // we've already dropped one, so we don't have enough left
-               DropFragments(range);
+               DropFragments(slot);
                if(fDebug) {
                   std::cout << "2 too much dropped" << std::endl;
                }
@@ -138,7 +151,7 @@ bool TFragmentMap::Add(const std::shared_ptr<TFragment>& frag, const std::vector
          }
       }
       if(dropped >= 0 && integrationLength[0] <= 0) {   // we've already dropped one, so we don't have enough left
-         DropFragments(range);
+         DropFragments(slot);
          if(fDebug) {
             std::cout << "2 too much dropped (end)" << std::endl;
          }
@@ -152,7 +165,7 @@ bool TFragmentMap::Add(const std::shared_ptr<TFragment>& frag, const std::vector
       // don't see them as two hits (and we would miss both of them)
       // if they are too far apart to get an integration of their sum, they're not piled up
       if(fDebug) {
-         std::cout << "dropped = " << dropped << ", charges.size() = " << charges.size() << std::endl;
+         std::cout << "dropped = " << dropped << ", charges.size() = " << nofCalcCharges << std::endl;
       }
       switch(dropped) {
       case 0:   // dropped e0, so only e0+e1 and e1 are left
@@ -180,134 +193,90 @@ bool TFragmentMap::Add(const std::shared_ptr<TFragment>& frag, const std::vector
          frags[1]->SetNumberOfPileups(-201);
          break;
       default:   // dropped none
-         charges.push_back(static_cast<float>(charge[0] + gRandom->Uniform()) / static_cast<float>(integrationLength[0]));
+         charges[nofCalcCharges++] = static_cast<float>(charge[0] + dither(slot.fTotalCharges)) / static_cast<float>(integrationLength[0]);
          if(fDebug) {
             std::cout << "2, -: " << hex(charge[0]) << "/" << hex(integrationLength[0]) << " = "
-                      << (charge[0] + gRandom->Uniform()) << "/" << integrationLength[0] << " = " << charges.back()
+                      << (charge[0] + dither(slot.fTotalCharges)) << "/" << integrationLength[0] << " = " << charges[nofCalcCharges - 1]
                       << std::endl;
          }
-         Solve(frags, charges, kValues);
+         Solve(frags, nofFrags, charges, kValues);
          break;
       }
    } break;
    case 3:   // two options: (3, 1, 1), (2, 2, 1)
    {
       if(charge.size() != 1) {
-         DropFragments(range);
+         DropFragments(slot);
          if(fDebug) {
             std::cout << "3 w/o single charge" << std::endl;
          }
          return false;
       }
-      // create and fill the vector of fragments
-      frags.push_back(std::get<0>((*(range.first)).second));
-      frags.push_back(std::get<0>((*std::next(range.first)).second));
-      frags.push_back(frag);
-      // create and fill the vector of all integration lengths
-      if(fDebug) {
-         std::cout << "inserting first ... " << std::endl;
-      }
-      kValues.insert(kValues.begin(), std::get<2>((*(range.first)).second).begin(), std::get<2>((*(range.first)).second).end());
-      if(fDebug) {
-         std::cout << "done" << std::endl;
-      }
-      situation = kValues.size();
-      if(fDebug) {
-         std::cout << "inserting second ... " << std::endl;
-      }
-      kValues.insert(kValues.end(), std::get<2>((*std::next(range.first)).second).begin(),
-                     std::get<2>((*std::next(range.first)).second).end());
-      if(fDebug) {
-         std::cout << "done" << std::endl;
-      }
-      kValues.push_back(integrationLength[0]);
-      // create and fill the vector of all charges
+      // fill the array of fragments
+      frags[0] = slot.fFragments[0];
+      frags[1] = slot.fFragments[1];
+      frags[2] = frag;
+      // fill the array of all integration lengths, the number of charges of the first fragment determines the situation
+      std::copy(slot.fKValues.begin(), slot.fKValues.begin() + slot.fTotalCharges, kValues.begin());
+      kValues[slot.fTotalCharges] = integrationLength[0];
+      situation                   = static_cast<int>(slot.fNofCharges[0]);
+      // fill the array of all charges
       // we need the actual charges, not the integrated ones, so we calculate them now
       std::vector<int> dropped;
-      for(size_t i = 0; i < std::get<1>((*(range.first)).second).size(); ++i) {
+      for(size_t i = 0; i < slot.fTotalCharges; ++i) {
          if(kValues[i] > 0) {
-            charges.push_back((static_cast<float>(std::get<1>((*(range.first)).second)[i]) + static_cast<float>(gRandom->Uniform())) / static_cast<float>(kValues[i]));
+            charges[nofCalcCharges++] = (static_cast<float>(slot.fCharges[i]) + static_cast<float>(dither(i))) / static_cast<float>(kValues[i]);
             if(fDebug) {
-               std::cout << "3, " << i << ": " << hex(std::get<1>((*(range.first)).second)[i]) << "/"
-                         << hex(kValues[i]) << " = " << (std::get<1>((*(range.first)).second)[i] + gRandom->Uniform())
-                         << "/" << kValues[i] << " = " << charges.back() << std::endl;
+               std::cout << "3, " << i << ": " << hex(slot.fCharges[i]) << "/"
+                         << hex(kValues[i]) << " = " << (slot.fCharges[i] + dither(i))
+                         << "/" << kValues[i] << " = " << charges[nofCalcCharges - 1] << std::endl;
             }
          } else {
-            dropped.push_back(i);
+            dropped.push_back(static_cast<int>(i));
             if(fDebug) {
                std::cout << "3, dropping " << i << std::endl;
             }
          }
       }
-      for(size_t i = 0; i < std::get<1>((*std::next(range.first)).second).size(); ++i) {
-         if(kValues[i + situation] > 0) {
-            charges.push_back((static_cast<float>(std::get<1>((*std::next(range.first)).second)[i]) + static_cast<float>(gRandom->Uniform())) / static_cast<float>(kValues[i + situation]));
-            if(fDebug) {
-               std::cout << "3, " << i + situation << ": "
-                         << hex(std::get<1>((*std::next(range.first)).second)[i]) << "/" << hex(kValues[i + situation])
-                         << " = " << (std::get<1>((*std::next(range.first)).second)[i] + gRandom->Uniform()) << "/"
-                         << kValues[i + situation] << " = " << charges.back() << std::endl;
-            }
-         } else {
-            dropped.push_back(i + situation);
-            if(fDebug) {
-               std::cout << "dropping " << i + situation << std::endl;
-            }
-         }
-      }
       if(integrationLength[0] <= 0) {
          dropped.push_back(4);
       }
       switch(dropped.size()) {
       case 0:   // dropped none
-         charges.push_back((static_cast<float>(charge[0]) + static_cast<float>(gRandom->Uniform())) / static_cast<float>(integrationLength[0]));
+         charges[nofCalcCharges++] = (static_cast<float>(charge[0]) + static_cast<float>(dither(slot.fTotalCharges))) / static_cast<float>(integrationLength[0]);
          if(fDebug) {
             std::cout << "3, -: " << hex(charge[0]) << "/" << hex(integrationLength[0]) << " = "
-                      << (charge[0] + gRandom->Uniform()) << "/" << integrationLength[0] << " = " << charges.back()
+                      << (charge[0] + dither(slot.fTotalCharges)) << "/" << integrationLength[0] << " = " << charges[nofCalcCharges - 1]
                       << std::endl;
          }
-         Solve(frags, charges, kValues, situation);
+         Solve(frags, nofFrags, charges, kValues, situation);
          break;
       case 1:   // dropped one
          // don't know how to handle these right now
-         DropFragments(range);
+         DropFragments(slot);
          if(fDebug) {
             std::cout << "3, single drop" << std::endl;
          }
          return false;
          break;
       case 2:   // dropped two => as many left as there are fragments
-         DropFragments(range);
+         // don't know how to handle these right now either
+         DropFragments(slot);
          if(fDebug) {
             std::cout << "3, double drop" << std::endl;
          }
          return false;
-         switch(dropped[0]) {
-         case 0:
-            switch(dropped[1]) {
-            case 1:   // e0+e1+e2, e2, e3
-               break;
-            case 2: break;
-            case 3: break;
-            case 4: break;
-            }
-            break;
-         }
-         break;
       default:   // dropped too many
-         DropFragments(range);
+         DropFragments(slot);
          if(fDebug) {
             std::cout << "3, dropped too many" << std::endl;
          }
          return false;
       }
    } break;
-   case 4:   // five options: (4, 1, 1, 1), (3, 2, 1, 1), (3, 1, 2, 1), (2, 3, 1, 1), (2, 2, 2, 1)
-             // break;
    default:
-      // std::cerr<<"address "<<frag->GetAddress()<<": deconvolution of "<<nofCharges<<" charges for "<<nofFrags<<"
-      // fragments not implemented yet!"<<std::endl;
-      DropFragments(range);
+      // we never store more than kMaxFragments - 1 fragments, so this should never happen
+      DropFragments(slot);
       if(fDebug) {
          std::cout << "unknown number of fragments " << nofFrags << std::endl;
       }
@@ -315,31 +284,27 @@ bool TFragmentMap::Add(const std::shared_ptr<TFragment>& frag, const std::vector
       break;
    }   // switch(nofFrags)
    // add all fragments to queue
-   int index = 0;
-   for(auto it = range.first; it != range.second; ++it) {
-      frag->SetEntryNumber();
-      for(const auto& outputQueue : fGoodOutputQueue) {
-         outputQueue->Push(std::get<0>((*it).second));
-      }
+   for(size_t i = 0; i < slot.fNofFragments; ++i) {
+      Push(slot.fFragments[i]);
       if(fDebug) {
-         std::cout << "Added " << ++index << ". fragment " << std::get<0>((*it).second) << std::endl;
+         std::cout << "Added " << i + 1 << ". fragment " << slot.fFragments[i] << std::endl;
       }
    }
-   frag->SetEntryNumber();
-   for(const auto& outputQueue : fGoodOutputQueue) {
-      outputQueue->Push(frag);
-   }
+   Push(frag);
    if(fDebug) {
       std::cout << "address " << frag->GetAddress() << ": added last fragment " << frag << std::endl;
    }
-   // remove these fragments from the map
-   fMap.erase(range.first, range.second);
+   // release these fragments from the slot
+   fPending -= slot.fNofFragments;
+   slot.fFragments.fill(nullptr);
+   slot.fNofFragments = 0;
+   slot.fTotalCharges = 0;
 
    return true;
 }
 
-void TFragmentMap::Solve(std::vector<std::shared_ptr<TFragment>> frag, std::vector<Float_t> charges,
-                         std::vector<Long_t> kValues, int situation)
+void TFragmentMap::Solve(std::array<std::shared_ptr<TFragment>, kMaxFragments>& frag, size_t nofFrags, const std::array<Float_t, kMaxCharges>& charges,
+                         const std::array<Long_t, kMaxCharges>& kValues, int situation)
 {
    /// Solves minimization of charges for given integrated charges (charges) and integration lengths (kValues).
    /// Resulting charges are stored in the provided fragments with a k-value of 1.
@@ -347,12 +312,12 @@ void TFragmentMap::Solve(std::vector<std::shared_ptr<TFragment>> frag, std::vect
    /// 3 - both later hits pile up with the first, any other value - the third hit only piles up with the second hit not the first one.
 
    // all k's are needed squared so we square all elements of k, cast to float here, because that is what we use later on
-   std::vector<float> kSquared(kValues.size());
+   std::array<float, kMaxCharges> kSquared{};
    for(size_t i = 0; i < kValues.size(); ++i) {
       kSquared[i] = static_cast<float>(kValues[i] * kValues[i]);
    }
 
-   switch(frag.size()) {
+   switch(nofFrags) {
    case 2:
       frag[0]->SetCharge((charges[0] * (kSquared[0] * kSquared[1] + kSquared[0] * kSquared[2]) + (charges[1] - charges[2]) * kSquared[1] * kSquared[2]) /
                          (kSquared[0] * kSquared[1] + kSquared[0] * kSquared[2] + kSquared[1] * kSquared[2]) * static_cast<float>(kValues[0]));
@@ -450,18 +415,60 @@ void TFragmentMap::Solve(std::vector<std::shared_ptr<TFragment>> frag, std::vect
    }
 }
 
-void TFragmentMap::DropFragments(std::pair<
-                                 std::multimap<UInt_t, std::tuple<std::shared_ptr<TFragment>, std::vector<Int_t>, std::vector<Short_t>>>::iterator,
-                                 std::multimap<UInt_t, std::tuple<std::shared_ptr<TFragment>, std::vector<Int_t>, std::vector<Short_t>>>::iterator>& range)
+void TFragmentMap::Push(const std::shared_ptr<TFragment>& frag)
+{
+   /// put the fragment into all good output queues, unless it is rejected by the fragment filter
+   if(!fFilter.Keep(frag)) {
+      return;
+   }
+   frag->SetEntryNumber();
+   for(const auto& outputQueue : fGoodOutputQueue) {
+      outputQueue->Push(frag);
+   }
+}
+
+void TFragmentMap::DropFragments(TPileUpSlot& slot)
 {
-   /// put the fragments within the range of the two iterators into the bad output queue
-   for(auto it = range.first; it != range.second; ++it) {
-      //(*it).second is a tuple, with the first element being a shared_ptr<TFragment>
-      // we need to convert this to a shared_ptr<TBadFragment>
-      fBadOutputQueue->Push(std::make_shared<TBadFragment>(*(std::get<0>((*it).second).get())));
+   /// put the fragments pending in this slot into the bad output queue and reset the slot
+   for(size_t i = 0; i < slot.fNofFragments; ++i) {
+      // we need to convert the shared_ptr<TFragment> to a shared_ptr<TBadFragment>
+      fBadOutputQueue->Push(std::make_shared<TBadFragment>(*(slot.fFragments[i].get())));
       if(fDebug) {
-         std::cout << "Added bad fragment " << std::get<0>((*it).second) << std::endl;
+         std::cout << "Added bad fragment " << slot.fFragments[i] << std::endl;
       }
    }
-   fMap.erase(range.first, range.second);
+   fPending -= slot.fNofFragments;
+   slot.fFragments.fill(nullptr);
+   slot.fNofFragments = 0;
+   slot.fTotalCharges = 0;
+}
+
+void TFragmentMap::DropExpired()
+{
+   /// drop all pending fragments whose first fragment is older than the latest timestamp minus the expiry window
+   fAddsSinceCheck = 0;
+   if(fPending == 0) {
+      return;
+   }
+   for(auto& iter : fSlots) {
+      if(iter.second.fNofFragments > 0 && fLatestTimeStamp - iter.second.fFirstTimeStamp > fExpiryWindow) {
+         if(fDebug) {
+            std::cout << "address " << iter.first << ": dropping " << iter.second.fNofFragments << " expired fragments" << std::endl;
+         }
+         DropFragments(iter.second);
+      }
+   }
+}
+
+void TFragmentMap::DropAll()
+{
+   /// drop all pending fragments, e.g. at the end of the run when no more partners can arrive
+   for(auto& iter : fSlots) {
+      DropFragments(iter.second);
+   }
+}
+
+size_t TFragmentMap::PendingFragments() const
+{
+   return fPending;
 }
@@ -1,4 +1,4 @@
-// TDetector.h TFragment.h TBadFragment.h TChannel.h TRunInfo.h TGRSISortInfo.h TPPG.h TEpicsFrag.h TScaler.h TScalerQueue.h TParsingDiagnostics.h TGRSIUtilities.h TMnemonic.h TSortingDiagnostics.h TTransientBits.h TPriorityValue.h TSingleton.h TDetectorInformation.h TParserLibrary.h TDataFrameLibrary.h TUserSettings.h GValue.h TGRSIOptions.h TGRSIint.h TAnalysisOptions.h TDataLoop.h StoppableThread.h TFragWriteLoop.h TTerminalLoop.h TEventBuildingLoop.h TDetBuildingLoop.h TAnalysisWriteLoop.h TFragHistLoop.h TCompiledHistograms.h TRuntimeObjects.h TAnalysisHistLoop.h GRootGuiFactory.h GRootFunctions.h GRootCommands.h GRootCanvas.h GRootBrowser.h GCanvas.h GH2Base.h  GH2I.h GH2D.h  GPeak.h GGaus.h GH1D.h GNotifier.h GPopup.h GSnapshot.h TCalibrator.h GHSym.h GCube.h TLevelScheme.h
+// TDetector.h TFragment.h TBadFragment.h TChannel.h TRunInfo.h TGRSISortInfo.h TPPG.h TEpicsFrag.h TScaler.h TScalerQueue.h TParsingDiagnostics.h TGRSIUtilities.h TMnemonic.h TSortingDiagnostics.h TTransientBits.h TPriorityValue.h TSingleton.h TDetectorInformation.h TParserLibrary.h TDataFrameLibrary.h TUserSettings.h GValue.h TGRSIOptions.h TGRSIint.h TAnalysisOptions.h TDataLoop.h StoppableThread.h TFragWriteLoop.h TTerminalLoop.h TEventBuildingLoop.h TDetBuildingLoop.h TAnalysisWriteLoop.h TFragHistLoop.h TCompiledHistograms.h TRuntimeObjects.h TAnalysisHistLoop.h GRootGuiFactory.h GRootFunctions.h GRootCommands.h GRootCanvas.h GRootBrowser.h GCanvas.h GH2Base.h  GH2I.h GH2D.h  GPeak.h GGaus.h GH1D.h GNotifier.h GPopup.h GSnapshot.h TCalibrator.h GHSym.h GCube.h GCutG.h TLevelScheme.h
 
 #ifdef __CINT__
 
@@ -96,6 +96,7 @@
 
 #pragma link C++ enum EAxis;
 #pragma link C++ enum kBackgroundSubtraction;
+#pragma link C++ enum EMapMode;
 #pragma link C++ function AddOffset;
 
 #pragma link C++ class GPopup + ;
@@ -116,8 +117,11 @@
 #pragma link C++ class GHSymF + ;
 #pragma link C++ class GHSymD + ;
 #pragma link C++ class GCube + ;
-#pragma link C++ class GCubeF + ;
-#pragma link C++ class GCubeD + ;
+#pragma link C++ class GCubeF - ;
+#pragma link C++ class GCubeD - ;
+#pragma link C++ class GGate + ;
+#pragma link C++ class GGate::TWeightedRange + ;
+#pragma link C++ class GCutG - ;
 
 #pragma link C++ class GPeak + ;
 #pragma link C++ class GGaus + ;
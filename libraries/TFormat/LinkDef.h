@@ -15,6 +15,8 @@
 #pragma link C++ class TSingleton < TRunInfo> - ;
 
 #pragma link C++ class TDetector + ;
+// reading a detector from a tree (e.g. TTree::GetEntry into the same object) replaces its hits
+#pragma read sourceClass="TDetector" targetClass="TDetector" version="[1-]" source="" target="fGeneration" code="{ ++fGeneration; }"
 #pragma link C++ class TDetectorHit - ;
 
 #pragma link C++ class TFragment + ;
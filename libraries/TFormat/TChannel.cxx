@@ -1,6 +1,9 @@
 #include "TChannel.h"
 
 #include <stdexcept>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <iomanip>
@@ -15,10 +18,13 @@
 
 #include "TFile.h"
 #include "TKey.h"
+#include "TBufferFile.h"
 
 #include "StoppableThread.h"
 #include "Globals.h"
 #include "TGRSIUtilities.h"
+#include "TCalibrationTable.h"
+#include "TDither.h"
 
 /*
  * Author:  P.C. Bender, <pcbend@gmail.com>
@@ -38,24 +44,273 @@ std::unordered_map<int, TChannel*>*          TChannel::fChannelNumberMap  = new
 TClassRef TChannel::fMnemonicClass = TClassRef("TMnemonic");
 
 std::string TChannel::fFileData;
+std::string TChannel::fFileBinary;
+ULong64_t   TChannel::fInputHash       = 0;
+ULong64_t   TChannel::fInputGeneration = 0;
+
+namespace {
+/// Keywords of the cal-file, parsed by TChannel::ParseChannels
+enum class ECalKeyword { kName,
+                         kAddress,
+                         kIntegration,
+                         kNumber,
+                         kTimeOffset,
+                         kTimeDrift,
+                         kStream,
+                         kDigitizer,
+                         kENGChi2,
+                         kCFDChi2,
+                         kLEDChi2,
+                         kTIMEChi2,
+                         kEFFChi2,
+                         kENGCoeff,
+                         kENGRange,
+                         kENGDrift,
+                         kLEDCoeff,
+                         kCFDCoeff,
+                         kTIMECoeff,
+                         kCTCoeff,
+                         kEnergyNonlinearity,
+                         kEFFCoeff,
+                         kFileInt,
+                         kRiseTime,
+                         kDecayTime,
+                         kBaseLine };
+
+const std::unordered_map<std::string, ECalKeyword> gCalKeywords = {
+   {"NAME", ECalKeyword::kName},
+   {"ADDRESS", ECalKeyword::kAddress},
+   {"INTEGRATION", ECalKeyword::kIntegration},
+   {"NUMBER", ECalKeyword::kNumber},
+   {"TIMEOFFSET", ECalKeyword::kTimeOffset},
+   {"TIMEDRIFT", ECalKeyword::kTimeDrift},
+   {"STREAM", ECalKeyword::kStream},
+   {"DIGITIZER", ECalKeyword::kDigitizer},
+   {"ENGCHI2", ECalKeyword::kENGChi2},
+   {"CFDCHI2", ECalKeyword::kCFDChi2},
+   {"LEDCHI2", ECalKeyword::kLEDChi2},
+   {"TIMECHI2", ECalKeyword::kTIMEChi2},
+   {"EFFCHI2", ECalKeyword::kEFFChi2},
+   {"ENGCOEFF", ECalKeyword::kENGCoeff},
+   {"ENGRANGE", ECalKeyword::kENGRange},
+   {"ENGDRIFT", ECalKeyword::kENGDrift},
+   {"LEDCOEFF", ECalKeyword::kLEDCoeff},
+   {"CFDCOEFF", ECalKeyword::kCFDCoeff},
+   {"TIMECOEFF", ECalKeyword::kTIMECoeff},
+   {"WALK", ECalKeyword::kTIMECoeff},
+   {"CTCOEFF", ECalKeyword::kCTCoeff},
+   {"ENERGYNONLINEARITY", ECalKeyword::kEnergyNonlinearity},
+   {"EFFCOEFF", ECalKeyword::kEFFCoeff},
+   {"FILEINT", ECalKeyword::kFileInt},
+   {"RISETIME", ECalKeyword::kRiseTime},
+   {"DECAYTIME", ECalKeyword::kDecayTime},
+   {"BASELINE", ECalKeyword::kBaseLine}};
+
+inline void Convert(const char* pos, char** end, float& value) { value = std::strtof(pos, end); }
+inline void Convert(const char* pos, char** end, double& value) { value = std::strtod(pos, end); }
+inline void Convert(const char* pos, char** end, int& value) { value = static_cast<int>(std::strtol(pos, end, 10)); }
+inline void Convert(const char* pos, char** end, unsigned int& value) { value = static_cast<unsigned int>(std::strtoul(pos, end, 10)); }
+inline void Convert(const char* pos, char** end, long& value) { value = std::strtol(pos, end, 10); }
+inline void Convert(const char* pos, char** end, long long& value) { value = std::strtoll(pos, end, 10); }
+inline void Convert(const char* pos, char** end, unsigned long& value) { value = std::strtoul(pos, end, 10); }
+inline void Convert(const char* pos, char** end, unsigned long long& value) { value = std::strtoull(pos, end, 10); }
+
+/// Reads a number from pos (skipping leading whitespace) and advances pos past it, returns false if there is no number.
+/// Only accepts numbers that std::istream would read as well, i.e. no "inf", "nan", or hex-floats.
+template <typename T>
+bool ReadNumber(const char*& pos, T& value)
+{
+   while(std::isspace(static_cast<unsigned char>(*pos)) != 0) {
+      ++pos;
+   }
+   if(std::isdigit(static_cast<unsigned char>(*pos)) == 0 && *pos != '-' && *pos != '+' && *pos != '.') {
+      return false;
+   }
+   const char* digits = (*pos == '-' || *pos == '+') ? pos + 1 : pos;
+   if(digits[0] == '0' && (digits[1] == 'x' || digits[1] == 'X')) {
+      // std::istream reads hexadecimal numbers only as 0
+      value = 0;
+      pos   = digits + 1;
+      return true;
+   }
+   char* end    = nullptr;
+   T     result = 0;
+   Convert(pos, &end, result);
+   if(end == pos) {
+      return false;
+   }
+   value = result;
+   pos   = end;
+   return true;
+}
+
+/// 64 bit FNV-1a hash, used to recognize calibrations that have already been loaded
+ULong64_t CalibrationHash(const char* data, size_t size)
+{
+   ULong64_t hash = 0xcbf29ce484222325ULL;
+   for(size_t i = 0; i < size; ++i) {
+      hash ^= static_cast<unsigned char>(data[i]);
+      hash *= 0x100000001b3ULL;
+   }
+   return hash;
+}
+
+// functions to write the members of a TChannel to and read them from the binary calibration, each value is preceded by its priority
+void WriteBinary(TBuffer& buffer, int value) { buffer << value; }
+void WriteBinary(TBuffer& buffer, Long64_t value) { buffer << value; }
+void WriteBinary(TBuffer& buffer, double value) { buffer << value; }
+void WriteBinary(TBuffer& buffer, bool value) { buffer << value; }
+void WriteBinary(TBuffer& buffer, const std::string& value) { buffer.WriteTString(TString(value.c_str())); }
+void WriteBinary(TBuffer& buffer, const std::vector<double>& value)
+{
+   buffer << static_cast<Int_t>(value.size());
+   buffer.WriteFastArray(value.data(), static_cast<Int_t>(value.size()));
+}
+void WriteBinary(TBuffer& buffer, const std::vector<Float_t>& value)
+{
+   buffer << static_cast<Int_t>(value.size());
+   buffer.WriteFastArray(value.data(), static_cast<Int_t>(value.size()));
+}
+void WriteBinary(TBuffer& buffer, const std::vector<std::vector<Float_t>>& value)
+{
+   buffer << static_cast<Int_t>(value.size());
+   for(const auto& vec : value) {
+      WriteBinary(buffer, vec);
+   }
+}
+void WriteBinary(TBuffer& buffer, const std::vector<std::pair<double, double>>& value)
+{
+   buffer << static_cast<Int_t>(value.size());
+   for(const auto& pair : value) {
+      buffer << pair.first << pair.second;
+   }
+}
+void WriteBinary(TBuffer& buffer, const TGraph& value)
+{
+   buffer << value.GetN();
+   buffer.WriteFastArray(value.GetX(), value.GetN());
+   buffer.WriteFastArray(value.GetY(), value.GetN());
+}
+
+void ReadBinary(TBuffer& buffer, int& value) { buffer >> value; }
+void ReadBinary(TBuffer& buffer, Long64_t& value) { buffer >> value; }
+void ReadBinary(TBuffer& buffer, double& value) { buffer >> value; }
+void ReadBinary(TBuffer& buffer, bool& value) { buffer >> value; }
+void ReadBinary(TBuffer& buffer, std::string& value)
+{
+   TString str;
+   buffer.ReadTString(str);
+   value = str.Data();
+}
+void ReadBinary(TBuffer& buffer, std::vector<double>& value)
+{
+   Int_t size = 0;
+   buffer >> size;
+   value.resize(size);
+   buffer.ReadFastArray(value.data(), size);
+}
+void ReadBinary(TBuffer& buffer, std::vector<Float_t>& value)
+{
+   Int_t size = 0;
+   buffer >> size;
+   value.resize(size);
+   buffer.ReadFastArray(value.data(), size);
+}
+void ReadBinary(TBuffer& buffer, std::vector<std::vector<Float_t>>& value)
+{
+   Int_t size = 0;
+   buffer >> size;
+   value.resize(size);
+   for(auto& vec : value) {
+      ReadBinary(buffer, vec);
+   }
+}
+void ReadBinary(TBuffer& buffer, std::vector<std::pair<double, double>>& value)
+{
+   Int_t size = 0;
+   buffer >> size;
+   value.resize(size);
+   for(auto& pair : value) {
+      buffer >> pair.first >> pair.second;
+   }
+}
+void ReadBinary(TBuffer& buffer, TGraph& value)
+{
+   Int_t size = 0;
+   buffer >> size;
+   std::vector<double> x(size);
+   std::vector<double> y(size);
+   buffer.ReadFastArray(x.data(), size);
+   buffer.ReadFastArray(y.data(), size);
+   value = (size > 0) ? TGraph(size, x.data(), y.data()) : TGraph();
+}
+
+template <typename T>
+void WriteBinary(TBuffer& buffer, const TPriorityValue<T>& value, EPriority prio)
+{
+   // values that have been set are written with priority prio, the priority they get when the cal-file is parsed
+   buffer << static_cast<UChar_t>(value.Priority() == EPriority::kDefault ? EPriority::kDefault : prio);
+   WriteBinary(buffer, value.Value());
+}
+
+template <typename T>
+TPriorityValue<T> ReadPriorityValue(TBuffer& buffer)
+{
+   UChar_t priority = 0;
+   buffer >> priority;
+   T value{};
+   ReadBinary(buffer, value);
+   return TPriorityValue<T>(value, static_cast<EPriority>(priority));
+}
+
+template <typename T>
+void ReadBinary(TBuffer& buffer, TPriorityValue<T>& value)
+{
+   // Set also copies values with default priority, so the member is the same as the one written, even if the priority wasn't raised
+   auto tmp = ReadPriorityValue<T>(buffer);
+   value.Set(tmp.Value(), tmp.Priority());
+}
+
+constexpr UShort_t kBinaryCalibrationVersion = 1;   ///< version of the binary calibration format
+}   // namespace
 
 TChannel::TChannel()
 {
    Clear();
 }   // default constructor need to write to root file.
 
-TChannel::~TChannel() = default;
+TChannel::~TChannel()
+{
+   if(fDetached) {
+      return;
+   }
+   auto iter = fChannelNumberMap->find(fNumber.Value());
+   if(iter != fChannelNumberMap->end() && iter->second == this) {
+      fChannelNumberMap->erase(iter);
+   }
+}
+
+TChannel::TChannel(const char* tempName) : TChannel(tempName, false)
+{
+}
 
-TChannel::TChannel(const char* tempName)
+TChannel::TChannel(const char* tempName, bool detached) : fDetached(detached)
 {
+   /// A detached channel (as created by the cal-file parser) isn't added to the channel number map and doesn't
+   /// invalidate the calibration table, so it can be used from any thread. AddChannel attaches it.
    Clear();
    // only set name if it's not empty
    if(strlen(tempName) > 0) { SetName(tempName); }
 }
 
-TChannel::TChannel(const TChannel& chan) : TNamed(chan)
+TChannel::TChannel(const TChannel& chan) : TChannel(chan, false)
 {
-   /// Makes a copy of a the TChannel.
+}
+
+TChannel::TChannel(const TChannel& chan, bool detached) : TNamed(chan), fDetached(detached)
+{
+   /// Makes a copy of a the TChannel. A detached copy (as used by the calibration table) isn't added to the
+   /// channel number map and changing it doesn't invalidate the calibration table.
    Clear();
    *(fMnemonic.Value()) = *(chan.fMnemonic.Value());
    SetAddress(chan.GetAddress());
@@ -251,9 +506,28 @@ void TChannel::SetName(const char* tmpName)
    }
 }
 
-void TChannel::InitChannelInput()
+void TChannel::InitChannelInput(ULong64_t hash, const char* binary, Int_t size)
 {
-   int channels_found = ParseInputData(fFileData.c_str(), "q", EPriority::kRootFile);
+   /// Reads the channels from the binary calibration if there is one, otherwise from the text in fFileData.
+   /// If the calibration is identical to the last one read and no calibration has been changed since then,
+   /// reading them again would not change anything, so they are skipped.
+   if(hash == 0) {
+      hash = CalibrationHash(fFileData.data(), fFileData.size());
+   }
+   if(hash == fInputHash && fInputGeneration == TCalibrationTable::Generation()) {
+      return;
+   }
+
+   int channels_found = -1;
+   if(binary != nullptr && size > 0) {
+      channels_found = ParseBinaryData(binary, size);
+   }
+   if(channels_found < 0) {
+      channels_found = ParseInputData(fFileData.c_str(), "q", EPriority::kRootFile);
+   }
+   fInputHash       = hash;
+   fInputGeneration = TCalibrationTable::Generation();
+
    if(gFile != nullptr) {
       std::cout << "Successfully read " << channels_found << " TChannels from " << CYAN << gFile->GetName() << RESET_COLOR << std::endl;
    } else {
@@ -280,6 +554,14 @@ void TChannel::DeleteAllChannels()
    }
    fChannelMap->clear();
    fChannelNumberMap->clear();
+   CalibrationChanged();
+}
+
+void TChannel::CalibrationChanged()
+{
+   /// The compiled calibrations in the TCalibrationTable point to the TChannels and copy their coefficients,
+   /// so any change has to invalidate the table. It is rebuilt the next time it is used.
+   TCalibrationTable::Invalidate();
 }
 
 void TChannel::AddChannel(TChannel* chan, Option_t* opt)
@@ -317,10 +599,12 @@ void TChannel::AddChannel(TChannel* chan, Option_t* opt)
       delete chan;
    } else {
       // We need to update the channel maps to correspond to the new channel that has been added.
+      chan->fDetached = false;
       fChannelMap->insert(std::make_pair(chan->GetAddress(), chan));
       if((chan->GetNumber() != 0) && (fChannelNumberMap->count(chan->GetNumber()) == 0)) {
          fChannelNumberMap->insert(std::make_pair(chan->GetNumber(), chan));
       }
+      CalibrationChanged();
    }
 }
 
@@ -421,6 +705,13 @@ TChannel* TChannel::GetDefaultChannel()
 void TChannel::Clear(Option_t*)
 {
    /// Clears all fields of a TChannel. There are currently no options to be specified.
+   // only channels in the channel map are compiled into the calibration table, new or parsed channels don't change it
+   bool inMap = false;
+   if(!fDetached) {
+      auto mapIter = fChannelMap->find(fAddress);
+      inMap        = (mapIter != fChannelMap->end() && mapIter->second == this);
+   }
+
    fAddress = 0xffffffff;
    fIntegration.Reset(0);
    fDigitizerTypeString = TPriorityValue<std::string>();
@@ -454,6 +745,9 @@ void TChannel::Clear(Option_t*)
    fEFFChi2.Reset(0.0);
    fCTCoefficients.Reset(std::vector<double>());
    fEnergyNonlinearity.Reset(TGraph());
+   if(inMap) {
+      CalibrationChanged();
+   }
 }
 
 TChannel* TChannel::GetChannel(unsigned int temp_address, bool warn)
@@ -540,13 +834,12 @@ std::vector<TChannel*> TChannel::FindChannelByRegEx(const char* ccName)
 void TChannel::SetAddress(unsigned int tmpadd)
 {
    /// Sets the address of a TChannel and also overwrites that channel if it is in the channel map
-   for(auto iter1 : *fChannelMap) {
-      if(iter1.second == this) {
-         std::cout << "Channel at address: " << hex(fAddress, 4)
-                   << " already exists. Please use AddChannel() or OverWriteChannel() to change this TChannel"
-                   << std::dec << std::endl;
-         break;
-      }
+   // channels are stored in the map with their address, so we only need to check that one entry
+   auto iter = fDetached ? fChannelMap->end() : fChannelMap->find(fAddress);
+   if(iter != fChannelMap->end() && iter->second == this) {
+      std::cout << "Channel at address: " << hex(fAddress, 4)
+                << " already exists. Please use AddChannel() or OverWriteChannel() to change this TChannel"
+                << std::dec << std::endl;
    }
    fAddress = tmpadd;
 }
@@ -558,12 +851,14 @@ void TChannel::DestroyENGCal()
    fENGRanges.Address()->clear();
    fENGChi2.Address()->clear();
    fENGDriftCoefficents.Address()->clear();
+   Changed();
 }
 
 void TChannel::DestroyCFDCal()
 {
    /// Erases the CFDCoefficients vector
    fCFDCoefficients.Address()->clear();
+   Changed();
 }
 
 void TChannel::DestroyLEDCal()
@@ -576,6 +871,7 @@ void TChannel::DestroyTIMECal()
 {
    /// Erases the TimeCal vector
    fTIMECoefficients.Address()->clear();
+   Changed();
 }
 
 void TChannel::DestroyEFFCal()
@@ -593,6 +889,7 @@ void TChannel::DestroyCTCal()
 void TChannel::DestroyEnergyNonlinearity()
 {
    fEnergyNonlinearity.Address()->Set(0);
+   Changed();
 }
 
 void TChannel::DestroyCalibrations()
@@ -619,7 +916,7 @@ double TChannel::CalibrateENG(int charge, int temp_int) const
 
    // We need to add a random number between 0 and 1 before calibrating to avoid
    // binning issues.
-   return CalibrateENG(static_cast<double>(charge) + gRandom->Uniform(), temp_int);
+   return CalibrateENG(static_cast<double>(charge) + TDither::Uniform(EDither::kCharge), temp_int);
 }
 
 double TChannel::CalibrateENG(double charge, int temp_int) const
@@ -664,8 +961,9 @@ double TChannel::CalibrateENG(double charge) const
          // check if the current range covers this charge
          if(fENGRanges.Value()[currentRange].first < charge && charge < fENGRanges.Value()[currentRange].second) {
             // check if there is an overlap with the next range in which case we select that one in 50% of the cases
+            // the selection is keyed on the (dithered) charge, so the same hit always uses the same range
             if(fENGRanges.Value()[currentRange + 1].first < charge && charge < fENGRanges.Value()[currentRange + 1].second &&
-               gRandom->Uniform() > 0.5) {
+               TDither::Uniform(TDither::DoubleBits(charge), fAddress, EDither::kRange) > 0.5) {
                ++currentRange;
             }
             foundRange = true;
@@ -682,24 +980,26 @@ double TChannel::CalibrateENG(double charge) const
 
    // apply the drift correction first
    if(!fENGDriftCoefficents.empty()) {
-      double corrCharge = -fENGDriftCoefficents[0];   // ILL subtracts the offset instead of adding it
-      for(size_t i = 1; i < fENGDriftCoefficents.size(); i++) {
-         corrCharge += fENGDriftCoefficents[i] * pow(charge, static_cast<double>(i));
+      // ILL subtracts the offset instead of adding it
+      const auto& drift      = fENGDriftCoefficents.Value();
+      double      corrCharge = (drift.size() == 1) ? -static_cast<double>(drift[0]) : static_cast<double>(drift.back());
+      for(size_t i = drift.size() - 1; i > 1; --i) {
+         corrCharge = corrCharge * charge + static_cast<double>(drift[i - 1]);
+      }
+      if(drift.size() > 1) {
+         corrCharge = corrCharge * charge - static_cast<double>(drift[0]);
       }
       charge = corrCharge;
    }
    // if we had drift correction charge is now the corrected charge, otherwise it is still the charge
-   double cal_chg = fENGCoefficients[currentRange][0];
-   for(size_t i = 1; i < fENGCoefficients[currentRange].size(); i++) {
-      cal_chg += fENGCoefficients[currentRange][i] * pow((charge), static_cast<double>(i));
-   }
-   return cal_chg;
+   // the polynomial is evaluated with the Horner scheme, the same way as in TCalibrationTable
+   return TCalibrationTable::Polynomial(fENGCoefficients[currentRange].data(), fENGCoefficients[currentRange].size(), charge);
 }
 
 double TChannel::CalibrateCFD(int cfd) const
 {
    /// Calibrates the CFD properly.
-   return CalibrateCFD(static_cast<double>(cfd) + gRandom->Uniform());
+   return CalibrateCFD(static_cast<double>(cfd) + TDither::Uniform(EDither::kCfd));
 }
 
 double TChannel::CalibrateCFD(double cfd) const
@@ -710,21 +1010,13 @@ double TChannel::CalibrateCFD(double cfd) const
       return cfd;
    }
 
-   double cal_cfd = 0.0;
-   // std::cout<<cfd<<":";
-   for(size_t i = 0; i < fCFDCoefficients.size(); i++) {
-      cal_cfd += fCFDCoefficients[i] * pow(cfd, static_cast<double>(i));
-      // std::cout<<" "<<i<<" - "<<fCFDCoefficients[i]<<" = "<<cal_cfd;
-   }
-   // std::cout<<std::endl;
-
-   return cal_cfd;
+   return TCalibrationTable::Polynomial(fCFDCoefficients.Value().data(), fCFDCoefficients.size(), cfd);
 }
 
 double TChannel::CalibrateLED(int led) const
 {
    /// Calibrates the LED
-   return CalibrateLED(static_cast<double>(led) + gRandom->Uniform());
+   return CalibrateLED(static_cast<double>(led) + TDither::Uniform(EDither::kLed));
 }
 
 double TChannel::CalibrateLED(double led) const
@@ -760,11 +1052,9 @@ double TChannel::CalibrateTIME(double energy) const
       return 0.0000;
    }
 
-   double timeCorrection = 0.0;
+   const auto& coefficients = fTIMECoefficients.Value();
 
-   timeCorrection = fTIMECoefficients.at(0) + (fTIMECoefficients.at(1) * pow(energy, fTIMECoefficients.at(2)));
-
-   return timeCorrection;
+   return coefficients[0] + (coefficients[1] * pow(energy, coefficients[2]));
 }
 
 double TChannel::CalibrateEFF(double) const
@@ -1052,6 +1342,11 @@ void TChannel::WriteCalBuffer(Option_t*)
    }
    fFileData.clear();
    fFileData = data;
+
+   // the binary calibration is made from the same channels, so writing a TChannel doesn't have to parse the text again
+   TBufferFile binary(TBuffer::kWrite);
+   WriteBinaryData(binary, chanVec, EPriority::kRootFile);
+   fFileBinary.assign(binary.Buffer(), binary.Length());
 }
 
 Int_t TChannel::ReadCalFromCurrentFile(Option_t*)
@@ -1114,12 +1409,11 @@ Int_t TChannel::ReadCalFile(std::ifstream& infile)
       return -2;
    }
 
-   auto* buffer = new char[length + 1];   //+1 for the null character to terminate the string
+   std::string buffer(length, '\0');
    infile.seekg(0, std::ios::beg);
-   infile.read(buffer, length);
-   buffer[length] = '\0';
+   infile.read(&buffer[0], length);
 
-   int channelsFound = ParseInputData(buffer, "q", EPriority::kInputFile);
+   int channelsFound = ParseInputData(buffer.c_str(), "q", EPriority::kInputFile);
    SaveToSelf();
 
    fChannelNumberMap->clear();   // This isn't the nicest way to do this but will keep us consistent.
@@ -1154,23 +1448,159 @@ Int_t TChannel::ReadCalFile(const char* filename)
 void TChannel::SaveToSelf()
 {
    /// This function saves the current cal-file to fFileData.
-   /// For some reason it does the latter not by using WriteCalBuffer ???
-   std::ostringstream buffer;
-   std::streambuf*    std_out = std::cout.rdbuf(buffer.rdbuf());
-   WriteCalFile();
-   fFileData.assign(buffer.str());
-   std::cout.rdbuf(std_out);
+   /// WriteCalFile without file name prints the same text as WriteCalBuffer creates, so we use the latter
+   /// instead of redirecting std::cout.
+   WriteCalBuffer();
 }
 
 Int_t TChannel::ParseInputData(const char* inputdata, Option_t* opt, EPriority prio)
 {
-   std::istringstream infile(inputdata);
+   int  linenumber  = 0;
+   auto channels    = ParseChannels(inputdata, prio, &linenumber);
+   int  newchannels = MergeChannels(channels);
+   if(strcmp(opt, "q") != 0) {
+      std::cout << "parsed " << linenumber << " lines." << std::endl;
+   }
+
+   return newchannels;
+}
+
+Int_t TChannel::MergeChannels(const std::vector<TChannel*>& channels)
+{
+   /// Adds the channels to the channel map, or updates the existing channels with them (and deletes them).
+   int newchannels = 0;
+   for(auto* channel : channels) {
+      TChannel* currentchan = GetChannel(channel->GetAddress(), false);
+      if(currentchan == nullptr) {
+         AddChannel(channel);   // consider using a default option here
+      } else {
+         currentchan->UpdateChannel(channel);
+         delete channel;
+      }
+      newchannels++;
+   }
+   CalibrationChanged();
+
+   return newchannels;
+}
 
-   TChannel* channel = nullptr;
+void TChannel::WriteBinaryData(TBuffer& buffer, const std::vector<TChannel*>& channels, EPriority prio)
+{
+   /// Writes the members of the channels that the cal-file parser sets to the buffer, with the priority prio the
+   /// parser would give them.
+   buffer << kBinaryCalibrationVersion;
+   buffer << static_cast<UInt_t>(channels.size());
+   for(auto* channel : channels) {
+      buffer.WriteTString(TString(channel->GetName()));
+      buffer << channel->fAddress;
+      WriteBinary(buffer, channel->fNumber, prio);
+      WriteBinary(buffer, channel->fIntegration, prio);
+      WriteBinary(buffer, channel->fTimeOffset, prio);
+      WriteBinary(buffer, channel->fTimeDrift, prio);
+      WriteBinary(buffer, channel->fStream, prio);
+      WriteBinary(buffer, channel->fDigitizerTypeString, prio);
+      WriteBinary(buffer, channel->fENGChi2, prio);
+      WriteBinary(buffer, channel->fCFDChi2, prio);
+      WriteBinary(buffer, channel->fLEDChi2, prio);
+      WriteBinary(buffer, channel->fTIMEChi2, prio);
+      WriteBinary(buffer, channel->fEFFChi2, prio);
+      WriteBinary(buffer, channel->fENGCoefficients, prio);
+      WriteBinary(buffer, channel->fENGRanges, prio);
+      WriteBinary(buffer, channel->fENGDriftCoefficents, prio);
+      WriteBinary(buffer, channel->fLEDCoefficients, prio);
+      WriteBinary(buffer, channel->fCFDCoefficients, prio);
+      WriteBinary(buffer, channel->fTIMECoefficients, prio);
+      WriteBinary(buffer, channel->fCTCoefficients, prio);
+      WriteBinary(buffer, channel->fEnergyNonlinearity, prio);
+      WriteBinary(buffer, channel->fEFFCoefficients, prio);
+      WriteBinary(buffer, channel->fUseCalFileInt, prio);
+      buffer << channel->WaveFormShape.InUse << channel->WaveFormShape.BaseLine << channel->WaveFormShape.TauDecay << channel->WaveFormShape.TauRise;
+   }
+}
+
+Int_t TChannel::ParseBinaryData(const char* data, Int_t size)
+{
+   /// Creates the channels from the binary calibration written by WriteBinaryData and merges them into the channel map
+   /// like ParseInputData does. The binary calibration is written from the channels the text was printed from, with the
+   /// priority parsing the text gives, so this results in those channels (at full precision, unlike the printed text)
+   /// without having to convert the text to numbers.
+   /// Returns -1 if the data can't be read, so the caller can fall back on the text.
+   TBufferFile buffer(TBuffer::kRead, size, const_cast<char*>(data), false);   // NOLINT(cppcoreguidelines-pro-type-const-cast)
+   UShort_t    version = 0;
+   buffer >> version;
+   if(version != kBinaryCalibrationVersion) {
+      return -1;
+   }
+   UInt_t nofChannels = 0;
+   buffer >> nofChannels;
+
+   std::vector<TChannel*> channels;
+   channels.reserve(nofChannels);
+   for(UInt_t i = 0; i < nofChannels; ++i) {
+      auto*   channel = new TChannel("", true);
+      TString name;
+      buffer.ReadTString(name);
+      if(name.Length() > 0) { channel->SetName(name.Data()); }
+      unsigned int address = 0;
+      buffer >> address;
+      channel->SetAddress(address);
+      // members with side effects (channel number map, digitizer type) use their setters, but only if the parser had called them
+      auto number = ReadPriorityValue<int>(buffer);
+      if(number.Priority() != EPriority::kDefault) {
+         channel->SetNumber(number);
+      }
+      ReadBinary(buffer, channel->fIntegration);
+      ReadBinary(buffer, channel->fTimeOffset);
+      ReadBinary(buffer, channel->fTimeDrift);
+      ReadBinary(buffer, channel->fStream);
+      auto digitizer = ReadPriorityValue<std::string>(buffer);
+      if(digitizer.Priority() != EPriority::kDefault) {
+         channel->SetDigitizerType(digitizer);
+      }
+      ReadBinary(buffer, channel->fENGChi2);
+      ReadBinary(buffer, channel->fCFDChi2);
+      ReadBinary(buffer, channel->fLEDChi2);
+      ReadBinary(buffer, channel->fTIMEChi2);
+      ReadBinary(buffer, channel->fEFFChi2);
+      ReadBinary(buffer, channel->fENGCoefficients);
+      ReadBinary(buffer, channel->fENGRanges);
+      ReadBinary(buffer, channel->fENGDriftCoefficents);
+      ReadBinary(buffer, channel->fLEDCoefficients);
+      ReadBinary(buffer, channel->fCFDCoefficients);
+      ReadBinary(buffer, channel->fTIMECoefficients);
+      ReadBinary(buffer, channel->fCTCoefficients);
+      ReadBinary(buffer, channel->fEnergyNonlinearity);
+      ReadBinary(buffer, channel->fEFFCoefficients);
+      ReadBinary(buffer, channel->fUseCalFileInt);
+      buffer >> channel->WaveFormShape.InUse >> channel->WaveFormShape.BaseLine >> channel->WaveFormShape.TauDecay >> channel->WaveFormShape.TauRise;
+      if(channel->fEnergyNonlinearity.Value().GetN() > 0) {
+         channel->SetupEnergyNonlinearity();
+      }
+      channels.push_back(channel);
+   }
+   if(buffer.Length() != size) {
+      // the binary calibration is corrupted
+      for(auto* channel : channels) {
+         delete channel;
+      }
+      return -1;
+   }
+
+   return MergeChannels(channels);
+}
+
+std::vector<TChannel*> TChannel::ParseChannels(const char* inputdata, EPriority prio, int* lines)
+{
+   /// Parses the input data into new detached channels, the caller owns them. Parsing doesn't touch the channel maps
+   /// or the calibration table, so it can run on any thread, MergeChannels adds the channels to the channel map.
+   /// The input is parsed in a single pass over the buffer, reusing one line buffer and reading the numbers
+   /// directly from it.
+   TChannel*              channel = nullptr;
+   std::vector<TChannel*> channels;
 
    std::string line;
-   int         linenumber  = 0;
-   int         newchannels = 0;
+   std::string type;
+   int         linenumber = 0;
 
    // bool creatednewchannel = false;
    bool brace_open = false;
@@ -1179,13 +1609,22 @@ Int_t TChannel::ParseInputData(const char* inputdata, Option_t* opt, EPriority p
 
    // Parse the cal file. This is useful because if the cal file contains something that
    // the parser does not recognize, it just skips it!
-   while(std::getline(infile, line)) {
+   const char* next = inputdata;
+   while(next != nullptr && *next != '\0') {
+      const char* end = std::strchr(next, '\n');
+      if(end == nullptr) {
+         line.assign(next);
+         next = nullptr;
+      } else {
+         line.assign(next, end);
+         next = end + 1;
+      }
       linenumber++;
-      trimWS(line);
       size_t comment = line.find("//");
       if(comment != std::string::npos) {
-         line = line.substr(0, comment);
+         line.resize(comment);
       }
+      trimWS(line);
       if(line.length() == 0u) {
          continue;
       }
@@ -1201,17 +1640,7 @@ Int_t TChannel::ParseInputData(const char* inputdata, Option_t* opt, EPriority p
       if(closebrace != std::string::npos) {
          brace_open = false;
          if(channel != nullptr) {
-            TChannel* currentchan = GetChannel(channel->GetAddress(), false);
-            if(currentchan == nullptr) {
-               AddChannel(channel);   // consider using a default option here
-               newchannels++;
-            } else {
-               currentchan->UpdateChannel(channel);
-               delete channel;
-               newchannels++;
-            }
-         } else {
-            delete channel;
+            channels.push_back(channel);
          }
          channel = nullptr;
          name.clear();
@@ -1221,186 +1650,212 @@ Int_t TChannel::ParseInputData(const char* inputdata, Option_t* opt, EPriority p
          brace_open = true;
          name       = line.substr(0, openbrace);
          trimWS(name);
-         channel = new TChannel("");
+         channel = new TChannel("", true);
          if(!name.empty()) { channel->SetName(name.c_str()); }
       }
       //*************************************//
       if(brace_open) {
          size_t ntype = line.find(':');
          if(ntype != std::string::npos) {
-            std::string type = line.substr(0, ntype);
-            line             = line.substr(ntype + 1, line.length());
+            type.assign(line, 0, ntype);
+            line.erase(0, ntype + 1);
             trimWS(line);
-            std::istringstream str(line);
+            const char* str = line.c_str();
             // transform type to upper case
             std::transform(type.begin(), type.end(), type.begin(), ::toupper);
-            if(type == "NAME") {
+            auto keyword = gCalKeywords.find(type);
+            if(keyword == gCalKeywords.end()) {
+               continue;
+            }
+            switch(keyword->second) {
+            case ECalKeyword::kName:
                channel->SetName(line.c_str());
-            } else if(type == "ADDRESS") {
+               break;
+            case ECalKeyword::kAddress: {
                unsigned int tempadd = 0;
-               str >> tempadd;
+               ReadNumber(str, tempadd);
                if(tempadd == 0) {   // maybe it is in hex...
-                  std::stringstream newss;
-                  newss << std::hex << line;
-                  newss >> tempadd;
+                  tempadd = static_cast<unsigned int>(std::strtoul(line.c_str(), nullptr, 16));
                }
                tempadd = tempadd & 0x00ffffff;   // front end number is not included in the odb...
                channel->SetAddress(tempadd);
-            } else if(type == "INTEGRATION") {
+            } break;
+            case ECalKeyword::kIntegration: {
                int tempint = 0;
-               str >> tempint;
+               ReadNumber(str, tempint);
                channel->SetIntegration(TPriorityValue<int>(tempint, prio));
-            } else if(type == "NUMBER") {
+            } break;
+            case ECalKeyword::kNumber: {
                int tempnum = 0;
-               str >> tempnum;
+               ReadNumber(str, tempnum);
                channel->SetNumber(TPriorityValue<int>(tempnum, prio));
-            } else if(type == "TIMEOFFSET") {
+            } break;
+            case ECalKeyword::kTimeOffset: {
                Long64_t tempoff = 0;
-               str >> tempoff;
+               ReadNumber(str, tempoff);
                channel->SetTimeOffset(TPriorityValue<Long64_t>(tempoff, prio));
-            } else if(type == "TIMEDRIFT") {
+            } break;
+            case ECalKeyword::kTimeDrift: {
                double tempdrift = 0.;
-               str >> tempdrift;
+               ReadNumber(str, tempdrift);
                channel->SetTimeDrift(TPriorityValue<double>(tempdrift, prio));
-            } else if(type == "STREAM") {
+            } break;
+            case ECalKeyword::kStream: {
                int tempstream = 0;
-               str >> tempstream;
+               ReadNumber(str, tempstream);
                channel->SetStream(TPriorityValue<int>(tempstream, prio));
-            } else if(type == "DIGITIZER") {
+            } break;
+            case ECalKeyword::kDigitizer:
                channel->SetDigitizerType(TPriorityValue<std::string>(line, prio));
-            } else if(type == "ENGCHI2") {
-               size_t range = line.find("range");
-               if(range != std::string::npos) {
-                  line = line.substr(range + 5, line.length());
-                  trimWS(line);
-                  str.str(line);
-                  str >> range;
-               } else {
-                  range = 0;
+               break;
+            case ECalKeyword::kENGChi2: {
+               size_t range    = 0;
+               size_t rangePos = line.find("range");
+               if(rangePos != std::string::npos) {
+                  str = line.c_str() + rangePos + 5;
+                  ReadNumber(str, range);
                }
                double tempdbl = 0.;
-               str >> tempdbl;
+               ReadNumber(str, tempdbl);
                channel->SetENGChi2(TPriorityValue<double>(tempdbl, prio), range);
-            } else if(type == "CFDCHI2") {
+            } break;
+            case ECalKeyword::kCFDChi2: {
                double tempdbl = 0.;
-               str >> tempdbl;
+               ReadNumber(str, tempdbl);
                channel->SetCFDChi2(TPriorityValue<double>(tempdbl, prio));
-            } else if(type == "LEDCHI2") {
+            } break;
+            case ECalKeyword::kLEDChi2: {
                double tempdbl = 0.;
-               str >> tempdbl;
+               ReadNumber(str, tempdbl);
                channel->SetLEDChi2(TPriorityValue<double>(tempdbl, prio));
-            } else if(type == "TIMECHI2") {
+            } break;
+            case ECalKeyword::kTIMEChi2: {
                double tempdbl = 0.;
-               str >> tempdbl;
+               ReadNumber(str, tempdbl);
                channel->SetTIMEChi2(TPriorityValue<double>(tempdbl, prio));
-            } else if(type == "EFFCHI2") {
+            } break;
+            case ECalKeyword::kEFFChi2: {
                double tempdbl = 0.;
-               str >> tempdbl;
+               ReadNumber(str, tempdbl);
                channel->SetEFFChi2(TPriorityValue<double>(tempdbl, prio));
-            } else if(type == "ENGCOEFF") {
-               size_t range = line.find("range");
-               if(range != std::string::npos) {
-                  line = line.substr(range + 5, line.length());
-                  trimWS(line);
-                  str.str(line);
-                  str >> range;
-               } else {
-                  range = 0;
+            } break;
+            case ECalKeyword::kENGCoeff: {
+               size_t range    = 0;
+               size_t rangePos = line.find("range");
+               if(rangePos != std::string::npos) {
+                  str = line.c_str() + rangePos + 5;
+                  ReadNumber(str, range);
                }
                if(range == 0) {
                   channel->DestroyENGCal();
                   channel->fENGCoefficients.SetPriority(prio);
                }
                float value = 0.;
-               while(!(str >> value).fail()) {
+               while(ReadNumber(str, value)) {
                   channel->AddENGCoefficient(value, range);
                }
-            } else if(type == "ENGRANGE") {
+            } break;
+            case ECalKeyword::kENGRange: {
                size_t range = 0;
                double low   = 0.;
                double high  = 0.;
-               str >> range >> low >> high;
+               if(ReadNumber(str, range) && ReadNumber(str, low)) {
+                  ReadNumber(str, high);
+               }
                channel->SetENGRange(std::make_pair(low, high), range);
-            } else if(type == "ENGDRIFT") {
+            } break;
+            case ECalKeyword::kENGDrift: {
                channel->fENGDriftCoefficents.SetPriority(prio);
                float value = 0.;
-               while(!(str >> value).fail()) {
+               while(ReadNumber(str, value)) {
                   channel->AddENGDriftCoefficent(value);
                }
-            } else if(type == "LEDCOEFF") {
+            } break;
+            case ECalKeyword::kLEDCoeff: {
                channel->DestroyLEDCal();
                channel->fLEDCoefficients.SetPriority(prio);
                double value = 0.;
-               while(!(str >> value).fail()) {
+               while(ReadNumber(str, value)) {
                   channel->AddLEDCoefficient(value);
                }
-            } else if(type == "CFDCOEFF") {
+            } break;
+            case ECalKeyword::kCFDCoeff: {
                channel->DestroyCFDCal();
                channel->fCFDCoefficients.SetPriority(prio);
                double value = 0.;
-               while(!(str >> value).fail()) {
+               while(ReadNumber(str, value)) {
                   channel->AddCFDCoefficient(value);
                }
-            } else if(type == "TIMECOEFF" || type == "WALK") {
+            } break;
+            case ECalKeyword::kTIMECoeff: {
                channel->DestroyTIMECal();
                channel->fTIMECoefficients.SetPriority(prio);
                double value = 0.;
-               while(!(str >> value).fail()) {
+               while(ReadNumber(str, value)) {
                   channel->AddTIMECoefficient(value);
                }
-            } else if(type == "CTCOEFF") {
+            } break;
+            case ECalKeyword::kCTCoeff: {
                channel->DestroyCTCal();
                channel->fCTCoefficients.SetPriority(prio);
                double value = 0.;
-               while(!(str >> value).fail()) {
+               while(ReadNumber(str, value)) {
                   channel->AddCTCoefficient(value);
                }
-            } else if(type == "ENERGYNONLINEARITY") {
+            } break;
+            case ECalKeyword::kEnergyNonlinearity: {
                channel->DestroyEnergyNonlinearity();
                channel->fEnergyNonlinearity.SetPriority(prio);
                double x = 0.;
                double y = 0.;
-               while(!(str >> x >> y).fail()) {
+               while(ReadNumber(str, x) && ReadNumber(str, y)) {
                   channel->AddEnergyNonlinearityPoint(x, y);
                }
                channel->SetupEnergyNonlinearity();
-            } else if(type == "EFFCOEFF") {
+            } break;
+            case ECalKeyword::kEFFCoeff: {
                channel->DestroyEFFCal();
                channel->fEFFCoefficients.SetPriority(prio);
                double value = 0.;
-               while(!(str >> value).fail()) {
+               while(ReadNumber(str, value)) {
                   channel->AddEFFCoefficient(value);
                }
-            } else if(type == "FILEINT") {
+            } break;
+            case ECalKeyword::kFileInt: {
                int tempstream = 0;
-               str >> tempstream;
+               ReadNumber(str, tempstream);
                if(tempstream > 0) {
                   channel->SetUseCalFileIntegration(TPriorityValue<bool>(true, prio));
                } else {
                   channel->SetUseCalFileIntegration(TPriorityValue<bool>(false, prio));
                }
-            } else if(type == "RISETIME") {
+            } break;
+            case ECalKeyword::kRiseTime: {
                double tempdbl = 0.;
-               str >> tempdbl;
+               ReadNumber(str, tempdbl);
                channel->SetWaveRise(tempdbl);
-            } else if(type == "DECAYTIME") {
+            } break;
+            case ECalKeyword::kDecayTime: {
                double tempdbl = 0.;
-               str >> tempdbl;
+               ReadNumber(str, tempdbl);
                channel->SetWaveDecay(tempdbl);
-            } else if(type == "BASELINE") {
+            } break;
+            case ECalKeyword::kBaseLine: {
                double tempdbl = 0.;
-               str >> tempdbl;
+               ReadNumber(str, tempdbl);
                channel->SetWaveBaseLine(tempdbl);
-            } else {
+            } break;
             }
          }
       }
    }
-   if(strcmp(opt, "q") != 0) {
-      std::cout << "parsed " << linenumber << " lines." << std::endl;
+   // a channel without closing brace is incomplete
+   delete channel;
+   if(lines != nullptr) {
+      *lines = linenumber;
    }
 
-   return newchannels;
+   return channels;
 }
 
 void TChannel::Streamer(TBuffer& R__b)
@@ -1425,7 +1880,19 @@ void TChannel::Streamer(TBuffer& R__b)
          R__str.Streamer(R__b);
          fFileData.assign(R__str.Data());
       }
-      InitChannelInput();
+      if(R__v >= 7) {
+         // binary calibration with its hash
+         ULong64_t hash = 0;
+         R__b >> hash;
+         char* binary = nullptr;
+         Int_t size   = R__b.ReadArray(binary);
+         fFileBinary.assign(binary != nullptr ? binary : "", size > 0 ? size : 0);
+         InitChannelInput(hash, binary, size);
+         delete[] binary;
+      } else {
+         fFileBinary.clear();
+         InitChannelInput();
+      }
       R__b.CheckByteCount(R__s, R__c, TChannel::IsA());
    } else {   // writing to file
       R__c = R__b.WriteVersion(TChannel::IsA(), true);
@@ -1437,6 +1904,16 @@ void TChannel::Streamer(TBuffer& R__b)
          TString R__str = fFileData.c_str();
          R__str.Streamer(R__b);
       }
+      {
+         // the binary calibration was made together with fFileData (WriteCalBuffer) or read with it, so writing has no side effects
+         // without one (calibration read from an old file) the hash of the text is written, like reading an old file does
+         if(fFileBinary.empty()) {
+            R__b << CalibrationHash(fFileData.data(), fFileData.size());
+         } else {
+            R__b << CalibrationHash(fFileBinary.data(), fFileBinary.size());
+         }
+         R__b.WriteArray(fFileBinary.data(), static_cast<Int_t>(fFileBinary.size()));
+      }
       R__b.SetByteCount(R__c, true);
    }
 }
@@ -1445,6 +1922,9 @@ int TChannel::WriteToRoot(TFile* fileptr)
 {
    /// Writes Cal File information to the tree
 
+   // calibrations reloaded during the sort only went into the calibration table so far
+   TCalibrationTable::ApplyReloads();
+
    TChannel* chan = GetDefaultChannel();
    // Maintain old gDirectory info
    TDirectory* savdir = gDirectory;
@@ -1521,6 +2001,31 @@ int TChannel::WriteToRoot(TFile* fileptr)
    return GetNumberOfChannels();
 }
 
+int TChannel::WriteSnapshot(TFile* fileptr)
+{
+   /// Writes the current channels to fileptr without touching the channel maps or applying reloaded calibrations,
+   /// so it can be used while the sort is still running (e.g. when rolling over to a new output file).
+   /// Returns the number of channels written.
+   TChannel* chan = GetDefaultChannel();
+   if(chan == nullptr || fileptr == nullptr) {
+      return 0;
+   }
+   TDirectory* savdir = gDirectory;
+
+   // WriteCalBuffer replaces the buffers read from file, so we restore them afterwards
+   std::string channelbuffer = fFileData;
+   std::string binarybuffer  = fFileBinary;
+   WriteCalBuffer();
+   fileptr->cd();
+   chan->Write("Channel", TObject::kOverwrite);
+   fFileData   = channelbuffer;
+   fFileBinary = binarybuffer;
+
+   savdir->cd();
+
+   return GetNumberOfChannels();
+}
+
 int TChannel::GetDetectorNumber() const
 {
    if(fDetectorNumber > -1) {   //||fDetectorNumber==0x0fffffff)
@@ -1607,6 +2112,9 @@ void TChannel::ReadEnergyNonlinearities(TFile* file, const char* graphName, bool
          AddChannel(newChannel);
       }
    }
+   CalibrationChanged();
+   // compile the nonlinearities into the calibration table right away instead of on the first hit
+   TCalibrationTable::Get();
 }
 
 void TChannel::SetDigitizerType(const TPriorityValue<std::string>& tmp)
@@ -1614,6 +2122,7 @@ void TChannel::SetDigitizerType(const TPriorityValue<std::string>& tmp)
    fDigitizerTypeString = tmp;
    if(fMnemonic.Value() != nullptr) {
       fMnemonic.Value()->EnumerateDigitizer(fDigitizerTypeString, fDigitizerType, fTimeStampUnit);
+      Changed();
    } else {
       std::cerr << __PRETTY_FUNCTION__ << ": mnemonic not set, can't set digitizer type and timestamp unit from " << fDigitizerTypeString << std::endl;   // NOLINT(cppcoreguidelines-pro-type-const-cast, cppcoreguidelines-pro-bounds-array-to-pointer-decay)
    }
@@ -26,6 +26,7 @@ void TDetector::Copy(TObject& rhs) const
    // if(!rhs.InheritsFrom("TDetector"))
    //   return;
    TObject::Copy(rhs);
+   ++static_cast<TDetector&>(rhs).fGeneration;
    static_cast<TDetector&>(rhs).fHits.resize(fHits.size());
    for(size_t i = 0; i < fHits.size(); ++i) {
       // we need to use IsA()->New() to make a new hit of whatever derived type this actually is
@@ -53,11 +54,20 @@ void TDetector::Print(std::ostream& out) const
 
 void TDetector::ClearTransients()
 {
+   ++fGeneration;
    for(auto* hit : fHits) {
       hit->ClearTransients();
    }
 }
 
+void TDetector::Calibrate()
+{
+   /// Calibrates all hits, see TDetectorHit::Calibrate.
+   for(auto* hit : fHits) {
+      hit->Calibrate();
+   }
+}
+
 TDetectorHit* TDetector::GetHit(const int& index) const
 {
    try {
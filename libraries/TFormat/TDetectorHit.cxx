@@ -1,5 +1,6 @@
 #include "TDetectorHit.h"
 #include "TGRSIOptions.h"
+#include "TCalibrationTable.h"
 
 #include <iostream>
 
@@ -47,12 +48,25 @@ Double_t TDetectorHit::GetTime(const ETimeFlag&, Option_t*) const
    if(IsTimeSet()) {
       return fTime;
    }
-   TChannel* tmpChan = GetChannel();
-   if(tmpChan == nullptr) {
-      return SetTime(static_cast<Double_t>(static_cast<double>(GetTimeStamp()) + gRandom->Uniform()));
+   // GetEnergy can switch this thread to a newer calibration table, so we only look up the calibration afterwards
+   double      energy = GetEnergy();
+   const auto* cal    = TCalibrationTable::Get().Find(fAddress);
+   if(cal == nullptr) {
+      return SetTime(static_cast<Double_t>(static_cast<double>(GetTimeStamp()) + TDither::Uniform(static_cast<uint64_t>(GetTimeStamp()), fAddress, EDither::kTime)));
    }
 
-   return SetTime(tmpChan->GetTime(GetTimeStamp(), GetCfd(), GetEnergy()));
+   // same as TChannel::GetTime, but without the lookup of the channel
+   return SetTime(cal->fMnemonic->GetTime(GetTimeStamp(), GetCfd(), energy, cal->fChannel));
+}
+
+void TDetectorHit::Calibrate()
+{
+   /// Looks up the channel and calculates the energy and time of the hit once, storing them in the hit.
+   /// After this the const getters only read the stored values instead of lazily setting them, so the
+   /// hit can be read by several threads at once.
+   GetChannel();
+   GetEnergy();
+   GetTime();
 }
 
 Float_t TDetectorHit::GetCharge() const
@@ -75,31 +89,34 @@ double TDetectorHit::GetEnergy(Option_t*) const
    if(TestHitBit(EBitFlag::kIsEnergySet)) {
       return fEnergy;
    }
-   TChannel* channel = GetChannel();
-   if(channel == nullptr) {
+   // the compiled calibration table gives the same results as the TChannel calibration functions
+   const auto& table = TCalibrationTable::Get();
+   const auto* cal   = table.Find(fAddress);
+   if(cal == nullptr) {
       return SetEnergy(static_cast<Double_t>(Charge()));
    }
-   if(channel->UseCalFileIntegration()) {
-      double energy = channel->CalibrateENG(Charge(), 0);
+   if(cal->fUseCalFileIntegration) {
+      double energy = table.CalibrateEnergy(*cal, Charge(), 0);
       return SetEnergy(energy +
                        GetEnergyNonlinearity(energy));   // this will use the integration value
                                                          // in the TChannel if it exists.
    }
    if(fKValue > 0) {
-      double energy = channel->CalibrateENG(Charge(), static_cast<int>(fKValue));
+      double energy = table.CalibrateEnergy(*cal, Charge(), static_cast<int>(fKValue));
       return SetEnergy(energy + GetEnergyNonlinearity(energy));
    }
-   double energy = channel->CalibrateENG(Charge());
+   double energy = table.CalibrateEnergy(*cal, Charge());
    return SetEnergy(energy + GetEnergyNonlinearity(energy));
 }
 
 Double_t TDetectorHit::GetEnergyNonlinearity(double energy) const
 {
-   TChannel* channel = GetChannel();
-   if(channel == nullptr) {
+   const auto& table = TCalibrationTable::Get();
+   const auto* cal   = table.Find(fAddress);
+   if(cal == nullptr) {
       return 0.;
    }
-   return -(channel->GetEnergyNonlinearity(energy));
+   return -(table.EnergyNonlinearity(*cal, energy));
 }
 
 void TDetectorHit::Copy(TObject& rhs) const
@@ -0,0 +1,134 @@
+#include "TDither.h"
+
+#include <array>
+#include <atomic>
+
+namespace {
+std::atomic<bool>     gDitherEnabled{true};
+std::atomic<uint64_t> gDitherSeed{0x5eed5eed5eed5eedULL};
+std::atomic<uint32_t> gDitherStreams{0};   ///< number of threads that have drawn from their own sequence
+
+/// State of the current thread, the scope set by TDither::TScope and the fallback sequence
+struct TDitherState {
+   bool     fScoped{false};
+   Long64_t fEntry{0};
+   UInt_t   fAddress{0};
+   uint32_t fDraw{0};
+   bool     fHasStream{false};
+   uint32_t fStream{0};
+   uint64_t fStreamCounter{0};
+};
+
+thread_local TDitherState gDitherState;
+
+inline void MulHiLo(uint32_t a, uint32_t b, uint32_t& hi, uint32_t& lo)
+{
+   uint64_t product = static_cast<uint64_t>(a) * static_cast<uint64_t>(b);
+   hi               = static_cast<uint32_t>(product >> 32);
+   lo               = static_cast<uint32_t>(product);
+}
+}   // namespace
+
+TDither::TScope::TScope(Long64_t entry, UInt_t address)
+   : fWasScoped(gDitherState.fScoped), fEntry(gDitherState.fEntry), fAddress(gDitherState.fAddress), fDraw(gDitherState.fDraw)
+{
+   gDitherState.fScoped  = true;
+   gDitherState.fEntry   = entry;
+   gDitherState.fAddress = address;
+   gDitherState.fDraw    = 0;
+}
+
+TDither::TScope::~TScope()
+{
+   // restore the previous scope, so scopes can be nested
+   gDitherState.fScoped  = fWasScoped;
+   gDitherState.fEntry   = fEntry;
+   gDitherState.fAddress = fAddress;
+   gDitherState.fDraw    = fDraw;
+}
+
+void TDither::SetEnabled(bool val)
+{
+   gDitherEnabled = val;
+}
+
+bool TDither::Enabled()
+{
+   return gDitherEnabled;
+}
+
+void TDither::SetSeed(uint64_t seed)
+{
+   gDitherSeed = seed;
+}
+
+uint64_t TDither::Seed()
+{
+   return gDitherSeed;
+}
+
+std::array<uint32_t, 4> TDither::Philox4x32(std::array<uint32_t, 4> counter, std::array<uint32_t, 2> key)
+{
+   /// Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3", SC11) of the 128 bit counter
+   /// with the 64 bit key.
+   static constexpr uint32_t kMultiplier0 = 0xD2511F53;
+   static constexpr uint32_t kMultiplier1 = 0xCD9E8D57;
+   static constexpr uint32_t kWeyl0       = 0x9E3779B9;
+   static constexpr uint32_t kWeyl1       = 0xBB67AE85;
+
+   for(int round = 0; round < 10; ++round) {
+      uint32_t hi0 = 0;
+      uint32_t lo0 = 0;
+      uint32_t hi1 = 0;
+      uint32_t lo1 = 0;
+      MulHiLo(kMultiplier0, counter[0], hi0, lo0);
+      MulHiLo(kMultiplier1, counter[2], hi1, lo1);
+      counter = {hi1 ^ counter[1] ^ key[0], lo1, hi0 ^ counter[3] ^ key[1], lo0};
+      key[0] += kWeyl0;
+      key[1] += kWeyl1;
+   }
+
+   return counter;
+}
+
+double TDither::Philox(uint64_t counterLow, uint32_t counterHigh0, uint32_t counterHigh1)
+{
+   /// Philox4x32-10 of the 128 bit counter made up of the arguments, keyed with the seed.
+   /// Returns a uniform number in [0, 1) with 53 random bits.
+   uint64_t seed   = gDitherSeed.load(std::memory_order_relaxed);
+   auto     result = Philox4x32({static_cast<uint32_t>(counterLow), static_cast<uint32_t>(counterLow >> 32), counterHigh0, counterHigh1},
+                                {static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)});
+
+   static constexpr double kTwoToMinus53 = 1.1102230246251565e-16;
+
+   uint64_t bits = (static_cast<uint64_t>(result[0]) << 32) | result[1];
+   return static_cast<double>(bits >> 11) * kTwoToMinus53;
+}
+
+double TDither::Uniform(uint64_t key, UInt_t address, EDither purpose, uint32_t draw)
+{
+   /// Returns a uniform random number in [0, 1) that only depends on the seed and the arguments.
+   if(!gDitherEnabled.load(std::memory_order_relaxed)) {
+      return 0.;
+   }
+   return Philox(key, address, (static_cast<uint32_t>(purpose) << 24) | (draw & 0xffffff));
+}
+
+double TDither::Uniform(EDither purpose)
+{
+   /// Returns a uniform random number in [0, 1). Inside a TScope it is determined by the entry number,
+   /// address, and the number of draws so far within the scope, otherwise it is the next number of the
+   /// sequence of this thread.
+   if(!gDitherEnabled.load(std::memory_order_relaxed)) {
+      return 0.;
+   }
+   if(gDitherState.fScoped) {
+      return Uniform(static_cast<uint64_t>(gDitherState.fEntry), gDitherState.fAddress, purpose, gDitherState.fDraw++);
+   }
+   if(!gDitherState.fHasStream) {
+      gDitherState.fStream    = gDitherStreams++;
+      gDitherState.fHasStream = true;
+   }
+   // the 0xff purpose can't be reached by the keyed numbers, so the sequences never overlap with those
+   return Philox(gDitherState.fStreamCounter++, gDitherState.fStream, (0xffU << 24) | static_cast<uint32_t>(purpose));
+}
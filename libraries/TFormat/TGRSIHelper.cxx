@@ -49,7 +49,8 @@ TGRSIHelper::TGRSIHelper(TList* input)
             }
             auto* tmpCut = static_cast<TCutG*>(key->ReadObj());
             if(tmpCut != nullptr) {
-               fCuts[tmpCut->GetName()] = tmpCut;
+               fCuts[tmpCut->GetName()] = new GCutG(*tmpCut);
+               delete tmpCut;
             }
          }
       } else {
@@ -81,6 +82,7 @@ void TGRSIHelper::Setup()
       fCube.emplace_back(TGRSIMap<std::string, GCube*>());
       fTree.emplace_back(TGRSIMap<std::string, TTree*>());
       fObject.emplace_back(TGRSIMap<std::string, TObject*>());
+      fMixing.emplace_back(fMixingDepth, fMixingSelection);
       CreateHistograms(i);
       for(auto& it : fH1[i]) {
          // if the key/name of the histogram does not contain a forward slash we put it in the root-directory
@@ -113,6 +115,10 @@ void TGRSIHelper::Setup()
          }
       }
       for(auto& it : fSym[i]) {
+         // shared histograms are only added to the list of the first slot
+         if(i > 0 && it.second->IsShared()) {
+            continue;
+         }
          // if the key/name of the histogram does not contain a forward slash we put it in the root-directory
          if(it.first.find_last_of('/') == std::string::npos) {
             (*fLists[i])[""].Add(it.second);
@@ -123,6 +129,10 @@ void TGRSIHelper::Setup()
          }
       }
       for(auto& it : fCube[i]) {
+         // shared histograms are only added to the list of the first slot
+         if(i > 0 && it.second->IsShared()) {
+            continue;
+         }
          // if the key/name of the histogram does not contain a forward slash we put it in the root-directory
          if(it.first.find_last_of('/') == std::string::npos) {
             (*fLists[i])[""].Add(it.second);
@@ -154,6 +164,14 @@ void TGRSIHelper::Setup()
 void TGRSIHelper::Finalize()
 {
    /// This function merges all maps of lists into the map of the first slot (slot 0)
+   // add the remaining buffered fills of all slots to the shared histograms
+   for(auto& shared : fShared) {
+      if(shared.second->InheritsFrom(GHSym::Class())) {
+         static_cast<GHSym*>(shared.second)->SetShared(false);
+      } else {
+         static_cast<GCube*>(shared.second)->SetShared(false);
+      }
+   }
    CheckSizes(0, "write");
    // get all objects from the first slot
    auto& res = fLists[0];
@@ -166,6 +184,10 @@ void TGRSIHelper::Finalize()
       for(const auto& list : *res) {
          // loop over each object in the list
          for(const auto&& obj : list.second) {
+            // shared histograms are the same object in all slots, so there's nothing to merge
+            if(IsShared(obj)) {
+               continue;
+            }
             // check if object exists in the slot's list
             if((*fLists[slot]).at(list.first).FindObject(obj->GetName()) != nullptr) {
                // check object type and merge correspondingly
@@ -212,9 +234,20 @@ void TGRSIHelper::Finalize()
    EndOfSort(res);
 }
 
+bool TGRSIHelper::IsShared(const TObject* obj) const
+{
+   for(const auto& shared : fShared) {
+      if(shared.second == obj) {
+         return true;
+      }
+   }
+   return false;
+}
+
 void TGRSIHelper::CheckSizes(unsigned int slot, const char* usage)
 {
    /// check size of each object in the output list
+   /// (GCubeF and GCubeD write content that is too large for one key in chunks, so only their header counts here)
    // loop over each TList in the map
    for(auto& list : *fLists[slot]) {
       // loop over each object in the list
@@ -64,11 +64,39 @@ void trimWS(std::string& line)
    line.erase(std::find_if(line.rbegin(), line.rend(), [](int ch) { return std::isspace(ch) == 0; }).base(), line.end());
 }
 
-int GetRunNumber(const std::string& fileName)
+namespace {
+std::size_t ExtensionPosition(const std::string& fileName)
 {
-   if(fileName.length() == 0) {
+   /// Returns the position of the dot starting the extension of the file name, npos if there is none.
+   std::size_t dotPos   = fileName.rfind('.');
+   std::size_t slashPos = fileName.rfind('/');
+   if(dotPos == std::string::npos || (slashPos != std::string::npos && dotPos < slashPos)) {
+      return std::string::npos;
+   }
+   return dotPos;
+}
+
+std::size_t RollIndexPosition(const std::string& fileName, std::size_t dotPos)
+{
+   /// Returns the position of the dot starting the roll index (".<digits>") in front of the extension, npos if there is none.
+   if(dotPos == std::string::npos || dotPos == 0) {
+      return std::string::npos;
+   }
+   std::size_t indexPos = fileName.find_last_not_of("0123456789", dotPos - 1);
+   if(indexPos == std::string::npos || indexPos + 1 == dotPos || fileName[indexPos] != '.') {
+      return std::string::npos;
+   }
+   return indexPos;
+}
+}   // namespace
+
+int GetRunNumber(const std::string& name)
+{
+   if(name.length() == 0) {
       return 0;
    }
+   std::string fileName = RemoveRollIndex(name);
+
    std::size_t found = fileName.rfind(".root");
    if(found == std::string::npos) {
       return 0;
@@ -87,11 +115,12 @@ int GetRunNumber(const std::string& fileName)
    return atoi(temp.c_str());
 }
 
-int GetSubRunNumber(const std::string& fileName)
+int GetSubRunNumber(const std::string& name)
 {
-   if(fileName.length() == 0) {
+   if(name.length() == 0) {
       return -1;
    }
+   std::string fileName = RemoveRollIndex(name);
 
    std::size_t found = fileName.rfind('-');
    if(found != std::string::npos) {
@@ -105,3 +134,41 @@ int GetSubRunNumber(const std::string& fileName)
    }
    return -1;
 }
+
+std::string RolledFileName(const std::string& fileName, size_t index)
+{
+   /// Returns the name of the index'th file when rolling over output files.
+   /// The first file (index 0) keeps the original name, all others get ".<index>" inserted before the extension
+   /// (e.g. fragment12345_000.root, fragment12345_000.1.root, ...), so GetRunNumber and GetSubRunNumber
+   /// still find the run and sub-run number, and GetRollIndex returns the index.
+   if(index == 0) {
+      return fileName;
+   }
+   std::size_t dotPos = ExtensionPosition(fileName);
+   if(dotPos == std::string::npos) {
+      return fileName + "." + std::to_string(index);
+   }
+   return fileName.substr(0, dotPos) + "." + std::to_string(index) + fileName.substr(dotPos);
+}
+
+size_t GetRollIndex(const std::string& fileName)
+{
+   /// Returns the index RolledFileName added to this file name, 0 if there is none.
+   std::size_t dotPos   = ExtensionPosition(fileName);
+   std::size_t indexPos = RollIndexPosition(fileName, dotPos);
+   if(indexPos == std::string::npos) {
+      return 0;
+   }
+   return std::stoul(fileName.substr(indexPos + 1, dotPos - indexPos - 1));
+}
+
+std::string RemoveRollIndex(const std::string& fileName)
+{
+   /// Returns the file name without the index RolledFileName added to it.
+   std::size_t dotPos   = ExtensionPosition(fileName);
+   std::size_t indexPos = RollIndexPosition(fileName, dotPos);
+   if(indexPos == std::string::npos) {
+      return fileName;
+   }
+   return fileName.substr(0, indexPos) + fileName.substr(dotPos);
+}
@@ -156,5 +156,6 @@ TClass* TMnemonic::GetClassType() const
 
 double TMnemonic::GetTime(Long64_t timestamp, Float_t, double, const TChannel* channel) const
 {
-   return (static_cast<double>(timestamp) + gRandom->Uniform()) * static_cast<double>(channel->GetTimeStampUnit());
+   // the dithering is keyed on the timestamp and address, so the same hit always gets the same time
+   return (static_cast<double>(timestamp) + TDither::Uniform(static_cast<uint64_t>(timestamp), channel->GetAddress(), EDither::kTime)) * static_cast<double>(channel->GetTimeStampUnit());
 }
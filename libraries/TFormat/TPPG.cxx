@@ -53,6 +53,8 @@ void TPPGData::Print(Option_t*) const
    std::cout << "time: " << std::setw(7) << GetTimeStamp() << "\t PPG Status: " << hex(static_cast<std::underlying_type<EPpgPattern>::type>(fNewPpg), 7) << "\t Old: " << hex(static_cast<std::underlying_type<EPpgPattern>::type>(fOldPpg), 7) << std::endl;
 }
 
+std::mutex TPPG::fMutex;
+
 TPPG::TPPG()
    : fPPGStatusMap(new PPGMap_t)
 {
@@ -92,7 +94,10 @@ TPPG& TPPG::operator=(const TPPG& rhs)
 
 void TPPG::Copy(TObject& obj) const
 {
+   /// Copies the PPG to obj. This can be used to take a snapshot of the PPG while data is being added to it.
    static_cast<TPPG&>(obj).Clear();
+   // Clear adds the default data point itself, so we only lock after clearing the copy
+   std::lock_guard<std::mutex> lock(fMutex);
    static_cast<TPPG&>(obj).fCycleLength          = fCycleLength;
    static_cast<TPPG&>(obj).fNumberOfCycleLengths = fNumberOfCycleLengths;
 
@@ -100,7 +105,7 @@ void TPPG::Copy(TObject& obj) const
    if(static_cast<TPPG&>(obj).fPPGStatusMap != nullptr && fPPGStatusMap != nullptr) {
       for(auto& ppgit : *fPPGStatusMap) {
          if(ppgit.second != nullptr) {
-            static_cast<TPPG&>(obj).AddData(ppgit.second);
+            static_cast<TPPG&>(obj).InsertData(ppgit.second);
          }
       }
       static_cast<TPPG&>(obj).fCurrIterator = static_cast<TPPG&>(obj).fPPGStatusMap->begin();
@@ -122,6 +127,13 @@ void TPPG::AddData(TPPGData* pat)
 {
    /// Adds a PPG status word at a given time in the current run. Makes a copy of the pointer to
    /// store in the map.
+   std::lock_guard<std::mutex> lock(fMutex);
+   InsertData(pat);
+}
+
+void TPPG::InsertData(const TPPGData* pat)
+{
+   /// Same as AddData, without locking.
    fPPGStatusMap->insert(std::make_pair(pat->GetTimeStamp(), new TPPGData(*pat)));
    fCycleLength = 0;
    fCycleSet    = false;
@@ -1,9 +1,12 @@
 #include "TParsingDiagnostics.h"
 
+#include <algorithm>
 #include <fstream>
 
 #include "TChannel.h"
 
+std::mutex TParsingDiagnostics::fMutex;
+
 TParsingDiagnosticsData::TParsingDiagnosticsData() = default;
 
 TParsingDiagnosticsData::TParsingDiagnosticsData(const std::shared_ptr<const TFragment>& frag)
@@ -66,22 +69,31 @@ TParsingDiagnostics::~TParsingDiagnostics()
 
 void TParsingDiagnostics::Copy(TObject& obj) const
 {
-   static_cast<TParsingDiagnostics&>(obj).fPPGCycleLength         = fPPGCycleLength;
-   static_cast<TParsingDiagnostics&>(obj).fNumberOfGoodFragments  = fNumberOfGoodFragments;
-   static_cast<TParsingDiagnostics&>(obj).fNumberOfBadFragments   = fNumberOfBadFragments;
-   static_cast<TParsingDiagnostics&>(obj).fChannelAddressData     = fChannelAddressData;
-   static_cast<TParsingDiagnostics&>(obj).fMinNetworkPacketNumber = fMinNetworkPacketNumber;
-   static_cast<TParsingDiagnostics&>(obj).fMaxNetworkPacketNumber = fMaxNetworkPacketNumber;
-   static_cast<TParsingDiagnostics&>(obj).fNumberOfNetworkPackets = fNumberOfNetworkPackets;
+   /// Copies the diagnostics to obj. This can be used to take a snapshot of the diagnostics while fragments are being counted.
+   std::lock_guard<std::mutex> lock(fMutex);
+   static_cast<TParsingDiagnostics&>(obj).fPPGCycleLength            = fPPGCycleLength;
+   static_cast<TParsingDiagnostics&>(obj).fNumberOfGoodFragments     = fNumberOfGoodFragments;
+   static_cast<TParsingDiagnostics&>(obj).fNumberOfBadFragments      = fNumberOfBadFragments;
+   static_cast<TParsingDiagnostics&>(obj).fFilterNames               = fFilterNames;
+   static_cast<TParsingDiagnostics&>(obj).fNumberOfFilteredFragments = fNumberOfFilteredFragments;
+   static_cast<TParsingDiagnostics&>(obj).fChannelAddressData        = fChannelAddressData;
+   static_cast<TParsingDiagnostics&>(obj).fMinDaqTimeStamp           = fMinDaqTimeStamp;
+   static_cast<TParsingDiagnostics&>(obj).fMaxDaqTimeStamp           = fMaxDaqTimeStamp;
+   static_cast<TParsingDiagnostics&>(obj).fMinNetworkPacketNumber    = fMinNetworkPacketNumber;
+   static_cast<TParsingDiagnostics&>(obj).fMaxNetworkPacketNumber    = fMaxNetworkPacketNumber;
+   static_cast<TParsingDiagnostics&>(obj).fNumberOfNetworkPackets    = fNumberOfNetworkPackets;
 }
 
 void TParsingDiagnostics::Clear(Option_t*)
 {
+   std::lock_guard<std::mutex> lock(fMutex);
    delete fIdHist;
    fIdHist         = nullptr;
    fPPGCycleLength = 0;
    fNumberOfGoodFragments.clear();
    fNumberOfBadFragments.clear();
+   // the filters keep the indices returned by AddFilter, so only the counters are reset
+   std::fill(fNumberOfFilteredFragments.begin(), fNumberOfFilteredFragments.end(), 0);
    fMinDaqTimeStamp        = 0;
    fMaxDaqTimeStamp        = 0;
    fMinNetworkPacketNumber = 0x7fffffff;   // just a large number
@@ -111,6 +123,9 @@ void TParsingDiagnostics::Print(Option_t*) const
       }
       std::cout << " bad fragments." << std::endl;
    }
+   for(size_t i = 0; i < fFilterNames.size(); ++i) {
+      std::cout << std::setw(12) << fNumberOfFilteredFragments[i] << " fragments rejected by " << fFilterNames[i] << " filter." << std::endl;
+   }
    for(const auto& iter : fChannelAddressData) {
       iter.second.Print(iter.first);
    }
@@ -119,6 +134,7 @@ void TParsingDiagnostics::Print(Option_t*) const
 void TParsingDiagnostics::GoodFragment(const std::shared_ptr<const TFragment>& frag)
 {
    /// increment the counter of good fragments for this detector type and check if any trigger ids have been lost
+   std::lock_guard<std::mutex> lock(fMutex);
    fNumberOfGoodFragments[frag->GetDetectorType()]++;
 
    UInt_t channelAddress = frag->GetAddress();
@@ -147,6 +163,49 @@ void TParsingDiagnostics::GoodFragment(const std::shared_ptr<const TFragment>& f
    }
 }
 
+void TParsingDiagnostics::GoodFragment(Short_t detType)
+{
+   std::lock_guard<std::mutex> lock(fMutex);
+   fNumberOfGoodFragments[detType]++;
+}
+
+void TParsingDiagnostics::BadFragment(Short_t detType)
+{
+   std::lock_guard<std::mutex> lock(fMutex);
+   fNumberOfBadFragments[detType]++;
+}
+
+void TParsingDiagnostics::FilteredFragment(size_t filterIndex)
+{
+   std::lock_guard<std::mutex> lock(fMutex);
+   ++fNumberOfFilteredFragments[filterIndex];
+}
+
+size_t TParsingDiagnostics::AddFilter(const std::string& name)
+{
+   /// Returns the index of the filter with this name, adding it if it doesn't exist yet.
+   /// This index is then used with FilteredFragment to count the fragments rejected by this filter.
+   std::lock_guard<std::mutex> lock(fMutex);
+   for(size_t i = 0; i < fFilterNames.size(); ++i) {
+      if(fFilterNames[i] == name) {
+         return i;
+      }
+   }
+   fFilterNames.push_back(name);
+   fNumberOfFilteredFragments.push_back(0);
+   return fFilterNames.size() - 1;
+}
+
+Long_t TParsingDiagnostics::NumberOfFilteredFragments(const std::string& name) const
+{
+   for(size_t i = 0; i < fFilterNames.size(); ++i) {
+      if(fFilterNames[i] == name) {
+         return fNumberOfFilteredFragments[i];
+      }
+   }
+   return 0;
+}
+
 void TParsingDiagnostics::ReadPPG(TPPG* ppg)
 {
    /// store different TPPG diagnostics like cycle length, length of each state, offset, how often each state was found
@@ -208,6 +267,14 @@ void TParsingDiagnostics::WriteToFile(const char* fileName) const
    }
    statsOut << std::endl;
 
+   if(!fFilterNames.empty()) {
+      statsOut << "Filtered fragments:";
+      for(size_t i = 0; i < fFilterNames.size(); ++i) {
+         statsOut << " " << fNumberOfFilteredFragments[i] << " by " << fFilterNames[i] << " filter";
+      }
+      statsOut << std::endl;
+   }
+
    for(const auto& iter : fChannelAddressData) {
       TChannel* chan = TChannel::GetChannel(iter.first, false);
       if(chan == nullptr) {
@@ -6,6 +6,8 @@
 #include "TChannel.h"
 #include "TGRSIOptions.h"
 
+std::mutex TSortingDiagnostics::fMutex;
+
 TSortingDiagnostics::TSortingDiagnostics()
 {
    Clear();
@@ -13,20 +15,32 @@ TSortingDiagnostics::TSortingDiagnostics()
 
 void TSortingDiagnostics::Copy(TObject& obj) const
 {
+   std::lock_guard<std::mutex> lock(fMutex);
    static_cast<TSortingDiagnostics&>(obj).fFragmentsOutOfOrder     = fFragmentsOutOfOrder;
    static_cast<TSortingDiagnostics&>(obj).fFragmentsOutOfTimeOrder = fFragmentsOutOfTimeOrder;
+   static_cast<TSortingDiagnostics&>(obj).fPreviousTimeStamps      = fPreviousTimeStamps;
+   static_cast<TSortingDiagnostics&>(obj).fPreviousTimes           = fPreviousTimes;
+   static_cast<TSortingDiagnostics&>(obj).fMaxEntryDiff            = fMaxEntryDiff;
+   static_cast<TSortingDiagnostics&>(obj).fMissingChannels         = fMissingChannels;
    static_cast<TSortingDiagnostics&>(obj).fMissingDetectorClasses  = fMissingDetectorClasses;
+   static_cast<TSortingDiagnostics&>(obj).fHitsRemoved             = fHitsRemoved;
 }
 
 void TSortingDiagnostics::Clear(Option_t*)
 {
+   std::lock_guard<std::mutex> lock(fMutex);
+   // the previous times and time stamps are kept, they are needed to find how far back out of order fragments belong
    fFragmentsOutOfOrder.clear();
    fFragmentsOutOfTimeOrder.clear();
+   fMaxEntryDiff = 0;
+   fMissingChannels.clear();
    fMissingDetectorClasses.clear();
+   fHitsRemoved.clear();
 }
 
 void TSortingDiagnostics::OutOfTimeOrder(double newFragTime, double oldFragTime, int64_t newEntry)
 {
+   std::lock_guard<std::mutex> lock(fMutex);
    fFragmentsOutOfTimeOrder[oldFragTime] = std::make_pair(oldFragTime - newFragTime, newEntry);
    // try and find a time before newFragTime
    size_t entry = 0;
@@ -45,6 +59,7 @@ void TSortingDiagnostics::OutOfTimeOrder(double newFragTime, double oldFragTime,
 
 void TSortingDiagnostics::OutOfOrder(int64_t newFragTS, int64_t oldFragTS, int64_t newEntry)
 {
+   std::lock_guard<std::mutex> lock(fMutex);
    fFragmentsOutOfOrder[oldFragTS] = std::make_pair(oldFragTS - newFragTS, newEntry);
    // try and find a timestamp before newFragTS
    size_t entry = 0;
@@ -61,8 +76,21 @@ void TSortingDiagnostics::OutOfOrder(int64_t newFragTS, int64_t oldFragTS, int64
    }
 }
 
+void TSortingDiagnostics::AddTime(double val)
+{
+   std::lock_guard<std::mutex> lock(fMutex);
+   fPreviousTimes.push_back(val);
+}
+
+void TSortingDiagnostics::AddTimeStamp(Long_t val)
+{
+   std::lock_guard<std::mutex> lock(fMutex);
+   fPreviousTimeStamps.push_back(val);
+}
+
 void TSortingDiagnostics::MissingChannel(const UInt_t& address)
 {
+   std::lock_guard<std::mutex> lock(fMutex);
    if(fMissingChannels.find(address) != fMissingChannels.end()) {
       ++(fMissingChannels[address]);
    } else {
@@ -72,6 +100,7 @@ void TSortingDiagnostics::MissingChannel(const UInt_t& address)
 
 void TSortingDiagnostics::AddDetectorClass(TChannel* channel)
 {
+   std::lock_guard<std::mutex> lock(fMutex);
    if(fMissingDetectorClasses.find(channel->GetClassType()) != fMissingDetectorClasses.end()) {
       ++(fMissingDetectorClasses[channel->GetClassType()]);
    } else {
@@ -153,6 +182,7 @@ void TSortingDiagnostics::WriteToFile(const char* fileName) const
 
 void TSortingDiagnostics::RemovedHits(TClass* detClass, int64_t removed, int64_t total)
 {
+   std::lock_guard<std::mutex> lock(fMutex);
    if(fHitsRemoved.find(detClass) == fHitsRemoved.end()) {
       fHitsRemoved[detClass] = std::make_pair(removed, total);
    } else {
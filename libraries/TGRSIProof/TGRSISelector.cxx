@@ -27,6 +27,7 @@
 #include "TGRSISelector.h"
 #include "GValue.h"
 #include "TParserLibrary.h"
+#include "TDither.h"
 
 #include "TBufferFile.h"
 #include "TSystem.h"
@@ -184,13 +185,17 @@ Bool_t TGRSISelector::Process(Long64_t entry)
    /// The return value is currently not used
 
    static TFile* current_file = nullptr;
+   static UInt_t file_key     = 0;
    if(current_file != fChain->GetCurrentFile()) {
       current_file = fChain->GetCurrentFile();
+      file_key     = TString(current_file->GetName()).Hash();
       std::cout << "Starting to sort: " << current_file->GetName() << std::endl;
       TChannel::ReadCalFromFile(current_file);
       TGRSIOptions::AnalysisOptions()->ReadFromFile(current_file);
    }
 
+   // any dithering for this entry is keyed on the entry number and file, independent of which worker processes it
+   TDither::TScope ditherScope(entry, file_key);
    fChain->GetEntry(entry);
    fEntry = entry;
    try {
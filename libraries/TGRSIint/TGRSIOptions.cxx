@@ -99,11 +99,24 @@ void TGRSIOptions::Clear(Option_t*)
 
    fFragmentWriteQueueSize = 100000;
    fAnalysisWriteQueueSize = 100000;
+   fHistogramThreads       = 1;
+
+   fRollFileSize    = 0;
+   fRollFileEntries = 0;
+   fRollFileMinutes = 0.;
 
    fNumberOfEvents = 0;
 
    fIgnoreMissingChannel = false;
    fSkipInputSort        = false;
+   fTriggerIdWindow      = 65536;
+
+   fKeepAddresses.clear();
+   fKeepMnemonics.clear();
+   fKeepDetectorTypes.clear();
+   fKeepMinCharge = std::numeric_limits<double>::lowest();
+   fKeepWaveform  = -1;
+   fBuildDetectors.clear();
 
    fSeparateOutOfOrder = false;
 
@@ -170,10 +183,23 @@ void TGRSIOptions::Print(Option_t*) const
              << std::endl
              << "fFragmentWriteQueueSize: " << fFragmentWriteQueueSize << std::endl
              << "fAnalysisWriteQueueSize: " << fAnalysisWriteQueueSize << std::endl
+             << "fHistogramThreads: " << fHistogramThreads << std::endl
+             << std::endl
+             << "fRollFileSize: " << fRollFileSize << std::endl
+             << "fRollFileEntries: " << fRollFileEntries << std::endl
+             << "fRollFileMinutes: " << fRollFileMinutes << std::endl
              << std::endl
              << "fIgnoreMissingChannel: " << fIgnoreMissingChannel << std::endl
              << "fSkipInputSort: " << fSkipInputSort << std::endl
              << "fSortDepth: " << fSortDepth << std::endl
+             << "fTriggerIdWindow: " << fTriggerIdWindow << std::endl
+             << std::endl
+             << "fKeepAddresses: " << fKeepAddresses.size() << std::endl
+             << "fKeepMnemonics: " << fKeepMnemonics.size() << std::endl
+             << "fKeepDetectorTypes: " << fKeepDetectorTypes.size() << std::endl
+             << "fKeepMinCharge: " << fKeepMinCharge << std::endl
+             << "fKeepWaveform: " << fKeepWaveform << std::endl
+             << "fBuildDetectors: " << fBuildDetectors.size() << std::endl
              << std::endl
              << "fSeparateOutOfOrder: " << fSeparateOutOfOrder << std::endl
              << std::endl
@@ -298,6 +324,22 @@ void TGRSIOptions::Load(int argc, char** argv)
       parser.option("sort-depth", &fSortDepth, true)
          .description("Number of events to hold when sorting by time/trigger_id")
          .default_value(200000);
+      parser.option("trigger-id-window", &fTriggerIdWindow, true)
+         .description("Number of trigger IDs for which the number of fragments is kept track of (rounded up to a power of 2)")
+         .default_value(65536);
+      parser.option("keep-address", &fKeepAddresses, true)
+         .description("Only keep fragments from these addresses or address ranges, e.g. 0x0000-0x00ff 0x1000");
+      parser.option("keep-mnemonic", &fKeepMnemonics, true)
+         .description("Only keep fragments from channels whose name matches these regular expressions, e.g. GRG.* GRS.*");
+      parser.option("keep-detector-type", &fKeepDetectorTypes, true)
+         .description("Only keep fragments of these detector types");
+      parser.option("keep-min-charge", &fKeepMinCharge, true)
+         .description("Only keep fragments with at least this charge");
+      parser.option("keep-waveform", &fKeepWaveform, true)
+         .description("Only keep fragments with (1) or without (0) waveform, default is -1 (keep all)")
+         .default_value(-1);
+      parser.option("build-detector build-detectors", &fBuildDetectors, true)
+         .description("Only build (and write) these detector classes into the analysis events, e.g. TGriffin TGriffinBgo");
 
       parser.option("q quit", &fCloseAfterSort, true).description("Quit after completing the sort").colour(DGREEN);
       parser.option("l no-logo", &fShowLogo, true).description("Inhibit the startup logo").default_value(true).colour(DGREEN);
@@ -346,6 +388,18 @@ void TGRSIOptions::Load(int argc, char** argv)
       parser.option("analysis-size", &fAnalysisWriteQueueSize, true)
          .description("Size of analysis write queue")
          .default_value(1000000);
+      parser.option("histogram-threads", &fHistogramThreads, true)
+         .description("Number of threads filling the fragment and analysis histograms each, with their own copies of the histograms that are merged on writing")
+         .default_value(1);
+      parser.option("roll-file-size", &fRollFileSize, true)
+         .description("Number of bytes after which the output tree files are closed and a new file is started (default is 0 = never)")
+         .default_value(0);
+      parser.option("roll-file-entries", &fRollFileEntries, true)
+         .description("Number of entries after which the output tree files are closed and a new file is started (default is 0 = never)")
+         .default_value(0);
+      parser.option("roll-file-minutes", &fRollFileMinutes, true)
+         .description("Minutes after which the output tree files are closed and a new file is started (default is 0 = never)")
+         .default_value(0.);
 
       parser.option("column-width", &fColumnWidth, true).description("Width of one column of status").default_value(20);
       parser.option("status-width", &fStatusWidth, true)
@@ -22,12 +22,14 @@
 #include "TFragmentChainLoop.h"
 #include "TTerminalLoop.h"
 #include "TUnpackingLoop.h"
+#include "TUnpackedEvent.h"
 #include "TPPG.h"
 #include "TSortingDiagnostics.h"
 #include "TParserLibrary.h"
 
 #include "GRootCommands.h"
 #include "TRunInfo.h"
+#include "TCalibrationTable.h"
 
 #include "TInterpreter.h"
 #include "TGHtmlBrowser.h"
@@ -202,6 +204,7 @@ void TGRSIint::Terminate(Int_t status)
    StoppableThread::SendStop();
    LoopUntilDone();
    StoppableThread::StopAll();
+   TCalibrationTable::WaitForReload();
 
    if(TGRSIOptions::Get()->MakeAnalysisTree()) {
       TSortingDiagnostics::Get()->Print("error");
@@ -450,8 +453,10 @@ void TGRSIint::SetupPipeline()
       (has_input_analysis_tree && (write_analysis_histograms || write_analysis_tree) && !generate_analysis_data);
 
    // Extract the run number and sub run number from whatever we were given
-   int run_number     = 0;
-   int sub_run_number = 0;
+   // (and the index of a rolled over file, which is passed on to the output files)
+   int    run_number     = 0;
+   int    sub_run_number = 0;
+   size_t roll_index     = 0;
    if(read_from_raw) {
       run_number     = fRawFiles[0]->GetRunNumber();
       sub_run_number = fRawFiles[0]->GetSubRunNumber();
@@ -459,10 +464,12 @@ void TGRSIint::SetupPipeline()
       const auto* run_title = gFragment->GetListOfFiles()->At(0)->GetTitle();
       run_number            = GetRunNumber(run_title);
       sub_run_number        = GetSubRunNumber(run_title);
+      roll_index            = GetRollIndex(run_title);
    } else if(read_from_analysis_tree) {
       const auto* run_title = gAnalysis->GetListOfFiles()->At(0)->GetTitle();
       run_number            = GetRunNumber(run_title);
       sub_run_number        = GetSubRunNumber(run_title);
+      roll_index            = GetRollIndex(run_title);
    }
 
    // Choose output file names for the 4 possible output files
@@ -473,6 +480,7 @@ void TGRSIint::SetupPipeline()
       } else {
          output_fragment_tree_filename = Form("fragment%05i_%03i.root", run_number, sub_run_number);
       }
+      output_fragment_tree_filename = RolledFileName(output_fragment_tree_filename, roll_index);
    }
 
    std::string output_fragment_hist_filename = opt->OutputFragmentHistogramFile();
@@ -482,6 +490,7 @@ void TGRSIint::SetupPipeline()
       } else {
          output_fragment_hist_filename = Form("hist_fragment%05i_%03i.root", run_number, sub_run_number);
       }
+      output_fragment_hist_filename = RolledFileName(output_fragment_hist_filename, roll_index);
    }
 
    std::string output_analysis_tree_filename = opt->OutputAnalysisFile();
@@ -499,6 +508,7 @@ void TGRSIint::SetupPipeline()
             output_analysis_tree_filename = Form("analysis%05i_%03i.root", run_number, sub_run_number);
          }
       }
+      output_analysis_tree_filename = RolledFileName(output_analysis_tree_filename, roll_index);
    }
 
    std::string output_analysis_hist_filename = opt->OutputAnalysisHistogramFile();
@@ -508,12 +518,18 @@ void TGRSIint::SetupPipeline()
       } else {
          output_analysis_hist_filename = Form("hist_analysis%05i_%03i.root", run_number, sub_run_number);
       }
+      output_analysis_hist_filename = RolledFileName(output_analysis_hist_filename, roll_index);
    }
 
    if(read_from_analysis_tree) {
       std::cerr << "Reading from analysis tree not currently supported" << std::endl;
    }
 
+   if(opt->UseRnTuple() && opt->RollOutputFiles()) {
+      std::cerr << DRED << "Error, rolling over output files is not supported for RNTuple output!" << RESET_COLOR << std::endl;
+      exit(1);
+   }
+
    ////////////////////////////////////////////////////
    ////////////  Setting up the loops  ////////////////
    ////////////////////////////////////////////////////
@@ -636,6 +652,17 @@ void TGRSIint::SetupPipeline()
       }
       fragmentQueues.push_back(eventBuildingLoop->InputQueue());
 
+      // declare the detector classes asked for on the command line, the consumers of the events (analysis
+      // histograms and tree) declare what they need when they are created below, see TUnpackedEvent
+      for(const auto& name : opt->BuildDetectors()) {
+         TClass* cls = TClass::GetClass(name.c_str());
+         if(cls == nullptr || !cls->InheritsFrom(TDetector::Class())) {
+            std::cerr << DRED << "Error, can't build unknown detector class \"" << name << "\"" << RESET_COLOR << std::endl;
+            exit(1);
+         }
+         TUnpackedEvent::BuildDetector(cls);
+      }
+
       detBuildingLoop               = TDetBuildingLoop::Get("6_det_build_loop");
       detBuildingLoop->InputQueue() = eventBuildingLoop->OutputQueue();
    }
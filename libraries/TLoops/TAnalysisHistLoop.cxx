@@ -26,11 +26,14 @@ TAnalysisHistLoop::TAnalysisHistLoop(std::string name)
    : StoppableThread(std::move(name)), fOutputFile(nullptr), fOutputFilename("last.root"),
      fInputQueue(std::make_shared<ThreadsafeQueue<std::shared_ptr<TUnpackedEvent>>>())
 {
+   fCompiledHistograms.SetNumberOfShards(TGRSIOptions::Get()->HistogramThreads());
    LoadLibrary(TGRSIOptions::Get()->AnalysisHistogramLib());
+   fCompiledHistograms.DeclareDetectors();
 }
 
 TAnalysisHistLoop::~TAnalysisHistLoop()
 {
+   fWorkers.Stop();
    CloseFile();
 }
 
@@ -50,19 +53,32 @@ bool TAnalysisHistLoop::Iteration()
    if(event) {
       if(fOutputFile == nullptr) {
          OpenFile();
+         StartWorkers();
       }
 
-      fCompiledHistograms.Fill(event);
+      fCompiledHistograms.Fill(event, 0);
       IncrementItemsPopped();
       return true;
    }
    if(fInputQueue->IsFinished()) {
+      fWorkers.Join();
       return false;
    }
    std::this_thread::sleep_for(std::chrono::milliseconds(1000));
    return true;
 }
 
+void TAnalysisHistLoop::StartWorkers()
+{
+   /// Starts the additional threads filling the histograms, this thread fills shard 0.
+   fWorkers.Start(fCompiledHistograms.GetNumberOfShards(), fInputQueue,
+                  [this](std::shared_ptr<TUnpackedEvent>& event, size_t shard) {
+                     fCompiledHistograms.Fill(event, shard);
+                     IncrementItemsPopped();
+                  },
+                  [this]() { return IsPaused(); });
+}
+
 void TAnalysisHistLoop::ClearHistograms()
 {
    fCompiledHistograms.ClearHistograms();
@@ -120,6 +136,7 @@ std::string TAnalysisHistLoop::GetLibraryName() const
 
 TList* TAnalysisHistLoop::GetObjects()
 {
+   fCompiledHistograms.Merge();
    return fCompiledHistograms.GetObjects();
 }
 
@@ -19,6 +19,7 @@
 #include "TChannel.h"
 #include "TRunInfo.h"
 #include "TGRSIOptions.h"
+#include "TGRSIUtilities.h"
 #include "TTreeFillMutex.h"
 #include "TSortingDiagnostics.h"
 
@@ -41,22 +42,85 @@ TAnalysisWriteLoop* TAnalysisWriteLoop::Get(std::string name, std::string output
 
 TAnalysisWriteLoop::TAnalysisWriteLoop(std::string name, const std::string& outputFilename)
    : StoppableThread(std::move(name)),
-     fOutputFile(TFile::Open(outputFilename.c_str(), "recreate")),
+     fOutputFilename(outputFilename),
      fInputQueue(std::make_shared<ThreadsafeQueue<std::shared_ptr<TUnpackedEvent>>>()),
      fOutOfOrderQueue(std::make_shared<ThreadsafeQueue<std::shared_ptr<const TFragment>>>())
 {
+   if(TGRSIOptions::Get()->SeparateOutOfOrder()) {
+      fOutOfOrderFrag = new TFragment;
+      fOutOfOrder     = true;
+   }
+   // the analysis tree gets the detector classes given by --build-detector, or all of them
+   for(const auto& name : TGRSIOptions::Get()->BuildDetectors()) {
+      TClass* cls = TClass::GetClass(name.c_str());
+      if(cls != nullptr) {
+         fWriteDetectors.insert(cls);
+      }
+   }
+   if(fWriteDetectors.empty()) {
+      TUnpackedEvent::BuildAllDetectors();
+   }
+   OpenOutputFile();
+}
+
+void TAnalysisWriteLoop::OpenOutputFile()
+{
+   /// Opens the current output file (the file name depends on how many times we've rolled over) and creates the trees in it.
+   /// Any branches that were already added to the previous file are re-created.
+   TThread::Lock();
+
+   std::string fileName = RolledFileName(fOutputFilename, fFileIndex);
+   fOutputFile          = TFile::Open(fileName.c_str(), "recreate");
    if(fOutputFile == nullptr || !fOutputFile->IsOpen()) {
-      std::cerr << "Failed to open '" << outputFilename << "'" << std::endl;
+      TThread::UnLock();
+      std::cerr << "Failed to open '" << fileName << "'" << std::endl;
       throw;
    }
 
    fEventTree = new TTree("AnalysisTree", "AnalysisTree");
-   if(TGRSIOptions::Get()->SeparateOutOfOrder()) {
+   for(auto& elem : fDetMap) {
+      fEventTree->Branch(elem.first->GetName(), elem.first->GetName(), elem.second);
+   }
+   if(fOutOfOrder) {
       fOutOfOrderTree = new TTree("OutOfOrderTree", "OutOfOrderTree");
-      fOutOfOrderFrag = new TFragment;
       fOutOfOrderTree->Branch("Fragment", &fOutOfOrderFrag);
-      fOutOfOrder = true;
    }
+
+   fFileStartTime = std::chrono::steady_clock::now();
+
+   TThread::UnLock();
+}
+
+bool TAnalysisWriteLoop::ShouldRollOver() const
+{
+   /// Checks whether any of the limits for the current output file has been reached.
+   if(fOutputFile == nullptr) {
+      return false;
+   }
+   auto* options = TGRSIOptions::Get();
+   if(options->RollFileEntries() > 0 && static_cast<size_t>(fEventTree->GetEntries()) >= options->RollFileEntries()) {
+      return true;
+   }
+   if(options->RollFileSize() > 0 && static_cast<size_t>(fOutputFile->GetEND()) >= options->RollFileSize()) {
+      return true;
+   }
+   if(options->RollFileMinutes() > 0.) {
+      std::chrono::duration<double, std::ratio<60>> elapsed = std::chrono::steady_clock::now() - fFileStartTime;
+      if(elapsed.count() >= options->RollFileMinutes()) {
+         return true;
+      }
+   }
+   return false;
+}
+
+void TAnalysisWriteLoop::RollOver()
+{
+   /// Finishes the current output file and starts the next one.
+   std::cout << "\r" << Name() << ": closing " << fOutputFile->GetName() << " after " << fEventTree->GetEntries() << " events" << std::endl;
+   // like at the end of the sort, the file is written without holding the global lock, so the other loops aren't blocked
+   WriteFile(true);
+   ++fFileIndex;
+   OpenOutputFile();
 }
 
 TAnalysisWriteLoop::~TAnalysisWriteLoop()
@@ -111,6 +175,9 @@ bool TAnalysisWriteLoop::Iteration()
 
    if(event != nullptr) {
       WriteEvent(event);
+      if(ShouldRollOver()) {
+         RollOver();
+      }
       return true;
    }
 
@@ -119,18 +186,39 @@ bool TAnalysisWriteLoop::Iteration()
 
 void TAnalysisWriteLoop::Write()
 {
+   WriteFile(false);
+}
+
+void TAnalysisWriteLoop::WriteFile(bool rollOver)
+{
+   /// Writes and closes the current output file. When rolling over, the event building is still running, so instead of
+   /// the PPG and the diagnostics themselves we write copies of them, and the channels are written as they are, without
+   /// applying calibrations reloaded during the sort (those end up in the last file).
    if(fOutputFile != nullptr) {
       gROOT->cd();
-      auto* options = TGRSIOptions::Get();
-      auto* ppg     = TPPG::Get();
-      auto* diag    = TSortingDiagnostics::Get();
+      TGRSIOptions*        options = TGRSIOptions::Get();
+      TPPG*                ppg     = TPPG::Get();
+      TSortingDiagnostics* diag    = TSortingDiagnostics::Get();
+
+      TPPG                ppgSnapshot;
+      TSortingDiagnostics diagSnapshot;
+      if(rollOver) {
+         ppg->Copy(ppgSnapshot);
+         diag->Copy(diagSnapshot);
+         ppg  = &ppgSnapshot;
+         diag = &diagSnapshot;
+      }
 
       fOutputFile->cd();
       if(GValue::Size() != 0) {
          GValue::Get()->Write("Values", TObject::kOverwrite);
       }
       if(TChannel::GetNumberOfChannels() != 0) {
-         TChannel::WriteToRoot();
+         if(rollOver) {
+            TChannel::WriteSnapshot(fOutputFile);
+         } else {
+            TChannel::WriteToRoot();
+         }
       }
       TRunInfo::WriteToRoot(fOutputFile);
       TGRSIOptions::AnalysisOptions()->WriteToFile(fOutputFile);
@@ -142,7 +230,10 @@ void TAnalysisWriteLoop::Write()
 
       fOutputFile->Write();
       delete fOutputFile;
-      fOutputFile = nullptr;
+      // deleting the file also deleted the trees in it
+      fOutputFile     = nullptr;
+      fEventTree      = nullptr;
+      fOutOfOrderTree = nullptr;
    }
 }
 
@@ -203,6 +294,10 @@ void TAnalysisWriteLoop::WriteEvent(std::shared_ptr<TUnpackedEvent>& event)
       // Load current events
       for(const auto& det : event->GetDetectors()) {
          TClass* cls = det->IsA();
+         // other consumers might have asked for more detector classes than we write
+         if(!fWriteDetectors.empty() && fWriteDetectors.count(cls) == 0) {
+            continue;
+         }
          // attempt to copy this detector into the detector map
          // if that fails (because the detector isn't in the map yet), create the branch and then copy this detector
          try {
@@ -44,7 +44,18 @@ void TCompiledHistograms::ClearHistograms()
 {
    std::lock_guard<std::mutex> lock(fMutex);
 
-   TIter    next(&fObjects);
+   ResetHistograms(&fObjects);
+   for(auto& shard : fShards) {
+      std::lock_guard<std::mutex> shardLock(shard->fMutex);
+      ResetHistograms(&shard->fObjects);
+   }
+   std::cout << "ended " << std::endl;
+}
+
+void TCompiledHistograms::ResetHistograms(TList* list)
+{
+   /// Resets all histograms in the list and in the directories in it.
+   TIter    next(list);
    TObject* obj = nullptr;
    while((obj = next()) != nullptr) {
       if(obj->InheritsFrom(TH1::Class())) {
@@ -62,7 +73,6 @@ void TCompiledHistograms::ClearHistograms()
          }
       }
    }
-   std::cout << "ended " << std::endl;
 }
 
 time_t TCompiledHistograms::get_timestamp()
@@ -80,6 +90,7 @@ bool TCompiledHistograms::file_exists()
 
 Int_t TCompiledHistograms::Write(const char*, Int_t, Int_t)
 {
+   Merge();
    fObjects.Sort();
 
    TIter    next(&fObjects);
@@ -113,6 +124,22 @@ void TCompiledHistograms::Load(const std::string& libName, const std::string& fu
    swap_lib(other);
 }
 
+void TCompiledHistograms::DeclareDetectors()
+{
+   /// Declares the detector classes the library needs to TUnpackedEvent, by calling its DeclareDetectors function.
+   /// A library without that function might use any detector, so all of them are declared. Only the library loaded
+   /// at the start of the sort is asked, later reloads can't change which detectors are built.
+   void (*declare)() = nullptr;
+   if(fLibrary) {
+      *reinterpret_cast<void_alias*>(&declare) = fLibrary->GetSymbol("DeclareDetectors");
+   }
+   if(declare == nullptr) {
+      TUnpackedEvent::BuildAllDetectors();
+      return;
+   }
+   declare();
+}
+
 void TCompiledHistograms::Reload()
 {
    if(file_exists() && get_timestamp() > fLastModified) {
@@ -173,6 +200,166 @@ void TCompiledHistograms::Fill(std::shared_ptr<TUnpackedEvent> detectors)
    fObj.SetDetectors(nullptr);
 }
 
+bool TCompiledHistograms::GetFunction(std::shared_ptr<DynamicLibrary>& library, void (*&func)(TRuntimeObjects&))
+{
+   /// Gets the current library and function, reloading the library if it has changed. The library stays loaded
+   /// as long as the caller holds on to it, even if another thread reloads it in the meantime.
+   std::lock_guard<std::mutex> lock(fMutex);
+   if(time(nullptr) > fLastChecked + fCheckEvery) {
+      Reload();
+   }
+
+   if(!fLibrary || (fFunc == nullptr) || (fDefaultDirectory == nullptr)) {
+      return false;
+   }
+
+   library = fLibrary;
+   func    = fFunc;
+   return true;
+}
+
+void TCompiledHistograms::Fill(std::shared_ptr<const TFragment> frag, size_t shard)
+{
+   /// Fills the histograms of the shard with the fragment. Can be called from different threads at the same time,
+   /// as long as each thread uses its own shard. Without shards this is the same as Fill(frag).
+   if(fShards.empty()) {
+      Fill(std::move(frag));
+      return;
+   }
+
+   std::shared_ptr<DynamicLibrary> library;
+   void (*func)(TRuntimeObjects&) = nullptr;
+   if(!GetFunction(library, func)) {
+      return;
+   }
+
+   {
+      TShard&                     current = *fShards.at(shard);
+      std::lock_guard<std::mutex> lock(current.fMutex);
+      TPreserveGDirectory         preserve;
+      current.fObj.SetDirectory(fDefaultDirectory);
+
+      current.fObj.SetFragment(std::move(frag));
+      func(current.fObj);
+      current.fObj.SetFragment(nullptr);
+   }
+
+   MergeIfDue(shard);
+}
+
+void TCompiledHistograms::Fill(std::shared_ptr<TUnpackedEvent> detectors, size_t shard)
+{
+   /// Fills the histograms of the shard with the event. Can be called from different threads at the same time,
+   /// as long as each thread uses its own shard. Without shards this is the same as Fill(detectors).
+   if(fShards.empty()) {
+      Fill(std::move(detectors));
+      return;
+   }
+
+   std::shared_ptr<DynamicLibrary> library;
+   void (*func)(TRuntimeObjects&) = nullptr;
+   if(!GetFunction(library, func)) {
+      return;
+   }
+
+   {
+      TShard&                     current = *fShards.at(shard);
+      std::lock_guard<std::mutex> lock(current.fMutex);
+      TPreserveGDirectory         preserve;
+      current.fObj.SetDirectory(fDefaultDirectory);
+
+      current.fObj.SetDetectors(std::move(detectors));
+      func(current.fObj);
+      current.fObj.SetDetectors(nullptr);
+   }
+
+   MergeIfDue(shard);
+}
+
+void TCompiledHistograms::SetNumberOfShards(size_t shards)
+{
+   /// Sets the number of threads filling the histograms. For more than one, each thread fills its own shard of
+   /// the histograms, which are merged into fObjects. Has to be called before filling starts.
+   fShards.clear();
+   if(shards < 2) {
+      return;
+   }
+   // the shards create histograms and directories from different threads
+   ROOT::EnableThreadSafety();
+   for(size_t i = 0; i < shards; ++i) {
+      fShards.emplace_back(new TShard(&fGates, fCutFiles));
+   }
+   fLastMerged = time(nullptr);
+}
+
+size_t TCompiledHistograms::GetNumberOfShards() const
+{
+   return fShards.size();
+}
+
+void TCompiledHistograms::MergeIfDue(size_t shard)
+{
+   /// Merges the shards every fMergeEvery seconds, so online snapshots of fObjects stay up-to-date. Only done
+   /// by the thread filling shard 0.
+   if(shard == 0 && time(nullptr) > fLastMerged + fMergeEvery) {
+      Merge();
+   }
+}
+
+void TCompiledHistograms::Merge()
+{
+   /// Adds the histograms the shards filled since the last merge to the histograms in fObjects and resets them.
+   /// Histograms that only exist in a shard so far are copied to fObjects.
+   std::lock_guard<std::mutex> lock(fMutex);
+   TPreserveGDirectory         preserve;
+   for(auto& shard : fShards) {
+      std::lock_guard<std::mutex> shardLock(shard->fMutex);
+      TIter                       next(&shard->fObjects);
+      TObject*                    obj = nullptr;
+      while((obj = next()) != nullptr) {
+         if(obj->InheritsFrom(TDirectory::Class())) {
+            auto* dir    = static_cast<TDirectory*>(obj);
+            auto* merged = static_cast<TDirectory*>(fObjects.FindObject(dir->GetName()));
+            if(merged == nullptr) {
+               merged = new TDirectory(dir->GetName(), dir->GetTitle());
+               fObjects.Add(merged);
+            }
+            TIter    dirNext(dir->GetList());
+            TObject* dirObj = nullptr;
+            while((dirObj = dirNext()) != nullptr) {
+               MergeObject(dirObj, merged->GetList(), merged);
+            }
+         } else {
+            MergeObject(obj, &fObjects, nullptr);
+         }
+      }
+   }
+   fLastMerged = time(nullptr);
+}
+
+void TCompiledHistograms::MergeObject(TObject* obj, TList* list, TDirectory* dir)
+{
+   /// Adds the histogram obj to the histogram of the same name in list (or copies it to the list if there is none)
+   /// and resets it. Objects that aren't histograms are left alone.
+   if(!obj->InheritsFrom(TH1::Class())) {
+      return;
+   }
+   auto* hist   = static_cast<TH1*>(obj);
+   auto* merged = static_cast<TH1*>(list->FindObject(hist->GetName()));
+   if(merged == nullptr) {
+      merged = static_cast<TH1*>(hist->Clone());
+      if(dir != nullptr) {
+         merged->SetDirectory(dir);
+      } else {
+         merged->SetDirectory(nullptr);
+         list->Add(merged);
+      }
+   } else if(hist->GetEntries() != 0) {
+      merged->Add(hist);
+   }
+   hist->Reset();
+}
+
 void TCompiledHistograms::AddCutFile(TFile* cut_file)
 {
    if(cut_file != nullptr) {
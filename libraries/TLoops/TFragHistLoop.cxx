@@ -26,11 +26,13 @@ TFragHistLoop::TFragHistLoop(std::string name)
    : StoppableThread(std::move(name)), fOutputFile(nullptr), fOutputFilename("last.root"),
      fInputQueue(std::make_shared<ThreadsafeQueue<std::shared_ptr<const TFragment>>>())
 {
+   fCompiledHistograms.SetNumberOfShards(TGRSIOptions::Get()->HistogramThreads());
    LoadLibrary(TGRSIOptions::Get()->FragmentHistogramLib());
 }
 
 TFragHistLoop::~TFragHistLoop()
 {
+   fWorkers.Stop();
    CloseFile();
 }
 
@@ -50,19 +52,32 @@ bool TFragHistLoop::Iteration()
    if(event) {
       if(fOutputFile == nullptr) {
          OpenFile();
+         StartWorkers();
       }
 
-      fCompiledHistograms.Fill(event);
+      fCompiledHistograms.Fill(event, 0);
       IncrementItemsPopped();
       return true;
    }
    if(fInputQueue->IsFinished()) {
+      fWorkers.Join();
       return false;
    }
    std::this_thread::sleep_for(std::chrono::milliseconds(1000));
    return true;
 }
 
+void TFragHistLoop::StartWorkers()
+{
+   /// Starts the additional threads filling the histograms, this thread fills shard 0.
+   fWorkers.Start(fCompiledHistograms.GetNumberOfShards(), fInputQueue,
+                  [this](std::shared_ptr<const TFragment>& event, size_t shard) {
+                     fCompiledHistograms.Fill(event, shard);
+                     IncrementItemsPopped();
+                  },
+                  [this]() { return IsPaused(); });
+}
+
 void TFragHistLoop::ClearHistograms()
 {
    fCompiledHistograms.ClearHistograms();
@@ -120,6 +135,7 @@ std::string TFragHistLoop::GetLibraryName() const
 
 TList* TFragHistLoop::GetObjects()
 {
+   fCompiledHistograms.Merge();
    return fCompiledHistograms.GetObjects();
 }
 
@@ -13,13 +13,14 @@
 #include "TChannel.h"
 #include "TRunInfo.h"
 #include "TGRSIOptions.h"
+#include "TGRSIUtilities.h"
 #include "TTreeFillMutex.h"
 #include "TParsingDiagnostics.h"
 
 #include "TBadFragment.h"
 #include "TScalerQueue.h"
 
-TFragWriteLoop* TFragWriteLoop::Get(std::string name, std::string fOutputFilename)
+TFragWriteLoop* TFragWriteLoop::Get(std::string name, std::string outputFilename)
 {
    if(name.length() == 0) {
       name = "write_loop";
@@ -27,42 +28,85 @@ TFragWriteLoop* TFragWriteLoop::Get(std::string name, std::string fOutputFilenam
 
    auto* loop = static_cast<TFragWriteLoop*>(StoppableThread::Get(name));
    if(loop == nullptr) {
-      if(fOutputFilename.length() == 0) {
-         fOutputFilename = "temp.root";
+      if(outputFilename.length() == 0) {
+         outputFilename = "temp.root";
       }
-      loop = new TFragWriteLoop(name, fOutputFilename);
+      loop = new TFragWriteLoop(name, outputFilename);
    }
    return loop;
 }
 
-TFragWriteLoop::TFragWriteLoop(std::string name, const std::string& fOutputFilename)
-   : StoppableThread(std::move(name)), fOutputFile(nullptr), fEventTree(nullptr), fBadEventTree(nullptr), fScalerTree(nullptr),
+TFragWriteLoop::TFragWriteLoop(std::string name, const std::string& outputFilename)
+   : StoppableThread(std::move(name)), fOutputFilename(outputFilename), fOutputFile(nullptr), fEventTree(nullptr), fBadEventTree(nullptr), fScalerTree(nullptr),
+     fEventAddress(new TFragment), fBadEventAddress(new TBadFragment), fScalerAddress(nullptr),
      fInputQueue(std::make_shared<ThreadsafeQueue<std::shared_ptr<const TFragment>>>()),
      fBadInputQueue(std::make_shared<ThreadsafeQueue<std::shared_ptr<const TBadFragment>>>()),
      fScalerInputQueue(std::make_shared<ThreadsafeQueue<std::shared_ptr<TEpicsFrag>>>())
 {
-   if(fOutputFilename != "/dev/null") {
-      TThread::Lock();
+   OpenOutputFile();
+}
 
-      fOutputFile = new TFile(fOutputFilename.c_str(), "RECREATE");
-      if(fOutputFile == nullptr || !fOutputFile->IsOpen()) {
-         throw std::runtime_error(Form("Failed to open \"%s\"\n", fOutputFilename.c_str()));
-      }
+void TFragWriteLoop::OpenOutputFile()
+{
+   /// Opens the current output file (the file name depends on how many times we've rolled over) and creates all trees in it.
+   if(fOutputFilename == "/dev/null") {
+      return;
+   }
 
-      fEventTree    = new TTree("FragmentTree", "FragmentTree");
-      fEventAddress = new TFragment;
-      fEventTree->Branch("TFragment", &fEventAddress);
+   TThread::Lock();
 
-      fBadEventTree    = new TTree("BadFragmentTree", "BadFragmentTree");
-      fBadEventAddress = new TBadFragment;
-      fBadEventTree->Branch("TBadFragment", &fBadEventAddress);
+   std::string fileName = RolledFileName(fOutputFilename, fFileIndex);
+   fOutputFile          = new TFile(fileName.c_str(), "RECREATE");
+   if(fOutputFile == nullptr || !fOutputFile->IsOpen()) {
+      TThread::UnLock();
+      throw std::runtime_error(Form("Failed to open \"%s\"\n", fileName.c_str()));
+   }
 
-      fScalerTree    = new TTree("EpicsTree", "EpicsTree");
-      fScalerAddress = nullptr;
-      fScalerTree->Branch("TEpicsFrag", &fScalerAddress);
+   fEventTree = new TTree("FragmentTree", "FragmentTree");
+   fEventTree->Branch("TFragment", &fEventAddress);
 
-      TThread::UnLock();
+   fBadEventTree = new TTree("BadFragmentTree", "BadFragmentTree");
+   fBadEventTree->Branch("TBadFragment", &fBadEventAddress);
+
+   fScalerTree    = new TTree("EpicsTree", "EpicsTree");
+   fScalerAddress = nullptr;
+   fScalerTree->Branch("TEpicsFrag", &fScalerAddress);
+
+   fFileStartTime = std::chrono::steady_clock::now();
+
+   TThread::UnLock();
+}
+
+bool TFragWriteLoop::ShouldRollOver() const
+{
+   /// Checks whether any of the limits for the current output file has been reached.
+   if(fOutputFile == nullptr) {
+      return false;
+   }
+   auto* options = TGRSIOptions::Get();
+   if(options->RollFileEntries() > 0 && static_cast<size_t>(fEventTree->GetEntries()) >= options->RollFileEntries()) {
+      return true;
    }
+   if(options->RollFileSize() > 0 && static_cast<size_t>(fOutputFile->GetEND()) >= options->RollFileSize()) {
+      return true;
+   }
+   if(options->RollFileMinutes() > 0.) {
+      std::chrono::duration<double, std::ratio<60>> elapsed = std::chrono::steady_clock::now() - fFileStartTime;
+      if(elapsed.count() >= options->RollFileMinutes()) {
+         return true;
+      }
+   }
+   return false;
+}
+
+void TFragWriteLoop::RollOver()
+{
+   /// Finishes the current output file and starts the next one.
+   std::cout << "\r" << Name() << ": closing " << fOutputFile->GetName() << " after " << fEventTree->GetEntries() << " fragments" << std::endl;
+   // like at the end of the sort, the file is written without holding the global lock, so the other loops aren't blocked
+   WriteFile(true);
+   ++fFileIndex;
+   OpenOutputFile();
 }
 
 TFragWriteLoop::~TFragWriteLoop()
@@ -83,8 +127,11 @@ std::string TFragWriteLoop::EndStatus()
    std::ostringstream str;
    str << std::endl
        << Name() << ": " << std::setw(8) << ItemsPopped() << "/" << ItemsPopped() + InputSize() << ", "
-       << fEventTree->GetEntries() << " good fragments, " << fBadEventTree->GetEntries() << " bad fragments"
-       << std::endl;
+       << fGoodFragmentsWritten << " good fragments, " << fBadFragmentsWritten << " bad fragments";
+   if(fFileIndex > 0) {
+      str << " in " << fFileIndex + 1 << " files";
+   }
+   str << std::endl;
    return str.str();
 }
 
@@ -118,6 +165,10 @@ bool TFragWriteLoop::Iteration()
       WriteScaler(scaler);
    }
 
+   if(hasAnything && ShouldRollOver()) {
+      RollOver();
+   }
+
    if(hasAnything) {
       return true;
    }
@@ -130,6 +181,14 @@ bool TFragWriteLoop::Iteration()
 
 void TFragWriteLoop::Write()
 {
+   WriteFile(false);
+}
+
+void TFragWriteLoop::WriteFile(bool rollOver)
+{
+   /// Writes and closes the current output file. When rolling over, the parser is still running, so instead of the
+   /// PPG and the diagnostics themselves we write copies of them, and the channels are written as they are, without
+   /// applying calibrations reloaded during the sort (those end up in the last file).
    if(fOutputFile != nullptr) {
       // get all singletons before switching to the output file
       gROOT->cd();
@@ -138,6 +197,15 @@ void TFragWriteLoop::Write()
       TParsingDiagnostics* parsingDiagnostics = TParsingDiagnostics::Get();
       GValue*              gValues            = GValue::Get();
 
+      TPPG                ppgSnapshot;
+      TParsingDiagnostics diagnosticsSnapshot;
+      if(rollOver) {
+         ppg->Copy(ppgSnapshot);
+         parsingDiagnostics->Copy(diagnosticsSnapshot);
+         ppg                = &ppgSnapshot;
+         parsingDiagnostics = &diagnosticsSnapshot;
+      }
+
       fOutputFile->cd();
       fEventTree->Write(fEventTree->GetName(), TObject::kOverwrite);
       fBadEventTree->Write(fBadEventTree->GetName(), TObject::kOverwrite);
@@ -147,7 +215,11 @@ void TFragWriteLoop::Write()
       }
 
       if(TChannel::GetNumberOfChannels() != 0) {
-         TChannel::WriteToRoot();
+         if(rollOver) {
+            TChannel::WriteSnapshot(fOutputFile);
+         } else {
+            TChannel::WriteToRoot();
+         }
       }
 
       TRunInfo::WriteToRoot(fOutputFile);
@@ -160,7 +232,6 @@ void TFragWriteLoop::Write()
       }
 
       if(!options->IgnoreScaler()) {
-         std::cout << "Starting to write dead time scalers" << std::endl;
          auto* deadtimeQueue = TDeadtimeScalerQueue::Get();
          auto* scalerTree    = new TTree("DeadtimeScaler", "DeadtimeScaler");
          auto* scalerData    = new TScalerData;
@@ -171,7 +242,6 @@ void TFragWriteLoop::Write()
          }
          scalerTree->Write();
 
-         std::cout << "Starting to write rate scalers" << std::endl;
          auto* rateQueue = TRateScalerQueue::Get();
          scalerTree      = new TTree("RateScaler", "RateScaler");
          scalerData      = new TScalerData;
@@ -181,11 +251,15 @@ void TFragWriteLoop::Write()
             scalerTree->Fill();
          }
          scalerTree->Write();
-         std::cout << "Done writing scaler trees" << std::endl;
       }
 
       fOutputFile->Close();
       fOutputFile->Delete();
+      // closing the file also deleted the trees in it
+      fOutputFile   = nullptr;
+      fEventTree    = nullptr;
+      fBadEventTree = nullptr;
+      fScalerTree   = nullptr;
       gROOT->cd();
    }
 }
@@ -197,6 +271,7 @@ void TFragWriteLoop::WriteEvent(const std::shared_ptr<const TFragment>& event)
       fEventAddress->ClearTransients();
       std::lock_guard<std::mutex> lock(ttree_fill_mutex);
       fEventTree->Fill();
+      ++fGoodFragmentsWritten;
       // fEventAddress = nullptr;
    } else {
       std::cout << __PRETTY_FUNCTION__ << ": no fragment tree!" << std::endl;   // NOLINT(cppcoreguidelines-pro-type-const-cast, cppcoreguidelines-pro-bounds-array-to-pointer-decay)
@@ -209,6 +284,7 @@ void TFragWriteLoop::WriteBadEvent(const std::shared_ptr<const TBadFragment>& ev
       *fBadEventAddress = *static_cast<const TBadFragment*>(event.get());
       std::lock_guard<std::mutex> lock(ttree_fill_mutex);
       fBadEventTree->Fill();
+      ++fBadFragmentsWritten;
    }
 }
 
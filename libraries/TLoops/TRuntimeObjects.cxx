@@ -1,6 +1,7 @@
 #include "TRuntimeObjects.h"
 
 #include <iostream>
+#include <iterator>
 #include <utility>
 
 #include "TClass.h"
@@ -10,13 +11,45 @@
 #include "TH2.h"
 #include "TDirectoryFile.h"
 #include "TProfile.h"
+#include "TROOT.h"
 
 #include "TH1D.h"
 #include "TH2D.h"
 
 #include "GValue.h"
 
-std::map<std::string, TRuntimeObjects*> TRuntimeObjects::fRuntimeMap;
+std::map<std::string, TRuntimeObjects*>      TRuntimeObjects::fRuntimeMap;
+std::vector<TRuntimeObjects::TDeclaration> TRuntimeObjects::fDeclarations;
+std::mutex                                 TRuntimeObjects::fDeclarationMutex;
+std::mutex                                 TRuntimeObjects::fCutMutex;
+
+namespace {
+void AppendBinning(std::string& key, const TRuntimeObjects::TBinning& binning)
+{
+   /// Appends the bytes of the binning to key (field by field, so there are no padding bytes).
+   auto append = [&key](const auto& val) { key.append(reinterpret_cast<const char*>(&val), sizeof(val)); };   // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+   key.append(1, '\0');
+   append(binning.fXBins);
+   append(binning.fXLow);
+   append(binning.fXHigh);
+   append(binning.fYBins);
+   append(binning.fYLow);
+   append(binning.fYHigh);
+}
+
+bool SameBinning(const TH1* hist, const TRuntimeObjects::TBinning& binning)
+{
+   const TAxis* xAxis = hist->GetXaxis();
+   if(xAxis->GetNbins() != binning.fXBins || xAxis->GetXmin() != binning.fXLow || xAxis->GetXmax() != binning.fXHigh) {
+      return false;
+   }
+   if(binning.fYBins <= 0) {
+      return hist->GetDimension() == 1;
+   }
+   const TAxis* yAxis = hist->GetYaxis();
+   return hist->GetDimension() == 2 && yAxis->GetNbins() == binning.fYBins && yAxis->GetXmin() == binning.fYLow && yAxis->GetXmax() == binning.fYHigh;
+}
+}   // namespace
 
 TRuntimeObjects::TRuntimeObjects(std::shared_ptr<const TFragment> frag, TList* objects, TList* gates,
                                  std::vector<TFile*>& cut_files, TDirectory* directory, const char* name)
@@ -24,6 +57,7 @@ TRuntimeObjects::TRuntimeObjects(std::shared_ptr<const TFragment> frag, TList* o
 {
    SetName(name);
    fRuntimeMap.insert(std::make_pair(name, this));
+   gROOT->GetListOfCleanups()->Add(this);
 }
 
 TRuntimeObjects::TRuntimeObjects(TList* objects, TList* gates, std::vector<TFile*>& cut_files, TDirectory* directory,
@@ -32,6 +66,42 @@ TRuntimeObjects::TRuntimeObjects(TList* objects, TList* gates, std::vector<TFile
 {
    SetName(name);
    fRuntimeMap.insert(std::make_pair(name, this));
+   gROOT->GetListOfCleanups()->Add(this);
+}
+
+TRuntimeObjects::~TRuntimeObjects()
+{
+   gROOT->GetListOfCleanups()->Remove(this);
+   auto iter = fRuntimeMap.find(GetName());
+   if(iter != fRuntimeMap.end() && iter->second == this) {
+      fRuntimeMap.erase(iter);
+   }
+}
+
+void TRuntimeObjects::RecursiveRemove(TObject* obj)
+{
+   /// Drops a histogram or directory that is being deleted from the registry and the handles.
+   if(fCached.erase(obj) == 0) {
+      return;
+   }
+   for(auto iter = fRegistry.begin(); iter != fRegistry.end();) {
+      iter = (iter->second.fObject == obj || iter->second.fDirectory == obj) ? fRegistry.erase(iter) : std::next(iter);
+   }
+   for(auto iter = fDirectories.begin(); iter != fDirectories.end();) {
+      iter = (iter->second == obj) ? fDirectories.erase(iter) : std::next(iter);
+   }
+   for(auto& handles : fHandles) {
+      for(auto& hist : handles) {
+         if(hist == obj) {
+            hist = nullptr;
+         }
+      }
+   }
+   for(auto& handles : fSparseHandles) {
+      for(auto iter = handles.begin(); iter != handles.end();) {
+         iter = (iter->second == obj) ? handles.erase(iter) : std::next(iter);
+      }
+   }
 }
 
 TH1* TRuntimeObjects::FillHistogram(const char* name, int bins, double low, double high, double value, double weight)
@@ -61,13 +131,14 @@ TH2* TRuntimeObjects::FillHistogramSym(const char* name, int Xbins, double Xlow,
 //-------------------------------------------------------------------------
 TDirectory* TRuntimeObjects::FillHistogram(const char* dirname, const char* name, int bins, double low, double high, double value, double weight)
 {
-   TDirectory* dir = FindDirectory(dirname);
-
-   auto* hist = static_cast<TH1*>(dir->FindObject(name));
+   TDirectory* dir  = nullptr;
+   auto*       hist = static_cast<TH1*>(FindHistogram(dirname, name, TBinning{bins, low, high}, TH1D::Class(), dir));
    if(hist == nullptr) {
+      if(dir == nullptr) {
+         return nullptr;
+      }
       hist = new TH1D(name, name, bins, low, high);
-      hist->SetDirectory(dir);
-      dir->Add(hist);
+      AddHistogram(dir, hist);
    }
 
    if(!std::isnan(value)) {
@@ -80,12 +151,14 @@ TDirectory* TRuntimeObjects::FillHistogram(const char* dirname, const char* name
                                            double Xvalue, int Ybins, double Ylow, double Yhigh, double Yvalue,
                                            double weight)
 {
-   TDirectory* dir  = FindDirectory(dirname);
-   auto*       hist = static_cast<TH2*>(dir->FindObject(name));
+   TDirectory* dir  = nullptr;
+   auto*       hist = static_cast<TH2*>(FindHistogram(dirname, name, TBinning{Xbins, Xlow, Xhigh, Ybins, Ylow, Yhigh}, TH2D::Class(), dir));
    if(hist == nullptr) {
+      if(dir == nullptr) {
+         return nullptr;
+      }
       hist = new TH2D(name, name, Xbins, Xlow, Xhigh, Ybins, Ylow, Yhigh);
-      hist->SetDirectory(dir);
-      dir->Add(hist);
+      AddHistogram(dir, hist);
    }
 
    if(!std::isnan(Xvalue) && !std::isnan(Yvalue)) {
@@ -98,12 +171,14 @@ TDirectory* TRuntimeObjects::FillProfileHist(const char* dirname, const char* na
                                              double Xhigh, double Xvalue, double Yvalue)
 {
 
-   TDirectory* dir  = FindDirectory(dirname);
-   auto*       prof = static_cast<TProfile*>(dir->FindObject(name));
+   TDirectory* dir  = nullptr;
+   auto*       prof = static_cast<TProfile*>(FindHistogram(dirname, name, TBinning{Xbins, Xlow, Xhigh}, TProfile::Class(), dir));
    if(prof == nullptr) {
+      if(dir == nullptr) {
+         return nullptr;
+      }
       prof = new TProfile(name, name, Xbins, Xlow, Xhigh);
-      prof->SetDirectory(dir);
-      dir->Add(prof);
+      AddHistogram(dir, prof);
    }
 
    if(!(std::isnan(Xvalue))) {
@@ -118,12 +193,14 @@ TDirectory* TRuntimeObjects::FillHistogramSym(const char* dirname, const char* n
                                               double Xhigh, double Xvalue, int Ybins, double Ylow, double Yhigh,
                                               double Yvalue)
 {
-   TDirectory* dir  = FindDirectory(dirname);
-   auto*       hist = static_cast<TH2*>(dir->FindObject(name));
+   TDirectory* dir  = nullptr;
+   auto*       hist = static_cast<TH2*>(FindHistogram(dirname, name, TBinning{Xbins, Xlow, Xhigh, Ybins, Ylow, Yhigh}, TH2D::Class(), dir));
    if(hist == nullptr) {
+      if(dir == nullptr) {
+         return nullptr;
+      }
       hist = new TH2D(name, name, Xbins, Xlow, Xhigh, Ybins, Ylow, Yhigh);
-      hist->SetDirectory(dir);
-      dir->Add(hist);
+      AddHistogram(dir, hist);
    }
    if(!(std::isnan(Xvalue))) {
       if(!(std::isnan(Yvalue))) {
@@ -145,18 +222,32 @@ TList& TRuntimeObjects::GetGates()
    return *fGates;
 }
 
-TCutG* TRuntimeObjects::GetCut(const std::string& name)
+GCutG* TRuntimeObjects::GetCut(const std::string& name)
 {
+   /// Returns the cut name from the first cut file that has it, or nullptr if none has it. Each cut is only read
+   /// once, later calls return the same GCutG. Cuts that weren't found are looked up again once cut files are added.
+   if(fCutFiles != fCut_files.size()) {
+      for(auto iter = fCuts.begin(); iter != fCuts.end();) {
+         iter = iter->second ? std::next(iter) : fCuts.erase(iter);
+      }
+      fCutFiles = fCut_files.size();
+   }
+   auto iter = fCuts.find(name);
+   if(iter != fCuts.end()) {
+      return iter->second.get();
+   }
+
+   // the cut files are shared by all shards of TCompiledHistograms
+   std::unique_ptr<GCutG>      cut;
+   std::lock_guard<std::mutex> lock(fCutMutex);
    for(auto& tfile : fCut_files) {
-      TObject* obj = tfile->Get(name.c_str());
+      auto* obj = dynamic_cast<TCutG*>(tfile->Get(name.c_str()));
       if(obj != nullptr) {
-         auto* cut = static_cast<TCutG*>(obj);
-         if(cut != nullptr) {
-            return cut;
-         }
+         cut = std::make_unique<GCutG>(*obj);
+         break;
       }
    }
-   return nullptr;
+   return fCuts.emplace(name, std::move(cut)).first->second.get();
 }
 
 double TRuntimeObjects::GetVariable(const char* name) const
@@ -166,10 +257,122 @@ double TRuntimeObjects::GetVariable(const char* name) const
 
 TDirectory* TRuntimeObjects::FindDirectory(const char* dirname)
 {
+   auto iter = fDirectories.find(dirname);
+   if(iter != fDirectories.end()) {
+      return iter->second;
+   }
    auto* dir = static_cast<TDirectory*>(GetObjects().FindObject(dirname));
    if(dir == nullptr) {
       dir = new TDirectory(dirname, dirname);
       GetObjects().Add(dir);
    }
+   dir->SetBit(kMustCleanup);
+   fDirectories.emplace(dirname, dir);
+   fCached.insert(dir);
    return dir;
 }
+
+TObject* TRuntimeObjects::FindHistogram(const char* dirname, const char* name, const TBinning& binning, TClass* cls, TDirectory*& dir)
+{
+   /// Returns the histogram name with this binning and type in directory dirname from the registry, or nullptr if it doesn't exist yet.
+   /// Histograms that are in the directory but not in the registry yet (e.g. added by someone else) are added to the registry.
+   /// dir is set to the directory, and fKey to the key of the histogram, so AddHistogram can be called right after this.
+   /// If the histogram exists with a different binning or type, an error is printed (once) and both the histogram and dir are nullptr.
+   fKey.assign(dirname).append(1, '/').append(name);
+   AppendBinning(fKey, binning);
+   auto iter = fRegistry.find(fKey);
+   if(iter != fRegistry.end()) {
+      dir = iter->second.fDirectory;
+      return iter->second.fObject;
+   }
+
+   dir          = FindDirectory(dirname);
+   TObject* obj = dir->FindObject(name);
+   if(obj != nullptr) {
+      auto* hist = dynamic_cast<TH1*>(obj);
+      if(obj->IsA() != cls || hist == nullptr || !SameBinning(hist, binning)) {
+         Error("FindHistogram", "%s/%s already exists as %s with a different binning or type than requested (%s), not filling it", dirname, name, obj->ClassName(), cls->GetName());
+         dir = nullptr;
+         fRegistry.emplace(fKey, TRegistryEntry{nullptr, nullptr});
+         return nullptr;
+      }
+      obj->SetBit(kMustCleanup);
+      fRegistry.emplace(fKey, TRegistryEntry{dir, obj});
+      fCached.insert(obj);
+   }
+   return obj;
+}
+
+void TRuntimeObjects::AddHistogram(TDirectory* dir, TH1* hist)
+{
+   /// Adds the new histogram to the directory and the registry, using the key of the last call of FindHistogram.
+   hist->SetDirectory(dir);
+   dir->Add(hist);
+   hist->SetBit(kMustCleanup);
+   fRegistry.emplace(fKey, TRegistryEntry{dir, hist});
+   fCached.insert(hist);
+}
+
+size_t TRuntimeObjects::Declare(const char* dirname, const char* name, const TBinning& binning, TClass* cls, TCreate create, bool family)
+{
+   std::lock_guard<std::mutex> lock(fDeclarationMutex);
+   // declaring the same histogram twice returns the same handle, a different binning or type is a different
+   // declaration (and an error when it is filled, see FindHistogram)
+   for(size_t i = 0; i < fDeclarations.size(); ++i) {
+      const auto& declaration = fDeclarations[i];
+      if(declaration.fDirectory == dirname && declaration.fName == name && declaration.fFamily == family && declaration.fClass == cls &&
+         declaration.fBinning.fXBins == binning.fXBins && declaration.fBinning.fXLow == binning.fXLow && declaration.fBinning.fXHigh == binning.fXHigh &&
+         declaration.fBinning.fYBins == binning.fYBins && declaration.fBinning.fYLow == binning.fYLow && declaration.fBinning.fYHigh == binning.fYHigh) {
+         return i;
+      }
+   }
+   fDeclarations.push_back(TDeclaration{dirname, name, binning, cls, create, family});
+   return fDeclarations.size() - 1;
+}
+
+TH1* TRuntimeObjects::GetHandle(size_t id, unsigned int index)
+{
+   /// Returns the histogram of the declaration id and index. On the first call for them the histogram is found
+   /// (or created) and stored in fHandles/fSparseHandles.
+   if(index < kMaxDenseIndex) {
+      if(id < fHandles.size() && index < fHandles[id].size() && fHandles[id][index] != nullptr) {
+         return fHandles[id][index];
+      }
+   } else if(id < fSparseHandles.size()) {
+      auto iter = fSparseHandles[id].find(index);
+      if(iter != fSparseHandles[id].end()) {
+         return iter->second;
+      }
+   }
+
+   TDeclaration declaration;
+   {
+      std::lock_guard<std::mutex> lock(fDeclarationMutex);
+      declaration = fDeclarations.at(id);
+   }
+   std::string name = declaration.fFamily ? Form(declaration.fName.c_str(), index) : declaration.fName;
+
+   TDirectory* dir  = nullptr;
+   auto*       hist = static_cast<TH1*>(FindHistogram(declaration.fDirectory.c_str(), name.c_str(), declaration.fBinning, declaration.fClass, dir));
+   if(hist == nullptr) {
+      if(dir == nullptr) {
+         return nullptr;
+      }
+      hist = declaration.fCreate(name.c_str(), declaration.fBinning);
+      AddHistogram(dir, hist);
+   }
+
+   if(id >= fHandles.size()) {
+      fHandles.resize(id + 1);
+      fSparseHandles.resize(id + 1);
+   }
+   if(index < kMaxDenseIndex) {
+      if(index >= fHandles[id].size()) {
+         fHandles[id].resize(index + 1, nullptr);
+      }
+      fHandles[id][index] = hist;
+   } else {
+      fSparseHandles[id][index] = hist;
+   }
+   return hist;
+}
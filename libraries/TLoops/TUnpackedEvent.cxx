@@ -4,6 +4,10 @@
 #include "TDetector.h"
 #include "TChannel.h"
 #include "TSortingDiagnostics.h"
+#include "TDither.h"
+
+std::unordered_set<TClass*> TUnpackedEvent::fBuildDetectors;
+bool                        TUnpackedEvent::fBuildAllDetectors = false;
 
 TUnpackedEvent::TUnpackedEvent() = default;
 
@@ -25,6 +29,13 @@ void TUnpackedEvent::Build()
          continue;
       }
 
+      // skip detector classes none of the consumers needs, so they are neither built nor written
+      if(!IsBuilt(detClass)) {
+         continue;
+      }
+
+      // any dithering while adding the fragment is keyed on its entry number and address, independent of the thread building this event
+      TDither::TScope ditherScope(frag->GetEntryNumber(), frag->GetAddress());
       GetDetector(detClass, true)->AddFragment(frag, channel);
    }
 
@@ -44,8 +55,16 @@ void TUnpackedEvent::ClearRawData()
 
 void TUnpackedEvent::BuildHits()
 {
+   // the hits are calibrated right after they are built, so all consumers of this event (which might run in
+   // parallel) only read the hits, instead of each setting the energy, time, and channel on first access
+   if(fFragments.empty()) {
+      return;
+   }
+   // dithering while building and calibrating the hits is keyed on the first fragment of the event
+   TDither::TScope ditherScope(fFragments.front()->GetEntryNumber(), fFragments.front()->GetAddress());
    for(const auto& det : fDetectors) {
       det->BuildHits();
+      det->Calibrate();
    }
 }
 
@@ -7,6 +7,7 @@
 
 #include "TGRSIOptions.h"
 #include "TParserLibrary.h"
+#include "TDither.h"
 
 TUnpackingLoop* TUnpackingLoop::Get(std::string name)
 {
@@ -67,6 +68,8 @@ bool TUnpackingLoop::Iteration()
    InputSize(error);   //"error" is the return value of popping an event from the input queue (which returns the number of events left)
    IncrementItemsPopped();
 
+   // any dithering while parsing is keyed on the number of the raw event, independent of the other threads of the sort
+   TDither::TScope ditherScope(static_cast<Long64_t>(ItemsPopped()), 0);
    fFragsReadFromRaw += fParser->Process(event);
    fGoodFragsRead += event->GoodFrags();
 
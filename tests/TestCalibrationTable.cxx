@@ -0,0 +1,149 @@
+// Checks the TCalibrationTable against the TChannels it is built from: the lookup of the channels with the dense
+// and the sorted index, the energy calibration compared to TChannel::CalibrateENG, and that the batch calibration
+// (TCalibrationTable::Calibrate) gives bit-identical energies and times to calibrating each hit on its own.
+
+#include <iostream>
+#include <vector>
+
+#include "TRandom3.h"
+
+#include "TChannel.h"
+#include "TCalibrationTable.h"
+#include "TDetectorHit.h"
+
+constexpr UInt_t kFirstAddress = 0x10;
+constexpr int    kChannels     = 16;
+constexpr UInt_t kFarAddress   = kFirstAddress + (1 << 21);   ///< too far from the others for the dense index
+
+TChannel* AddChannel(UInt_t address)
+{
+   auto* channel = new TChannel(Form("TEST%06x", address));
+   channel->SetAddress(address);
+   TChannel::AddChannel(channel);
+   return channel;
+}
+
+int CheckLookup(const std::vector<UInt_t>& addresses, bool dense)
+{
+   int         failures = 0;
+   const auto& table    = TCalibrationTable::Get();
+   if(table.Dense() != dense) {
+      std::cerr << "expected a " << (dense ? "dense" : "sorted") << " index for " << addresses.size() << " channels" << std::endl;
+      ++failures;
+   }
+   for(auto address : addresses) {
+      const auto* cal = table.Find(address);
+      if(cal == nullptr || cal->fAddress != address) {
+         std::cerr << std::hex << "didn't find channel 0x" << address << std::dec << (dense ? " (dense)" : " (sorted)") << std::endl;
+         ++failures;
+      }
+   }
+   for(auto address : {0U, kFirstAddress - 1, kFirstAddress + kChannels, kFarAddress - 1, kFarAddress + 1}) {
+      if(table.Find(address) != nullptr) {
+         std::cerr << std::hex << "found non-existing channel 0x" << address << std::dec << (dense ? " (dense)" : " (sorted)") << std::endl;
+         ++failures;
+      }
+   }
+   return failures;
+}
+
+int main()
+{
+   int failures = 0;
+
+   // a mix of calibrations: linear and quadratic polynomials, overlapping ranges, drift corrections,
+   // nonlinearities, and integrations from the cal-file
+   TRandom3               random(4321);
+   std::vector<UInt_t>    addresses;
+   std::vector<TChannel*> channels;
+   for(int i = 0; i < kChannels; ++i) {
+      UInt_t address = kFirstAddress + i;
+      auto*  channel = AddChannel(address);
+      addresses.push_back(address);
+      channels.push_back(channel);
+      if(i % 4 == 3) {
+         continue;   // no calibration
+      }
+      channel->AddENGCoefficient(static_cast<Float_t>(random.Uniform(-2., 2.)));
+      channel->AddENGCoefficient(static_cast<Float_t>(random.Uniform(0.9, 1.1)));
+      if(i % 2 == 0) {
+         channel->AddENGCoefficient(static_cast<Float_t>(random.Uniform(-1e-6, 1e-6)));
+      }
+      if(i % 4 == 1) {
+         channel->AddENGCoefficient(static_cast<Float_t>(random.Uniform(-5., 5.)), 1);
+         channel->AddENGCoefficient(static_cast<Float_t>(random.Uniform(0.9, 1.1)), 1);
+         channel->SetENGRange(std::make_pair(0., 6000.), 0);
+         channel->SetENGRange(std::make_pair(5000., 20000.), 1);
+      }
+      if(i % 3 == 0) {
+         channel->AddENGDriftCoefficent(static_cast<Float_t>(random.Uniform(-1., 1.)));
+         channel->AddENGDriftCoefficent(static_cast<Float_t>(random.Uniform(0.99, 1.01)));
+      }
+      if(i % 2 == 1) {
+         for(double energy = 0.; energy <= 10000.; energy += 500.) {
+            channel->AddEnergyNonlinearityPoint(energy, random.Uniform(-2., 2.));
+         }
+      }
+      if(i % 5 == 0) {
+         channel->SetIntegration(TPriorityValue<int>(125, EPriority::kUser));
+         channel->SetUseCalFileIntegration(TPriorityValue<bool>(true, EPriority::kUser));
+      }
+   }
+
+   failures += CheckLookup(addresses, true);
+
+   // the energy calibration of the table is the same as the one of the channel
+   const auto& table = TCalibrationTable::Get();
+   for(size_t c = 0; c < channels.size(); ++c) {
+      const auto* cal = table.Find(addresses[c]);
+      for(int i = 0; i < 1000; ++i) {
+         double charge      = (i == 0) ? 0. : random.Uniform(0., 20000.);
+         int    integration = (i % 3 == 0) ? 0 : static_cast<int>(random.Integer(400)) + 1;
+         double expected    = channels[c]->CalibrateENG(charge, integration);
+         double result      = table.CalibrateEnergy(*cal, charge, integration);
+         if(result != expected) {
+            std::cerr << std::hex << "channel 0x" << addresses[c] << std::dec << ", charge " << charge << ", integration " << integration << ": table " << result << ", channel " << expected << std::endl;
+            ++failures;
+            break;
+         }
+      }
+   }
+
+   // the batch calibration gives the same energies and times as the hits, including hits of unknown channels
+   constexpr size_t      kHits = 10000;
+   std::vector<UInt_t>   address(kHits);
+   std::vector<Float_t>  charge(kHits);
+   std::vector<Short_t>  kValue(kHits);
+   std::vector<Long64_t> timeStamp(kHits);
+   std::vector<Float_t>  cfd(kHits);
+   for(size_t i = 0; i < kHits; ++i) {
+      address[i]   = kFirstAddress + random.Integer(kChannels + 2);
+      kValue[i]    = static_cast<Short_t>((i % 2 == 0) ? 0 : 100 + random.Integer(300));
+      charge[i]    = (i % 100 == 0) ? 0.F : static_cast<Float_t>(random.Uniform(0., kValue[i] > 0 ? 2e6 : 15000.));   // within the energy ranges after dividing by the integration
+      timeStamp[i] = static_cast<Long64_t>(random.Uniform(0., 1e12));
+      cfd[i]       = static_cast<Float_t>(random.Uniform(0., 16.));
+   }
+   std::vector<double> energy(kHits);
+   std::vector<double> time(kHits);
+   table.Calibrate(kHits, address.data(), charge.data(), kValue.data(), timeStamp.data(), cfd.data(), energy.data(), time.data());
+   for(size_t i = 0; i < kHits; ++i) {
+      TDetectorHit hit(static_cast<int>(address[i]));
+      hit.SetCharge(charge[i]);
+      hit.SetKValue(kValue[i]);
+      hit.SetTimeStamp(timeStamp[i]);
+      hit.SetCfd(cfd[i]);
+      if(hit.GetEnergy() != energy[i] || hit.GetTime() != time[i]) {
+         std::cerr << "hit " << i << std::hex << " of channel 0x" << address[i] << std::dec << ": batch energy " << energy[i] << ", time " << time[i]
+                   << ", single hit energy " << hit.GetEnergy() << ", time " << hit.GetTime() << std::endl;
+         ++failures;
+         break;
+      }
+   }
+
+   // a channel far away from the others switches the table to the sorted index
+   AddChannel(kFarAddress);
+   addresses.push_back(kFarAddress);
+   failures += CheckLookup(addresses, false);
+
+   return failures == 0 ? 0 : 1;
+}
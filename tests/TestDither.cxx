@@ -0,0 +1,85 @@
+// Checks the Philox4x32-10 generator of TDither against the known-answer vectors of the reference implementation (Random123),
+// and that the dithering inside a TDither::TScope only depends on entry number, address, and draw, not on the thread.
+
+#include <array>
+#include <cstdint>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "TDither.h"
+
+int main()
+{
+   int failures = 0;
+
+   auto check = [&failures](std::array<uint32_t, 4> counter, std::array<uint32_t, 2> key, std::array<uint32_t, 4> expected) {
+      auto result = TDither::Philox4x32(counter, key);
+      if(result != expected) {
+         std::cerr << std::hex << "Philox4x32-10 of " << counter[0] << " " << counter[1] << " " << counter[2] << " " << counter[3]
+                   << ": got " << result[0] << " " << result[1] << " " << result[2] << " " << result[3]
+                   << ", expected " << expected[0] << " " << expected[1] << " " << expected[2] << " " << expected[3] << std::dec << std::endl;
+         ++failures;
+      }
+   };
+
+   check({0x00000000, 0x00000000, 0x00000000, 0x00000000}, {0x00000000, 0x00000000}, {0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8});
+   check({0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff}, {0xffffffff, 0xffffffff}, {0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd});
+   check({0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}, {0xa4093822, 0x299f31d0}, {0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1});
+
+   // the same entries dithered in one thread and spread over several threads (in a different order) give the same numbers
+   constexpr int kEntries = 1000;
+   constexpr int kDraws   = 3;
+   constexpr int kThreads = 4;
+
+   auto dither = [](std::vector<double>& numbers, int entry) {
+      TDither::TScope scope(entry, 0x1234);
+      for(int draw = 0; draw < kDraws; ++draw) {
+         numbers[entry * kDraws + draw] = TDither::Uniform(EDither::kCharge);
+      }
+   };
+
+   std::vector<double> sequential(kEntries * kDraws);
+   for(int entry = 0; entry < kEntries; ++entry) {
+      dither(sequential, entry);
+   }
+
+   std::vector<double>      parallel(kEntries * kDraws);
+   std::vector<std::thread> threads;
+   for(int thread = 0; thread < kThreads; ++thread) {
+      threads.emplace_back([&parallel, &dither, thread]() {
+         for(int entry = kEntries - 1 - thread; entry >= 0; entry -= kThreads) {
+            dither(parallel, entry);
+         }
+      });
+   }
+   for(auto& thread : threads) {
+      thread.join();
+   }
+
+   if(sequential != parallel) {
+      std::cerr << "dithering within a scope depends on the thread" << std::endl;
+      ++failures;
+   }
+   for(double number : sequential) {
+      if(number < 0. || number >= 1.) {
+         std::cerr << "dithering gave " << number << ", outside of [0, 1)" << std::endl;
+         ++failures;
+         break;
+      }
+   }
+
+   // the keyed numbers are the same as the scoped ones with the same entry, address, and draw
+   if(TDither::Uniform(17, 0x1234, EDither::kCharge, 2) != sequential[17 * kDraws + 2]) {
+      std::cerr << "keyed and scoped dithering differ" << std::endl;
+      ++failures;
+   }
+
+   TDither::SetEnabled(false);
+   if(TDither::Uniform(17, 0x1234, EDither::kCharge, 2) != 0.) {
+      std::cerr << "disabled dithering isn't 0" << std::endl;
+      ++failures;
+   }
+
+   return failures == 0 ? 0 : 1;
+}
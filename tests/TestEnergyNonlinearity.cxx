@@ -0,0 +1,103 @@
+// Checks the energy nonlinearity of the TCalibrationTable (linear segments on a uniform grid) against TGraph::Eval,
+// which TChannel::GetEnergyNonlinearity uses: at and right next to the points of the graph, within the segments,
+// and outside the range covered by the graph (where both are zero). Inside the range the two may only differ
+// by the rounding bound documented at TCalibrationTable::EnergyNonlinearity.
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include "TRandom3.h"
+
+#include "TChannel.h"
+#include "TCalibrationTable.h"
+
+struct TPoint {
+   double fX;
+   double fY;
+};
+
+double Bound(const std::vector<TPoint>& points, double energy)
+{
+   /// Rounding bound of the difference to TGraph::Eval, twice the documented one to leave some headroom,
+   /// taking the larger bound of the two segments next to a point.
+   double bound = 0.;
+   for(size_t i = 0; i + 1 < points.size(); ++i) {
+      const auto& low  = points[i];
+      const auto& high = points[i + 1];
+      if(energy < low.fX || high.fX < energy) {
+         continue;
+      }
+      bound = std::max(bound, 8. * std::numeric_limits<double>::epsilon() * (std::abs(energy) + std::abs(low.fX) + std::abs(high.fX)) * std::max(std::abs(low.fY), std::abs(high.fY)) / (high.fX - low.fX));
+   }
+   return bound;
+}
+
+int Check(UInt_t address, const std::vector<TPoint>& points, const std::vector<double>& energies)
+{
+   int         failures = 0;
+   const auto* channel  = TChannel::GetChannel(address, false);
+   const auto& table    = TCalibrationTable::Get();
+   const auto* cal      = table.Find(address);
+   for(double energy : energies) {
+      double expected = channel->GetEnergyNonlinearity(energy);
+      double result   = table.EnergyNonlinearity(*cal, energy);
+      bool   inside   = points.front().fX <= energy && energy <= points.back().fX;
+      if((inside && std::abs(result - expected) > Bound(points, energy)) || (!inside && (result != 0. || expected != 0.))) {
+         std::cerr << std::hex << "channel 0x" << address << std::dec << ", energy " << energy << ": table " << result << ", TGraph::Eval " << expected
+                   << ", difference " << result - expected << ", bound " << Bound(points, energy) << std::endl;
+         ++failures;
+      }
+   }
+   return failures;
+}
+
+int main()
+{
+   int      failures = 0;
+   TRandom3 random(2468);
+
+   // unevenly spaced points (from sub-keV to a few hundred keV apart) of a nonlinearity of a few keV up to about 10 MeV
+   std::vector<TPoint> points;
+   for(double x = 20.; x < 10000.; x += (points.size() % 10 < 3) ? random.Uniform(0.1, 1.) : random.Uniform(10., 300.)) {
+      points.push_back(TPoint{x, random.Uniform(-3., 3.)});
+   }
+   auto* channel = new TChannel("TEST0001");
+   channel->SetAddress(1);
+   for(const auto& point : points) {
+      channel->AddEnergyNonlinearityPoint(point.fX, point.fY);
+   }
+   TChannel::AddChannel(channel);
+
+   // a graph with a single point only covers that energy
+   std::vector<TPoint> single{{1332.5, 1.25}};
+   auto*               singleChannel = new TChannel("TEST0002");
+   singleChannel->SetAddress(2);
+   singleChannel->AddEnergyNonlinearityPoint(single[0].fX, single[0].fY);
+   TChannel::AddChannel(singleChannel);
+
+   // the points themselves and their neighbours (where the bucket and segment can change), the middle of each segment,
+   // random energies, and energies outside of the graph
+   std::vector<double> energies;
+   for(size_t i = 0; i < points.size(); ++i) {
+      energies.push_back(points[i].fX);
+      energies.push_back(std::nextafter(points[i].fX, -1e9));
+      energies.push_back(std::nextafter(points[i].fX, 1e9));
+      if(i + 1 < points.size()) {
+         energies.push_back((points[i].fX + points[i + 1].fX) / 2.);
+      }
+   }
+   for(int i = 0; i < 100000; ++i) {
+      energies.push_back(random.Uniform(points.front().fX, points.back().fX));
+   }
+   for(double energy : {-100., 0., 19.999, 10500., 1e6}) {
+      energies.push_back(energy);
+   }
+   failures += Check(1, points, energies);
+
+   failures += Check(2, single, {1332.5, std::nextafter(1332.5, 0.), std::nextafter(1332.5, 2000.), 0., 1000., 2000.});
+
+   return failures == 0 ? 0 : 1;
+}
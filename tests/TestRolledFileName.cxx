@@ -0,0 +1,44 @@
+// Checks that the names of rolled over output files can be parsed back into run number, sub-run number, and roll index.
+
+#include <iostream>
+#include <string>
+
+#include "TGRSIUtilities.h"
+
+int main()
+{
+   int failures = 0;
+
+   auto check = [&failures](const std::string& fileName, int runNumber, int subRunNumber, size_t rollIndex) {
+      if(GetRunNumber(fileName) != runNumber || GetSubRunNumber(fileName) != subRunNumber || GetRollIndex(fileName) != rollIndex) {
+         std::cerr << fileName << ": got run " << GetRunNumber(fileName) << ", sub-run " << GetSubRunNumber(fileName) << ", roll index " << GetRollIndex(fileName)
+                   << ", expected " << runNumber << ", " << subRunNumber << ", " << rollIndex << std::endl;
+         ++failures;
+      }
+   };
+
+   for(const std::string fileName : {"fragment12345_000.root", "analysis12345_007.root", "/data/run.2/fragment12345_012.root", "fragment12345-003.root"}) {
+      const int runNumber    = GetRunNumber(fileName);
+      const int subRunNumber = GetSubRunNumber(fileName);
+      check(fileName, runNumber, subRunNumber, 0);
+      for(size_t index = 0; index < 12; ++index) {
+         std::string rolled = RolledFileName(fileName, index);
+         check(rolled, runNumber, subRunNumber, index);
+         if(RemoveRollIndex(rolled) != fileName) {
+            std::cerr << rolled << ": removing the roll index gave " << RemoveRollIndex(rolled) << ", expected " << fileName << std::endl;
+            ++failures;
+         }
+      }
+   }
+
+   check("fragment12345_000.root", 12345, 0, 0);
+   check("fragment12345_000.1.root", 12345, 0, 1);
+   check("/data/run.2/fragment12345_012.10.root", 12345, 12, 10);
+
+   if(RolledFileName("fragment12345_000.root", 3) != "fragment12345_000.3.root") {
+      std::cerr << "unexpected name " << RolledFileName("fragment12345_000.root", 3) << " for the third rolled file" << std::endl;
+      ++failures;
+   }
+
+   return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,93 @@
+// Checks that the vectors cached by TSuppressed are re-used as long as the generations of the detector and BGO don't change,
+// and are re-created once they do, e.g. after ClearTransients or when TTree::GetEntry reads the next entry into the same objects.
+
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "TTree.h"
+
+#include "TSuppressed.h"
+#include "TDetectorHit.h"
+#include "TBgo.h"
+
+class TTestSuppressed : public TSuppressed {
+public:
+   bool SuppressionCriterion(const TDetectorHit* hit, const TDetectorHit* bgoHit) override
+   {
+      ++fCriterionCalls;
+      return std::llabs(hit->GetTimeStamp() - bgoHit->GetTimeStamp()) < 50;
+   }
+
+   void Suppress(const TBgo* bgo, std::vector<TDetectorHit*>& suppressedHits) { CreateSuppressed(bgo, Hits(), suppressedHits); }
+
+   int fCriterionCalls{0};
+};
+
+int main()
+{
+   int failures = 0;
+
+   TTestSuppressed detector;
+   TBgo            bgo;
+   auto*           hit1   = new TDetectorHit;
+   auto*           hit2   = new TDetectorHit;
+   auto*           bgoHit = new TDetectorHit;
+   hit1->SetTimeStamp(100);
+   hit2->SetTimeStamp(500);
+   bgoHit->SetTimeStamp(100);
+   detector.AddHit(hit1);
+   detector.AddHit(hit2);
+   bgo.AddHit(bgoHit);
+
+   std::vector<TDetectorHit*> suppressedHits;
+
+   auto check = [&](const char* step, Long64_t timeStamp) {
+      detector.Suppress(&bgo, suppressedHits);
+      if(suppressedHits.size() != 1 || suppressedHits[0]->GetTimeStamp() != timeStamp) {
+         std::cerr << step << ": got " << suppressedHits.size() << " suppressed hits";
+         if(!suppressedHits.empty()) {
+            std::cerr << ", the first one at " << suppressedHits[0]->GetTimeStamp();
+         }
+         std::cerr << ", expected one at " << timeStamp << std::endl;
+         ++failures;
+      }
+   };
+
+   check("initial hits", 500);
+   int criterionCalls = detector.fCriterionCalls;
+   check("same hits again", 500);
+   if(detector.fCriterionCalls != criterionCalls) {
+      std::cerr << "same hits again: the suppressed hits were re-created" << std::endl;
+      ++failures;
+   }
+
+   // re-fill the BGO hit, the hit at 500 is suppressed now instead of the one at 100
+   bgoHit->SetTimeStamp(500);
+   bgo.ClearTransients();
+   check("re-filled BGO hit", 100);
+
+   // re-fill the first hit, which moves it away from the BGO hit
+   hit1->SetTimeStamp(900);
+   detector.ClearTransients();
+   check("re-filled hit", 900);
+
+   // reading an entry into the same object starts a new generation
+   TTree tree("tree", "tree");
+   tree.SetDirectory(nullptr);
+   TBgo* bgoAddress = &bgo;
+   tree.Branch("TBgo", &bgoAddress);
+   tree.Fill();
+   ULong64_t generation = bgo.Generation();
+   tree.GetEntry(0);
+   if(bgo.Generation() == generation) {
+      std::cerr << "TTree::GetEntry didn't change the generation of the BGO" << std::endl;
+      ++failures;
+   }
+
+   for(auto* hit : suppressedHits) {
+      delete hit;
+   }
+
+   return failures == 0 ? 0 : 1;
+}
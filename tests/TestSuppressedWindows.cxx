@@ -0,0 +1,143 @@
+// Checks that limiting the pairs TSuppressed checks the addback and suppression criteria for (AddbackWindow, SuppressionWindow,
+// AddbackNeighbours, SuppressionNeighbours) gives the same addback and suppressed hits as checking all pairs.
+// The criteria are the usual ones of a clover array: hits in the same detector within a time window.
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "TRandom3.h"
+
+#include "TChannel.h"
+#include "TSuppressed.h"
+#include "TDetectorHit.h"
+#include "TBgo.h"
+
+constexpr double kAddbackWindow     = 300.;
+constexpr double kSuppressionWindow = 200.;
+constexpr int    kDetectors         = 16;
+constexpr UInt_t kBgoAddress        = 0x100;   ///< addresses of the BGO channels start here, the detector is the address minus this
+
+class TAllPairs : public TSuppressed {
+public:
+   bool AddbackCriterion(const TDetectorHit* hit1, const TDetectorHit* hit2) override
+   {
+      return hit1->GetDetector() == hit2->GetDetector() && std::abs(hit1->GetTime() - hit2->GetTime()) < kAddbackWindow;
+   }
+   bool SuppressionCriterion(const TDetectorHit* hit, const TDetectorHit* bgoHit) override
+   {
+      return hit->GetDetector() == bgoHit->GetDetector() && std::abs(hit->GetTime() - bgoHit->GetTime()) < kSuppressionWindow;
+   }
+
+   void Addback(std::vector<TDetectorHit*>& addbacks, std::vector<UShort_t>& nofFragments) { CreateAddback(Hits(), addbacks, nofFragments); }
+   void Suppress(const TBgo* bgo, std::vector<TDetectorHit*>& suppressedHits) { CreateSuppressed(bgo, Hits(), suppressedHits); }
+   void SuppressedAddback(const TBgo* bgo, std::vector<TDetectorHit*>& addbacks, std::vector<UShort_t>& nofFragments) { CreateSuppressedAddback(bgo, Hits(), addbacks, nofFragments); }
+};
+
+class TWindowed : public TAllPairs {
+public:
+   double AddbackWindow() const override { return kAddbackWindow; }
+   double SuppressionWindow() const override { return kSuppressionWindow; }
+   bool   AddbackNeighbours(Int_t detector1, Int_t detector2) const override { return detector1 == detector2; }
+   bool   SuppressionNeighbours(Int_t detector, Int_t bgoDetector) const override { return detector == bgoDetector; }
+};
+
+void AddChannel(UInt_t address, int detector)
+{
+   auto* channel = new TChannel(Form("TEST%03x", address));
+   channel->SetAddress(address);
+   channel->SetDetectorNumber(detector);
+   TChannel::AddChannel(channel);
+}
+
+TDetectorHit* NewHit(UInt_t address, double time)
+{
+   auto* hit = new TDetectorHit(static_cast<int>(address));
+   hit->SetTimeStamp(static_cast<Long64_t>(time));
+   hit->SetTime(time);
+   return hit;
+}
+
+bool Same(const char* step, int event, const std::vector<TDetectorHit*>& expected, const std::vector<TDetectorHit*>& result)
+{
+   bool same = expected.size() == result.size();
+   for(size_t i = 0; same && i < expected.size(); ++i) {
+      same = expected[i]->GetAddress() == result[i]->GetAddress() && expected[i]->GetTime() == result[i]->GetTime();
+   }
+   if(!same) {
+      std::cerr << "event " << event << ", " << step << ": got " << result.size() << " hits, expected " << expected.size() << std::endl;
+   }
+   return same;
+}
+
+void Delete(std::vector<TDetectorHit*>& hits)
+{
+   for(auto* hit : hits) {
+      delete hit;
+   }
+   hits.clear();
+}
+
+int main()
+{
+   int failures = 0;
+
+   for(int detector = 0; detector < kDetectors; ++detector) {
+      AddChannel(detector, detector);
+      AddChannel(kBgoAddress + detector, detector);
+   }
+
+   TRandom3 random(12345);
+   for(int event = 0; event < 1000; ++event) {
+      TAllPairs allPairs;
+      TWindowed windowed;
+      TBgo      bgo;
+      // hits spread over a few addback windows, so some are added back and some aren't
+      int nofHits = static_cast<int>(random.Integer(20));
+      for(int i = 0; i < nofHits; ++i) {
+         UInt_t address = random.Integer(kDetectors);
+         double time    = random.Uniform(0., 2000.);
+         allPairs.AddHit(NewHit(address, time));
+         windowed.AddHit(NewHit(address, time));
+      }
+      int nofBgoHits = static_cast<int>(random.Integer(20));
+      for(int i = 0; i < nofBgoHits; ++i) {
+         bgo.AddHit(NewHit(kBgoAddress + random.Integer(kDetectors), random.Uniform(0., 2000.)));
+      }
+
+      std::vector<TDetectorHit*> expectedAddback;
+      std::vector<TDetectorHit*> addback;
+      std::vector<UShort_t>      expectedFragments;
+      std::vector<UShort_t>      fragments;
+      allPairs.Addback(expectedAddback, expectedFragments);
+      windowed.Addback(addback, fragments);
+      if(!Same("addback", event, expectedAddback, addback) || expectedFragments != fragments) {
+         ++failures;
+      }
+
+      std::vector<TDetectorHit*> expectedSuppressed;
+      std::vector<TDetectorHit*> suppressed;
+      allPairs.Suppress(&bgo, expectedSuppressed);
+      windowed.Suppress(&bgo, suppressed);
+      if(!Same("suppressed", event, expectedSuppressed, suppressed)) {
+         ++failures;
+      }
+
+      std::vector<TDetectorHit*> expectedSuppressedAddback;
+      std::vector<TDetectorHit*> suppressedAddback;
+      std::vector<UShort_t>      expectedSuppressedFragments;
+      std::vector<UShort_t>      suppressedFragments;
+      allPairs.SuppressedAddback(&bgo, expectedSuppressedAddback, expectedSuppressedFragments);
+      windowed.SuppressedAddback(&bgo, suppressedAddback, suppressedFragments);
+      if(!Same("suppressed addback", event, expectedSuppressedAddback, suppressedAddback) || expectedSuppressedFragments != suppressedFragments) {
+         ++failures;
+      }
+
+      for(auto* hits : {&expectedAddback, &addback, &expectedSuppressed, &suppressed, &expectedSuppressedAddback, &suppressedAddback}) {
+         Delete(*hits);
+      }
+      // the detectors delete their hits
+   }
+
+   return failures == 0 ? 0 : 1;
+}